@@ -12,6 +12,7 @@ public enum BoxClientError: Error {
     case remoteRejected(status: BoxCodec.Status, message: String)
     case missingPingResponse
     case invalidAction
+    case inconsistentChunks
 }
 
 extension BoxClientError: LocalizedError {
@@ -31,6 +32,8 @@ extension BoxClientError: LocalizedError {
             return "missing ping response from server"
         case .invalidAction:
             return "client action does not match requested helper"
+        case .inconsistentChunks:
+            return "server sent chunks that do not belong to the same object"
         }
     }
 }
@@ -213,7 +216,8 @@ public enum BoxClient {
                     userId: options.userId,
                     timeout: timeout,
                     pingResult: pingResult,
-                    syncRecords: syncRecords
+                    syncRecords: syncRecords,
+                    serverPublicKey: options.serverPublicKey
                 )
                 completionHolder.withLockedValue { storage in
                     storage = handler.completionFuture
@@ -389,6 +393,12 @@ final class BoxClientHandler: ChannelInboundHandler {
         case waitingForPutAck
         /// Waiting for the GET response (PUT data or STATUS).
         case waitingForGetResponse
+        /// Waiting for the object (or STATUS) answering a cursor `next`.
+        case waitingForCursorObject
+        /// Waiting for the STATUS answering a cursor commit or seek.
+        case waitingForCursorAck
+        /// Waiting for the STATUS acknowledgements of the DELETE batches (`pendingDeletes`, `queuedDeletes`).
+        case waitingForDeleteAcks
         /// Waiting for the locate response (PUT with record or STATUS error).
         case waitingForLocateResponse
         /// Waiting for the remote root to stream synchronisation data.
@@ -417,6 +427,8 @@ final class BoxClientHandler: ChannelInboundHandler {
     private let pingResult: NIOLockedValueBox<String?>?
     /// Optional holder capturing sync records streamed by the server.
     private let syncRecords: NIOLockedValueBox<[BoxClient.SyncRecord]>?
+    /// Node key the server must sign the handshake transcript with, when known.
+    private let serverPublicKey: [UInt8]?
     /// Convenience accessor exposing the future resolved when the client finishes.
     var completionFuture: EventLoopFuture<Void> {
         completionPromise.futureResult
@@ -427,6 +439,33 @@ final class BoxClientHandler: ChannelInboundHandler {
     private let userId: UUID
     /// Internal stage tracker.
     private var stage: Stage = .waitingForHello
+    /// Ephemeral key pair offered in the HELLO key share.
+    private let handshake = BoxSessionHandshake()
+    /// Encrypted session established by the HELLO exchange (nil when the server only speaks cleartext).
+    private var session: BoxSession?
+    /// Set once a HELLO cookie has been echoed; a second challenge aborts the handshake.
+    private var cookieEchoed = false
+    /// Chunks of a large GET or cursor response received so far, keyed by index.
+    private var chunks: (count: UInt32, parts: [UInt32: [UInt8]])?
+    /// DELETE batch sent and not acknowledged yet.
+    private struct PendingDelete {
+        let payload: BoxCodec.DeletePayload
+        var attempts: Int
+        var sentAt: NIODeadline
+    }
+    /// DELETE batches of the action, sent from `nextQueuedDelete` on as the window frees up.
+    private var queuedDeletes: [BoxCodec.DeletePayload] = []
+    private var nextQueuedDelete = 0
+    /// DELETE batches in flight, keyed by the request id the server echoes in its STATUS.
+    private var pendingDeletes: [UUID: PendingDelete] = [:]
+    /// Periodic check resending the DELETE batches left unacknowledged.
+    private var deleteRetransmitTask: RepeatedTask?
+    /// DELETE batches in flight at once: a long list does not flood the server's receive buffer.
+    private static let deleteWindow = 4
+    /// Delay after which an unacknowledged DELETE batch is sent again (under the same request id).
+    private static let deleteRetransmitDelay: TimeAmount = .milliseconds(500)
+    /// Sends of one DELETE batch before the client gives up.
+    private static let deleteMaxAttempts = 5
 
     /// Creates a new client handler.
     /// - Parameters:
@@ -437,6 +476,7 @@ final class BoxClientHandler: ChannelInboundHandler {
     ///   - eventLoop: Event loop owning the handler for promise creation.
     ///   - nodeId: Node identifier propagated over the wire.
     ///   - userId: User identifier propagated over the wire.
+    ///   - serverPublicKey: Node key the server must sign the handshake with, when known.
     init(
         remoteAddress: SocketAddress,
         action: BoxClientAction,
@@ -447,7 +487,8 @@ final class BoxClientHandler: ChannelInboundHandler {
         userId: UUID,
         timeout: TimeAmount?,
         pingResult: NIOLockedValueBox<String?>?,
-        syncRecords: NIOLockedValueBox<[BoxClient.SyncRecord]>?
+        syncRecords: NIOLockedValueBox<[BoxClient.SyncRecord]>?,
+        serverPublicKey: [UInt8]? = nil
     ) {
         self.remoteAddress = remoteAddress
         self.action = action
@@ -459,6 +500,7 @@ final class BoxClientHandler: ChannelInboundHandler {
         self.timeout = timeout
         self.pingResult = pingResult
         self.syncRecords = syncRecords
+        self.serverPublicKey = serverPublicKey
     }
 
     /// Sends the initial HELLO when the channel becomes active.
@@ -483,7 +525,19 @@ final class BoxClientHandler: ChannelInboundHandler {
         }
         var datagram = envelope.data
         do {
-            let frame = try BoxCodec.decodeFrame(from: &datagram)
+            var frame = try BoxCodec.decodeFrame(from: &datagram)
+            if frame.isSealed {
+                guard session != nil else {
+                    logger.debug("Ignoring sealed datagram without session")
+                    return
+                }
+                do {
+                    try session?.open(&frame)
+                } catch {
+                    logger.debug("Dropping sealed datagram", metadata: ["error": "\(error)"])
+                    return
+                }
+            }
             try handle(frame: frame, context: context)
         } catch {
             logger.error("Failed to decode client datagram", metadata: ["error": "\(error)"])
@@ -498,9 +552,11 @@ final class BoxClientHandler: ChannelInboundHandler {
     }
 
     /// Sends a HELLO frame to the remote server.
-    private func sendHello(context: ChannelHandlerContext) {
+    /// - Parameter cookie: Cookie echoed after a `rateLimited` challenge.
+    private func sendHello(context: ChannelHandlerContext, cookie: [UInt8]? = nil) {
         do {
-            let payload = try BoxCodec.encodeHelloPayload(status: .ok, versions: [1], allocator: allocator)
+            let hello = BoxCodec.HelloPayload(status: .ok, supportedVersions: [1], keyShare: handshake.publicKey, cookie: cookie)
+            let payload = try BoxCodec.encodeHelloPayload(hello, allocator: allocator)
             send(
                 frame: BoxCodec.Frame(command: .hello, requestId: nextRequestId(), nodeId: nodeId, userId: userId, payload: payload),
                 context: context
@@ -523,6 +579,12 @@ final class BoxClientHandler: ChannelInboundHandler {
             try handlePutAck(frame: frame, context: context)
         case .waitingForGetResponse:
             try handleGetResponse(frame: frame, context: context)
+        case .waitingForCursorObject:
+            try handleCursorObject(frame: frame, context: context)
+        case .waitingForCursorAck:
+            try handleCursorAck(frame: frame, context: context)
+        case .waitingForDeleteAcks:
+            try handleDeleteAck(frame: frame, context: context)
         case .waitingForLocateResponse:
             try handleLocateResponse(frame: frame, context: context)
         case .waitingForSyncPayloads:
@@ -545,6 +607,37 @@ final class BoxClientHandler: ChannelInboundHandler {
             failAndClose(error: BoxCodecError.unsupportedCommand, context: context)
             return
         }
+        if helloPayload.status == .rateLimited, let cookie = helloPayload.cookie {
+            // The server is shedding handshakes: echo its cookie once to prove our address.
+            guard !cookieEchoed else {
+                failAndClose(error: BoxClientError.remoteRejected(status: .rateLimited, message: "hello-cookie-rejected"), context: context)
+                return
+            }
+            cookieEchoed = true
+            logger.debug("HELLO cookie challenge received, retrying")
+            sendHello(context: context, cookie: cookie)
+            return
+        }
+        if let serverPublicKey {
+            // A known server must prove its identity; a missing share or signature is a downgrade.
+            guard let serverShare = helloPayload.keyShare, let signature = helloPayload.signature else {
+                logger.error("Server did not sign the handshake")
+                failAndClose(error: BoxSessionError.invalidSignature, context: context)
+                return
+            }
+            let transcript = BoxSessionHandshake.transcript(initiatorShare: handshake.publicKey, responderShare: serverShare)
+            do {
+                try BoxSessionHandshake.verify(signature: signature, transcript: transcript, publicKey: serverPublicKey)
+            } catch {
+                logger.error("Server handshake signature does not match its node key")
+                failAndClose(error: error, context: context)
+                return
+            }
+        }
+        if let serverShare = helloPayload.keyShare {
+            session = try handshake.session(peerShare: serverShare, role: .initiator)
+            logger.debug("encrypted session established", metadata: ["verified": "\(serverPublicKey != nil)"])
+        }
 
         let statusPayload = BoxCodec.encodeStatusPayload(status: .ok, message: "ping", allocator: allocator)
         send(
@@ -570,8 +663,17 @@ final class BoxClientHandler: ChannelInboundHandler {
         case .ping:
             pingResult?.withLockedValue { $0 = statusPayload.message }
             succeedAndClose(context: context)
-        case let .put(queuePath, contentType, data):
-            let putPayload = BoxCodec.PutPayload(queuePath: queuePath, contentType: contentType, data: data)
+        case let .put(queuePath, contentType, data, notBefore, priority):
+            // Text-like payloads travel and rest compressed when that actually saves bytes.
+            let compressed = BoxCompression.shouldCompress(contentType: contentType, size: data.count) ? BoxCompression.compress(data) : nil
+            let putPayload = BoxCodec.PutPayload(
+                queuePath: queuePath,
+                contentType: contentType,
+                data: compressed ?? data,
+                notBefore: notBefore,
+                priority: priority,
+                encoding: compressed == nil ? .identity : .lz4
+            )
             let buffer = BoxCodec.encodePutPayload(putPayload, allocator: allocator)
             send(
                 frame: BoxCodec.Frame(command: .put, requestId: nextRequestId(), nodeId: nodeId, userId: userId, payload: buffer),
@@ -579,15 +681,37 @@ final class BoxClientHandler: ChannelInboundHandler {
             )
             stage = .waitingForPutAck
         case let .get(queuePath):
-            let getPayload = BoxCodec.GetPayload(queuePath: queuePath)
+            let getPayload = BoxCodec.GetPayload(queuePath: queuePath, acceptsCompression: true)
             let buffer = BoxCodec.encodeGetPayload(getPayload, allocator: allocator)
             send(
                 frame: BoxCodec.Frame(command: .get, requestId: nextRequestId(), nodeId: nodeId, userId: userId, payload: buffer),
                 context: context
             )
             stage = .waitingForGetResponse
+        case let .cursor(queuePath, cursor, operation):
+            sendCursorRequest(queuePath: queuePath, cursor: BoxCodec.CursorRequest(name: cursor, operation: operation), context: context)
+            switch operation {
+            case .next, .lease:
+                stage = .waitingForCursorObject
+            case .commit, .seek, .ack:
+                stage = .waitingForCursorAck
+            }
+        case let .delete(queuePath, targets):
+            var start = targets.startIndex
+            while start < targets.endIndex {
+                let end = min(start + BoxCodec.maxDeleteTargets, targets.endIndex)
+                queuedDeletes.append(BoxCodec.DeletePayload(queuePath: queuePath, targets: Array(targets[start..<end])))
+                start = end
+            }
+            guard !queuedDeletes.isEmpty else {
+                succeedAndClose(context: context)
+                return
+            }
+            stage = .waitingForDeleteAcks
+            try sendQueuedDeletes(context: context)
+            scheduleDeleteRetransmit(context: context)
         case let .sync(queuePath):
-            let searchPayload = BoxCodec.SearchPayload(queuePath: queuePath)
+            let searchPayload = BoxCodec.SearchPayload(queuePath: queuePath, acceptsCompression: true)
             let buffer = BoxCodec.encodeSearchPayload(searchPayload, allocator: allocator)
             send(
                 frame: BoxCodec.Frame(command: .search, requestId: nextRequestId(), nodeId: nodeId, userId: userId, payload: buffer),
@@ -621,20 +745,206 @@ final class BoxClientHandler: ChannelInboundHandler {
         }
     }
 
+    private func sendCursorRequest(queuePath: String, cursor: BoxCodec.CursorRequest, context: ChannelHandlerContext) {
+        let getPayload = BoxCodec.GetPayload(queuePath: queuePath, cursor: cursor, acceptsCompression: true)
+        let buffer = BoxCodec.encodeGetPayload(getPayload, allocator: allocator)
+        send(
+            frame: BoxCodec.Frame(command: .get, requestId: nextRequestId(), nodeId: nodeId, userId: userId, payload: buffer),
+            context: context
+        )
+    }
+
+    /// Processes the object returned for a cursor `next` or a lease, then commits or acknowledges it.
+    private func handleCursorObject(frame: BoxCodec.Frame, context: ChannelHandlerContext) throws {
+        guard case let .cursor(queuePath, cursor, operation) = action else { return }
+        switch frame.command {
+        case .put:
+            var payload = frame.payload
+            let putPayload = try BoxCodec.decodePutPayload(from: &payload)
+            // Large objects arrive sliced like a plain GET, with the id in every slice.
+            guard let received = reassemble(putPayload, context: context) else { return }
+            let data = try BoxCompression.decode(received, encoding: putPayload.encoding)
+            logger.info(
+                "GET response",
+                metadata: [
+                    "queue": "\(putPayload.queuePath)",
+                    "cursor": "\(cursor)",
+                    "type": "\(putPayload.contentType)",
+                    "bytes": "\(data.count)",
+                    "encoding": "\(putPayload.encoding.name)"
+                ]
+            )
+            guard let objectId = putPayload.objectId else {
+                failAndClose(error: BoxClientError.remoteRejected(status: .internalError, message: "missing-object-id"), context: context)
+                return
+            }
+            let followUp: BoxCodec.CursorOperation
+            if case .lease = operation {
+                followUp = .ack(objectId)
+            } else {
+                followUp = .commit(objectId)
+            }
+            sendCursorRequest(queuePath: queuePath, cursor: BoxCodec.CursorRequest(name: cursor, operation: followUp), context: context)
+            stage = .waitingForCursorAck
+        case .status:
+            try handleCursorAck(frame: frame, context: context)
+        default:
+            logger.warning("Unexpected command while awaiting cursor response", metadata: ["command": "\(frame.command)"])
+        }
+    }
+
+    /// Processes the STATUS answering a cursor commit or seek.
+    private func handleCursorAck(frame: BoxCodec.Frame, context: ChannelHandlerContext) throws {
+        guard frame.command == .status else {
+            logger.warning("Expected STATUS acknowledgement, received \(frame.command)")
+            return
+        }
+        var payload = frame.payload
+        let statusPayload = try BoxCodec.decodeStatusPayload(from: &payload)
+        logger.info("cursor status", metadata: ["status": "\(statusPayload.status)", "message": "\(statusPayload.message)"])
+        if statusPayload.status == .ok {
+            succeedAndClose(context: context)
+        } else {
+            failAndClose(error: BoxClientError.remoteRejected(status: statusPayload.status, message: statusPayload.message), context: context)
+        }
+    }
+
+    /// Processes the STATUS acknowledgement of one DELETE batch, then sends the next queued ones.
+    ///
+    /// `not-found` is not an error for a batch: the objects were already gone (for example, acknowledged twice,
+    /// or removed by a first copy of a batch that was sent again). The acknowledgement of a batch already
+    /// counted is ignored.
+    private func handleDeleteAck(frame: BoxCodec.Frame, context: ChannelHandlerContext) throws {
+        guard frame.command == .status else {
+            logger.warning("Expected STATUS acknowledgement, received \(frame.command)")
+            return
+        }
+        guard pendingDeletes.removeValue(forKey: frame.requestId) != nil else {
+            logger.debug("Duplicate DELETE acknowledgement ignored", metadata: ["requestId": "\(frame.requestId)"])
+            return
+        }
+        var payload = frame.payload
+        let statusPayload = try BoxCodec.decodeStatusPayload(from: &payload)
+        logger.info("DELETE acknowledgement", metadata: ["status": "\(statusPayload.status)", "message": "\(statusPayload.message)"])
+        guard statusPayload.status == .ok || statusPayload.status == .notFound else {
+            failAndClose(error: BoxClientError.remoteRejected(status: statusPayload.status, message: statusPayload.message), context: context)
+            return
+        }
+        try sendQueuedDeletes(context: context)
+        if pendingDeletes.isEmpty {
+            succeedAndClose(context: context)
+        }
+    }
+
+    /// Sends queued DELETE batches until `deleteWindow` of them await their acknowledgement.
+    private func sendQueuedDeletes(context: ChannelHandlerContext) throws {
+        while pendingDeletes.count < Self.deleteWindow, nextQueuedDelete < queuedDeletes.count {
+            let requestId = nextRequestId()
+            pendingDeletes[requestId] = PendingDelete(payload: queuedDeletes[nextQueuedDelete], attempts: 0, sentAt: .now())
+            nextQueuedDelete += 1
+            try sendDelete(requestId: requestId, context: context)
+        }
+    }
+
+    /// Sends (again) the pending DELETE batch `requestId`. A copy the server already applied is harmless:
+    /// its targets are gone and the batch is answered `not-found`.
+    private func sendDelete(requestId: UUID, context: ChannelHandlerContext) throws {
+        guard var pending = pendingDeletes[requestId] else {
+            return
+        }
+        let buffer = try BoxCodec.encodeDeletePayload(pending.payload, allocator: allocator)
+        pending.attempts += 1
+        pending.sentAt = .now()
+        pendingDeletes[requestId] = pending
+        send(
+            frame: BoxCodec.Frame(command: .delete, requestId: requestId, nodeId: nodeId, userId: userId, payload: buffer),
+            context: context
+        )
+    }
+
+    /// Checks the DELETE batches in flight every `deleteRetransmitDelay` (cancelled with the timeout).
+    private func scheduleDeleteRetransmit(context: ChannelHandlerContext) {
+        guard deleteRetransmitTask == nil else {
+            return
+        }
+        deleteRetransmitTask = context.eventLoop.scheduleRepeatedTask(
+            initialDelay: Self.deleteRetransmitDelay,
+            delay: Self.deleteRetransmitDelay
+        ) { [weak self] task in
+            guard let self, let context = self.activeContext else {
+                task.cancel()
+                return
+            }
+            self.retransmitDeletes(context: context)
+        }
+    }
+
+    /// Resends the DELETE batches unacknowledged for `deleteRetransmitDelay`; fails once one of them
+    /// went `deleteMaxAttempts` times without an answer.
+    private func retransmitDeletes(context: ChannelHandlerContext) {
+        let stale = NIODeadline.now() - Self.deleteRetransmitDelay
+        for (requestId, pending) in pendingDeletes where pending.sentAt <= stale {
+            guard stage == .waitingForDeleteAcks else {
+                return
+            }
+            guard pending.attempts < Self.deleteMaxAttempts else {
+                logger.error("DELETE batch unacknowledged", metadata: ["requestId": "\(requestId)", "attempts": "\(pending.attempts)"])
+                failAndClose(error: BoxClientError.timeout(Self.deleteRetransmitDelay * Int64(pending.attempts)), context: context)
+                return
+            }
+            logger.debug("Resending DELETE batch", metadata: ["requestId": "\(requestId)", "attempt": "\(pending.attempts + 1)"])
+            do {
+                try sendDelete(requestId: requestId, context: context)
+            } catch {
+                failAndClose(error: error, context: context)
+                return
+            }
+        }
+    }
+
+    /// Adds one frame of an object reply: returns the whole payload once every slice has arrived, `nil`
+    /// while slices are missing or after failing on inconsistent ones.
+    private func reassemble(_ putPayload: BoxCodec.PutPayload, context: ChannelHandlerContext) -> [UInt8]? {
+        guard let chunk = putPayload.chunk else { return putPayload.data }
+        var pending = chunks ?? (chunk.count, [:])
+        guard pending.count == chunk.count else {
+            failAndClose(error: BoxClientError.inconsistentChunks, context: context)
+            return nil
+        }
+        pending.parts[chunk.index] = putPayload.data
+        guard pending.parts.count == Int(chunk.count) else {
+            // Later chunks follow under the same request; the overall timeout covers lost ones.
+            chunks = pending
+            return nil
+        }
+        chunks = nil
+        return (0..<chunk.count).flatMap { pending.parts[$0] ?? [] }
+    }
+
     /// Processes the response to a GET command (either PUT payload or STATUS error).
     private func handleGetResponse(frame: BoxCodec.Frame, context: ChannelHandlerContext) throws {
         switch frame.command {
         case .put:
             var payload = frame.payload
             let putPayload = try BoxCodec.decodePutPayload(from: &payload)
+            guard let received = reassemble(putPayload, context: context) else { return }
+            let data = try BoxCompression.decode(received, encoding: putPayload.encoding)
             logger.info(
                 "GET response",
                 metadata: [
                     "queue": "\(putPayload.queuePath)",
                     "type": "\(putPayload.contentType)",
-                    "bytes": "\(putPayload.data.count)"
+                    "bytes": "\(data.count)",
+                    "encoding": "\(putPayload.encoding.name)"
                 ]
             )
+            if putPayload.chunk != nil, let objectId = putPayload.objectId {
+                // A sliced pop stays leased on the server until every slice has arrived.
+                let consumer = BoxCodec.CursorRequest.chunkedGetConsumer(for: frame.requestId)
+                sendCursorRequest(queuePath: putPayload.queuePath, cursor: BoxCodec.CursorRequest(name: consumer, operation: .ack(objectId)), context: context)
+                stage = .waitingForCursorAck
+                return
+            }
         case .status:
             var payload = frame.payload
             let statusPayload = try BoxCodec.decodeStatusPayload(from: &payload)
@@ -709,12 +1019,13 @@ final class BoxClientHandler: ChannelInboundHandler {
         case .put:
             var payload = frame.payload
             let putPayload = try BoxCodec.decodePutPayload(from: &payload)
+            let data = try BoxCompression.decode(putPayload.data, encoding: putPayload.encoding)
             syncRecords?.withLockedValue { storage in
                 storage.append(
                     BoxClient.SyncRecord(
                         queuePath: putPayload.queuePath,
                         contentType: putPayload.contentType,
-                        data: putPayload.data
+                        data: data
                     )
                 )
             }
@@ -752,7 +1063,19 @@ final class BoxClientHandler: ChannelInboundHandler {
 
     /// Serialises and sends a frame to the remote endpoint.
     private func send(frame: BoxCodec.Frame, context: ChannelHandlerContext) {
-        let datagram = BoxCodec.encodeFrame(frame, allocator: allocator)
+        let datagram: ByteBuffer
+        if frame.command != .hello, var session {
+            do {
+                datagram = try session.seal(frame, allocator: allocator)
+            } catch {
+                failAndClose(error: error, context: context)
+                return
+            }
+            // Sealing advances the nonce counter of the session.
+            self.session = session
+        } else {
+            datagram = BoxCodec.encodeFrame(frame, allocator: allocator)
+        }
         let envelope = AddressedEnvelope(remoteAddress: remoteAddress, data: datagram)
         context.writeAndFlush(wrapOutboundOut(envelope), promise: nil)
     }
@@ -784,10 +1107,12 @@ final class BoxClientHandler: ChannelInboundHandler {
         context.close(promise: nil)
     }
 
-    /// Cancels the timeout task if it is still pending.
+    /// Cancels the timeout task (and the DELETE retransmissions) if still pending.
     private func cancelTimeout() {
         timeoutTask?.cancel()
         timeoutTask = nil
+        deleteRetransmitTask?.cancel()
+        deleteRetransmitTask = nil
     }
 
     /// Schedules the timeout guard when a timeout value was supplied.
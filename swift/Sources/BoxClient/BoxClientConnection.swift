@@ -0,0 +1,367 @@
+import BoxCore
+import Foundation
+import Logging
+import NIOCore
+import NIOPosix
+
+/// Long-lived encrypted UDP channel to one Box server.
+///
+/// `BoxClient.run` binds a socket, shakes hands and tears everything down for each command, which suits
+/// the CLI. Server-to-server traffic (queue mirroring, SPECS §7.16) keeps one connection per peer
+/// instead: the HELLO exchange runs once, every request is sealed with the same session and sent again
+/// until its answer arrives. A request that runs out of attempts closes the connection; the next call
+/// shakes hands again.
+public actor BoxClientConnection {
+    /// Bound channel with the handler matching answers to requests.
+    private struct Link: @unchecked Sendable {
+        let channel: Channel
+        let handler: BoxConnectionHandler
+
+        func request(_ frame: BoxCodec.Frame) async throws -> BoxCodec.Frame {
+            let handler = self.handler
+            let box = UncheckedSendableBox(frame)
+            let eventLoop = channel.eventLoop
+            let answer = try await eventLoop.flatSubmit { handler.request(box.value, on: eventLoop) }.get()
+            return answer.value
+        }
+    }
+
+    private let group: EventLoopGroup
+    private let address: String
+    private let port: UInt16
+    private let nodeId: UUID
+    private let userId: UUID
+    private let serverPublicKey: [UInt8]?
+    private let helloSigner: @Sendable ([UInt8]) -> [UInt8]?
+    private let retransmitInterval: TimeAmount
+    private let attempts: Int
+    private let logger: Logger
+    private var link: Link?
+    private var connecting: Task<Link, Error>?
+
+    /// Creates a connection; the handshake happens on the first request.
+    /// - Parameters:
+    ///   - group: Event loop group running the channel (shared with the caller).
+    ///   - address: Server address.
+    ///   - port: Server UDP port.
+    ///   - nodeId: Node identifier propagated over the wire.
+    ///   - userId: User identifier propagated over the wire.
+    ///   - serverPublicKey: Node key the server must sign the handshake with, when known.
+    ///   - helloSigner: Signs `BoxSessionHandshake.initiatorTranscript` with the local node key, so the
+    ///     server binds the session to `nodeId`.
+    ///   - retransmitInterval: Delay before a request without answer is sent again.
+    ///   - attempts: Transmissions of one request before the connection fails.
+    ///   - logger: Logger used for diagnostics.
+    public init(
+        group: EventLoopGroup,
+        address: String,
+        port: UInt16,
+        nodeId: UUID,
+        userId: UUID,
+        serverPublicKey: [UInt8]?,
+        helloSigner: @escaping @Sendable ([UInt8]) -> [UInt8]? = { _ in nil },
+        retransmitInterval: TimeAmount = .seconds(1),
+        attempts: Int = 5,
+        logger: Logger
+    ) {
+        self.group = group
+        self.address = address
+        self.port = port
+        self.nodeId = nodeId
+        self.userId = userId
+        self.serverPublicKey = serverPublicKey
+        self.helloSigner = helloSigner
+        self.retransmitInterval = retransmitInterval
+        self.attempts = attempts
+        self.logger = logger
+    }
+
+    /// Stores `data` in `queuePath` and returns the STATUS message of the server.
+    ///
+    /// Text-like payloads travel LZ4-compressed when that saves bytes, as with `BoxClient`. A payload
+    /// larger than `BoxCodec.maxChunkSize` is sent as chunks sharing a transfer identifier (`objectId`),
+    /// each acknowledged before the next one leaves; the answer to the last chunk is the server's reply.
+    /// Servers reassemble chunks for mirror batches only (SPECS §7.16).
+    /// - Throws: `BoxClientError.remoteRejected` when the server answers with another status than `ok`,
+    ///   `BoxClientError.timeout` when it does not answer at all.
+    @discardableResult
+    public func put(queuePath: String, contentType: String, data: [UInt8]) async throws -> String {
+        let link = try await connected()
+        let compressed = BoxCompression.shouldCompress(contentType: contentType, size: data.count) ? BoxCompression.compress(data) : nil
+        let body = compressed ?? data
+        let encoding: BoxCodec.PayloadEncoding = compressed == nil ? .identity : .lz4
+        let count = max(1, (body.count + BoxCodec.maxChunkSize - 1) / BoxCodec.maxChunkSize)
+        let transfer = UUID()
+        var message = ""
+        for index in 0..<count {
+            let payload: BoxCodec.PutPayload
+            if count == 1 {
+                payload = BoxCodec.PutPayload(queuePath: queuePath, contentType: contentType, data: body, encoding: encoding)
+            } else {
+                let start = index * BoxCodec.maxChunkSize
+                payload = BoxCodec.PutPayload(
+                    queuePath: queuePath,
+                    contentType: contentType,
+                    data: Array(body[start..<min(start + BoxCodec.maxChunkSize, body.count)]),
+                    objectId: transfer,
+                    encoding: encoding,
+                    chunk: BoxCodec.ChunkInfo(index: UInt32(index), count: UInt32(count))
+                )
+            }
+            let status = try await send(payload, on: link)
+            guard status.status == .ok else {
+                throw BoxClientError.remoteRejected(status: status.status, message: status.message)
+            }
+            message = status.message
+        }
+        return message
+    }
+
+    /// Closes the channel; a later request opens a new one.
+    public func close() async {
+        connecting?.cancel()
+        guard let link else { return }
+        self.link = nil
+        try? await link.channel.close()
+    }
+
+    private func send(_ payload: BoxCodec.PutPayload, on link: Link) async throws -> BoxCodec.StatusPayload {
+        let frame = BoxCodec.Frame(
+            command: .put,
+            requestId: UUID(),
+            nodeId: nodeId,
+            userId: userId,
+            payload: BoxCodec.encodePutPayload(payload, allocator: link.channel.allocator)
+        )
+        let answer: BoxCodec.Frame
+        do {
+            answer = try await link.request(frame)
+        } catch {
+            // Lost datagrams or a server that dropped our session: start over with a new handshake.
+            await drop(link)
+            throw error
+        }
+        guard answer.command == .status else {
+            throw BoxClientError.remoteRejected(status: .badRequest, message: "unexpected-\(answer.command)")
+        }
+        var buffer = answer.payload
+        return try BoxCodec.decodeStatusPayload(from: &buffer)
+    }
+
+    private func drop(_ dropped: Link) async {
+        guard link?.channel === dropped.channel else { return }
+        link = nil
+        try? await dropped.channel.close()
+    }
+
+    private func connected() async throws -> Link {
+        if let link {
+            return link
+        }
+        if let connecting {
+            return try await connecting.value
+        }
+        let task = Task { try await self.handshake() }
+        connecting = task
+        defer { connecting = nil }
+        let established = try await task.value
+        link = established
+        return established
+    }
+
+    private func handshake() async throws -> Link {
+        let remote: SocketAddress
+        do {
+            remote = try SocketAddress.makeAddressResolvingHost(address, port: Int(port))
+        } catch {
+            throw BoxClientError.invalidAddress(address, port)
+        }
+        let handler = BoxConnectionHandler(remoteAddress: remote, retransmitInterval: retransmitInterval, attempts: attempts, logger: logger)
+        let channel = try await DatagramBootstrap(group: group)
+            .channelInitializer { channel in
+                channel.pipeline.addHandler(handler)
+            }
+            .bind(host: BoxClient.determineBindHost(remoteAddress: remote), port: 0)
+            .get()
+        let link = Link(channel: channel, handler: handler)
+        do {
+            let handshake = BoxSessionHandshake()
+            let signature = helloSigner(BoxSessionHandshake.initiatorTranscript(initiatorShare: handshake.publicKey, node: nodeId))
+            var hello = try await exchangeHello(
+                BoxCodec.HelloPayload(status: .ok, supportedVersions: [1], keyShare: handshake.publicKey, signature: signature),
+                on: link
+            )
+            if hello.status == .rateLimited, let cookie = hello.cookie {
+                hello = try await exchangeHello(
+                    BoxCodec.HelloPayload(status: .ok, supportedVersions: [1], keyShare: handshake.publicKey, signature: signature, cookie: cookie),
+                    on: link
+                )
+            }
+            guard hello.status == .ok, hello.supportedVersions.contains(1) else {
+                throw BoxClientError.remoteRejected(status: hello.status, message: "hello-rejected")
+            }
+            // Nothing travels in cleartext on this channel: a server without a key share is refused.
+            guard let serverShare = hello.keyShare else {
+                throw BoxSessionError.invalidKeyShare
+            }
+            if let serverPublicKey {
+                guard let serverSignature = hello.signature else {
+                    throw BoxSessionError.invalidSignature
+                }
+                let transcript = BoxSessionHandshake.transcript(initiatorShare: handshake.publicKey, responderShare: serverShare)
+                try BoxSessionHandshake.verify(signature: serverSignature, transcript: transcript, publicKey: serverPublicKey)
+            }
+            let session = UncheckedSendableBox(try handshake.session(peerShare: serverShare, role: .initiator))
+            try await channel.eventLoop.submit { handler.session = session.value }.get()
+            logger.debug("connection established", metadata: [
+                "address": "\(address)",
+                "port": "\(port)",
+                "verified": "\(serverPublicKey != nil)"
+            ])
+            return link
+        } catch {
+            try? await channel.close()
+            throw error
+        }
+    }
+
+    private func exchangeHello(_ hello: BoxCodec.HelloPayload, on link: Link) async throws -> BoxCodec.HelloPayload {
+        let frame = BoxCodec.Frame(
+            command: .hello,
+            requestId: UUID(),
+            nodeId: nodeId,
+            userId: userId,
+            payload: try BoxCodec.encodeHelloPayload(hello, allocator: link.channel.allocator)
+        )
+        let answer = try await link.request(frame)
+        var buffer = answer.payload
+        switch answer.command {
+        case .hello:
+            return try BoxCodec.decodeHelloPayload(from: &buffer)
+        case .status:
+            let status = try BoxCodec.decodeStatusPayload(from: &buffer)
+            throw BoxClientError.remoteRejected(status: status.status, message: status.message)
+        default:
+            throw BoxClientError.remoteRejected(status: .badRequest, message: "unexpected-\(answer.command)")
+        }
+    }
+}
+
+/// Channel handler of a `BoxClientConnection`: sends requests, resends them on a timer and completes
+/// each one with the first frame carrying its request identifier. Only touched on the channel event loop.
+final class BoxConnectionHandler: ChannelInboundHandler {
+    typealias InboundIn = AddressedEnvelope<ByteBuffer>
+    typealias OutboundOut = AddressedEnvelope<ByteBuffer>
+
+    private struct Request {
+        var frame: BoxCodec.Frame
+        var promise: EventLoopPromise<UncheckedSendableBox<BoxCodec.Frame>>
+        var attemptsLeft: Int
+        var timer: Scheduled<Void>?
+    }
+
+    private let remoteAddress: SocketAddress
+    private let retransmitInterval: TimeAmount
+    private let attempts: Int
+    private let logger: Logger
+    private var context: ChannelHandlerContext?
+    private var requests: [UUID: Request] = [:]
+    /// Session established by the HELLO exchange; every other frame is sealed with it.
+    var session: BoxSession?
+
+    init(remoteAddress: SocketAddress, retransmitInterval: TimeAmount, attempts: Int, logger: Logger) {
+        self.remoteAddress = remoteAddress
+        self.retransmitInterval = retransmitInterval
+        self.attempts = attempts
+        self.logger = logger
+    }
+
+    func handlerAdded(context: ChannelHandlerContext) {
+        self.context = context
+    }
+
+    func handlerRemoved(context: ChannelHandlerContext) {
+        self.context = nil
+        failAll(ChannelError.ioOnClosedChannel)
+    }
+
+    func channelInactive(context: ChannelHandlerContext) {
+        failAll(ChannelError.ioOnClosedChannel)
+        context.fireChannelInactive()
+    }
+
+    func channelRead(context: ChannelHandlerContext, data: NIOAny) {
+        let envelope = unwrapInboundIn(data)
+        guard envelope.remoteAddress == remoteAddress else { return }
+        var datagram = envelope.data
+        guard var frame = try? BoxCodec.decodeFrame(from: &datagram) else { return }
+        if frame.isSealed {
+            do {
+                guard session != nil else { return }
+                try session?.open(&frame)
+            } catch {
+                logger.debug("dropping sealed datagram", metadata: ["error": "\(error)"])
+                return
+            }
+        }
+        guard let request = requests.removeValue(forKey: frame.requestId) else { return }
+        request.timer?.cancel()
+        request.promise.succeed(UncheckedSendableBox(frame))
+    }
+
+    func errorCaught(context: ChannelHandlerContext, error: Error) {
+        // ICMP unreachable and friends: the retransmit timer decides when to give up.
+        logger.debug("connection error", metadata: ["error": "\(error)"])
+    }
+
+    /// Sends `frame` until a frame with the same request identifier comes back.
+    func request(_ frame: BoxCodec.Frame, on eventLoop: EventLoop) -> EventLoopFuture<UncheckedSendableBox<BoxCodec.Frame>> {
+        guard context != nil else {
+            return eventLoop.makeFailedFuture(ChannelError.ioOnClosedChannel)
+        }
+        let promise = eventLoop.makePromise(of: UncheckedSendableBox<BoxCodec.Frame>.self)
+        requests[frame.requestId] = Request(frame: frame, promise: promise, attemptsLeft: attempts, timer: nil)
+        transmit(frame.requestId)
+        return promise.futureResult
+    }
+
+    private func transmit(_ requestId: UUID) {
+        guard let context, var request = requests[requestId] else { return }
+        guard request.attemptsLeft > 0 else {
+            requests.removeValue(forKey: requestId)
+            request.promise.fail(BoxClientError.timeout(.nanoseconds(retransmitInterval.nanoseconds * Int64(attempts))))
+            return
+        }
+        request.attemptsLeft -= 1
+        let datagram: ByteBuffer
+        if request.frame.command != .hello, var session {
+            do {
+                datagram = try session.seal(request.frame, allocator: context.channel.allocator)
+            } catch {
+                requests.removeValue(forKey: requestId)
+                request.promise.fail(error)
+                return
+            }
+            // Sealing advances the nonce counter of the session.
+            self.session = session
+        } else {
+            datagram = BoxCodec.encodeFrame(request.frame, allocator: context.channel.allocator)
+        }
+        context.writeAndFlush(wrapOutboundOut(AddressedEnvelope(remoteAddress: remoteAddress, data: datagram)), promise: nil)
+        request.timer = context.eventLoop.scheduleTask(in: retransmitInterval) { [weak self] in
+            self?.transmit(requestId)
+        }
+        requests[requestId] = request
+    }
+
+    private func failAll(_ error: Error) {
+        let pending = requests.values
+        requests.removeAll()
+        for request in pending {
+            request.timer?.cancel()
+            request.promise.fail(error)
+        }
+    }
+}
+
+extension BoxConnectionHandler: @unchecked Sendable {}
@@ -327,6 +327,8 @@ fileprivate struct Endpoint: Hashable {
     var address: String
     /// UDP port advertised for the node.
     var port: UInt16
+    /// Ed25519 node key advertised in the Location Service record, used to authenticate the server.
+    var publicKey: [UInt8]? = nil
 }
 
 /// Candidate socket address inspected while selecting the preferred endpoint.
@@ -358,7 +360,7 @@ public struct BoxCommandParser: AsyncParsableCommand {
         CommandConfiguration(
             commandName: "box",
             abstract: "Box messaging toolkit (Swift rewrite).",
-            subcommands: [Admin.self, InitConfig.self, Register.self, PingRoots.self, Put.self, Get.self, Locate.self]
+            subcommands: [Admin.self, InitConfig.self, Register.self, PingRoots.self, Put.self, Get.self, Delete.self, Locate.self]
         )
     }
 
@@ -833,10 +835,14 @@ public struct BoxCommandParser: AsyncParsableCommand {
         switch action {
         case .handshake:
             return "handshake"
-        case let .put(queuePath, _, _):
+        case let .put(queuePath, _, _, _, _):
             return "put to \(queuePath)"
         case let .get(queuePath):
             return "get from \(queuePath)"
+        case let .cursor(queuePath, cursor, _):
+            return "cursor \(cursor) on \(queuePath)"
+        case let .delete(queuePath, targets):
+            return "delete of \(targets.count) object(s) from \(queuePath)"
         case let .locate(node):
             return "locate \(node.uuidString)"
         case .ping:
@@ -973,6 +979,30 @@ public struct BoxCommandParser: AsyncParsableCommand {
                 contentType = try stream.nextValue("Expected MIME type after 'as'.")
             }
 
+            var notBefore: Date?
+            if stream.consumeKeyword("after") {
+                let value = try stream.nextValue("Expected seconds after 'after'.")
+                guard let seconds = TimeInterval(value), seconds > 0 else {
+                    throw ValidationError("Invalid delay '\(value)': expected a positive number of seconds.")
+                }
+                notBefore = Date().addingTimeInterval(seconds)
+            } else if stream.consumeKeyword("not-before") {
+                let value = try stream.nextValue("Expected ISO-8601 date after 'not-before'.")
+                guard let date = ISO8601DateFormatter().date(from: value) else {
+                    throw ValidationError("Invalid date '\(value)': expected ISO-8601 (e.g. 2025-10-17T14:30:00Z).")
+                }
+                notBefore = date
+            }
+
+            var priority: UInt8 = 0
+            if stream.consumeKeyword("priority") {
+                let value = try stream.nextValue("Expected priority class after 'priority'.")
+                guard let parsed = UInt8(value), parsed <= BoxCodec.maxPriority else {
+                    throw ValidationError("Invalid priority '\(value)': expected 0 to \(BoxCodec.maxPriority).")
+                }
+                priority = parsed
+            }
+
             if stream.hasRemaining {
                 throw ValidationError("Unexpected arguments: \(stream.remainingDescription)")
             }
@@ -1024,7 +1054,7 @@ public struct BoxCommandParser: AsyncParsableCommand {
                     nodeId: configuration.common.nodeUUID,
                     userId: configuration.common.userUUID,
                     portMappingRequested: false,
-                    clientAction: .put(queuePath: queuePath, contentType: contentType, data: messageBytes),
+                    clientAction: .put(queuePath: queuePath, contentType: contentType, data: messageBytes, notBefore: notBefore, priority: priority),
                     portMappingOrigin: .default,
                     externalAddressOverride: nil,
                     externalPortOverride: nil,
@@ -1032,7 +1062,8 @@ public struct BoxCommandParser: AsyncParsableCommand {
                     permanentQueues: permanentQueues,
                     rootServers: configuration.common.rootServers,
                     bindAddress: binding.address,
-                    bindPort: binding.port
+                    bindPort: binding.port,
+                    serverPublicKey: endpoint.publicKey
                 )
 
                 do {
@@ -1092,6 +1123,32 @@ public struct BoxCommandParser: AsyncParsableCommand {
                 queueOverride = try stream.nextValue("Expected queue name after 'queue'.")
             }
 
+            var cursorName: String?
+            var cursorOperation = BoxCodec.CursorOperation.next
+            if stream.consumeKeyword("cursor") {
+                cursorName = try stream.nextValue("Expected cursor name after 'cursor'.")
+                if stream.consumeKeyword("rewind") {
+                    cursorOperation = .seek(nil)
+                } else if stream.consumeKeyword("since") {
+                    let value = try stream.nextValue("Expected ISO-8601 date after 'since'.")
+                    guard let date = ISO8601DateFormatter().date(from: value) else {
+                        throw ValidationError("Invalid date '\(value)': expected ISO-8601 (e.g. 2025-10-17T14:30:00Z).")
+                    }
+                    cursorOperation = .seek(date)
+                }
+            } else if stream.consumeKeyword("lease") {
+                cursorName = try stream.nextValue("Expected consumer name after 'lease'.")
+                var visibility: TimeInterval?
+                if stream.consumeKeyword("visibility") {
+                    let value = try stream.nextValue("Expected seconds after 'visibility'.")
+                    guard let seconds = TimeInterval(value), seconds > 0 else {
+                        throw ValidationError("Invalid visibility '\(value)': expected a positive number of seconds.")
+                    }
+                    visibility = seconds
+                }
+                cursorOperation = .lease(visibility: visibility)
+            }
+
             if stream.hasRemaining {
                 throw ValidationError("Unexpected arguments: \(stream.remainingDescription)")
             }
@@ -1142,13 +1199,14 @@ public struct BoxCommandParser: AsyncParsableCommand {
                     nodeId: configuration.common.nodeUUID,
                     userId: configuration.common.userUUID,
                     portMappingRequested: false,
-                    clientAction: .get(queuePath: queuePath),
+                    clientAction: cursorName.map { .cursor(queuePath: queuePath, cursor: $0, operation: cursorOperation) } ?? .get(queuePath: queuePath),
                     portMappingOrigin: .default,
                     externalAddressOverride: nil,
                     externalPortOverride: nil,
                     externalAddressOrigin: .default,
                     permanentQueues: permanentQueues,
-                    rootServers: configuration.common.rootServers
+                    rootServers: configuration.common.rootServers,
+                    serverPublicKey: endpoint.publicKey
                 )
 
                 do {
@@ -1167,6 +1225,137 @@ public struct BoxCommandParser: AsyncParsableCommand {
         }
     }
 
+    /// `box delete` — remove messages from a remote queue (acknowledges permanent-queue entries).
+    public struct Delete: AsyncParsableCommand {
+        public static var configuration: CommandConfiguration {
+            CommandConfiguration(
+                commandName: "delete",
+                abstract: "Delete messages from a remote Box queue by id or SHA-256 digest."
+            )
+        }
+
+        @Option(name: .customLong("config"), help: "Configuration PLIST path (defaults to ~/.box/Box.plist).")
+        public var configurationPath: String?
+
+        @Option(name: .long, help: "Log level (trace, debug, info, warn, error).")
+        public var logLevel: String?
+
+        @Option(name: .long, help: "Log target (stderr|stdout|file:<path>).")
+        public var logTarget: String?
+
+        @Argument(parsing: .captureForPassthrough, help: "Natural command expression (e.g. 'from <uuid> queue INBOX id <digest> id <uuid>').")
+        public var expression: [String] = []
+
+        public init() {}
+
+        public mutating func run() async throws {
+            guard !expression.isEmpty else {
+                throw ValidationError("Missing arguments. Example: box delete from <UUID> queue INBOX id <SHA-256>")
+            }
+
+            var stream = NaturalLanguageTokenStream(tokens: expression)
+            guard stream.consumeKeyword("from") || stream.consumeKeyword("at") else {
+                throw ValidationError("Expected 'from' or 'at' before the target.")
+            }
+            let targetToken = try stream.nextValue("Expected target after keyword.")
+            let target = try NaturalTarget(token: targetToken)
+
+            var queueOverride: String?
+            if stream.consumeKeyword("queue") {
+                queueOverride = try stream.nextValue("Expected queue name after 'queue'.")
+            }
+
+            var targets: [BoxCodec.DeleteTarget] = []
+            while stream.consumeKeyword("id") {
+                let token = try stream.nextValue("Expected object UUID or SHA-256 digest after 'id'.")
+                if let digest = BoxContentDigest(hex: token) {
+                    targets.append(.digest(digest))
+                } else if let id = UUID(uuidString: token) {
+                    targets.append(.id(id))
+                } else {
+                    throw ValidationError("Invalid object reference '\(token)': expected a UUID or a 64-character SHA-256 digest.")
+                }
+            }
+            guard !targets.isEmpty else {
+                throw ValidationError("Expected at least one 'id <uuid|digest>'.")
+            }
+
+            if stream.hasRemaining {
+                throw ValidationError("Unexpected arguments: \(stream.remainingDescription)")
+            }
+
+            let configurationURL = try BoxCommandParser.resolveConfigurationURL(path: configurationPath)
+            let configurationResult = try BoxConfiguration.load(from: configurationURL)
+            let configuration = configurationResult.configuration
+
+            let (effectiveLogLevel, logLevelOrigin, effectiveLogTarget, logTargetOrigin) = try BoxCommandParser.resolveClientLogging(
+                logLevelOption: logLevel,
+                logTargetOption: logTarget,
+                configuration: configuration
+            )
+
+            BoxLogging.bootstrap(level: effectiveLogLevel, target: effectiveLogTarget)
+
+            let queueName = try BoxCommandParser.resolveQueueName(preferred: queueOverride, embedded: target.queueComponent)
+            let queuePath = "/" + queueName
+            let cache = try LocationCache()
+            let endpoints = try BoxCommandParser.resolveEndpoints(
+                for: target,
+                cache: cache,
+                portOverride: target.portOverride,
+                fallbackHost: configuration.client.address,
+                fallbackPort: configuration.client.address == nil ? nil : (configuration.client.port ?? BoxRuntimeOptions.defaultPort)
+            )
+
+            guard !endpoints.isEmpty else {
+                throw ValidationError("No reachable endpoints found for \(target.debugDescription).")
+            }
+
+            let permanentQueues = try BoxCommandParser.permanentQueueSet(for: configuration)
+            var failures: [(Endpoint, Error)] = []
+
+            for endpoint in endpoints {
+                let options = BoxRuntimeOptions(
+                    mode: .client,
+                    address: endpoint.address,
+                    port: endpoint.port,
+                    portOrigin: .cliFlag,
+                    addressOrigin: .cliFlag,
+                    configurationPath: configurationResult.url.path,
+                    adminChannelEnabled: false,
+                    logLevel: effectiveLogLevel,
+                    logTarget: effectiveLogTarget,
+                    logLevelOrigin: logLevelOrigin,
+                    logTargetOrigin: logTargetOrigin,
+                    nodeId: configuration.common.nodeUUID,
+                    userId: configuration.common.userUUID,
+                    portMappingRequested: false,
+                    clientAction: .delete(queuePath: queuePath, targets: targets),
+                    portMappingOrigin: .default,
+                    externalAddressOverride: nil,
+                    externalPortOverride: nil,
+                    externalAddressOrigin: .default,
+                    permanentQueues: permanentQueues,
+                    rootServers: configuration.common.rootServers,
+                    serverPublicKey: endpoint.publicKey
+                )
+
+                do {
+                    try await BoxClient.run(with: options)
+                    return
+                } catch {
+                    failures.append((endpoint, error))
+                }
+            }
+
+            let lines = failures.map { failure -> String in
+                let endpoint = failure.0
+                return "- \(endpoint.nodeUUID.uuidString) @ \(BoxCommandParser.formatEndpointAddress(endpoint.address)):\(endpoint.port): \(failure.1.localizedDescription)"
+            }.joined(separator: "\n")
+            throw ValidationError("Failed to delete messages:\n\(lines)")
+        }
+    }
+
     /// `box locate` — resolve a node UUID via the remote Location Service.
     public struct Locate: AsyncParsableCommand {
         public static var configuration: CommandConfiguration {
@@ -1571,7 +1760,12 @@ extension BoxCommandParser {
             throw ValidationError("Node \(record.nodeUUID.uuidString) does not advertise any reachable address.")
         }
 
-        return Endpoint(nodeUUID: record.nodeUUID, address: selected.ip, port: selected.port)
+        return Endpoint(
+            nodeUUID: record.nodeUUID,
+            address: selected.ip,
+            port: selected.port,
+            publicKey: record.nodePublicKey.flatMap(BoxIdentityCache.peerKeyBytes(fromAdvertised:))
+        )
     }
 
     /// Picks the best candidate from the provided list.
@@ -1902,7 +2096,7 @@ extension BoxCommandParser {
             CommandConfiguration(
                 commandName: "admin",
                 abstract: "Interact with the local admin channel.",
-                subcommands: [Status.self, Ping.self, LogTarget.self, ReloadConfig.self, Stats.self, NatProbe.self, Locate.self, LocationSummary.self, SyncRoots.self]
+                subcommands: [Status.self, Ping.self, LogTarget.self, ReloadConfig.self, Stats.self, NatProbe.self, Locate.self, LocationSummary.self, SyncRoots.self, Store.self, Snapshot.self, RestoreSnapshot.self]
             )
         }
 
@@ -2107,6 +2301,156 @@ extension BoxCommandParser {
             }
         }
 
+        /// `box admin store` — queue store maintenance.
+        public struct Store: AsyncParsableCommand {
+            public static var configuration: CommandConfiguration {
+                CommandConfiguration(
+                    commandName: "store",
+                    abstract: "Maintain the daemon queue store.",
+                    subcommands: [Compact.self]
+                )
+            }
+
+            public init() {}
+
+            /// `box admin store compact [queue]` — starts an online compaction job and reports its progress.
+            public struct Compact: AsyncParsableCommand {
+                @Option(name: .shortAndLong, help: "Admin socket path (defaults to ~/.box/run/boxd.socket).")
+                public var socket: String?
+
+                @Argument(help: "Queue to compact (all queues and the blob area when omitted).")
+                public var queue: String?
+
+                @Flag(name: .long, help: "Only report the progress of the current or last job.")
+                public var status: Bool = false
+
+                @Flag(name: .long, help: "Print progress every second until the job ends.")
+                public var wait: Bool = false
+
+                public init() {}
+
+                public mutating func run() throws {
+                    if status && queue != nil {
+                        throw ValidationError("--status does not take a queue.")
+                    }
+                    var command = status ? "store compact-status" : "store compact"
+                    if let queue, !queue.isEmpty {
+                        command += " \(try Admin.encodeJSON(["queue": queue]))"
+                    }
+                    var response = try Admin.sendCommand(command, socketOverride: socket)
+                    Admin.writeResponse(response)
+                    guard wait else { return }
+                    while Admin.compactionState(in: response) == "running" {
+                        Thread.sleep(forTimeInterval: 1)
+                        response = try Admin.sendCommand("store compact-status", socketOverride: socket)
+                        Admin.writeResponse(response)
+                    }
+                    if Admin.compactionState(in: response) == "failed" {
+                        throw ExitCode(1)
+                    }
+                }
+            }
+        }
+
+        /// `box admin snapshot <dir>` — writes a point-in-time snapshot of the store.
+        public struct Snapshot: AsyncParsableCommand {
+            public static var configuration: CommandConfiguration {
+                CommandConfiguration(
+                    commandName: "snapshot",
+                    abstract: "Write a hard-linked point-in-time snapshot of the queue store."
+                )
+            }
+
+            @Option(name: .shortAndLong, help: "Admin socket path (defaults to ~/.box/run/boxd.socket).")
+            public var socket: String?
+
+            @Argument(help: "Snapshot directory to create, on the volume of the store.")
+            public var directory: String
+
+            @Option(name: .long, help: "Previous snapshot to list added and removed files against (incremental backups).")
+            public var base: String?
+
+            public init() {}
+
+            public mutating func run() throws {
+                var payload = ["path": Admin.absolutePath(directory)]
+                if let base, !base.isEmpty {
+                    payload["base"] = Admin.absolutePath(base)
+                }
+                let response = try Admin.sendCommand("snapshot \(try Admin.encodeJSON(payload))", socketOverride: socket)
+                Admin.writeResponse(response)
+            }
+        }
+
+        /// `box admin restore-snapshot <dir>` — rebuilds the queue store from a snapshot while boxd is stopped.
+        public struct RestoreSnapshot: AsyncParsableCommand {
+            public static var configuration: CommandConfiguration {
+                CommandConfiguration(
+                    commandName: "restore-snapshot",
+                    abstract: "Rebuild the queue store from a snapshot (boxd must be stopped)."
+                )
+            }
+
+            @Option(name: .shortAndLong, help: "Admin socket path used to check that boxd is stopped.")
+            public var socket: String?
+
+            @Argument(help: "Snapshot directory written by `box admin snapshot`.")
+            public var directory: String
+
+            @Option(name: .long, help: "Store root to rebuild, missing or empty (defaults to ~/.box/queues).")
+            public var root: String?
+
+            public init() {}
+
+            public mutating func run() throws {
+                if (try? Admin.sendCommand("ping", socketOverride: socket)) != nil {
+                    throw ValidationError("boxd is running; stop it before restoring a snapshot.")
+                }
+                let rootURL: URL
+                if let root, !root.isEmpty {
+                    rootURL = URL(fileURLWithPath: Admin.absolutePath(root), isDirectory: true)
+                } else if let queues = BoxPaths.queuesDirectory() {
+                    rootURL = queues
+                } else {
+                    throw ValidationError("Unable to determine the queue store path. Specify one with --root.")
+                }
+                let snapshot: BoxStoreSnapshot
+                do {
+                    snapshot = try BoxStoreSnapshot.restore(from: URL(fileURLWithPath: Admin.absolutePath(directory), isDirectory: true), to: rootURL)
+                } catch {
+                    throw ValidationError("Restore failed: \(error.localizedDescription)")
+                }
+                let summary: [String: Any] = [
+                    "status": "ok",
+                    "root": rootURL.path,
+                    "createdAt": ISO8601DateFormatter().string(from: snapshot.createdAt),
+                    "queues": snapshot.queues,
+                    "files": snapshot.paths.count
+                ]
+                let data = try JSONSerialization.data(withJSONObject: summary, options: [.sortedKeys])
+                Admin.writeResponse(String(decoding: data, as: UTF8.self))
+            }
+        }
+
+        /// Expands `~` and makes `path` absolute against the current directory, for paths sent to boxd.
+        private static func absolutePath(_ path: String) -> String {
+            let expanded = NSString(string: path).expandingTildeInPath
+            if expanded.hasPrefix("/") {
+                return expanded
+            }
+            return URL(fileURLWithPath: FileManager.default.currentDirectoryPath, isDirectory: true).appendingPathComponent(expanded).standardizedFileURL.path
+        }
+
+        /// Extracts `compaction.state` from a `store compact` response.
+        private static func compactionState(in response: String) -> String? {
+            guard let data = response.data(using: .utf8),
+                  let object = try? JSONSerialization.jsonObject(with: data) as? [String: Any],
+                  let compaction = object["compaction"] as? [String: Any] else {
+                return nil
+            }
+            return compaction["state"] as? String
+        }
+
         private static func sendCommand(_ command: String, socketOverride: String?) throws -> String {
             let socketPath = try resolveSocketPath(socketOverride)
             let transport = BoxAdminTransportFactory.makeTransport(socketPath: socketPath)
@@ -29,6 +29,10 @@ public enum BoxCodec {
     public static let version: UInt8 = 0x01
     /// Header size after the length field (command + request identifier + node/user identifiers).
     private static let headerRemainderSize: Int = 52
+    /// Full header size (magic + version + length + remainder), authenticated when the payload is sealed.
+    public static let headerSize: Int = 2 + 4 + headerRemainderSize
+    /// Bit set on the command field when the payload is sealed with the session AEAD (see `BoxSession`).
+    public static let sealedCommandFlag: UInt32 = 0x8000_0000
 
     /// Enumeration of the command identifiers defined by the protocol.
     public enum Command: UInt32 {
@@ -38,7 +42,7 @@ public enum BoxCodec {
         case put = 2
         /// GET command (request an object).
         case get = 3
-        /// DELETE command (not yet implemented in Swift).
+        /// DELETE command (remove objects by id or digest, batched).
         case delete = 4
         /// STATUS command (transport control / pong).
         case status = 5
@@ -84,6 +88,10 @@ public enum BoxCodec {
         public var userId: UUID
         /// Payload slice referencing the underlying datagram.
         public var payload: ByteBuffer
+        /// Indicates that `payload` is still AEAD-sealed (counter + ciphertext + tag).
+        public var isSealed: Bool
+        /// Raw header bytes of a sealed frame, kept as associated data for `BoxSession.open(_:)`.
+        public var authenticatedHeader: ByteBuffer?
 
         /// Creates a new frame value.
         /// - Parameters:
@@ -98,23 +106,47 @@ public enum BoxCodec {
             self.nodeId = nodeId
             self.userId = userId
             self.payload = payload
+            self.isSealed = false
+            self.authenticatedHeader = nil
         }
     }
 
+    /// Extension identifiers carried after the version list of a HELLO payload (type u8, length u16, value).
+    public enum HelloExtension: UInt8 {
+        /// Ephemeral X25519 public key (32 bytes).
+        case keyShare = 1
+        /// Ed25519 signature of the handshake transcript by the responder node identity (64 bytes).
+        case signature = 2
+        /// Stateless cookie issued by a loaded responder and echoed by the initiator (16 bytes).
+        case cookie = 3
+    }
+
     /// Payload of a HELLO frame.
     public struct HelloPayload {
         /// Status code advertised by the sender.
         public var status: Status
         /// List of protocol versions supported by the sender.
         public var supportedVersions: [UInt16]
+        /// Optional ephemeral X25519 key share opening an encrypted session.
+        public var keyShare: [UInt8]?
+        /// Optional transcript signature returned by the responder.
+        public var signature: [UInt8]?
+        /// Optional handshake cookie (issued with `rateLimited`, echoed on retry).
+        public var cookie: [UInt8]?
 
         /// Creates a new HELLO payload representation.
         /// - Parameters:
         ///   - status: Status code advertised by the sender.
         ///   - supportedVersions: List of protocol versions supported by the sender.
-        public init(status: Status, supportedVersions: [UInt16]) {
+        ///   - keyShare: Optional ephemeral X25519 public key.
+        ///   - signature: Optional transcript signature.
+        ///   - cookie: Optional handshake cookie.
+        public init(status: Status, supportedVersions: [UInt16], keyShare: [UInt8]? = nil, signature: [UInt8]? = nil, cookie: [UInt8]? = nil) {
             self.status = status
             self.supportedVersions = supportedVersions
+            self.keyShare = keyShare
+            self.signature = signature
+            self.cookie = cookie
         }
     }
 
@@ -135,6 +167,47 @@ public enum BoxCodec {
         }
     }
 
+    /// Encoding of the data bytes of a PUT payload (SPECS §7.9).
+    public enum PayloadEncoding: UInt8, Sendable {
+        /// Plain bytes.
+        case identity = 0
+        /// `BoxCompression` frame (original length + LZ4 block).
+        case lz4 = 1
+
+        /// Name recorded in stored objects.
+        public var name: String {
+            switch self {
+            case .identity: return "identity"
+            case .lz4: return "lz4"
+            }
+        }
+
+        /// Parses a stored name; `nil` for unknown encodings.
+        public init?(name: String) {
+            switch name {
+            case "identity": self = .identity
+            case "lz4": self = .lz4
+            default: return nil
+            }
+        }
+    }
+
+    /// Position of one PUT frame within an object sent in several frames (SPECS §7.10).
+    public struct ChunkInfo: Equatable, Sendable {
+        /// Zero-based index of this frame.
+        public var index: UInt32
+        /// Number of frames making up the object.
+        public var count: UInt32
+
+        public init(index: UInt32, count: UInt32) {
+            self.index = index
+            self.count = count
+        }
+    }
+
+    /// Largest payload slice carried by one chunk frame; keeps a sealed datagram well under 64 KiB.
+    public static let maxChunkSize = 48 * 1024
+
     /// Payload of a PUT frame.
     public struct PutPayload {
         /// Queue path describing the logical destination.
@@ -143,16 +216,89 @@ public enum BoxCodec {
         public var contentType: String
         /// Raw payload bytes.
         public var data: [UInt8]
+        /// Stored object identifier, appended by the server to GET responses served from a cursor.
+        public var objectId: UUID?
+        /// Earliest time the object becomes visible in its queue (delayed delivery).
+        public var notBefore: Date?
+        /// Priority class, 0 (bulk, default) to `maxPriority` (most urgent).
+        public var priority: UInt8
+        /// Encoding of `data`; compressed payloads are stored and forwarded as received.
+        public var encoding: PayloadEncoding
+        /// Set when `data` is one slice of a larger object; slices share every other field.
+        public var chunk: ChunkInfo?
 
         /// Creates a new PUT payload representation.
         /// - Parameters:
         ///   - queuePath: Logical queue path.
         ///   - contentType: Content type string.
         ///   - data: Raw payload bytes.
-        public init(queuePath: String, contentType: String, data: [UInt8]) {
+        ///   - objectId: Optional stored object identifier (trailing 16 bytes).
+        ///   - notBefore: Optional delivery date (int64 milliseconds after the object identifier, which is
+        ///     then zero-filled when absent).
+        ///   - priority: Priority class (uint8 after `notBefore`, which is then 0 when absent). Values above
+        ///     `maxPriority` are clamped.
+        ///   - encoding: Encoding of `data` (uint8 after `priority`, which is then 0 when absent).
+        ///   - chunk: Chunk index and count (two uint32 after `encoding`, which is then 0 when absent).
+        public init(
+            queuePath: String,
+            contentType: String,
+            data: [UInt8],
+            objectId: UUID? = nil,
+            notBefore: Date? = nil,
+            priority: UInt8 = 0,
+            encoding: PayloadEncoding = .identity,
+            chunk: ChunkInfo? = nil
+        ) {
             self.queuePath = queuePath
             self.contentType = contentType
             self.data = data
+            self.objectId = objectId
+            self.notBefore = notBefore
+            self.priority = min(priority, BoxCodec.maxPriority)
+            self.encoding = encoding
+            self.chunk = chunk
+        }
+    }
+
+    /// Operation applied to a named consumer cursor by a GET frame.
+    ///
+    /// Lease operations do not use a position; the name identifies the consumer owning the leases.
+    public enum CursorOperation: Equatable, Sendable {
+        /// Return the first object after the committed position (op 0). The position does not move.
+        case next
+        /// Move the position past the object with this identifier (op 1, 16 bytes).
+        case commit(UUID)
+        /// Position the cursor so `next` returns the first object created at or after the date (op 2,
+        /// int64 milliseconds since 1970). `nil` rewinds to the start of the queue (encoded as -1).
+        case seek(Date?)
+        /// Lease the oldest visible object, hiding it for the visibility timeout (op 3, uint32
+        /// milliseconds, 0 for the server default). The PUT response ends with the object id.
+        case lease(visibility: TimeInterval?)
+        /// Acknowledge (delete) a leased object (op 4, 16 bytes).
+        case ack(UUID)
+    }
+
+    /// Cursor section of a GET frame.
+    public struct CursorRequest: Equatable, Sendable {
+        /// Cursor name, unique per queue.
+        public var name: String
+        /// Requested operation.
+        public var operation: CursorOperation
+
+        /// Creates a cursor request.
+        /// - Parameters:
+        ///   - name: Cursor name.
+        ///   - operation: Requested operation.
+        public init(name: String, operation: CursorOperation) {
+            self.name = name
+            self.operation = operation
+        }
+
+        /// Consumer holding the lease of an object popped by a chunked GET, acknowledged by the requester
+        /// once every slice arrived (SPECS §7.10).
+        /// - Parameter requestId: Request id of the GET.
+        public static func chunkedGetConsumer(for requestId: UUID) -> String {
+            "get-\(requestId.uuidString.lowercased())"
         }
     }
 
@@ -160,23 +306,69 @@ public enum BoxCodec {
     public struct GetPayload {
         /// Queue path requested by the client.
         public var queuePath: String
+        /// Optional consumer cursor; without it GET pops (or peeks on permanent queues) the oldest object.
+        public var cursor: CursorRequest?
+        /// Whether the reply may carry `lz4` data; otherwise the server expands compressed objects.
+        public var acceptsCompression: Bool
 
         /// Creates a new GET payload representation.
-        /// - Parameter queuePath: Queue path requested by the client.
-        public init(queuePath: String) {
+        /// - Parameters:
+        ///   - queuePath: Queue path requested by the client.
+        ///   - cursor: Optional consumer cursor request.
+        ///   - acceptsCompression: Accepted encodings flag (uint8 after the cursor, which is then reduced
+        ///     to an empty name when absent).
+        public init(queuePath: String, cursor: CursorRequest? = nil, acceptsCompression: Bool = false) {
+            self.queuePath = queuePath
+            self.cursor = cursor
+            self.acceptsCompression = acceptsCompression
+        }
+    }
+
+    /// Selector identifying the objects removed by a DELETE frame.
+    public enum DeleteTarget: Equatable, Sendable {
+        /// Object identifier (kind 1, 16 bytes on the wire).
+        case id(UUID)
+        /// SHA-256 payload digest (kind 2, 32 bytes on the wire). Matches every entry holding that content.
+        case digest(BoxContentDigest)
+    }
+
+    /// Payload of a DELETE frame.
+    public struct DeletePayload {
+        /// Queue holding the objects.
+        public var queuePath: String
+        /// Objects to remove, at most `maxDeleteTargets`.
+        public var targets: [DeleteTarget]
+
+        /// Creates a new DELETE payload representation.
+        /// - Parameters:
+        ///   - queuePath: Queue holding the objects.
+        ///   - targets: Objects to remove.
+        public init(queuePath: String, targets: [DeleteTarget]) {
             self.queuePath = queuePath
+            self.targets = targets
         }
     }
 
+    /// Highest PUT priority class. Dequeue serves the oldest object of the highest non-empty class.
+    public static let maxPriority: UInt8 = 7
+
+    /// Maximum number of targets in one DELETE frame (keeps a digest batch under ~50 KB per datagram).
+    public static let maxDeleteTargets = 1536
+
     /// Payload of a SEARCH frame (queue listing).
     public struct SearchPayload {
         /// Queue path that should be enumerated.
         public var queuePath: String
+        /// Whether the replies may carry `lz4` data; otherwise the server expands compressed objects.
+        public var acceptsCompression: Bool
 
         /// Creates a new SEARCH payload.
-        /// - Parameter queuePath: Queue path requested by the client.
-        public init(queuePath: String) {
+        /// - Parameters:
+        ///   - queuePath: Queue path requested by the client.
+        ///   - acceptsCompression: Accepted encodings flag, laid out as in a GET payload without cursor.
+        public init(queuePath: String, acceptsCompression: Bool = false) {
             self.queuePath = queuePath
+            self.acceptsCompression = acceptsCompression
         }
     }
 
@@ -197,6 +389,7 @@ public enum BoxCodec {
     /// - Returns: A frame containing the command, request identifier and payload slice.
     /// - Throws: `BoxCodecError` if the header is malformed or incomplete.
     public static func decodeFrame(from buffer: inout ByteBuffer) throws -> Frame {
+        let headerStart = buffer.readerIndex
         guard let magicByte: UInt8 = buffer.readInteger(),
               let versionByte: UInt8 = buffer.readInteger(),
               let totalLength: UInt32 = buffer.readInteger(endianness: .big, as: UInt32.self),
@@ -210,7 +403,8 @@ public enum BoxCodec {
         guard versionByte == version else {
             throw BoxCodecError.unsupportedVersion
         }
-        guard let command = Command(rawValue: rawCommand) else {
+        let sealed = (rawCommand & sealedCommandFlag) != 0
+        guard let command = Command(rawValue: rawCommand & ~sealedCommandFlag) else {
             throw BoxCodecError.unsupportedCommand
         }
 
@@ -228,7 +422,12 @@ public enum BoxCodec {
             throw BoxCodecError.truncatedPayload
         }
 
-        return Frame(command: command, requestId: requestId, nodeId: nodeId, userId: userId, payload: payloadSlice)
+        var frame = Frame(command: command, requestId: requestId, nodeId: nodeId, userId: userId, payload: payloadSlice)
+        if sealed {
+            frame.isSealed = true
+            frame.authenticatedHeader = buffer.getSlice(at: headerStart, length: headerSize)
+        }
+        return frame
     }
 
     /// Encodes a frame into a new datagram buffer.
@@ -239,16 +438,27 @@ public enum BoxCodec {
     public static func encodeFrame(_ frame: Frame, allocator: ByteBufferAllocator) -> ByteBuffer {
         var payloadCopy = frame.payload
         let payloadLength = payloadCopy.readableBytes
-        var buffer = allocator.buffer(capacity: 2 + 4 + headerRemainderSize + payloadLength)
+        var buffer = allocator.buffer(capacity: headerSize + payloadLength)
+        writeHeader(for: frame, payloadLength: payloadLength, sealed: false, into: &buffer)
+        buffer.writeBuffer(&payloadCopy)
+        return buffer
+    }
+
+    /// Writes the frame header, setting `sealedCommandFlag` when the payload will be sealed.
+    /// - Parameters:
+    ///   - frame: Frame whose command and identifiers are serialised.
+    ///   - payloadLength: Number of payload bytes that will follow the header on the wire.
+    ///   - sealed: Whether the payload is AEAD-sealed.
+    ///   - buffer: Destination buffer.
+    static func writeHeader(for frame: Frame, payloadLength: Int, sealed: Bool, into buffer: inout ByteBuffer) {
         buffer.writeInteger(magic)
         buffer.writeInteger(version)
         buffer.writeInteger(UInt32(headerRemainderSize + payloadLength), endianness: .big)
-        buffer.writeInteger(frame.command.rawValue, endianness: .big)
+        let rawCommand = sealed ? frame.command.rawValue | sealedCommandFlag : frame.command.rawValue
+        buffer.writeInteger(rawCommand, endianness: .big)
         writeUUID(frame.requestId, into: &buffer)
         writeUUID(frame.nodeId, into: &buffer)
         writeUUID(frame.userId, into: &buffer)
-        buffer.writeBuffer(&payloadCopy)
-        return buffer
     }
 
     private static func readUUID(from buffer: inout ByteBuffer) -> UUID? {
@@ -264,6 +474,8 @@ public enum BoxCodec {
         }
     }
 
+    private static let zeroUUID = UUID(uuid: (0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0))
+
     private static func writeUUID(_ uuid: UUID, into buffer: inout ByteBuffer) {
         var value = uuid.uuid
         let bytes = withUnsafeBytes(of: &value) { pointer in
@@ -296,6 +508,32 @@ public enum BoxCodec {
         return buffer
     }
 
+    /// Encodes a HELLO payload including its optional extensions.
+    /// - Parameters:
+    ///   - payload: Typed HELLO payload.
+    ///   - allocator: Byte buffer allocator from the channel.
+    /// - Throws: `BoxCodecError.unsupportedVersionCount` if the count exceeds 255.
+    /// - Returns: A buffer ready to be embedded in a frame.
+    public static func encodeHelloPayload(_ payload: HelloPayload, allocator: ByteBufferAllocator) throws -> ByteBuffer {
+        var buffer = try encodeHelloPayload(status: payload.status, versions: payload.supportedVersions, allocator: allocator)
+        if let keyShare = payload.keyShare {
+            writeHelloExtension(.keyShare, value: keyShare, into: &buffer)
+        }
+        if let signature = payload.signature {
+            writeHelloExtension(.signature, value: signature, into: &buffer)
+        }
+        if let cookie = payload.cookie {
+            writeHelloExtension(.cookie, value: cookie, into: &buffer)
+        }
+        return buffer
+    }
+
+    private static func writeHelloExtension(_ type: HelloExtension, value: [UInt8], into buffer: inout ByteBuffer) {
+        buffer.writeInteger(type.rawValue)
+        buffer.writeInteger(UInt16(value.count), endianness: .big)
+        buffer.writeBytes(value)
+    }
+
     /// Decodes a HELLO payload from the supplied buffer slice.
     /// - Parameter payload: Payload slice referencing the HELLO buffer.
     /// - Returns: A strongly typed HELLO payload.
@@ -316,7 +554,26 @@ public enum BoxCodec {
         guard let status = Status(rawValue: rawStatus) else {
             throw BoxCodecError.malformedHeader
         }
-        return HelloPayload(status: status, supportedVersions: versions)
+        var hello = HelloPayload(status: status, supportedVersions: versions)
+        // Extensions are optional; unknown identifiers are skipped so older peers stay compatible.
+        while payload.readableBytes > 0 {
+            guard let rawType: UInt8 = payload.readInteger(),
+                  let length: UInt16 = payload.readInteger(endianness: .big, as: UInt16.self),
+                  let value = payload.readBytes(length: Int(length)) else {
+                throw BoxCodecError.truncatedPayload
+            }
+            switch HelloExtension(rawValue: rawType) {
+            case .keyShare:
+                hello.keyShare = value
+            case .signature:
+                hello.signature = value
+            case .cookie:
+                hello.cookie = value
+            case nil:
+                continue
+            }
+        }
+        return hello
     }
 
     /// Encodes a STATUS payload.
@@ -369,7 +626,7 @@ public enum BoxCodec {
         let dataBytes = payload.data
 
         var buffer = allocator.buffer(
-            capacity: 2 + queueBytes.count + 2 + typeBytes.count + 4 + dataBytes.count
+            capacity: 2 + queueBytes.count + 2 + typeBytes.count + 4 + dataBytes.count + 16 + 8 + 1 + 1 + 8
         )
         buffer.writeInteger(UInt16(queueBytes.count), endianness: .big)
         buffer.writeBytes(queueBytes)
@@ -377,6 +634,30 @@ public enum BoxCodec {
         buffer.writeBytes(typeBytes)
         buffer.writeInteger(UInt32(dataBytes.count), endianness: .big)
         buffer.writeBytes(dataBytes)
+        // Each trailer field is written when it or a later field is set.
+        let hasEncoding = payload.encoding != .identity || payload.chunk != nil
+        let hasPriority = payload.priority > 0 || hasEncoding
+        let hasNotBefore = payload.notBefore != nil || hasPriority
+        if let objectId = payload.objectId {
+            writeUUID(objectId, into: &buffer)
+        } else if hasNotBefore {
+            buffer.writeBytes([UInt8](repeating: 0, count: 16))
+        }
+        if let notBefore = payload.notBefore {
+            buffer.writeInteger(Int64((notBefore.timeIntervalSince1970 * 1000).rounded(.down)), endianness: .big)
+        } else if hasPriority {
+            buffer.writeInteger(Int64(0), endianness: .big)
+        }
+        if hasPriority {
+            buffer.writeInteger(payload.priority)
+        }
+        if hasEncoding {
+            buffer.writeInteger(payload.encoding.rawValue)
+        }
+        if let chunk = payload.chunk {
+            buffer.writeInteger(chunk.index, endianness: .big)
+            buffer.writeInteger(chunk.count, endianness: .big)
+        }
         return buffer
     }
 
@@ -399,7 +680,34 @@ public enum BoxCodec {
             throw BoxCodecError.invalidUTF8
         }
 
-        return PutPayload(queuePath: queuePath, contentType: contentType, data: dataBytes)
+        // An all-zero identifier only pads the trailer in front of `notBefore`.
+        let objectId = (payload.readableBytes >= 16 ? readUUID(from: &payload) : nil).flatMap { $0 == zeroUUID ? nil : $0 }
+        let notBefore = payload.readInteger(endianness: .big, as: Int64.self).flatMap { milliseconds in
+            milliseconds == 0 ? nil : Date(timeIntervalSince1970: TimeInterval(milliseconds) / 1000)
+        }
+        let priority = payload.readInteger(as: UInt8.self) ?? 0
+        guard let encoding = PayloadEncoding(rawValue: payload.readInteger(as: UInt8.self) ?? 0) else {
+            throw BoxCodecError.malformedHeader
+        }
+        var chunk: ChunkInfo?
+        if payload.readableBytes > 0 {
+            guard let index = payload.readInteger(endianness: .big, as: UInt32.self),
+                  let count = payload.readInteger(endianness: .big, as: UInt32.self) else {
+                throw BoxCodecError.truncatedPayload
+            }
+            guard index < count else { throw BoxCodecError.invalidLength }
+            chunk = ChunkInfo(index: index, count: count)
+        }
+        return PutPayload(
+            queuePath: queuePath,
+            contentType: contentType,
+            data: dataBytes,
+            objectId: objectId,
+            notBefore: notBefore,
+            priority: priority,
+            encoding: encoding,
+            chunk: chunk
+        )
     }
 
     /// Encodes a GET payload (queue path).
@@ -415,6 +723,35 @@ public enum BoxCodec {
         var buffer = allocator.buffer(capacity: 2 + queueBytes.count)
         buffer.writeInteger(UInt16(queueBytes.count), endianness: .big)
         buffer.writeBytes(queueBytes)
+        if let cursor = payload.cursor {
+            let nameBytes = Array(cursor.name.utf8)
+            buffer.writeInteger(UInt16(nameBytes.count), endianness: .big)
+            buffer.writeBytes(nameBytes)
+            switch cursor.operation {
+            case .next:
+                buffer.writeInteger(UInt8(0))
+            case .commit(let id):
+                buffer.writeInteger(UInt8(1))
+                writeUUID(id, into: &buffer)
+            case .seek(let date):
+                buffer.writeInteger(UInt8(2))
+                let milliseconds = date.map { Int64(($0.timeIntervalSince1970 * 1000).rounded(.down)) } ?? -1
+                buffer.writeInteger(milliseconds, endianness: .big)
+            case .lease(let visibility):
+                buffer.writeInteger(UInt8(3))
+                let milliseconds = visibility.map { UInt32(clamping: Int64(($0 * 1000).rounded())) } ?? 0
+                buffer.writeInteger(milliseconds, endianness: .big)
+            case .ack(let id):
+                buffer.writeInteger(UInt8(4))
+                writeUUID(id, into: &buffer)
+            }
+        } else if payload.acceptsCompression {
+            // Cursor names are never empty: a zero length only pads the trailer.
+            buffer.writeInteger(UInt16(0), endianness: .big)
+        }
+        if payload.acceptsCompression {
+            buffer.writeInteger(UInt8(1) << (PayloadEncoding.lz4.rawValue - 1))
+        }
         return buffer
     }
 
@@ -430,10 +767,129 @@ public enum BoxCodec {
         guard let queuePath = String(bytes: queueBytes, encoding: .utf8) else {
             throw BoxCodecError.invalidUTF8
         }
-        return GetPayload(queuePath: queuePath)
+        guard payload.readableBytes > 0 else {
+            return GetPayload(queuePath: queuePath)
+        }
+        guard let nameLength: UInt16 = payload.readInteger(endianness: .big, as: UInt16.self) else {
+            throw BoxCodecError.truncatedPayload
+        }
+        guard nameLength > 0 else {
+            return GetPayload(queuePath: queuePath, acceptsCompression: readAcceptedEncodings(from: &payload))
+        }
+        guard let nameBytes = payload.readBytes(length: Int(nameLength)),
+              let operationCode: UInt8 = payload.readInteger() else {
+            throw BoxCodecError.truncatedPayload
+        }
+        guard let name = String(bytes: nameBytes, encoding: .utf8) else {
+            throw BoxCodecError.invalidUTF8
+        }
+        let operation: CursorOperation
+        switch operationCode {
+        case 0:
+            operation = .next
+        case 1:
+            guard let id = readUUID(from: &payload) else { throw BoxCodecError.truncatedPayload }
+            operation = .commit(id)
+        case 2:
+            guard let milliseconds: Int64 = payload.readInteger(endianness: .big, as: Int64.self) else {
+                throw BoxCodecError.truncatedPayload
+            }
+            operation = .seek(milliseconds < 0 ? nil : Date(timeIntervalSince1970: TimeInterval(milliseconds) / 1000))
+        case 3:
+            guard let milliseconds: UInt32 = payload.readInteger(endianness: .big, as: UInt32.self) else {
+                throw BoxCodecError.truncatedPayload
+            }
+            operation = .lease(visibility: milliseconds == 0 ? nil : TimeInterval(milliseconds) / 1000)
+        case 4:
+            guard let id = readUUID(from: &payload) else { throw BoxCodecError.truncatedPayload }
+            operation = .ack(id)
+        default:
+            throw BoxCodecError.malformedHeader
+        }
+        return GetPayload(
+            queuePath: queuePath,
+            cursor: CursorRequest(name: name, operation: operation),
+            acceptsCompression: readAcceptedEncodings(from: &payload)
+        )
+    }
+
+    /// Reads the optional accepted-encodings mask closing a GET payload (bit `n - 1` for encoding `n`).
+    private static func readAcceptedEncodings(from payload: inout ByteBuffer) -> Bool {
+        let mask = payload.readInteger(as: UInt8.self) ?? 0
+        return mask & (UInt8(1) << (PayloadEncoding.lz4.rawValue - 1)) != 0
+    }
+
+    /// Encodes a DELETE payload (queue path, target count, then `kind` + identifier per target).
+    /// - Parameters:
+    ///   - payload: Typed DELETE payload.
+    ///   - allocator: Byte buffer allocator from the channel.
+    /// - Returns: Encoded DELETE payload buffer.
+    /// - Throws: `BoxCodecError.invalidLength` when the payload holds more than `maxDeleteTargets` targets.
+    public static func encodeDeletePayload(
+        _ payload: DeletePayload,
+        allocator: ByteBufferAllocator
+    ) throws -> ByteBuffer {
+        guard payload.targets.count <= maxDeleteTargets else {
+            throw BoxCodecError.invalidLength
+        }
+        let queueBytes = Array(payload.queuePath.utf8)
+        var buffer = allocator.buffer(capacity: 2 + queueBytes.count + 2 + payload.targets.count * (1 + BoxContentDigest.byteCount))
+        buffer.writeInteger(UInt16(queueBytes.count), endianness: .big)
+        buffer.writeBytes(queueBytes)
+        buffer.writeInteger(UInt16(payload.targets.count), endianness: .big)
+        for target in payload.targets {
+            switch target {
+            case .id(let id):
+                buffer.writeInteger(UInt8(1))
+                writeUUID(id, into: &buffer)
+            case .digest(let digest):
+                buffer.writeInteger(UInt8(2))
+                buffer.writeBytes(digest.bytes)
+            }
+        }
+        return buffer
+    }
+
+    /// Decodes a DELETE payload from the supplied buffer slice.
+    /// - Parameter payload: Payload slice referencing the DELETE buffer.
+    /// - Returns: Typed DELETE payload.
+    /// - Throws: `BoxCodecError` when the payload is malformed or lists too many targets.
+    public static func decodeDeletePayload(from payload: inout ByteBuffer) throws -> DeletePayload {
+        guard let queueLength: UInt16 = payload.readInteger(endianness: .big, as: UInt16.self),
+              let queueBytes = payload.readBytes(length: Int(queueLength)),
+              let count: UInt16 = payload.readInteger(endianness: .big, as: UInt16.self) else {
+            throw BoxCodecError.truncatedPayload
+        }
+        guard let queuePath = String(bytes: queueBytes, encoding: .utf8) else {
+            throw BoxCodecError.invalidUTF8
+        }
+        guard Int(count) <= maxDeleteTargets else {
+            throw BoxCodecError.invalidLength
+        }
+        var targets: [DeleteTarget] = []
+        targets.reserveCapacity(Int(count))
+        for _ in 0..<count {
+            guard let kind: UInt8 = payload.readInteger() else {
+                throw BoxCodecError.truncatedPayload
+            }
+            switch kind {
+            case 1:
+                guard let id = readUUID(from: &payload) else { throw BoxCodecError.truncatedPayload }
+                targets.append(.id(id))
+            case 2:
+                guard let bytes = payload.readBytes(length: BoxContentDigest.byteCount),
+                      let digest = BoxContentDigest(bytes: bytes) else {
+                    throw BoxCodecError.truncatedPayload
+                }
+                targets.append(.digest(digest))
+            default:
+                throw BoxCodecError.malformedHeader
+            }
+        }
+        return DeletePayload(queuePath: queuePath, targets: targets)
     }
 
-    /// Encodes a SEARCH payload (queue path).
+    /// Encodes a SEARCH payload (queue path, then the accepted encodings as in a GET payload).
     /// - Parameters:
     ///   - payload: Typed SEARCH payload.
     ///   - allocator: Byte buffer allocator from the channel.
@@ -442,7 +898,10 @@ public enum BoxCodec {
         _ payload: SearchPayload,
         allocator: ByteBufferAllocator
     ) -> ByteBuffer {
-        encodeGetPayload(GetPayload(queuePath: payload.queuePath), allocator: allocator)
+        encodeGetPayload(
+            GetPayload(queuePath: payload.queuePath, acceptsCompression: payload.acceptsCompression),
+            allocator: allocator
+        )
     }
 
     /// Decodes a SEARCH payload from the supplied buffer slice.
@@ -451,7 +910,7 @@ public enum BoxCodec {
     /// - Throws: `BoxCodecError` when the payload is malformed.
     public static func decodeSearchPayload(from payload: inout ByteBuffer) throws -> SearchPayload {
         let getPayload = try decodeGetPayload(from: &payload)
-        return SearchPayload(queuePath: getPayload.queuePath)
+        return SearchPayload(queuePath: getPayload.queuePath, acceptsCompression: getPayload.acceptsCompression)
     }
 
     /// Encodes a Locate payload (target node UUID).
@@ -0,0 +1,181 @@
+import Foundation
+
+/// Errors thrown while expanding a compressed payload.
+public enum BoxCompressionError: Error {
+    /// The compressed bytes do not describe a valid block.
+    case corrupted
+    /// The declared size exceeds `BoxCompression.maximumDecompressedSize`.
+    case tooLarge
+}
+
+/// Payload compression used on the wire and at rest (SPECS §7.9).
+///
+/// The codec is the LZ4 block format: greedy matching over a hash of 4-byte sequences, no entropy
+/// stage, so both directions run at memory speed and need no system library. A compressed payload is
+/// framed as the original length (uint32, big endian) followed by one LZ4 block.
+public enum BoxCompression {
+    /// Payloads below this size are sent as-is: the saving would not cover the frame overhead.
+    public static let minimumSize = 256
+    /// Largest payload a frame may declare, so a forged header cannot make the reader allocate gigabytes.
+    public static let maximumDecompressedSize = 64 * 1024 * 1024
+
+    private static let hashLog = 12
+    private static let minMatch = 4
+    /// A match may not start within the last 12 bytes of the input (LZ4 block rule).
+    private static let matchStartMargin = 12
+    /// The last 5 bytes are always literals (LZ4 block rule).
+    private static let literalTail = 5
+    private static let maxOffset = 65_535
+
+    /// Whether `contentType` carries text that usually compresses well (text, JSON, XML, JavaScript).
+    public static func isCompressible(contentType: String) -> Bool {
+        let mime = contentType.split(separator: ";").first.map { $0.trimmingCharacters(in: .whitespaces).lowercased() } ?? ""
+        return mime.hasPrefix("text/")
+            || mime == "application/json"
+            || mime.hasSuffix("+json")
+            || mime == "application/xml"
+            || mime.hasSuffix("+xml")
+            || mime == "application/javascript"
+    }
+
+    /// Whether a sender should try to compress a payload of `size` bytes and type `contentType`.
+    public static func shouldCompress(contentType: String, size: Int) -> Bool {
+        size >= minimumSize && size <= maximumDecompressedSize && isCompressible(contentType: contentType)
+    }
+
+    /// Compresses `data` into a framed block.
+    /// - Returns: The frame, or `nil` when it would not be smaller than `data`.
+    public static func compress(_ data: [UInt8]) -> [UInt8]? {
+        guard data.count <= maximumDecompressedSize else { return nil }
+        var frame: [UInt8] = []
+        frame.reserveCapacity(data.count)
+        let size = UInt32(data.count)
+        frame.append(contentsOf: [UInt8(size >> 24), UInt8((size >> 16) & 0xFF), UInt8((size >> 8) & 0xFF), UInt8(size & 0xFF)])
+        compressBlock(data, into: &frame)
+        return frame.count < data.count ? frame : nil
+    }
+
+    /// Expands a frame produced by `compress`.
+    /// - Parameter maximumSize: Largest expanded size accepted, checked on the header before anything is allocated.
+    /// - Throws: `BoxCompressionError` when the frame is malformed or declares an oversized payload.
+    public static func decompress(_ frame: [UInt8], maximumSize: Int = maximumDecompressedSize) throws -> [UInt8] {
+        guard frame.count >= 4 else { throw BoxCompressionError.corrupted }
+        let size = Int(frame[0]) << 24 | Int(frame[1]) << 16 | Int(frame[2]) << 8 | Int(frame[3])
+        guard size <= min(maximumSize, maximumDecompressedSize) else { throw BoxCompressionError.tooLarge }
+        return try decompressBlock(frame[4...], size: size)
+    }
+
+    /// Returns the plain bytes of a payload sent or stored with `encoding`.
+    /// - Parameter maximumSize: Largest expanded size accepted (see `decompress`).
+    public static func decode(_ data: [UInt8], encoding: BoxCodec.PayloadEncoding, maximumSize: Int = maximumDecompressedSize) throws -> [UInt8] {
+        switch encoding {
+        case .identity:
+            return data
+        case .lz4:
+            return try decompress(data, maximumSize: maximumSize)
+        }
+    }
+
+    private static func compressBlock(_ input: [UInt8], into output: inout [UInt8]) {
+        let count = input.count
+        var anchor = 0
+        if count > matchStartMargin {
+            var table = [Int](repeating: -1, count: 1 << hashLog)
+            let matchStartLimit = count - matchStartMargin
+            let matchEndLimit = count - literalTail
+            var index = 0
+            while index < matchStartLimit {
+                let sequence = read32(input, at: index)
+                let slot = Int((sequence &* 2_654_435_761) >> UInt32(32 - hashLog))
+                let candidate = table[slot]
+                table[slot] = index
+                guard candidate >= 0, index - candidate <= maxOffset, read32(input, at: candidate) == sequence else {
+                    index += 1
+                    continue
+                }
+                var length = minMatch
+                while index + length < matchEndLimit, input[candidate + length] == input[index + length] {
+                    length += 1
+                }
+                writeSequence(literals: input[anchor..<index], matchLength: length, offset: index - candidate, into: &output)
+                index += length
+                anchor = index
+            }
+        }
+        writeSequence(literals: input[anchor..<count], matchLength: nil, offset: 0, into: &output)
+    }
+
+    /// Appends one LZ4 sequence; the final sequence has literals only.
+    private static func writeSequence(literals: ArraySlice<UInt8>, matchLength: Int?, offset: Int, into output: inout [UInt8]) {
+        let matchCode = matchLength.map { $0 - minMatch } ?? 0
+        output.append(UInt8(min(literals.count, 15) << 4 | min(matchCode, 15)))
+        if literals.count >= 15 {
+            writeLength(literals.count - 15, into: &output)
+        }
+        output.append(contentsOf: literals)
+        guard matchLength != nil else { return }
+        output.append(UInt8(offset & 0xFF))
+        output.append(UInt8(offset >> 8))
+        if matchCode >= 15 {
+            writeLength(matchCode - 15, into: &output)
+        }
+    }
+
+    private static func writeLength(_ length: Int, into output: inout [UInt8]) {
+        var remaining = length
+        while remaining >= 255 {
+            output.append(255)
+            remaining -= 255
+        }
+        output.append(UInt8(remaining))
+    }
+
+    private static func decompressBlock(_ block: ArraySlice<UInt8>, size: Int) throws -> [UInt8] {
+        var output: [UInt8] = []
+        output.reserveCapacity(size)
+        var index = block.startIndex
+        let end = block.endIndex
+        while index < end {
+            let token = block[index]
+            index += 1
+            let literalCount = try readLength(Int(token >> 4), from: block, at: &index)
+            guard literalCount <= end - index, output.count + literalCount <= size else {
+                throw BoxCompressionError.corrupted
+            }
+            output.append(contentsOf: block[index..<(index + literalCount)])
+            index += literalCount
+            if index == end { break }
+            guard end - index >= 2 else { throw BoxCompressionError.corrupted }
+            let offset = Int(block[index]) | Int(block[index + 1]) << 8
+            index += 2
+            let matchLength = try readLength(Int(token & 0x0F), from: block, at: &index) + minMatch
+            guard offset > 0, offset <= output.count, output.count + matchLength <= size else {
+                throw BoxCompressionError.corrupted
+            }
+            // Byte by byte: a match may overlap the bytes it produces (short offsets encode runs).
+            let start = output.count - offset
+            for position in start..<(start + matchLength) {
+                output.append(output[position])
+            }
+        }
+        guard output.count == size else { throw BoxCompressionError.corrupted }
+        return output
+    }
+
+    private static func readLength(_ nibble: Int, from block: ArraySlice<UInt8>, at index: inout Int) throws -> Int {
+        guard nibble == 15 else { return nibble }
+        var length = nibble
+        while true {
+            guard index < block.endIndex else { throw BoxCompressionError.corrupted }
+            let byte = block[index]
+            index += 1
+            length += Int(byte)
+            guard length <= maximumDecompressedSize else { throw BoxCompressionError.corrupted }
+            if byte != 255 { return length }
+        }
+    }
+
+    private static func read32(_ bytes: [UInt8], at index: Int) -> UInt32 {
+        UInt32(bytes[index]) | UInt32(bytes[index + 1]) << 8 | UInt32(bytes[index + 2]) << 16 | UInt32(bytes[index + 3]) << 24
+    }
+}
@@ -35,6 +35,26 @@ public struct BoxConfiguration: Sendable {
         public var externalAddress: String?
         public var externalPort: UInt16?
         public var permanentQueues: [String]?
+        /// Number of nonce counters tracked by each session replay window (`replay_window`).
+        public var replayWindow: Int?
+        /// Key-share HELLOs per second above which a cookie round trip is required (`hello_cookie_threshold`).
+        public var helloCookieThreshold: Int?
+        /// Per-queue retention limits keyed by queue name (`queue_retention`).
+        public var queueRetention: [String: BoxConfiguration.QueueRetention]?
+        /// Volume usage percentage at which non-critical PUTs are refused (`disk_high_watermark`).
+        public var diskHighWatermark: Int?
+        /// Volume usage percentage below which PUTs are accepted again (`disk_low_watermark`).
+        public var diskLowWatermark: Int?
+        /// Seconds a leased object stays hidden before it is redelivered (`lease_visibility_timeout`).
+        public var leaseVisibilityTimeout: Int?
+        /// Maximum unacknowledged leases per consumer (`lease_max_in_flight`).
+        public var leaseMaxInFlight: Int?
+        /// In-memory queues keyed by queue name (`volatile_queues`).
+        public var volatileQueues: [String: BoxConfiguration.VolatileQueue]?
+        /// Byte budget of the in-memory cache of decoded objects (`read_cache_bytes`, 0 disables it).
+        public var readCacheBytes: Int?
+        /// Queues replicated to the other nodes of the user (`mirror_queues`).
+        public var mirrorQueues: [String]?
 
         public init(
             port: UInt16? = nil,
@@ -50,7 +70,17 @@ public struct BoxConfiguration: Sendable {
             portMappingEnabled: Bool? = nil,
             externalAddress: String? = nil,
             externalPort: UInt16? = nil,
-            permanentQueues: [String]? = nil
+            permanentQueues: [String]? = nil,
+            replayWindow: Int? = nil,
+            helloCookieThreshold: Int? = nil,
+            queueRetention: [String: BoxConfiguration.QueueRetention]? = nil,
+            diskHighWatermark: Int? = nil,
+            diskLowWatermark: Int? = nil,
+            leaseVisibilityTimeout: Int? = nil,
+            leaseMaxInFlight: Int? = nil,
+            volatileQueues: [String: BoxConfiguration.VolatileQueue]? = nil,
+            readCacheBytes: Int? = nil,
+            mirrorQueues: [String]? = nil
         ) {
             self.port = port
             self.logLevel = logLevel
@@ -66,6 +96,51 @@ public struct BoxConfiguration: Sendable {
             self.externalAddress = externalAddress
             self.externalPort = externalPort
             self.permanentQueues = permanentQueues
+            self.replayWindow = replayWindow
+            self.helloCookieThreshold = helloCookieThreshold
+            self.queueRetention = queueRetention
+            self.diskHighWatermark = diskHighWatermark
+            self.diskLowWatermark = diskLowWatermark
+            self.leaseVisibilityTimeout = leaseVisibilityTimeout
+            self.leaseMaxInFlight = leaseMaxInFlight
+            self.volatileQueues = volatileQueues
+            self.readCacheBytes = readCacheBytes
+            self.mirrorQueues = mirrorQueues
+        }
+    }
+
+    /// Retention limits of one queue (`server.queue_retention.<queue>`). Absent keys disable the limit.
+    public struct QueueRetention: Codable, Sendable, Equatable {
+        /// Maximum object age in seconds (`max_age`).
+        public var maxAge: Int?
+        /// Maximum number of objects (`max_count`).
+        public var maxCount: Int?
+        /// Maximum total size in bytes (`max_bytes`).
+        public var maxBytes: Int?
+
+        public init(maxAge: Int? = nil, maxCount: Int? = nil, maxBytes: Int? = nil) {
+            self.maxAge = maxAge
+            self.maxCount = maxCount
+            self.maxBytes = maxBytes
+        }
+
+        enum CodingKeys: String, CodingKey {
+            case maxAge = "max_age"
+            case maxCount = "max_count"
+            case maxBytes = "max_bytes"
+        }
+    }
+
+    /// Ring settings of one volatile queue (`server.volatile_queues.<queue>`).
+    public struct VolatileQueue: Codable, Sendable, Equatable {
+        /// Maximum number of objects kept in memory (`capacity`).
+        public var capacity: Int?
+        /// Overflow policy: `drop-oldest` (default), `reject` or `spill` (`overflow`).
+        public var overflow: String?
+
+        public init(capacity: Int? = nil, overflow: String? = nil) {
+            self.capacity = capacity
+            self.overflow = overflow
         }
     }
 
@@ -261,7 +336,17 @@ private extension BoxConfiguration {
             portMappingEnabled: serverSection.portMapping,
             externalAddress: serverSection.externalAddress,
             externalPort: serverSection.externalPort,
-            permanentQueues: serverSection.permanentQueues
+            permanentQueues: serverSection.permanentQueues,
+            replayWindow: serverSection.replayWindow,
+            helloCookieThreshold: serverSection.helloCookieThreshold,
+            queueRetention: serverSection.queueRetention,
+            diskHighWatermark: serverSection.diskHighWatermark,
+            diskLowWatermark: serverSection.diskLowWatermark,
+            leaseVisibilityTimeout: serverSection.leaseVisibilityTimeout,
+            leaseMaxInFlight: serverSection.leaseMaxInFlight,
+            volatileQueues: serverSection.volatileQueues,
+            readCacheBytes: serverSection.readCacheBytes,
+            mirrorQueues: serverSection.mirrorQueues
         )
 
         let clientSection = plist.client ?? ConfigurationPlist.Client.default(baseDirectory: defaultBaseDirectory)
@@ -294,7 +379,17 @@ private extension BoxConfiguration {
                 portMapping: server.portMappingEnabled,
                 externalAddress: server.externalAddress,
                 externalPort: server.externalPort,
-                permanentQueues: server.permanentQueues
+                permanentQueues: server.permanentQueues,
+                replayWindow: server.replayWindow,
+                helloCookieThreshold: server.helloCookieThreshold,
+                queueRetention: server.queueRetention,
+                diskHighWatermark: server.diskHighWatermark,
+                diskLowWatermark: server.diskLowWatermark,
+                leaseVisibilityTimeout: server.leaseVisibilityTimeout,
+                leaseMaxInFlight: server.leaseMaxInFlight,
+                volatileQueues: server.volatileQueues,
+                readCacheBytes: server.readCacheBytes,
+                mirrorQueues: server.mirrorQueues
             ),
             client: ConfigurationPlist.Client(
                 logLevel: client.logLevel?.rawValue,
@@ -355,6 +450,16 @@ private struct ConfigurationPlist: Codable {
         var externalAddress: String?
         var externalPort: UInt16?
         var permanentQueues: [String]?
+        var replayWindow: Int?
+        var helloCookieThreshold: Int?
+        var queueRetention: [String: BoxConfiguration.QueueRetention]?
+        var diskHighWatermark: Int?
+        var diskLowWatermark: Int?
+        var leaseVisibilityTimeout: Int?
+        var leaseMaxInFlight: Int?
+        var volatileQueues: [String: BoxConfiguration.VolatileQueue]?
+        var readCacheBytes: Int?
+        var mirrorQueues: [String]?
 
         enum CodingKeys: String, CodingKey {
             case port
@@ -371,6 +476,16 @@ private struct ConfigurationPlist: Codable {
             case externalAddress = "external_address"
             case externalPort = "external_port"
             case permanentQueues = "permanent_queues"
+            case replayWindow = "replay_window"
+            case helloCookieThreshold = "hello_cookie_threshold"
+            case queueRetention = "queue_retention"
+            case diskHighWatermark = "disk_high_watermark"
+            case diskLowWatermark = "disk_low_watermark"
+            case leaseVisibilityTimeout = "lease_visibility_timeout"
+            case leaseMaxInFlight = "lease_max_in_flight"
+            case volatileQueues = "volatile_queues"
+            case readCacheBytes = "read_cache_bytes"
+            case mirrorQueues = "mirror_queues"
         }
 
         static func `default`(baseDirectory: URL? = nil) -> Server {
@@ -0,0 +1,54 @@
+import Crypto
+import Foundation
+
+/// SHA-256 digest identifying an object payload (SPECS §7).
+public struct BoxContentDigest: Hashable, Sendable, CustomStringConvertible {
+    /// Digest length in bytes.
+    public static let byteCount = 32
+
+    /// Raw 32-byte digest.
+    public let bytes: [UInt8]
+
+    /// Wraps raw digest bytes.
+    /// - Returns: `nil` unless `bytes` holds exactly 32 bytes.
+    public init?(bytes: [UInt8]) {
+        guard bytes.count == Self.byteCount else { return nil }
+        self.bytes = bytes
+    }
+
+    /// Parses the lowercase or uppercase hexadecimal form.
+    public init?(hex: String) {
+        guard let bytes = BoxHex.decode(hex) else { return nil }
+        self.init(bytes: bytes)
+    }
+
+    /// Hashes `payload`, which is already in memory, in a single pass.
+    public init(of payload: [UInt8]) {
+        self.bytes = Array(SHA256.hash(data: payload))
+    }
+
+    /// Lowercase hexadecimal form (64 characters), used in file names and on the admin channel.
+    public var hex: String {
+        BoxHex.encode(bytes)
+    }
+
+    public var description: String {
+        hex
+    }
+}
+
+extension BoxContentDigest: Codable {
+    public init(from decoder: Decoder) throws {
+        let container = try decoder.singleValueContainer()
+        let text = try container.decode(String.self)
+        guard let digest = BoxContentDigest(hex: text) else {
+            throw DecodingError.dataCorruptedError(in: container, debugDescription: "invalid SHA-256 digest")
+        }
+        self = digest
+    }
+
+    public func encode(to encoder: Encoder) throws {
+        var container = encoder.singleValueContainer()
+        try container.encode(hex)
+    }
+}
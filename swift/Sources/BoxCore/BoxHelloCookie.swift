@@ -0,0 +1,86 @@
+import Crypto
+import Foundation
+
+/// Stateless HELLO cookies used to shed spoofed handshake floods (SPECS §5.3.2).
+///
+/// While the responder is under load it answers a key-share HELLO with `rateLimited` and a cookie
+/// instead of running X25519 or allocating a session. The cookie is a truncated HMAC-SHA256 over the
+/// source address under a secret rotated every `rotationInterval`, so the responder keeps no state per
+/// sender and only peers that can receive at their claimed address can echo it back. The value is not
+/// synchronised; it is owned by the server channel handler and touched on its event loop only.
+public struct BoxHelloCookieJar {
+    /// Cookie length in bytes.
+    public static let cookieSize = 16
+    /// Default number of key-share HELLOs per second above which cookies are required.
+    public static let defaultThreshold = 256
+    /// Secret lifetime; a cookie stays valid for one to two intervals.
+    public static let rotationInterval: TimeInterval = 120
+
+    /// Key-share HELLOs per second tolerated before cookies are demanded (0 = always demand).
+    public var threshold: Int
+
+    private var currentSecret = SymmetricKey(size: .bits256)
+    private var previousSecret: SymmetricKey?
+    private var rotatedAt: Date
+    private var windowStart: Date
+    private var windowCount = 0
+
+    /// Creates a jar with a fresh random secret.
+    public init(threshold: Int = BoxHelloCookieJar.defaultThreshold, now: Date = Date()) {
+        self.threshold = threshold
+        self.rotatedAt = now
+        self.windowStart = now
+    }
+
+    /// Records a key-share HELLO and reports whether the responder is currently under load.
+    ///
+    /// The rate is measured over fixed one-second windows; the count includes the current HELLO.
+    public mutating func recordHandshake(now: Date = Date()) -> Bool {
+        rotateIfNeeded(now: now)
+        if now.timeIntervalSince(windowStart) >= 1 || now < windowStart {
+            windowStart = now
+            windowCount = 0
+        }
+        windowCount += 1
+        return windowCount > threshold
+    }
+
+    /// Issues the cookie bound to `address`.
+    public func cookie(for address: [UInt8]) -> [UInt8] {
+        Self.mac(address, key: currentSecret)
+    }
+
+    /// Checks an echoed cookie against the current and previous secrets (constant-time compare).
+    public func validate(_ cookie: [UInt8], for address: [UInt8]) -> Bool {
+        guard cookie.count == Self.cookieSize else { return false }
+        if Self.constantTimeEquals(cookie, Self.mac(address, key: currentSecret)) {
+            return true
+        }
+        if let previousSecret, Self.constantTimeEquals(cookie, Self.mac(address, key: previousSecret)) {
+            return true
+        }
+        return false
+    }
+
+    /// Rotates the secret once `rotationInterval` has elapsed.
+    public mutating func rotateIfNeeded(now: Date = Date()) {
+        guard now.timeIntervalSince(rotatedAt) >= Self.rotationInterval else { return }
+        // After a long idle period the previous secret is stale too; drop it.
+        previousSecret = now.timeIntervalSince(rotatedAt) < 2 * Self.rotationInterval ? currentSecret : nil
+        currentSecret = SymmetricKey(size: .bits256)
+        rotatedAt = now
+    }
+
+    private static func mac(_ address: [UInt8], key: SymmetricKey) -> [UInt8] {
+        Array(HMAC<SHA256>.authenticationCode(for: address, using: key).prefix(cookieSize))
+    }
+
+    private static func constantTimeEquals(_ lhs: [UInt8], _ rhs: [UInt8]) -> Bool {
+        guard lhs.count == rhs.count else { return false }
+        var difference: UInt8 = 0
+        for index in 0..<lhs.count {
+            difference |= lhs[index] ^ rhs[index]
+        }
+        return difference == 0
+    }
+}
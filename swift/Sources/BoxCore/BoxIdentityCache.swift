@@ -0,0 +1,224 @@
+import Crypto
+import Foundation
+
+/// Immutable view of the identity material used during handshakes.
+///
+/// Keys are parsed once when the snapshot is built, so signing or looking up a peer key never decodes
+/// hex, reads a file or hops to an actor. A new snapshot replaces the previous one on rotation; readers
+/// holding the old instance keep a consistent view until they drop it.
+public final class BoxIdentitySnapshot: @unchecked Sendable {
+    /// Monotonic counter incremented on every swap (0 for the empty snapshot).
+    public let generation: UInt64
+    /// Raw node identity material, when loaded.
+    public let nodeMaterial: BoxIdentityMaterial?
+    /// Raw client identity material, when loaded.
+    public let clientMaterial: BoxIdentityMaterial?
+    /// Ed25519 public keys of known peers, indexed by node UUID.
+    public let peerKeys: [UUID: [UInt8]]
+
+    fileprivate let nodeSigningKey: Curve25519.Signing.PrivateKey?
+    fileprivate let peerVerifyingKeys: [UUID: Curve25519.Signing.PublicKey]
+
+    init(
+        generation: UInt64,
+        nodeMaterial: BoxIdentityMaterial?,
+        clientMaterial: BoxIdentityMaterial?,
+        peerKeys: [UUID: [UInt8]],
+        nodeSigningKey: Curve25519.Signing.PrivateKey?,
+        peerVerifyingKeys: [UUID: Curve25519.Signing.PublicKey]
+    ) {
+        self.generation = generation
+        self.nodeMaterial = nodeMaterial
+        self.clientMaterial = clientMaterial
+        self.peerKeys = peerKeys
+        self.nodeSigningKey = nodeSigningKey
+        self.peerVerifyingKeys = peerVerifyingKeys
+    }
+
+    /// Empty snapshot used before any identity has been loaded.
+    static let empty = BoxIdentitySnapshot(
+        generation: 0,
+        nodeMaterial: nil,
+        clientMaterial: nil,
+        peerKeys: [:],
+        nodeSigningKey: nil,
+        peerVerifyingKeys: [:]
+    )
+
+    /// Returns the identity material for `role`, if cached.
+    public func material(for role: BoxIdentityRole) -> BoxIdentityMaterial? {
+        switch role {
+        case .node:
+            return nodeMaterial
+        case .client:
+            return clientMaterial
+        }
+    }
+
+    /// Signs `message` with the cached node key.
+    /// - Returns: The Ed25519 signature, or `nil` when no node identity is loaded.
+    public func signWithNodeKey(_ message: [UInt8]) -> [UInt8]? {
+        guard let nodeSigningKey, let signature = try? nodeSigningKey.signature(for: message) else {
+            return nil
+        }
+        return Array(signature)
+    }
+
+    /// Verifies a signature produced by the peer `nodeUUID`.
+    /// - Returns: `false` when the peer is unknown or the signature does not match.
+    public func verifyPeerSignature(_ signature: [UInt8], for message: [UInt8], from nodeUUID: UUID) -> Bool {
+        guard let key = peerVerifyingKeys[nodeUUID] else { return false }
+        return key.isValidSignature(signature, for: message)
+    }
+}
+
+/// Process-wide holder of the current `BoxIdentitySnapshot`.
+///
+/// Writers (key store, Location Service) build a complete new snapshot and publish it with a single
+/// reference swap. Readers call `snapshot` from any thread, including NIO event loops: the lock only
+/// guards the reference copy, never parsing or I/O, so a handshake cannot block behind a rotation.
+public final class BoxIdentityCache: @unchecked Sendable {
+    private let lock = NSLock()
+    private var current: BoxIdentitySnapshot = .empty
+
+    public init() {}
+
+    /// Current snapshot; cheap enough to call once per datagram.
+    public var snapshot: BoxIdentitySnapshot {
+        lock.lock()
+        defer { lock.unlock() }
+        return current
+    }
+
+    /// Installs identity material for `role`, keeping the other role and the peer keys.
+    /// - Throws: `BoxNoiseKeyStore.StoreError.corrupted` when the secret key is not a valid Ed25519 key.
+    public func install(_ material: BoxIdentityMaterial, for role: BoxIdentityRole) throws {
+        var signingKey: Curve25519.Signing.PrivateKey?
+        if role == .node {
+            do {
+                signingKey = try Curve25519.Signing.PrivateKey(rawRepresentation: material.secretKey)
+            } catch {
+                throw BoxNoiseKeyStore.StoreError.corrupted("Identity material for role \(role.rawValue) is not a valid Ed25519 key.")
+            }
+        }
+        swap { previous, generation in
+            BoxIdentitySnapshot(
+                generation: generation,
+                nodeMaterial: role == .node ? material : previous.nodeMaterial,
+                clientMaterial: role == .client ? material : previous.clientMaterial,
+                peerKeys: previous.peerKeys,
+                nodeSigningKey: role == .node ? signingKey : previous.nodeSigningKey,
+                peerVerifyingKeys: previous.peerVerifyingKeys
+            )
+        }
+    }
+
+    /// Replaces the peer key table with `keys` (raw 32-byte Ed25519 public keys).
+    /// Invalid keys are skipped. The swap is skipped when the table is unchanged.
+    public func updatePeerKeys(_ keys: [UUID: [UInt8]]) {
+        var verifying: [UUID: Curve25519.Signing.PublicKey] = [:]
+        var accepted: [UUID: [UInt8]] = [:]
+        for (nodeUUID, bytes) in keys {
+            guard let key = try? Curve25519.Signing.PublicKey(rawRepresentation: bytes) else { continue }
+            verifying[nodeUUID] = key
+            accepted[nodeUUID] = bytes
+        }
+        swap { previous, generation in
+            guard accepted != previous.peerKeys else { return nil }
+            return BoxIdentitySnapshot(
+                generation: generation,
+                nodeMaterial: previous.nodeMaterial,
+                clientMaterial: previous.clientMaterial,
+                peerKeys: accepted,
+                nodeSigningKey: previous.nodeSigningKey,
+                peerVerifyingKeys: verifying
+            )
+        }
+    }
+
+    /// Adds or replaces a single peer key. The key is merged into the table current when the lock is
+    /// taken, so concurrent updates of different peers all land. An invalid key is ignored.
+    public func updatePeerKey(_ bytes: [UInt8], for nodeUUID: UUID) {
+        guard let key = try? Curve25519.Signing.PublicKey(rawRepresentation: bytes) else { return }
+        swap { previous, generation in
+            guard previous.peerKeys[nodeUUID] != bytes else { return nil }
+            var keys = previous.peerKeys
+            var verifying = previous.peerVerifyingKeys
+            keys[nodeUUID] = bytes
+            verifying[nodeUUID] = key
+            return BoxIdentitySnapshot(
+                generation: generation,
+                nodeMaterial: previous.nodeMaterial,
+                clientMaterial: previous.clientMaterial,
+                peerKeys: keys,
+                nodeSigningKey: previous.nodeSigningKey,
+                peerVerifyingKeys: verifying
+            )
+        }
+    }
+
+    /// Parses the textual key advertised in Location Service records (`hex:<64 hex digits>`, or
+    /// `ed25519:<64 hex digits>` as written by `box register`).
+    public static func peerKeyBytes(fromAdvertised value: String) -> [UInt8]? {
+        let hex = ["hex:", "ed25519:"].first(where: { value.hasPrefix($0) }).map { String(value.dropFirst($0.count)) } ?? value
+        guard let bytes = BoxHex.decode(hex), bytes.count == 32 else { return nil }
+        return bytes
+    }
+
+    /// Publishes the successor of the current snapshot, or keeps it when `build` returns `nil`. Keys are
+    /// parsed by the callers before this point, so the closure only compares and assembles
+    /// already-decoded values while the lock is held; reading the table and replacing it happen under
+    /// the same lock, so no concurrent update is lost.
+    private func swap(_ build: (BoxIdentitySnapshot, UInt64) -> BoxIdentitySnapshot?) {
+        lock.lock()
+        defer { lock.unlock() }
+        if let next = build(current, current.generation &+ 1) {
+            current = next
+        }
+    }
+}
+
+/// Lowercase hexadecimal helpers working directly on UTF-8 code units.
+public enum BoxHex {
+    private static let digits = Array("0123456789abcdef".utf8)
+
+    /// Encodes `bytes` as lowercase hexadecimal.
+    public static func encode(_ bytes: [UInt8]) -> String {
+        var output = [UInt8]()
+        output.reserveCapacity(bytes.count * 2)
+        for byte in bytes {
+            output.append(digits[Int(byte >> 4)])
+            output.append(digits[Int(byte & 0x0f)])
+        }
+        return String(decoding: output, as: UTF8.self)
+    }
+
+    /// Decodes hexadecimal text (either case).
+    /// - Returns: `nil` on odd length or non-hex characters.
+    public static func decode(_ string: String) -> [UInt8]? {
+        let units = Array(string.utf8)
+        guard units.count % 2 == 0 else { return nil }
+        var result = [UInt8]()
+        result.reserveCapacity(units.count / 2)
+        var index = 0
+        while index < units.count {
+            guard let high = nibble(units[index]), let low = nibble(units[index + 1]) else { return nil }
+            result.append(high << 4 | low)
+            index += 2
+        }
+        return result
+    }
+
+    private static func nibble(_ unit: UInt8) -> UInt8? {
+        switch unit {
+        case UInt8(ascii: "0")...UInt8(ascii: "9"):
+            return unit - UInt8(ascii: "0")
+        case UInt8(ascii: "a")...UInt8(ascii: "f"):
+            return unit - UInt8(ascii: "a") + 10
+        case UInt8(ascii: "A")...UInt8(ascii: "F"):
+            return unit - UInt8(ascii: "A") + 10
+        default:
+            return nil
+        }
+    }
+}
@@ -0,0 +1,69 @@
+import Foundation
+
+/// Sliding-window replay filter keyed on the session nonce counter (SPECS §5.3.1).
+///
+/// The window is a fixed ring of 64-bit words allocated once per session: accepting or rejecting a
+/// counter touches one word, and advancing the window clears at most `wordCount` words, so the cost
+/// per packet is bounded and allocation free. The value is not synchronised; it lives inside a
+/// `BoxSession` owned by a single event loop.
+public struct BoxReplayWindow: Sendable {
+    /// Default number of tracked counters.
+    public static let defaultSize = 2048
+    /// Accepted bounds for the configurable size (`server.replay_window`).
+    public static let sizeRange = 128...65_536
+
+    /// Number of bits in the ring (multiple of 64).
+    public let size: Int
+    private var words: [UInt64]
+    private var highest: UInt64 = 0
+
+    /// Creates an empty window.
+    /// - Parameter size: Requested number of bits, clamped to `sizeRange` and rounded up to a multiple of 64.
+    public init(size: Int = BoxReplayWindow.defaultSize) {
+        let clamped = min(max(size, Self.sizeRange.lowerBound), Self.sizeRange.upperBound)
+        let rounded = (clamped + 63) & ~63
+        self.size = rounded
+        self.words = [UInt64](repeating: 0, count: rounded / 64)
+    }
+
+    /// Distance behind the highest counter that is still accepted. One word is sacrificed so the
+    /// word holding `highest` can be recycled without losing the older bits.
+    public var span: UInt64 {
+        UInt64(size - 64)
+    }
+
+    /// Returns whether `counter` would be accepted, without recording it.
+    public func wouldAccept(_ counter: UInt64) -> Bool {
+        guard counter > 0 else { return false }
+        if counter > highest { return true }
+        guard highest - counter < span else { return false }
+        let (word, mask) = position(of: counter)
+        return words[word] & mask == 0
+    }
+
+    /// Records `counter` as seen. Call only after the frame authenticated successfully.
+    /// - Returns: `false` when the counter is a replay or too old.
+    @discardableResult
+    public mutating func accept(_ counter: UInt64) -> Bool {
+        guard wouldAccept(counter) else { return false }
+        if counter > highest {
+            let currentWord = highest >> 6
+            let targetWord = counter >> 6
+            let advance = min(targetWord - currentWord, UInt64(words.count))
+            if advance > 0 {
+                for step in 1...advance {
+                    words[Int((currentWord + step) % UInt64(words.count))] = 0
+                }
+            }
+            highest = counter
+        }
+        let (word, mask) = position(of: counter)
+        words[word] |= mask
+        return true
+    }
+
+    private func position(of counter: UInt64) -> (word: Int, mask: UInt64) {
+        let word = Int((counter >> 6) % UInt64(words.count))
+        return (word, 1 << (counter & 63))
+    }
+}
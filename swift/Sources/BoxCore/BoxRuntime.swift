@@ -13,10 +13,16 @@ public enum BoxRuntimeMode: Sendable {
 public enum BoxClientAction: Sendable {
     /// Perform only the HELLO/STATUS handshake and exit.
     case handshake
-    /// Send a PUT request with the given queue path, content type, and payload bytes.
-    case put(queuePath: String, contentType: String, data: [UInt8])
+    /// Send a PUT request with the given queue path, content type, and payload bytes. With `notBefore`,
+    /// the server holds the object back until that date; `priority` (0…7) moves it ahead of lower classes.
+    case put(queuePath: String, contentType: String, data: [UInt8], notBefore: Date? = nil, priority: UInt8 = 0)
     /// Send a GET request for the supplied queue path.
     case get(queuePath: String)
+    /// Apply a consumer cursor operation. `.next` fetches the next object and commits it once received;
+    /// `.lease` leases the oldest object and acknowledges it once received.
+    case cursor(queuePath: String, cursor: String, operation: BoxCodec.CursorOperation)
+    /// Send DELETE requests removing the targets from the queue (split into frames of `BoxCodec.maxDeleteTargets`).
+    case delete(queuePath: String, targets: [BoxCodec.DeleteTarget])
     /// Resolve a Location Service record for the supplied node identifier.
     case locate(node: UUID)
     /// Perform a handshake and capture the server STATUS response.
@@ -150,6 +156,9 @@ public struct BoxRuntimeOptions: Sendable {
     public var bindAddress: String?
     /// Optional local UDP port used when binding the client UDP socket.
     public var bindPort: UInt16?
+    /// Ed25519 node key expected from the server (client). When set, the HELLO response must carry a
+    /// key share signed with it, otherwise the handshake fails.
+    public var serverPublicKey: [UInt8]?
 
     /// Creates a new bundle of runtime options.
     /// - Parameters:
@@ -189,7 +198,8 @@ public struct BoxRuntimeOptions: Sendable {
         permanentQueues: Set<String> = [],
         rootServers: [RootServer] = [],
         bindAddress: String? = nil,
-        bindPort: UInt16? = nil
+        bindPort: UInt16? = nil,
+        serverPublicKey: [UInt8]? = nil
     ) {
         self.mode = mode
         self.address = address
@@ -214,6 +224,7 @@ public struct BoxRuntimeOptions: Sendable {
         self.rootServers = rootServers
         self.bindAddress = bindAddress
         self.bindPort = bindPort
+        self.serverPublicKey = serverPublicKey
     }
 }
 
@@ -0,0 +1,242 @@
+import Crypto
+import Foundation
+import NIOCore
+
+/// Errors raised while establishing or using an encrypted session.
+public enum BoxSessionError: Error, Equatable {
+    /// The peer key share is not a valid X25519 public key.
+    case invalidKeyShare
+    /// The responder signature does not match the expected identity.
+    case invalidSignature
+    /// The sealed payload is shorter than the counter + tag overhead.
+    case truncated
+    /// The frame is not sealed or lacks its authenticated header.
+    case notSealed
+    /// AEAD authentication failed (tampered frame or wrong key).
+    case authenticationFailed
+    /// The counter was already accepted or fell behind the replay window.
+    case replayed
+    /// The send counter reached its maximum; a new handshake is required.
+    case counterExhausted
+}
+
+/// Ephemeral X25519 key pair used for one HELLO exchange.
+///
+/// The initiator sends `publicKey` in the HELLO `keyShare` extension, the responder answers with its
+/// own share plus an Ed25519 signature of the transcript. An initiator acting for a node (queue
+/// mirroring) may sign `initiatorTranscript` to authenticate itself as well. Both sides then derive directional
+/// ChaCha20-Poly1305 keys with HKDF-SHA256.
+public struct BoxSessionHandshake {
+    private static let label = Array("box/session/v1".utf8)
+
+    private let privateKey: Curve25519.KeyAgreement.PrivateKey
+
+    /// Ephemeral public key advertised to the peer.
+    public var publicKey: [UInt8] {
+        Array(privateKey.publicKey.rawRepresentation)
+    }
+
+    /// Generates a fresh ephemeral key pair.
+    public init() {
+        self.privateKey = Curve25519.KeyAgreement.PrivateKey()
+    }
+
+    /// Transcript bound by the responder signature: label, initiator share, responder share.
+    public static func transcript(initiatorShare: [UInt8], responderShare: [UInt8]) -> [UInt8] {
+        label + initiatorShare + responderShare
+    }
+
+    /// Bytes an initiator signs with its node key to bind its share to `node` (HELLO `signature`).
+    /// Only the holder of the ephemeral private key can use the resulting session, so a replayed HELLO
+    /// gains nothing.
+    public static func initiatorTranscript(initiatorShare: [UInt8], node: UUID) -> [UInt8] {
+        let uuid = node.uuid
+        let nodeBytes: [UInt8] = [
+            uuid.0, uuid.1, uuid.2, uuid.3, uuid.4, uuid.5, uuid.6, uuid.7,
+            uuid.8, uuid.9, uuid.10, uuid.11, uuid.12, uuid.13, uuid.14, uuid.15
+        ]
+        return label + Array("/initiator".utf8) + initiatorShare + nodeBytes
+    }
+
+    /// Derives the session once the peer share is known.
+    /// - Parameters:
+    ///   - peerShare: Ephemeral public key received from the peer.
+    ///   - role: Local role (initiator = client, responder = server).
+    ///   - replayWindowSize: Number of counters tracked by the replay window.
+    /// - Returns: A session ready to seal and open frames.
+    public func session(peerShare: [UInt8], role: BoxSession.Role, replayWindowSize: Int = BoxReplayWindow.defaultSize) throws -> BoxSession {
+        let peerKey: Curve25519.KeyAgreement.PublicKey
+        do {
+            peerKey = try Curve25519.KeyAgreement.PublicKey(rawRepresentation: peerShare)
+        } catch {
+            throw BoxSessionError.invalidKeyShare
+        }
+        let shared = try privateKey.sharedSecretFromKeyAgreement(with: peerKey)
+        let transcript: [UInt8]
+        switch role {
+        case .initiator:
+            transcript = Self.transcript(initiatorShare: publicKey, responderShare: peerShare)
+        case .responder:
+            transcript = Self.transcript(initiatorShare: peerShare, responderShare: publicKey)
+        }
+        let salt = Array(SHA256.hash(data: transcript))
+        let initiatorToResponder = shared.hkdfDerivedSymmetricKey(using: SHA256.self, salt: salt, sharedInfo: Self.label + Array("/i2r".utf8), outputByteCount: 32)
+        let responderToInitiator = shared.hkdfDerivedSymmetricKey(using: SHA256.self, salt: salt, sharedInfo: Self.label + Array("/r2i".utf8), outputByteCount: 32)
+        switch role {
+        case .initiator:
+            return BoxSession(sendKey: initiatorToResponder, receiveKey: responderToInitiator, replayWindowSize: replayWindowSize)
+        case .responder:
+            return BoxSession(sendKey: responderToInitiator, receiveKey: initiatorToResponder, replayWindowSize: replayWindowSize)
+        }
+    }
+
+    /// Verifies the responder signature over the transcript.
+    /// - Parameters:
+    ///   - signature: Signature received in the HELLO response.
+    ///   - transcript: Transcript built with `transcript(initiatorShare:responderShare:)`.
+    ///   - publicKey: Expected Ed25519 node identity key.
+    public static func verify(signature: [UInt8], transcript: [UInt8], publicKey: [UInt8]) throws {
+        guard let key = try? Curve25519.Signing.PublicKey(rawRepresentation: publicKey),
+              key.isValidSignature(signature, for: transcript) else {
+            throw BoxSessionError.invalidSignature
+        }
+    }
+}
+
+/// Directional AEAD state shared by both ends after a HELLO key exchange.
+///
+/// Sealed payload layout: 8-byte big-endian counter, ciphertext, 16-byte Poly1305 tag. The nonce is
+/// four zero bytes followed by the counter, so it is never random and never repeats for a key. The
+/// whole frame header (with `BoxCodec.sealedCommandFlag` set) is authenticated as associated data.
+/// The value is mutated on every frame and must stay confined to the event loop that owns the peer.
+public struct BoxSession {
+    /// Side of the handshake.
+    public enum Role: Sendable {
+        case initiator
+        case responder
+    }
+
+    /// Bytes added to every sealed payload (counter + tag).
+    public static let overhead = 8 + 16
+
+    private let sendKey: SymmetricKey
+    private let receiveKey: SymmetricKey
+    private var sendCounter: UInt64 = 0
+    private var replayWindow: BoxReplayWindow
+
+    init(sendKey: SymmetricKey, receiveKey: SymmetricKey, replayWindowSize: Int) {
+        self.sendKey = sendKey
+        self.receiveKey = receiveKey
+        self.replayWindow = BoxReplayWindow(size: replayWindowSize)
+    }
+
+    /// Encodes `frame` and seals its payload in the output buffer (no intermediate payload buffer).
+    /// - Parameters:
+    ///   - frame: Plaintext frame.
+    ///   - allocator: Byte buffer allocator from the channel.
+    /// - Returns: Datagram ready to be written.
+    public mutating func seal(_ frame: BoxCodec.Frame, allocator: ByteBufferAllocator) throws -> ByteBuffer {
+        var buffer = allocator.buffer(capacity: BoxCodec.headerSize + Self.overhead + frame.payload.readableBytes)
+        try append(frame, to: &buffer)
+        return buffer
+    }
+
+    /// Seals several frames into one allocation and returns one datagram slice per frame.
+    ///
+    /// Multi-frame responses (SEARCH/sync streams) pay for a single buffer instead of one per frame.
+    public mutating func seal(_ frames: [BoxCodec.Frame], allocator: ByteBufferAllocator) throws -> [ByteBuffer] {
+        let total = frames.reduce(0) { $0 + BoxCodec.headerSize + Self.overhead + $1.payload.readableBytes }
+        var buffer = allocator.buffer(capacity: total)
+        var ranges: [(start: Int, length: Int)] = []
+        ranges.reserveCapacity(frames.count)
+        for frame in frames {
+            let start = buffer.writerIndex
+            try append(frame, to: &buffer)
+            ranges.append((start, buffer.writerIndex - start))
+        }
+        return ranges.compactMap { buffer.getSlice(at: $0.start, length: $0.length) }
+    }
+
+    /// Authenticates and decrypts a sealed frame, replacing its payload with the plaintext.
+    ///
+    /// The plaintext is written back over the ciphertext in the frame's own buffer.
+    public mutating func open(_ frame: inout BoxCodec.Frame) throws {
+        guard frame.isSealed, let header = frame.authenticatedHeader else {
+            throw BoxSessionError.notSealed
+        }
+        let start = frame.payload.readerIndex
+        let sealedLength = frame.payload.readableBytes
+        guard sealedLength >= Self.overhead,
+              let counter = frame.payload.getInteger(at: start, endianness: .big, as: UInt64.self) else {
+            throw BoxSessionError.truncated
+        }
+        guard replayWindow.wouldAccept(counter) else {
+            throw BoxSessionError.replayed
+        }
+
+        let nonce = try Self.nonce(for: counter)
+        let ciphertextLength = sealedLength - Self.overhead
+        let key = receiveKey
+        let plaintext: Data
+        do {
+            plaintext = try frame.payload.withUnsafeReadableBytes { raw in
+                try header.withUnsafeReadableBytes { aad in
+                    let box = try ChaChaPoly.SealedBox(
+                        nonce: nonce,
+                        ciphertext: UnsafeRawBufferPointer(rebasing: raw[8..<(8 + ciphertextLength)]),
+                        tag: UnsafeRawBufferPointer(rebasing: raw[(8 + ciphertextLength)...])
+                    )
+                    return try ChaChaPoly.open(box, using: key, authenticating: aad)
+                }
+            }
+        } catch {
+            throw BoxSessionError.authenticationFailed
+        }
+        replayWindow.accept(counter)
+
+        frame.payload.setBytes(plaintext, at: start + 8)
+        frame.payload = frame.payload.getSlice(at: start + 8, length: plaintext.count) ?? frame.payload
+        frame.isSealed = false
+        frame.authenticatedHeader = nil
+    }
+
+    private mutating func append(_ frame: BoxCodec.Frame, to buffer: inout ByteBuffer) throws {
+        guard sendCounter < UInt64.max else {
+            throw BoxSessionError.counterExhausted
+        }
+        sendCounter += 1
+        let counter = sendCounter
+        let payloadLength = frame.payload.readableBytes
+
+        let headerStart = buffer.writerIndex
+        BoxCodec.writeHeader(for: frame, payloadLength: Self.overhead + payloadLength, sealed: true, into: &buffer)
+        buffer.writeInteger(counter, endianness: .big)
+        let payloadStart = buffer.writerIndex
+        var plaintext = frame.payload
+        buffer.writeBuffer(&plaintext)
+
+        let nonce = try Self.nonce(for: counter)
+        let headerOffset = headerStart - buffer.readerIndex
+        let payloadOffset = payloadStart - buffer.readerIndex
+        let key = sendKey
+        let sealed = try buffer.withUnsafeReadableBytes { raw in
+            let aad = UnsafeRawBufferPointer(rebasing: raw[headerOffset..<(headerOffset + BoxCodec.headerSize)])
+            let body = UnsafeRawBufferPointer(rebasing: raw[payloadOffset..<(payloadOffset + payloadLength)])
+            return try ChaChaPoly.seal(body, using: key, nonce: nonce, authenticating: aad)
+        }
+        // Ciphertext overwrites the plaintext in place; only the tag extends the buffer.
+        buffer.setBytes(sealed.ciphertext, at: payloadStart)
+        buffer.writeBytes(sealed.tag)
+    }
+
+    private static func nonce(for counter: UInt64) throws -> ChaChaPoly.Nonce {
+        var bytes = [UInt8](repeating: 0, count: 12)
+        var value = counter.bigEndian
+        withUnsafeBytes(of: &value) { raw in
+            for index in 0..<8 {
+                bytes[4 + index] = raw[index]
+            }
+        }
+        return try ChaChaPoly.Nonce(data: bytes)
+    }
+}
@@ -9,6 +9,16 @@ public struct BoxIdentityMaterial: Codable, Equatable, Sendable {
     public var secretKey: [UInt8]
 }
 
+extension BoxIdentityMaterial {
+    /// Signs `message` with the Ed25519 secret key.
+    /// - Parameter message: Bytes to sign (e.g. a session handshake transcript).
+    /// - Returns: 64-byte Ed25519 signature.
+    public func signature(for message: [UInt8]) throws -> [UInt8] {
+        let key = try Curve25519.Signing.PrivateKey(rawRepresentation: Data(secretKey))
+        return Array(try key.signature(for: message))
+    }
+}
+
 /// Distinguishes between the supported identity roles.
 public enum BoxIdentityRole: String, Sendable {
     case node
@@ -25,6 +35,9 @@ public enum BoxIdentityRole: String, Sendable {
 }
 
 /// Stores Noise identity key material under `~/.box/keys`.
+///
+/// Every identity loaded or generated through the store is also installed in `cache`, so hot paths
+/// (HELLO handling on event loops) read parsed keys synchronously instead of awaiting the actor.
 public actor BoxNoiseKeyStore {
     public enum StoreError: Error, LocalizedError {
         case storageUnavailable(String)
@@ -42,9 +55,15 @@ public actor BoxNoiseKeyStore {
 
     private let baseDirectory: URL
     private let fileManager = FileManager.default
+    /// Snapshot of the identities handled by this store, readable from any thread.
+    public nonisolated let cache: BoxIdentityCache
 
     /// Creates a key store rooted at the supplied directory (defaults to `~/.box/keys`).
-    public init(baseDirectory: URL? = nil) throws {
+    /// - Parameters:
+    ///   - baseDirectory: Key directory override.
+    ///   - cache: Identity cache fed by the store (shared with other components when provided).
+    public init(baseDirectory: URL? = nil, cache: BoxIdentityCache = BoxIdentityCache()) throws {
+        self.cache = cache
         if let baseDirectory {
             self.baseDirectory = baseDirectory
         } else if let resolved = BoxPaths.boxDirectory()?.appendingPathComponent("keys", isDirectory: true) {
@@ -62,11 +81,16 @@ public actor BoxNoiseKeyStore {
 
     /// Loads the identity material, creating a fresh one when missing.
     public func ensureIdentity(for role: BoxIdentityRole) throws -> BoxIdentityMaterial {
+        if let cached = cache.snapshot.material(for: role) {
+            return cached
+        }
         if let existing = try loadIdentityIfPresent(for: role) {
+            try cache.install(existing, for: role)
             return existing
         }
         let generated = generateIdentityMaterial()
         try persist(generated, for: role)
+        try cache.install(generated, for: role)
         return generated
     }
 
@@ -76,6 +100,7 @@ public actor BoxNoiseKeyStore {
     public func regenerateIdentity(for role: BoxIdentityRole) throws -> BoxIdentityMaterial {
         let generated = generateIdentityMaterial()
         try persist(generated, for: role)
+        try cache.install(generated, for: role)
         return generated
     }
 
@@ -109,7 +134,11 @@ public actor BoxNoiseKeyStore {
 
     /// Loads the existing identity material.
     public func loadIdentity(for role: BoxIdentityRole) throws -> BoxIdentityMaterial {
+        if let cached = cache.snapshot.material(for: role) {
+            return cached
+        }
         if let existing = try loadIdentityIfPresent(for: role) {
+            try cache.install(existing, for: role)
             return existing
         }
         throw StoreError.storageUnavailable("Identity not found for role \(role.rawValue).")
@@ -181,29 +210,14 @@ public actor BoxNoiseKeyStore {
         }
 
         static func hexString(from bytes: [UInt8]) -> String {
-            bytes.map { String(format: "%02x", $0) }.joined()
+            BoxHex.encode(bytes)
         }
 
         private static func bytes(fromHex string: String) -> [UInt8]? {
-            let characters = Array(string)
-            guard characters.count % 2 == 0 else { return nil }
-            var result: [UInt8] = []
-            result.reserveCapacity(characters.count / 2)
-            var index = 0
-            while index < characters.count {
-                let byteString = String(characters[index..<(index + 2)])
-                guard let value = UInt8(byteString, radix: 16) else { return nil }
-                result.append(value)
-                index += 2
-            }
-            return result
+            BoxHex.decode(string)
         }
     }
 
-    private static func hexString(from bytes: [UInt8]) -> String {
-        bytes.map { String(format: "%02x", $0) }.joined()
-    }
-
     private struct IdentityLink: Codable {
         let algorithm: String
         let createdAt: String
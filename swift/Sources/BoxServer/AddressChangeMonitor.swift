@@ -0,0 +1,335 @@
+import BoxCore
+import Foundation
+import Logging
+import NIOConcurrencyHelpers
+
+#if os(Linux)
+import Glibc
+#elseif os(Windows)
+import WinSDK
+#else
+import Darwin
+#endif
+
+/// Watches the local interface addresses and reports changes that may affect the advertised endpoints.
+///
+/// On Linux the monitor subscribes to the `NETLINK_ROUTE` multicast groups for IPv4/IPv6 addresses and
+/// reacts to `RTM_NEWADDR` / `RTM_DELADDR` once a burst has been quiet for `debounce`. The socket is
+/// non-blocking and read by a dispatch read source, so no thread waits on it and nothing wakes while
+/// addresses are stable. Other platforms (or a Linux host where the netlink socket cannot be opened)
+/// fall back to comparing `getifaddrs` snapshots periodically.
+final class AddressChangeMonitor: @unchecked Sendable {
+    /// Address family reported by a netlink message.
+    enum Family: String, Sendable {
+        case ipv4
+        case ipv6
+    }
+
+    /// Single address event decoded from a netlink datagram.
+    struct Event: Equatable, Sendable {
+        enum Kind: String, Sendable {
+            case added
+            case removed
+        }
+
+        var kind: Kind
+        var family: Family
+        var scope: UInt8
+        var interfaceIndex: UInt32
+
+        /// Host (`RT_SCOPE_HOST`) and link (`RT_SCOPE_LINK`) scoped addresses never reach peers.
+        var affectsReachability: Bool {
+            scope != Netlink.scopeHost && scope != Netlink.scopeLink
+        }
+    }
+
+    /// Coalesced description of the changes observed during one debounce window.
+    struct Change: Sendable {
+        var families: Set<Family>
+        var added: Int
+        var removed: Int
+        var source: String
+
+        var metadata: Logger.Metadata {
+            [
+                "families": .string(families.map(\.rawValue).sorted().joined(separator: ",")),
+                "added": .string("\(added)"),
+                "removed": .string("\(removed)"),
+                "source": .string(source)
+            ]
+        }
+    }
+
+    /// Netlink constants (`linux/netlink.h`, `linux/rtnetlink.h`) — not exported by Glibc.
+    enum Netlink {
+        static let family: Int32 = 16
+        static let protocolRoute: Int32 = 0
+        static let groupIPv4Address: UInt32 = 0x10
+        static let groupIPv6Address: UInt32 = 0x100
+        static let messageDone: UInt16 = 3
+        static let messageNewAddress: UInt16 = 20
+        static let messageDeleteAddress: UInt16 = 21
+        static let headerSize = 16
+        static let addressMessageSize = 8
+        static let scopeLink: UInt8 = 253
+        static let scopeHost: UInt8 = 254
+    }
+
+    /// Source of the events while the monitor runs: the netlink read source, or the polling task.
+    private struct Running {
+        var task: Task<Void, Never>?
+        var source: DispatchSourceRead?
+    }
+
+    private let logger: Logger
+    private let debounce: TimeInterval
+    private let pollInterval: TimeInterval
+    private let onChange: @Sendable (Change) -> Void
+    private let running = NIOLockedValueBox<Running?>(nil)
+    private let queue = DispatchQueue(label: "box.address-monitor")
+    /// Change being coalesced and its pending delivery; only touched on `queue`.
+    private var pending: Change?
+    private var flush: DispatchWorkItem?
+
+    /// Creates a monitor.
+    /// - Parameters:
+    ///   - logger: Logger used for diagnostics.
+    ///   - debounce: Quiet period used to coalesce bursts of events (a renumbering emits several).
+    ///   - pollInterval: Period of the `getifaddrs` fallback.
+    ///   - onChange: Callback invoked once per coalesced change.
+    init(
+        logger: Logger,
+        debounce: TimeInterval = 1,
+        pollInterval: TimeInterval = 30,
+        onChange: @escaping @Sendable (Change) -> Void
+    ) {
+        self.logger = logger
+        self.debounce = debounce
+        self.pollInterval = pollInterval
+        self.onChange = onChange
+    }
+
+    func start() {
+#if os(Windows)
+        logger.info("address change monitor not available on Windows yet")
+#else
+        running.withLockedValue { running in
+            guard running == nil else { return }
+#if os(Linux)
+            if let descriptor = openNetlinkSocket() {
+                let source = DispatchSource.makeReadSource(fileDescriptor: descriptor, queue: queue)
+                source.setEventHandler { [weak self] in
+                    self?.receiveNetlink(from: descriptor, source: source)
+                }
+                source.setCancelHandler { [weak self] in
+                    close(descriptor)
+                    self?.flush?.cancel()
+                    self?.flush = nil
+                }
+                source.activate()
+                running = Running(task: nil, source: source)
+                logger.info("address change monitor started", metadata: ["source": "netlink"])
+                return
+            }
+#endif
+            logger.info("address change monitor started", metadata: ["source": "poll", "interval": .string("\(Int(pollInterval))s")])
+            running = Running(task: Task.detached { [weak self] in await self?.poll() }, source: nil)
+        }
+#endif
+    }
+
+    func stop() {
+        guard let stopped = running.withLockedValue({ running -> Running? in
+            defer { running = nil }
+            return running
+        }) else { return }
+        stopped.task?.cancel()
+        stopped.source?.cancel()
+    }
+
+    /// Adds `events` to the change being coalesced and postpones its delivery until `debounce` has
+    /// passed without another event.
+    func report(_ events: [Event]) {
+        queue.async { self.coalesce(events) }
+    }
+
+    /// `report` on `queue`.
+    private func coalesce(_ events: [Event]) {
+        let events = events.filter(\.affectsReachability)
+        guard !events.isEmpty else { return }
+        var change = pending ?? Change(families: [], added: 0, removed: 0, source: "netlink")
+        for event in events {
+            change.families.insert(event.family)
+            switch event.kind {
+            case .added: change.added += 1
+            case .removed: change.removed += 1
+            }
+        }
+        pending = change
+        flush?.cancel()
+        let item = DispatchWorkItem { [weak self] in
+            guard let self, let change = self.pending else { return }
+            self.pending = nil
+            self.flush = nil
+            self.onChange(change)
+        }
+        flush = item
+        queue.asyncAfter(deadline: .now() + debounce, execute: item)
+    }
+
+#if !os(Windows)
+    private func poll() async {
+        var previous = Self.currentAddresses()
+        while !Task.isCancelled {
+            do {
+                try await Task.sleep(nanoseconds: UInt64(pollInterval * 1_000_000_000))
+            } catch {
+                return
+            }
+            let current = Self.currentAddresses()
+            guard current != previous else { continue }
+            let added = current.subtracting(previous)
+            let removed = previous.subtracting(current)
+            var families = Set<Family>()
+            for address in added.union(removed) {
+                families.insert(address.contains(":") ? .ipv6 : .ipv4)
+            }
+            previous = current
+            onChange(Change(families: families, added: added.count, removed: removed.count, source: "poll"))
+        }
+    }
+
+    /// Returns the numeric addresses of every non-loopback interface that is up.
+    static func currentAddresses() -> Set<String> {
+        var ifaddrPointer: UnsafeMutablePointer<ifaddrs>?
+        guard getifaddrs(&ifaddrPointer) == 0, let basePointer = ifaddrPointer else {
+            return []
+        }
+        defer { freeifaddrs(basePointer) }
+
+        var addresses = Set<String>()
+        var cursor: UnsafeMutablePointer<ifaddrs>? = basePointer
+        while let entry = cursor {
+            cursor = entry.pointee.ifa_next
+            let flags = Int32(bitPattern: UInt32(entry.pointee.ifa_flags))
+            guard (flags & Int32(IFF_UP)) != 0, (flags & Int32(IFF_LOOPBACK)) == 0 else { continue }
+            guard let address = entry.pointee.ifa_addr else { continue }
+            let family = Int32(address.pointee.sa_family)
+            guard family == AF_INET || family == AF_INET6 else { continue }
+            if let host = numericHostString(for: UnsafePointer(address)) {
+                addresses.insert(host)
+            }
+        }
+        return addresses
+    }
+#endif
+
+#if os(Linux)
+    /// `struct sockaddr_nl` laid out by hand (12 bytes).
+    private struct NetlinkSocketAddress {
+        var family: UInt16 = UInt16(Netlink.family)
+        var padding: UInt16 = 0
+        var pid: UInt32 = 0
+        var groups: UInt32
+    }
+
+    private func openNetlinkSocket() -> Int32? {
+        let descriptor = socket(Netlink.family, Int32(SOCK_RAW.rawValue) | Int32(SOCK_NONBLOCK.rawValue) | Int32(SOCK_CLOEXEC.rawValue), Netlink.protocolRoute)
+        guard descriptor >= 0 else {
+            logger.debug("netlink socket unavailable", metadata: ["errno": .string("\(errno)")])
+            return nil
+        }
+
+        var address = NetlinkSocketAddress(groups: Netlink.groupIPv4Address | Netlink.groupIPv6Address)
+        let bound = withUnsafePointer(to: &address) { pointer in
+            bind(
+                descriptor,
+                UnsafeRawPointer(pointer).assumingMemoryBound(to: sockaddr.self),
+                socklen_t(MemoryLayout<NetlinkSocketAddress>.size)
+            )
+        }
+        guard bound == 0 else {
+            logger.debug("netlink bind failed", metadata: ["errno": .string("\(errno)")])
+            close(descriptor)
+            return nil
+        }
+        return descriptor
+    }
+
+    /// Reads every datagram available on `descriptor` (on `queue`).
+    private func receiveNetlink(from descriptor: Int32, source: DispatchSourceRead) {
+        var buffer = [UInt8](repeating: 0, count: 8192)
+        while true {
+            let received = buffer.withUnsafeMutableBytes { raw in
+                recv(descriptor, raw.baseAddress, raw.count, 0)
+            }
+            if received > 0 {
+                coalesce(Self.parseNetlinkMessages(Array(buffer[0..<received])))
+                continue
+            }
+            let error = errno
+            if received < 0 && error == EINTR { continue }
+            if received < 0 && error != EAGAIN && error != EWOULDBLOCK {
+                logger.warning("netlink receive failed", metadata: ["errno": .string("\(error)")])
+                source.cancel()
+            }
+            return
+        }
+    }
+#endif
+
+    /// Extracts the address events contained in a netlink datagram.
+    ///
+    /// Messages other than `RTM_NEWADDR` / `RTM_DELADDR` are skipped; truncated messages end the parse.
+    static func parseNetlinkMessages(_ bytes: [UInt8]) -> [Event] {
+        var events: [Event] = []
+        var offset = 0
+        while offset + Netlink.headerSize <= bytes.count {
+            let length = Int(readHostUInt32(bytes, at: offset))
+            let type = readHostUInt16(bytes, at: offset + 4)
+            guard length >= Netlink.headerSize, offset + length <= bytes.count else { break }
+            if type == Netlink.messageDone { break }
+
+            if type == Netlink.messageNewAddress || type == Netlink.messageDeleteAddress,
+               length >= Netlink.headerSize + Netlink.addressMessageSize {
+                let body = offset + Netlink.headerSize
+                let family: Family?
+                switch Int32(bytes[body]) {
+                case AF_INET: family = .ipv4
+                case AF_INET6: family = .ipv6
+                default: family = nil
+                }
+                if let family {
+                    events.append(
+                        Event(
+                            kind: type == Netlink.messageNewAddress ? .added : .removed,
+                            family: family,
+                            scope: bytes[body + 3],
+                            interfaceIndex: readHostUInt32(bytes, at: body + 4)
+                        )
+                    )
+                }
+            }
+            // NLMSG_ALIGN: messages are padded to 4 bytes.
+            offset += (length + 3) & ~3
+        }
+        return events
+    }
+
+    private static func readHostUInt32(_ bytes: [UInt8], at offset: Int) -> UInt32 {
+        var value: UInt32 = 0
+        withUnsafeMutableBytes(of: &value) { raw in
+            for index in 0..<4 { raw[index] = bytes[offset + index] }
+        }
+        return value
+    }
+
+    private static func readHostUInt16(_ bytes: [UInt8], at offset: Int) -> UInt16 {
+        var value: UInt16 = 0
+        withUnsafeMutableBytes(of: &value) { raw in
+            raw[0] = bytes[offset]
+            raw[1] = bytes[offset + 1]
+        }
+        return value
+    }
+}
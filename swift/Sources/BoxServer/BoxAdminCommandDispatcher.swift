@@ -10,6 +10,8 @@ struct BoxAdminCommandDispatcher: Sendable {
     private let natProbe: @Sendable (String?) async -> String
     private let locationSummaryProvider: @Sendable () async -> String
     private let syncRoots: @Sendable () async -> String
+    private let storeCompaction: @Sendable (String?, Bool) async -> String
+    private let snapshot: @Sendable (String, String?) async -> String
 
     init(
         statusProvider: @escaping @Sendable () async -> String,
@@ -19,7 +21,9 @@ struct BoxAdminCommandDispatcher: Sendable {
         locateNode: @escaping @Sendable (UUID) async -> String,
         natProbe: @escaping @Sendable (String?) async -> String,
         locationSummaryProvider: @escaping @Sendable () async -> String,
-        syncRoots: @escaping @Sendable () async -> String
+        syncRoots: @escaping @Sendable () async -> String,
+        storeCompaction: @escaping @Sendable (String?, Bool) async -> String,
+        snapshot: @escaping @Sendable (String, String?) async -> String
     ) {
         self.statusProvider = statusProvider
         self.logTargetUpdater = logTargetUpdater
@@ -29,6 +33,8 @@ struct BoxAdminCommandDispatcher: Sendable {
         self.natProbe = natProbe
         self.locationSummaryProvider = locationSummaryProvider
         self.syncRoots = syncRoots
+        self.storeCompaction = storeCompaction
+        self.snapshot = snapshot
     }
 
     func process(_ rawValue: String) async -> String {
@@ -57,6 +63,10 @@ struct BoxAdminCommandDispatcher: Sendable {
             return await locationSummaryProvider()
         case .syncRoots:
             return await syncRoots()
+        case .storeCompact(let queue, let statusOnly):
+            return await storeCompaction(queue, statusOnly)
+        case .snapshot(let path, let base):
+            return await snapshot(path, base)
         case .invalid(let message):
             return adminResponse(["status": "error", "message": message])
         case .unknown(let value):
@@ -134,6 +144,35 @@ struct BoxAdminCommandDispatcher: Sendable {
         if command == "location-summary" {
             return .locationSummary
         }
+        if command == "store compact-status" {
+            return .storeCompact(queue: nil, statusOnly: true)
+        }
+        if command == "store compact" || command.hasPrefix("store compact ") {
+            let remainder = command.dropFirst("store compact".count).trimmingCharacters(in: .whitespaces)
+            if remainder.isEmpty {
+                return .storeCompact(queue: nil, statusOnly: false)
+            }
+            if remainder.hasPrefix("{") {
+                guard let queue = extractStringField(from: String(remainder), field: "queue") else {
+                    return .invalid("invalid-store-compact-payload")
+                }
+                return .storeCompact(queue: queue, statusOnly: false)
+            }
+            return .storeCompact(queue: String(remainder), statusOnly: false)
+        }
+        if command == "snapshot" || command.hasPrefix("snapshot ") {
+            let remainder = command.dropFirst("snapshot".count).trimmingCharacters(in: .whitespaces)
+            guard !remainder.isEmpty else {
+                return .invalid("missing-snapshot-path")
+            }
+            if remainder.hasPrefix("{") {
+                guard let path = extractStringField(from: String(remainder), field: "path") else {
+                    return .invalid("invalid-snapshot-payload")
+                }
+                return .snapshot(path: path, base: extractStringField(from: String(remainder), field: "base"))
+            }
+            return .snapshot(path: String(remainder), base: nil)
+        }
         return .unknown(command)
     }
 
@@ -10,6 +10,8 @@ enum BoxAdminParsedCommand {
     case natProbe(String?)
     case locationSummary
     case syncRoots
+    case storeCompact(queue: String?, statusOnly: Bool)
+    case snapshot(path: String, base: String?)
     case invalid(String)
     case unknown(String)
 }
@@ -0,0 +1,120 @@
+import Foundation
+
+/// Lease of one queue entry.
+struct BoxLease: Sendable {
+    let consumer: String
+    let expiresAt: Date
+    /// Until then the consumer may still acknowledge the entry after expiry, unless it was leased again.
+    let acknowledgeableUntil: Date
+}
+
+/// Leases of one queue (SPECS §9.3), indexed so that no call scans the table.
+///
+/// Leases are kept by file name, with the number of unexpired leases of each consumer and the
+/// pending dates in a min-heap. `expire(now:)` pops the dates that are due: a lease first stops
+/// counting (the entry is visible again), then is forgotten at `acknowledgeableUntil`. Heap dates left
+/// by a lease that was replaced or removed are skipped when they come up.
+struct BoxLeaseTable: Sendable {
+    private struct Record: Sendable {
+        let lease: BoxLease
+        var isActive: Bool
+    }
+
+    private struct Deadline: Sendable {
+        let date: Date
+        let name: String
+    }
+
+    private var records: [String: Record] = [:]
+    private var inFlight: [String: Int] = [:]
+    private var deadlines: [Deadline] = []
+    /// Number of unexpired leases.
+    private(set) var activeCount = 0
+
+    /// Whether no lease (not even an expired one still acknowledgeable) is left.
+    var isEmpty: Bool {
+        records.isEmpty
+    }
+
+    /// Whether `name` is under an unexpired lease.
+    func isLeased(_ name: String) -> Bool {
+        records[name]?.isActive ?? false
+    }
+
+    /// Number of unexpired leases held by `consumer`.
+    func inFlight(for consumer: String) -> Int {
+        inFlight[consumer] ?? 0
+    }
+
+    /// Lease of `name`, expired or not, while it can still be acknowledged.
+    func lease(named name: String) -> BoxLease? {
+        records[name]?.lease
+    }
+
+    /// Leases `name`, replacing any lease it had.
+    mutating func insert(_ lease: BoxLease, for name: String) {
+        remove(named: name)
+        records[name] = Record(lease: lease, isActive: true)
+        inFlight[lease.consumer, default: 0] += 1
+        activeCount += 1
+        push(Deadline(date: lease.expiresAt, name: name))
+    }
+
+    /// Drops the lease of `name` (acknowledged entry).
+    mutating func remove(named name: String) {
+        guard let record = records.removeValue(forKey: name), record.isActive else { return }
+        deactivate(record.lease)
+    }
+
+    /// Expires the leases due at `now` and forgets those no longer acknowledgeable.
+    mutating func expire(now: Date) {
+        while let first = deadlines.first, first.date <= now {
+            pop()
+            guard let record = records[first.name] else { continue }
+            if record.isActive, record.lease.expiresAt == first.date {
+                records[first.name]?.isActive = false
+                deactivate(record.lease)
+                if record.lease.acknowledgeableUntil > first.date {
+                    push(Deadline(date: record.lease.acknowledgeableUntil, name: first.name))
+                    continue
+                }
+            }
+            if !(records[first.name]?.isActive ?? true), record.lease.acknowledgeableUntil <= now {
+                records.removeValue(forKey: first.name)
+            }
+        }
+    }
+
+    private mutating func deactivate(_ lease: BoxLease) {
+        activeCount -= 1
+        let remaining = (inFlight[lease.consumer] ?? 1) - 1
+        inFlight[lease.consumer] = remaining > 0 ? remaining : nil
+    }
+
+    private mutating func push(_ deadline: Deadline) {
+        deadlines.append(deadline)
+        var child = deadlines.count - 1
+        while child > 0 {
+            let parent = (child - 1) / 2
+            guard deadlines[child].date < deadlines[parent].date else { break }
+            deadlines.swapAt(child, parent)
+            child = parent
+        }
+    }
+
+    private mutating func pop() {
+        let last = deadlines.removeLast()
+        guard !deadlines.isEmpty else { return }
+        deadlines[0] = last
+        var parent = 0
+        while true {
+            let left = 2 * parent + 1
+            guard left < deadlines.count else { break }
+            let right = left + 1
+            let child = right < deadlines.count && deadlines[right].date < deadlines[left].date ? right : left
+            guard deadlines[child].date < deadlines[parent].date else { break }
+            deadlines.swapAt(child, parent)
+            parent = child
+        }
+    }
+}
@@ -0,0 +1,126 @@
+import BoxCore
+import Foundation
+
+/// Change to an entry of a queue, published on the store change feed (SPECS §7.16).
+enum BoxStoreChange: Sendable, Equatable {
+    /// Entry `name` was written or replaced.
+    case stored(queue: String, name: String)
+    /// Entry `name` was removed.
+    case removed(queue: String, name: String)
+    /// The queue changed without per-entry reports (external writes found late, lost notifications).
+    case reset(queue: String)
+
+    var queue: String {
+        switch self {
+        case .stored(let queue, _), .removed(let queue, _), .reset(let queue):
+            return queue
+        }
+    }
+}
+
+/// One batch of a queue mirror stream, sent in a PUT of type `contentType` (SPECS §7.16).
+///
+/// A change batch carries the log positions `first...last` of the queue in the primary's `epoch`; the
+/// follower applies the entries above its own position and acknowledges `last`. A copy batch (no
+/// `first`) carries current entries of the queue: the first one of a copy has `purge`, the last one
+/// `base`, the log position the completed copy stands for.
+struct BoxMirrorBatch: Codable, Sendable {
+    /// Content type of mirror PUTs. As a `+json` type the client sends it LZ4-compressed when that saves bytes.
+    static let contentType = "application/vnd.box.mirror+json"
+
+    /// Largest encoded batch accepted in chunks; an object that does not fit is not mirrored.
+    static let maxTransferBytes = 64 * 1024 * 1024
+
+    /// Stored object with its payload, as the primary holds it.
+    struct Object: Codable, Sendable {
+        var id: UUID
+        var contentType: String
+        var content: Data
+        var createdAt: Date
+        var nodeId: UUID
+        var userId: UUID
+        var userMetadata: [String: String]?
+        var digest: BoxContentDigest?
+        var priority: UInt8?
+        var encoding: String?
+
+        init(_ object: BoxStoredObject) {
+            id = object.id
+            contentType = object.contentType
+            content = Data(object.data)
+            createdAt = object.createdAt
+            nodeId = object.nodeId
+            userId = object.userId
+            userMetadata = object.userMetadata
+            digest = object.digest
+            priority = object.priority > 0 ? object.priority : nil
+            encoding = object.encoding == .identity ? nil : object.encoding.name
+        }
+
+        /// The object to store, `nil` for an unknown payload encoding.
+        var storedObject: BoxStoredObject? {
+            var payloadEncoding = BoxCodec.PayloadEncoding.identity
+            if let encoding {
+                guard let parsed = BoxCodec.PayloadEncoding(name: encoding) else { return nil }
+                payloadEncoding = parsed
+            }
+            return BoxStoredObject(
+                id: id,
+                contentType: contentType,
+                data: [UInt8](content),
+                createdAt: createdAt,
+                nodeId: nodeId,
+                userId: userId,
+                userMetadata: userMetadata,
+                digest: digest,
+                priority: priority ?? 0,
+                encoding: payloadEncoding
+            )
+        }
+    }
+
+    struct Entry: Codable, Sendable {
+        /// Log position, 0 in copy batches.
+        var seq: UInt64
+        /// File name of the entry on the primary, kept by the follower.
+        var name: String
+        var removed: Bool?
+        var object: Object?
+    }
+
+    /// Position a follower applied for one queue of one primary, kept in `<root>/.mirror/<node>.json`.
+    struct Position: Codable, Sendable, Equatable {
+        var epoch: UUID
+        /// Last log position applied, `nil` while a copy is incomplete.
+        var applied: UInt64?
+    }
+
+    /// Node the batch comes from; must be the authenticated sender.
+    var source: UUID
+    var queue: String
+    /// Identifies one run of the primary's log; positions of another epoch are meaningless.
+    var epoch: UUID
+    var first: UInt64?
+    var last: UInt64?
+    var purge: Bool?
+    var base: UInt64?
+    var entries: [Entry]
+
+    /// Queue holding, on a follower, the mirror of `queue` of the node `source`.
+    static func mirrorQueueName(of queue: String, source: UUID) -> String {
+        "\(queue)@\(source.uuidString)"
+    }
+
+    func encoded() throws -> Data {
+        let encoder = JSONEncoder()
+        encoder.outputFormatting = [.withoutEscapingSlashes]
+        encoder.dateEncodingStrategy = .iso8601
+        return try encoder.encode(self)
+    }
+
+    static func decode(from data: Data) throws -> BoxMirrorBatch {
+        let decoder = JSONDecoder()
+        decoder.dateDecodingStrategy = .iso8601
+        return try decoder.decode(BoxMirrorBatch.self, from: data)
+    }
+}
@@ -0,0 +1,118 @@
+import BoxCore
+import Foundation
+
+/// Sequential reader over a stored payload (SPECS §7.10).
+///
+/// Blob-backed payloads are read from an open file handle, one chunk at a time, so serving a large
+/// object costs one chunk of memory. The handle is opened before the queue entry is removed: a popped
+/// object stays readable through it even after its last blob link is unlinked. Inline payloads are
+/// already decoded and are simply sliced.
+final class BoxPayloadReader: @unchecked Sendable {
+    /// Total payload size in bytes.
+    let size: Int
+    /// Open blob file, with its path for error reports.
+    private let file: (handle: FileHandle, url: URL)?
+    private let bytes: [UInt8]
+    private var offset = 0
+
+    /// Reads an already decoded payload.
+    init(bytes: [UInt8]) {
+        self.size = bytes.count
+        self.file = nil
+        self.bytes = bytes
+    }
+
+    /// Opens the raw blob file at `url`.
+    init(fileURL url: URL) throws {
+        let handle: FileHandle
+        let size: UInt64
+        do {
+            handle = try FileHandle(forReadingFrom: url)
+            size = try handle.seekToEnd()
+            try handle.seek(toOffset: 0)
+        } catch {
+            throw BoxStoreError.io(error)
+        }
+        self.size = Int(size)
+        self.file = (handle, url)
+        self.bytes = []
+    }
+
+    deinit {
+        try? file?.handle.close()
+    }
+
+    /// Whether every byte has been returned.
+    var isAtEnd: Bool {
+        offset >= size
+    }
+
+    /// Returns the next `maxLength` bytes at most, or `nil` once the payload is exhausted.
+    func nextChunk(maxLength: Int) throws -> [UInt8]? {
+        guard !isAtEnd, maxLength > 0 else { return nil }
+        let length = min(maxLength, size - offset)
+        let chunk: [UInt8]
+        if let file {
+            let data: Data?
+            do {
+                data = try file.handle.read(upToCount: length)
+            } catch {
+                throw BoxStoreError.io(error)
+            }
+            // The blob was truncated after it was opened.
+            guard let data, !data.isEmpty else { throw BoxStoreError.corrupted(file.url) }
+            chunk = [UInt8](data)
+        } else {
+            chunk = Array(bytes[offset..<(offset + length)])
+        }
+        offset += chunk.count
+        return chunk
+    }
+
+    /// Reads the remainder of the payload at once (small objects, or payloads the server must expand).
+    func readRemaining() throws -> [UInt8] {
+        var result: [UInt8] = []
+        result.reserveCapacity(size - offset)
+        while let chunk = try nextChunk(maxLength: 64 * 1024) {
+            result.append(contentsOf: chunk)
+        }
+        return result
+    }
+}
+
+/// Object whose payload is read on demand through a `BoxPayloadReader`.
+struct BoxStreamedObject: Sendable {
+    let id: UUID
+    let contentType: String
+    let createdAt: Date
+    let nodeId: UUID
+    let userId: UUID
+    let priority: UInt8
+    let encoding: BoxCodec.PayloadEncoding
+    let payload: BoxPayloadReader
+
+    /// Wraps an object that is already in memory.
+    init(_ object: BoxStoredObject) {
+        self.init(
+            id: object.id,
+            contentType: object.contentType,
+            createdAt: object.createdAt,
+            nodeId: object.nodeId,
+            userId: object.userId,
+            priority: object.priority,
+            encoding: object.encoding,
+            payload: BoxPayloadReader(bytes: object.data)
+        )
+    }
+
+    init(id: UUID, contentType: String, createdAt: Date, nodeId: UUID, userId: UUID, priority: UInt8, encoding: BoxCodec.PayloadEncoding, payload: BoxPayloadReader) {
+        self.id = id
+        self.contentType = contentType
+        self.createdAt = createdAt
+        self.nodeId = nodeId
+        self.userId = userId
+        self.priority = priority
+        self.encoding = encoding
+        self.payload = payload
+    }
+}
@@ -0,0 +1,78 @@
+import BoxCore
+import Foundation
+import NIOConcurrencyHelpers
+
+/// Queue name resolved once: what a request needs to know about its queue (SPECS §7.17).
+struct BoxQueueHandle: Sendable, Equatable {
+    /// Sanitized name, which is also the directory name under the store root.
+    let name: String
+    /// Queue directory.
+    let directory: URL
+    /// Listed in `server.permanent_queues`: GET reads without removing.
+    let permanent: Bool
+    /// Policy of a queue listed in `server.volatile_queues`.
+    let volatilePolicy: BoxVolatilePolicy?
+}
+
+/// Interned queue handles shared by the network handler and the store.
+///
+/// Raw names, as sent by clients, map to handles behind one lock: a request resolves its queue with a
+/// single hash lookup instead of trimming and scanning the name, and the same lookup tells whether the
+/// queue is permanent or volatile. `configure` refreshes those flags when the configuration changes.
+/// Invalid names are not cached, and the table is cleared when it reaches `capacity`, so clients
+/// cycling through names cannot grow it without bound.
+final class BoxQueueHandleTable: @unchecked Sendable {
+    /// Raw names kept before the table is cleared.
+    static let capacity = 4096
+
+    private struct State {
+        /// Handles by raw name.
+        var handles: [String: BoxQueueHandle] = [:]
+        var permanent: Set<String> = []
+        var volatile: [String: BoxVolatilePolicy] = [:]
+    }
+
+    private let root: URL
+    private let state = NIOLockedValueBox(State())
+
+    /// Creates a table for the queues under `root`.
+    init(root: URL) {
+        self.root = root
+    }
+
+    /// Resolves `rawName`, normalizing it on first use only.
+    /// - Throws: `BoxStoreError.invalidQueueName` when the store refuses the name.
+    func handle(for rawName: String) throws -> BoxQueueHandle {
+        if let cached = state.withLockedValue({ $0.handles[rawName] }) {
+            return cached
+        }
+        let name = try BoxServerStore.normalizeQueueName(rawName)
+        return state.withLockedValue { state in
+            if state.handles.count >= Self.capacity {
+                state.handles.removeAll(keepingCapacity: true)
+            }
+            let handle = makeHandle(name: name, in: state)
+            state.handles[rawName] = handle
+            return handle
+        }
+    }
+
+    /// Applies the sanitized `server.permanent_queues` and `server.volatile_queues` to every handle.
+    func configure(permanent: Set<String>, volatile: [String: BoxVolatilePolicy]) {
+        state.withLockedValue { state in
+            state.permanent = permanent
+            state.volatile = volatile
+            let current = state
+            state.handles = current.handles.mapValues { makeHandle(name: $0.name, in: current) }
+        }
+    }
+
+    private func makeHandle(name: String, in state: State) -> BoxQueueHandle {
+        BoxQueueHandle(
+            name: name,
+            directory: root.appendingPathComponent(name, isDirectory: true),
+            permanent: state.permanent.contains(name),
+            volatilePolicy: state.volatile[name]
+        )
+    }
+}
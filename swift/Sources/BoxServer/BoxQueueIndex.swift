@@ -0,0 +1,495 @@
+import BoxCore
+import Foundation
+
+/// In-memory ordered view of one queue directory.
+///
+/// Entries are kept sorted by file name, which starts with the UTC timestamp of the object, so the
+/// oldest object is always `entries.first`. The index is rebuilt from a directory listing only when
+/// the directory modification date differs from the one recorded after the last load or local
+/// mutation: another process (or a second `BoxServerStore` on the same root) writing into the queue
+/// invalidates it on the next access.
+///
+/// Lookups by object id and by payload digest are dictionary hits. Digests and blob sizes are known for
+/// entries written through the index; entries loaded from a listing get theirs when the store first
+/// needs them (a DELETE by digest, a `max_bytes` retention pass).
+///
+/// Consumers dequeue by priority (SPECS §7.6): each priority class keeps its names in a FIFO bucket,
+/// and `nextEntry` returns the oldest entry of the highest non-empty class.
+struct BoxQueueIndex: Sendable {
+    /// One object file.
+    struct Entry: Sendable, Equatable {
+        /// File name inside the queue directory.
+        let name: String
+        /// Object identifier parsed from the file name.
+        let id: UUID?
+        /// Creation time parsed from the timestamp prefix (file modification date for untimestamped queues).
+        let createdAt: Date
+        /// File size in bytes. Blob-backed files stay below the descriptor size limit.
+        let size: Int64
+        /// Whether the file name carries the timestamp prefix.
+        let isTimestamped: Bool
+        /// Priority class parsed from the file name (0 when absent).
+        let priority: UInt8
+        /// Payload digest, `nil` until read from the file.
+        var digest: BoxContentDigest? = nil
+        /// Size of the blob payload the file references, 0 when inline or not read yet (`digest` is then `nil`).
+        var blobSize: Int64 = 0
+
+        /// Bytes the object occupies: its file and the payload it references.
+        var bytes: Int64 {
+            size + blobSize
+        }
+    }
+
+    /// Names of one priority class in file-name (age) order. Dequeuing from the front only moves
+    /// `head`, so draining a class costs O(1) per entry; the consumed prefix is dropped once it
+    /// outweighs the live part.
+    private struct PriorityBucket: Sendable {
+        var names: [String] = []
+        var head = 0
+
+        var live: ArraySlice<String> {
+            names[head...]
+        }
+
+        mutating func insert(_ name: String) {
+            if head == names.count || names[names.count - 1] < name {
+                names.append(name)
+                return
+            }
+            names.insert(name, at: position(of: name))
+        }
+
+        mutating func remove(_ name: String) {
+            if head < names.count && names[head] == name {
+                head += 1
+                if head == names.count {
+                    names.removeAll(keepingCapacity: true)
+                    head = 0
+                } else if head > 64 && head * 2 > names.count {
+                    names.removeFirst(head)
+                    head = 0
+                }
+                return
+            }
+            let index = position(of: name)
+            if index < names.count && names[index] == name {
+                names.remove(at: index)
+            }
+        }
+
+        private func position(of name: String) -> Int {
+            var low = head
+            var high = names.count
+            while low < high {
+                let mid = (low + high) / 2
+                if names[mid] < name {
+                    low = mid + 1
+                } else {
+                    high = mid
+                }
+            }
+            return low
+        }
+    }
+
+    /// Number of priority classes (0 lowest, `BoxCodec.maxPriority` highest).
+    static let priorityLevels = Int(BoxCodec.maxPriority) + 1
+
+    private(set) var entries: [Entry] = []
+    /// Sum of `Entry.bytes`.
+    private(set) var totalBytes: Int64 = 0
+    private var buckets = Array(repeating: PriorityBucket(), count: BoxQueueIndex.priorityLevels)
+    private var namesById: [UUID: String] = [:]
+    private var namesByDigest: [BoxContentDigest: [String]] = [:]
+    private var untimestampedCount = 0
+    /// Number of entries whose digest is not known yet.
+    private(set) var undigestedCount = 0
+    /// Directory modification date observed when the index was last known to be in sync.
+    var directoryModifiedAt: Date?
+    /// Change marker set by the store on every load and local mutation (SPECS §7.12).
+    var generation: UInt64 = 0
+
+    /// Lists `directory` and builds a fresh index.
+    static func load(from directory: URL, fileManager: FileManager) throws -> BoxQueueIndex {
+        let keys: [URLResourceKey] = [.fileSizeKey, .contentModificationDateKey]
+        let files = try fileManager.contentsOfDirectory(at: directory, includingPropertiesForKeys: keys)
+            .filter { $0.pathExtension == "json" }
+        var index = BoxQueueIndex()
+        index.entries.reserveCapacity(files.count)
+        for url in files {
+            let values = try? url.resourceValues(forKeys: Set(keys))
+            let name = url.lastPathComponent
+            let stamp = timestamp(fromFileName: name)
+            let entry = Entry(
+                name: name,
+                id: identifier(fromFileName: name),
+                createdAt: stamp ?? values?.contentModificationDate ?? Date(),
+                size: Int64(values?.fileSize ?? 0),
+                isTimestamped: stamp != nil,
+                priority: priority(fromFileName: name)
+            )
+            index.entries.append(entry)
+        }
+        index.entries.sort { $0.name < $1.name }
+        // Accounting in name order keeps every bucket insertion an append.
+        for entry in index.entries {
+            index.account(entry, sign: 1)
+        }
+        index.directoryModifiedAt = modificationDate(of: directory)
+        return index
+    }
+
+    init() {}
+
+    /// Rebuilds an index persisted in the store manifest (SPECS §7.12) without touching the directory.
+    /// The arrays are parallel and sorted by name; `nil` when their lengths disagree.
+    init?(names: [String], sizes: [Int64], blobSizes: [Int64], dates: [Date], digests: [BoxContentDigest?], directoryModifiedAt: Date) {
+        guard sizes.count == names.count, blobSizes.count == names.count, dates.count == names.count, digests.count == names.count else { return nil }
+        entries.reserveCapacity(names.count)
+        for position in names.indices {
+            let name = names[position]
+            // Dates were saved parsed: only the shape of the prefix is checked here.
+            let utf8 = Array(name.utf8.prefix(16))
+            let entry = Entry(
+                name: name,
+                id: Self.identifier(fromFileName: name),
+                createdAt: dates[position],
+                size: sizes[position],
+                isTimestamped: utf8.count == 16 && utf8[8] == UInt8(ascii: "T") && utf8[15] == UInt8(ascii: "Z"),
+                priority: Self.priority(fromFileName: name),
+                digest: digests[position],
+                blobSize: blobSizes[position]
+            )
+            guard entries.last.map({ $0.name < name }) ?? true else { return nil }
+            entries.append(entry)
+            account(entry, sign: 1)
+        }
+        self.directoryModifiedAt = directoryModifiedAt
+    }
+
+    /// Entries ordered by age. Timestamped file names already sort chronologically; untimestamped
+    /// queues (`whoswho`, `uuid`) fall back to sorting on the file modification date.
+    var oldestFirst: [Entry] {
+        untimestampedCount == 0 ? entries : entries.sorted { $0.createdAt < $1.createdAt }
+    }
+
+    /// Returns the file name holding `id`, if indexed.
+    func name(for id: UUID) -> String? {
+        namesById[id]
+    }
+
+    /// Returns the file names whose payload has `digest` (complete once `undigestedCount` is 0).
+    func names(for digest: BoxContentDigest) -> [String] {
+        namesByDigest[digest] ?? []
+    }
+
+    /// Returns the oldest entry of the highest non-empty priority class, skipping the names for which
+    /// `isExcluded` holds (leased entries).
+    func nextEntry(excluding isExcluded: (String) -> Bool = { _ in false }) -> Entry? {
+        for bucket in buckets.reversed() {
+            for name in bucket.live where !isExcluded(name) {
+                return entry(named: name)
+            }
+        }
+        return nil
+    }
+
+    /// Returns the first entry whose name sorts after `position` (the first entry when `nil`).
+    func firstEntry(after position: String?) -> Entry? {
+        guard let position else { return entries.first }
+        let (index, found) = search(position)
+        let next = found ? index + 1 : index
+        return next < entries.count ? entries[next] : nil
+    }
+
+    /// Returns the entry stored under `name`.
+    func entry(named name: String) -> Entry? {
+        let (position, found) = search(name)
+        return found ? entries[position] : nil
+    }
+
+    /// Inserts (or replaces) an entry, keeping the order.
+    mutating func insert(_ entry: Entry) {
+        let (position, found) = search(entry.name)
+        if found {
+            account(entries[position], sign: -1)
+            entries[position] = entry
+        } else {
+            entries.insert(entry, at: position)
+        }
+        account(entry, sign: 1)
+    }
+
+    /// Fills in the digest and blob size of the entries that have none, as given by `resolve` (`nil`
+    /// leaves an entry as it is). Names and priority classes do not change, so this is a single pass.
+    mutating func fillDigests(_ resolve: (Entry) -> (digest: BoxContentDigest, blobSize: Int64)?) {
+        guard undigestedCount > 0 else { return }
+        for position in entries.indices where entries[position].digest == nil {
+            guard let resolved = resolve(entries[position]) else { continue }
+            totalBytes += resolved.blobSize - entries[position].blobSize
+            entries[position].digest = resolved.digest
+            entries[position].blobSize = resolved.blobSize
+            namesByDigest[resolved.digest, default: []].append(entries[position].name)
+            undigestedCount -= 1
+        }
+    }
+
+    /// Removes the entry stored under `name`.
+    @discardableResult
+    mutating func remove(named name: String) -> Entry? {
+        let (position, found) = search(name)
+        guard found else { return nil }
+        let entry = entries.remove(at: position)
+        account(entry, sign: -1)
+        return entry
+    }
+
+    /// Binary search on the sorted names: insertion point and whether `name` is present there.
+    private func search(_ name: String) -> (position: Int, found: Bool) {
+        var low = 0
+        var high = entries.count
+        while low < high {
+            let mid = (low + high) / 2
+            if entries[mid].name < name {
+                low = mid + 1
+            } else {
+                high = mid
+            }
+        }
+        return (low, low < entries.count && entries[low].name == name)
+    }
+
+    private mutating func account(_ entry: Entry, sign: Int64) {
+        totalBytes += sign * entry.bytes
+        let level = min(Int(entry.priority), Self.priorityLevels - 1)
+        if sign > 0 {
+            buckets[level].insert(entry.name)
+        } else {
+            buckets[level].remove(entry.name)
+        }
+        if !entry.isTimestamped {
+            untimestampedCount += Int(sign)
+        }
+        if let digest = entry.digest {
+            if sign > 0 {
+                namesByDigest[digest, default: []].append(entry.name)
+            } else {
+                namesByDigest[digest]?.removeAll { $0 == entry.name }
+                if namesByDigest[digest]?.isEmpty == true {
+                    namesByDigest.removeValue(forKey: digest)
+                }
+            }
+        } else {
+            undigestedCount += Int(sign)
+        }
+        if let id = entry.id {
+            if sign > 0 {
+                namesById[id] = entry.name
+            } else if namesById[id] == entry.name {
+                namesById.removeValue(forKey: id)
+            }
+        }
+    }
+
+    /// Builds an entry for a file that was just written.
+    static func entry(forFileNamed name: String, size: Int, blobSize: Int = 0, createdAt: Date, digest: BoxContentDigest?) -> Entry {
+        let stamp = timestamp(fromFileName: name)
+        return Entry(
+            name: name,
+            id: identifier(fromFileName: name),
+            createdAt: stamp ?? createdAt,
+            size: Int64(size),
+            isTimestamped: stamp != nil,
+            priority: priority(fromFileName: name),
+            digest: digest,
+            blobSize: Int64(blobSize)
+        )
+    }
+
+    /// Parses the `p<digit>-` marker that follows the timestamp of `<timestamp>-p<n>-<uuid>.json`.
+    static func priority(fromFileName name: String) -> UInt8 {
+        let utf8 = Array(name.utf8.prefix(stampedLength + 4))
+        guard let stamp = stampLength(of: utf8), utf8.count >= stamp + 4,
+              utf8[stamp] == UInt8(ascii: "-"), utf8[stamp + 1] == UInt8(ascii: "p"), utf8[stamp + 3] == UInt8(ascii: "-") else { return 0 }
+        let digit = Int(utf8[stamp + 2]) - Int(UInt8(ascii: "0"))
+        guard (0...Int(BoxCodec.maxPriority)).contains(digit) else { return 0 }
+        return UInt8(digit)
+    }
+
+    static func modificationDate(of url: URL) -> Date? {
+        try? url.resourceValues(forKeys: [.contentModificationDateKey]).contentModificationDate
+    }
+
+    /// Parses the trailing UUID of `<timestamp>-<uuid>.json` or `<uuid>.json`.
+    static func identifier(fromFileName name: String) -> UUID? {
+        guard name.hasSuffix(".json") else { return nil }
+        let stem = name.dropLast(5)
+        guard stem.count >= 36 else { return nil }
+        return UUID(uuidString: String(stem.suffix(36)))
+    }
+
+    /// Length of `yyyyMMddTHHmmssZ`, the prefix of names written before sub-second stamps.
+    static let secondsLength = 16
+    /// Length of `yyyyMMddTHHmmssZ-ffffff`, the prefix the store writes now.
+    static let stampedLength = 23
+
+    /// Parses the `yyyyMMddTHHmmssZ` prefix of a timestamped file name, with the `-ffffff`
+    /// microseconds that follow it when present.
+    static func timestamp(fromFileName name: String) -> Date? {
+        let utf8 = Array(name.utf8.prefix(stampedLength + 1))
+        guard let length = stampLength(of: utf8) else { return nil }
+        func number(_ range: Range<Int>) -> Int64? {
+            var value: Int64 = 0
+            for index in range {
+                let digit = Int64(utf8[index]) - Int64(UInt8(ascii: "0"))
+                guard (0...9).contains(digit) else { return nil }
+                value = value * 10 + digit
+            }
+            return value
+        }
+        guard let year = number(0..<4), let month = number(4..<6), let day = number(6..<8),
+              let hour = number(9..<11), let minute = number(11..<13), let second = number(13..<15),
+              (1...12).contains(month), (1...31).contains(day), hour < 24, minute < 60, second < 61 else {
+            return nil
+        }
+        let fraction = length == stampedLength ? number(17..<23) ?? 0 : 0
+        let seconds = days(fromCivilYear: year, month: month, day: day) * 86_400 + hour * 3_600 + minute * 60 + second
+        return Date(timeIntervalSince1970: TimeInterval(seconds) + TimeInterval(fraction) / 1_000_000)
+    }
+
+    /// Formats `yyyyMMddTHHmmssZ-ffffff` for a UTC time in microseconds since 1970, with integer
+    /// arithmetic only. Stamps sort lexically in time order and after the bare seconds prefix.
+    static func timestampPrefix(microseconds: Int64) -> String {
+        let microseconds = max(0, microseconds)
+        let seconds = microseconds / 1_000_000
+        let (year, month, day) = civil(fromDays: seconds / 86_400)
+        let daySeconds = seconds % 86_400
+        return String(unsafeUninitializedCapacity: stampedLength) { buffer in
+            func digits(_ value: Int64, at offset: Int, width: Int) {
+                var value = value
+                for index in stride(from: offset + width - 1, through: offset, by: -1) {
+                    buffer[index] = UInt8(ascii: "0") + UInt8(value % 10)
+                    value /= 10
+                }
+            }
+            digits(year, at: 0, width: 4)
+            digits(month, at: 4, width: 2)
+            digits(day, at: 6, width: 2)
+            buffer[8] = UInt8(ascii: "T")
+            digits(daySeconds / 3_600, at: 9, width: 2)
+            digits(daySeconds / 60 % 60, at: 11, width: 2)
+            digits(daySeconds % 60, at: 13, width: 2)
+            buffer[15] = UInt8(ascii: "Z")
+            buffer[16] = UInt8(ascii: "-")
+            digits(microseconds % 1_000_000, at: 17, width: 6)
+            return stampedLength
+        }
+    }
+
+    /// Microseconds since 1970 of `date`, the unit of `timestampPrefix`.
+    static func microseconds(of date: Date) -> Int64 {
+        Int64((date.timeIntervalSince1970 * 1_000_000).rounded())
+    }
+
+    /// 16 for a bare `yyyyMMddTHHmmssZ` prefix, 23 when `-ffffff` microseconds follow, `nil` for other
+    /// names. A stamp is followed by `-`, where the first UUID group of `<seconds>-<uuid>` still runs.
+    private static func stampLength(of utf8: [UInt8]) -> Int? {
+        guard utf8.count >= secondsLength, utf8[8] == UInt8(ascii: "T"), utf8[15] == UInt8(ascii: "Z") else { return nil }
+        guard utf8.count > stampedLength, utf8[16] == UInt8(ascii: "-"), utf8[stampedLength] == UInt8(ascii: "-"),
+              utf8[17..<stampedLength].allSatisfy({ (UInt8(ascii: "0")...UInt8(ascii: "9")).contains($0) }) else {
+            return secondsLength
+        }
+        return stampedLength
+    }
+
+    /// Days since 1970-01-01 of a proleptic Gregorian date (H. Hinnant's `days_from_civil`).
+    private static func days(fromCivilYear year: Int64, month: Int64, day: Int64) -> Int64 {
+        let year = month <= 2 ? year - 1 : year
+        let era = (year >= 0 ? year : year - 399) / 400
+        let yearOfEra = year - era * 400
+        let dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1
+        let dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear
+        return era * 146_097 + dayOfEra - 719_468
+    }
+
+    /// Inverse of `days(fromCivilYear:month:day:)` (H. Hinnant's `civil_from_days`).
+    private static func civil(fromDays days: Int64) -> (year: Int64, month: Int64, day: Int64) {
+        let shifted = days + 719_468
+        let era = (shifted >= 0 ? shifted : shifted - 146_096) / 146_097
+        let dayOfEra = shifted - era * 146_097
+        let yearOfEra = (dayOfEra - dayOfEra / 1_460 + dayOfEra / 36_524 - dayOfEra / 146_096) / 365
+        let dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100)
+        let shiftedMonth = (5 * dayOfYear + 2) / 153
+        let day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1
+        let month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9
+        return (yearOfEra + era * 400 + (month <= 2 ? 1 : 0), month, day)
+    }
+}
+
+/// Retention limits applied to one queue (SPECS §7.3). `nil` disables a limit.
+public struct BoxRetentionPolicy: Sendable, Equatable {
+    /// Maximum object age in seconds.
+    public var maxAge: TimeInterval?
+    /// Maximum number of objects kept.
+    public var maxCount: Int?
+    /// Maximum total size of the objects in bytes, blob payloads included.
+    public var maxBytes: Int64?
+
+    public init(maxAge: TimeInterval? = nil, maxCount: Int? = nil, maxBytes: Int64? = nil) {
+        self.maxAge = maxAge
+        self.maxCount = maxCount
+        self.maxBytes = maxBytes
+    }
+
+    /// Whether at least one limit is set.
+    public var isEnabled: Bool {
+        maxAge != nil || maxCount != nil || maxBytes != nil
+    }
+}
+
+/// Lease parameters applied to GET-with-lease (SPECS §9.3).
+public struct BoxLeasePolicy: Sendable, Equatable {
+    public static let defaultVisibilityTimeout: TimeInterval = 30
+    public static let defaultMaxInFlight = 64
+    /// Longest visibility a client may request.
+    public static let maxVisibilityTimeout: TimeInterval = 12 * 3_600
+
+    /// Seconds a leased object stays hidden.
+    public var visibilityTimeout: TimeInterval
+    /// Unacknowledged leases allowed per consumer.
+    public var maxInFlight: Int
+
+    public init(visibilityTimeout: TimeInterval = BoxLeasePolicy.defaultVisibilityTimeout, maxInFlight: Int = BoxLeasePolicy.defaultMaxInFlight) {
+        self.visibilityTimeout = min(max(visibilityTimeout, 1), Self.maxVisibilityTimeout)
+        self.maxInFlight = max(maxInFlight, 1)
+    }
+}
+
+/// Result of a lease request.
+public enum BoxLeaseOutcome: Sendable {
+    /// The object is hidden from other readers until `expiresAt` or its acknowledgement.
+    case leased(BoxStoredObject, expiresAt: Date)
+    /// Every object is either absent or already leased.
+    case empty
+    /// The consumer already holds `maxInFlight` unacknowledged leases.
+    case windowFull
+}
+
+/// Outcome of a DELETE batch.
+public struct BoxDeleteResult: Sendable, Equatable {
+    /// Number of queue entries removed.
+    public var removed: Int
+    /// Number of targets that matched no entry.
+    public var missing: Int
+}
+
+/// Outcome of one retention batch.
+public struct BoxRetentionResult: Sendable, Equatable {
+    /// Number of objects removed.
+    public var evicted: Int
+    /// Bytes released.
+    public var evictedBytes: Int64
+    /// Whether the queue still exceeds its policy (the batch limit was reached).
+    public var hasMore: Bool
+}
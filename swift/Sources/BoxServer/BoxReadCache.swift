@@ -0,0 +1,139 @@
+import Foundation
+
+/// Size-bounded LRU cache of decoded queue objects (SPECS §7.8).
+///
+/// Keys are a sanitized queue name and a queue file name; a file name embeds the object id and never
+/// changes while the file exists, so an entry stays valid until the store writes, removes or replaces
+/// that file, or notices an external change to the queue directory. A hit hands out the cached
+/// `BoxStoredObject`, whose payload array is shared instead of re-read, re-decoded and copied.
+/// Recency is tracked with a doubly linked list threaded through a slot array: lookup, insertion and
+/// eviction are O(1).
+struct BoxReadCache: Sendable {
+    /// Budget used when `server.read_cache_bytes` is not set.
+    static let defaultBudget = 16 * 1024 * 1024
+    /// Bookkeeping charged per entry on top of the payload size.
+    static let entryOverhead = 256
+
+    struct Key: Hashable, Sendable {
+        let queue: String
+        let name: String
+    }
+
+    /// Counters reported by `box admin stats`.
+    struct Statistics: Sendable, Equatable {
+        var hits = 0
+        var misses = 0
+        var entries = 0
+        var bytes = 0
+        var budget = 0
+
+        /// Share of lookups served from memory, 0 before the first lookup.
+        var hitRatio: Double {
+            let lookups = hits + misses
+            return lookups > 0 ? Double(hits) / Double(lookups) : 0
+        }
+    }
+
+    private struct Slot: Sendable {
+        var key: Key
+        var object: BoxStoredObject
+        var cost: Int
+        var previous: Int?
+        var next: Int?
+    }
+
+    private var slots: [Slot?] = []
+    private var freeSlots: [Int] = []
+    private var positions: [Key: Int] = [:]
+    /// Most recently used slot.
+    private var head: Int?
+    /// Least recently used slot, evicted first.
+    private var tail: Int?
+    private(set) var statistics = Statistics()
+
+    /// Creates a cache holding at most `budget` bytes; 0 disables caching.
+    init(budget: Int = BoxReadCache.defaultBudget) {
+        statistics.budget = max(0, budget)
+    }
+
+    var budget: Int {
+        get { statistics.budget }
+        set {
+            statistics.budget = max(0, newValue)
+            evictToBudget()
+        }
+    }
+
+    /// Returns the cached object for `key` and marks it as most recently used.
+    mutating func object(for key: Key) -> BoxStoredObject? {
+        guard let position = positions[key], let object = slots[position]?.object else {
+            if statistics.budget > 0 { statistics.misses += 1 }
+            return nil
+        }
+        statistics.hits += 1
+        unlink(position)
+        linkAtHead(position)
+        return object
+    }
+
+    /// Caches `object` under `key`, evicting the least recently used entries beyond the budget.
+    /// Objects larger than an eighth of the budget are not cached, so one upload cannot flush the cache.
+    mutating func insert(_ object: BoxStoredObject, for key: Key) {
+        removeValue(for: key)
+        let cost = object.data.count + Self.entryOverhead
+        guard cost <= statistics.budget / 8 else { return }
+        let slot = Slot(key: key, object: object, cost: cost, previous: nil, next: nil)
+        let position: Int
+        if let free = freeSlots.popLast() {
+            slots[free] = slot
+            position = free
+        } else {
+            slots.append(slot)
+            position = slots.count - 1
+        }
+        positions[key] = position
+        linkAtHead(position)
+        statistics.entries += 1
+        statistics.bytes += cost
+        evictToBudget()
+    }
+
+    /// Drops the entry for `key`, if any.
+    mutating func removeValue(for key: Key) {
+        guard let position = positions.removeValue(forKey: key), let slot = slots[position] else { return }
+        unlink(position)
+        slots[position] = nil
+        freeSlots.append(position)
+        statistics.entries -= 1
+        statistics.bytes -= slot.cost
+    }
+
+    /// Drops every entry of `queue`.
+    mutating func removeAll(inQueue queue: String) {
+        for key in positions.keys where key.queue == queue {
+            removeValue(for: key)
+        }
+    }
+
+    private mutating func evictToBudget() {
+        while statistics.bytes > statistics.budget, let last = tail, let key = slots[last]?.key {
+            removeValue(for: key)
+        }
+    }
+
+    private mutating func unlink(_ position: Int) {
+        guard let slot = slots[position] else { return }
+        if let previous = slot.previous { slots[previous]?.next = slot.next } else { head = slot.next }
+        if let next = slot.next { slots[next]?.previous = slot.previous } else { tail = slot.previous }
+        slots[position]?.previous = nil
+        slots[position]?.next = nil
+    }
+
+    private mutating func linkAtHead(_ position: Int) {
+        slots[position]?.next = head
+        slots[position]?.previous = nil
+        if let head { slots[head]?.previous = position }
+        head = position
+        if tail == nil { tail = position }
+    }
+}
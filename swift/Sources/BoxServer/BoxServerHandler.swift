@@ -14,7 +14,56 @@ final class BoxServerHandler: ChannelInboundHandler {
     private let authorizer: @Sendable (UUID, UUID) async -> Bool
     private let locationResolver: @Sendable (UUID) async -> LocationServiceNodeRecord?
     private let jsonEncoder: JSONEncoder
-    private let isPermanentQueue: @Sendable (String) -> Bool
+    private let sessionSigner: @Sendable ([UInt8]) -> [UInt8]?
+    /// Checks an initiator HELLO signature against the advertised key of a node.
+    private let peerVerifier: @Sendable (_ signature: [UInt8], _ message: [UInt8], _ node: UUID) -> Bool
+    private let replayWindowSize: @Sendable () -> Int
+    private let helloCookieThreshold: @Sendable () -> Int
+    private let diskPressure: @Sendable () -> Bool
+    private let leasePolicy: @Sendable () -> BoxLeasePolicy
+    private let volatileQueues: BoxVolatileQueues
+    /// Stateless cookie issuer for key-share HELLOs. Only touched on the channel event loop.
+    private var cookieJar = BoxHelloCookieJar()
+    /// Encrypted sessions keyed by peer address. Only touched on the channel event loop.
+    private var sessions: [SocketAddress: SessionEntry] = [:]
+    /// Sessions answered to a HELLO but not yet proven by a sealed frame. A HELLO carries no proof of
+    /// its source address, so it never replaces a live session on its own.
+    private var pendingSessions: [SocketAddress: SessionEntry] = [:]
+    private static let maxSessions = 4096
+    private static let sessionIdleTimeout: TimeAmount = .minutes(10)
+    private static let pendingSessionTimeout: TimeAmount = .seconds(30)
+    /// Chunked mirror batches in progress, one per authenticated peer.
+    private var mirrorTransfers: [SocketAddress: MirrorTransfer] = [:]
+    private static let maxMirrorTransfers = 64
+    /// Largest expanded PUT accepted from an unknown sender (a Location record registering itself):
+    /// a record sent uncompressed fits in one datagram, so a compressed one never needs more.
+    private static let selfRegistrationMaximumSize = 64 * 1024
+
+    /// Chunked mirror batch being received from one peer. Only touched on the channel event loop.
+    private struct MirrorTransfer {
+        var id: UUID
+        var count: UInt32
+        var parts: [UInt32: [UInt8]] = [:]
+        var lastUsed = NIODeadline.now()
+        var applying = false
+        /// Answer sent for the whole batch, repeated for a retransmitted last chunk.
+        var reply: (status: BoxCodec.Status, message: String)?
+    }
+
+    private enum MirrorChunkOutcome {
+        case partial
+        case complete([UInt8])
+        case applying
+        case answered(BoxCodec.Status, String)
+        case invalid
+    }
+
+    private struct SessionEntry {
+        var session: BoxSession
+        var lastUsed: NIODeadline
+        /// Node that signed the HELLO of this session, `nil` for anonymous clients.
+        var node: UUID?
+    }
 
     init(
         logger: Logger,
@@ -23,7 +72,13 @@ final class BoxServerHandler: ChannelInboundHandler {
         identityProvider: @escaping @Sendable () -> (UUID, UUID),
         authorizer: @escaping @Sendable (UUID, UUID) async -> Bool,
         locationResolver: @escaping @Sendable (UUID) async -> LocationServiceNodeRecord?,
-        isPermanentQueue: @escaping @Sendable (String) -> Bool
+        sessionSigner: @escaping @Sendable ([UInt8]) -> [UInt8]? = { _ in nil },
+        peerVerifier: @escaping @Sendable ([UInt8], [UInt8], UUID) -> Bool = { _, _, _ in false },
+        replayWindowSize: @escaping @Sendable () -> Int = { BoxReplayWindow.defaultSize },
+        helloCookieThreshold: @escaping @Sendable () -> Int = { BoxHelloCookieJar.defaultThreshold },
+        diskPressure: @escaping @Sendable () -> Bool = { false },
+        leasePolicy: @escaping @Sendable () -> BoxLeasePolicy = { BoxLeasePolicy() },
+        volatileQueues: BoxVolatileQueues = BoxVolatileQueues()
     ) {
         self.logger = logger
         self.allocator = allocator
@@ -31,7 +86,13 @@ final class BoxServerHandler: ChannelInboundHandler {
         self.identityProvider = identityProvider
         self.authorizer = authorizer
         self.locationResolver = locationResolver
-        self.isPermanentQueue = isPermanentQueue
+        self.sessionSigner = sessionSigner
+        self.peerVerifier = peerVerifier
+        self.replayWindowSize = replayWindowSize
+        self.helloCookieThreshold = helloCookieThreshold
+        self.diskPressure = diskPressure
+        self.leasePolicy = leasePolicy
+        self.volatileQueues = volatileQueues
         let encoder = JSONEncoder()
         encoder.outputFormatting = [.sortedKeys]
         self.jsonEncoder = encoder
@@ -42,35 +103,75 @@ final class BoxServerHandler: ChannelInboundHandler {
         var datagram = envelope.data
 
         do {
-            let frame = try BoxCodec.decodeFrame(from: &datagram)
-            try handle(frame: frame, from: envelope.remoteAddress, context: context)
+            var frame = try BoxCodec.decodeFrame(from: &datagram)
+            let sealed = frame.isSealed
+            if sealed {
+                guard openSealedFrame(&frame, from: envelope.remoteAddress, context: context) else { return }
+            }
+            try handle(frame: frame, from: envelope.remoteAddress, sealed: sealed, context: context)
         } catch {
             logger.warning("failed to decode datagram", metadata: ["error": "\(error)", "remote": "\(envelope.remoteAddress)"])
         }
     }
 
-    private func handle(frame: BoxCodec.Frame, from remote: SocketAddress, context: ChannelHandlerContext) throws {
+    /// Opens a sealed frame with the cached session of `remote`.
+    /// - Returns: `false` when the frame must be dropped (no session, replay or forged tag).
+    private func openSealedFrame(_ frame: inout BoxCodec.Frame, from remote: SocketAddress, context: ChannelHandlerContext) -> Bool {
+        guard sessions[remote] != nil || pendingSessions[remote] != nil else {
+            let statusPayload = BoxCodec.encodeStatusPayload(status: .unauthorized, message: "session-required", allocator: allocator)
+            send(command: .status, requestId: frame.requestId, payload: statusPayload, to: remote, context: context)
+            return false
+        }
+        var failure: Error?
+        if sessions[remote] != nil {
+            do {
+                try sessions[remote]?.session.open(&frame)
+                sessions[remote]?.lastUsed = .now()
+                return true
+            } catch {
+                failure = error
+            }
+        }
+        if var pending = pendingSessions[remote] {
+            do {
+                // The peer holds the keys of its latest HELLO: that session now replaces the live one.
+                try pending.session.open(&frame)
+                pendingSessions.removeValue(forKey: remote)
+                storeSession(pending.session, for: remote, node: pending.node)
+                return true
+            } catch {
+                failure = error
+            }
+        }
+        // Forged or replayed datagrams are dropped silently: answering would help an attacker probe.
+        logger.debug("dropping sealed datagram", metadata: ["remote": "\(remote)", "error": "\(String(describing: failure))"])
+        return false
+    }
+
+    private func handle(frame: BoxCodec.Frame, from remote: SocketAddress, sealed: Bool, context: ChannelHandlerContext) throws {
         var payload = frame.payload
         switch frame.command {
         case .hello:
             try respondToHello(payload: &payload, frame: frame, remote: remote, context: context)
         case .status:
-            try respondToStatus(frame: frame, remote: remote, context: context)
+            try respondToStatus(frame: frame, remote: remote, sealed: sealed, context: context)
         case .put:
-            try handlePut(payload: &payload, frame: frame, remote: remote, context: context)
+            try handlePut(payload: &payload, frame: frame, remote: remote, sealed: sealed, context: context)
         case .get:
-            try handleGet(payload: &payload, frame: frame, remote: remote, context: context)
+            try handleGet(payload: &payload, frame: frame, remote: remote, sealed: sealed, context: context)
+        case .delete:
+            try handleDelete(payload: &payload, frame: frame, remote: remote, sealed: sealed, context: context)
         case .locate:
-            try handleLocate(payload: &payload, frame: frame, remote: remote, context: context)
+            try handleLocate(payload: &payload, frame: frame, remote: remote, sealed: sealed, context: context)
         case .search:
-            try handleSearch(payload: &payload, frame: frame, remote: remote, context: context)
+            try handleSearch(payload: &payload, frame: frame, remote: remote, sealed: sealed, context: context)
         default:
             let statusPayload = BoxCodec.encodeStatusPayload(
                 status: .badRequest,
                 message: "unknown-command",
                 allocator: allocator
             )
-            send(command: .status, requestId: frame.requestId, payload: statusPayload, to: remote, context: context)
+            send(command: .status, requestId: frame.requestId, payload: statusPayload, to: remote, context: context, sealed: sealed)
         }
     }
 
@@ -86,26 +187,102 @@ final class BoxServerHandler: ChannelInboundHandler {
             send(command: .status, requestId: frame.requestId, payload: statusPayload, to: remote, context: context)
             return
         }
-        let responsePayload = try BoxCodec.encodeHelloPayload(status: .ok, versions: [1], allocator: allocator)
+        guard let keyShare = hello.keyShare else {
+            let responsePayload = try BoxCodec.encodeHelloPayload(status: .ok, versions: [1], allocator: allocator)
+            send(command: .hello, requestId: frame.requestId, payload: responsePayload, to: remote, context: context)
+            return
+        }
+
+        // Under load, demand a cookie before spending X25519 work or session state on the sender.
+        // The challenge is smaller than the HELLO that triggered it, so it cannot amplify a spoofed flood.
+        cookieJar.threshold = helloCookieThreshold()
+        if cookieJar.recordHandshake() {
+            let address = Self.cookieAddress(of: remote)
+            guard let echoed = hello.cookie, cookieJar.validate(echoed, for: address) else {
+                let challenge = BoxCodec.HelloPayload(status: .rateLimited, supportedVersions: [1], cookie: cookieJar.cookie(for: address))
+                let challengePayload = try BoxCodec.encodeHelloPayload(challenge, allocator: allocator)
+                send(command: .hello, requestId: frame.requestId, payload: challengePayload, to: remote, context: context)
+                return
+            }
+        }
+
+        // A key share opens a pending session; it replaces the live one once the peer seals a frame with it.
+        let handshake = BoxSessionHandshake()
+        let session: BoxSession
+        do {
+            session = try handshake.session(peerShare: keyShare, role: .responder, replayWindowSize: replayWindowSize())
+        } catch {
+            logger.info("HELLO with invalid key share", metadata: ["remote": "\(remote)", "error": "\(error)"])
+            let statusPayload = BoxCodec.encodeStatusPayload(status: .badRequest, message: "invalid-key-share", allocator: allocator)
+            send(command: .status, requestId: frame.requestId, payload: statusPayload, to: remote, context: context)
+            return
+        }
+        // A node signing its share (queue mirroring) is bound to the session; anyone else stays anonymous.
+        var node: UUID?
+        if let signature = hello.signature,
+           peerVerifier(signature, BoxSessionHandshake.initiatorTranscript(initiatorShare: keyShare, node: frame.nodeId), frame.nodeId) {
+            node = frame.nodeId
+        }
+        storePendingSession(session, for: remote, node: node)
+        let transcript = BoxSessionHandshake.transcript(initiatorShare: keyShare, responderShare: handshake.publicKey)
+        let response = BoxCodec.HelloPayload(
+            status: .ok,
+            supportedVersions: [1],
+            keyShare: handshake.publicKey,
+            signature: sessionSigner(transcript)
+        )
+        let responsePayload = try BoxCodec.encodeHelloPayload(response, allocator: allocator)
         send(command: .hello, requestId: frame.requestId, payload: responsePayload, to: remote, context: context)
     }
 
-    private func respondToStatus(frame: BoxCodec.Frame, remote: SocketAddress, context: ChannelHandlerContext) throws {
+    /// Bytes a cookie is bound to: source IP and port as seen on the socket.
+    private static func cookieAddress(of remote: SocketAddress) -> [UInt8] {
+        Array("\(remote.ipAddress ?? "")|\(remote.port ?? 0)".utf8)
+    }
+
+    private func storePendingSession(_ session: BoxSession, for remote: SocketAddress, node: UUID?) {
+        let now = NIODeadline.now()
+        if pendingSessions[remote] == nil && pendingSessions.count >= Self.maxSessions {
+            // Unproven handshakes are cheap to redo: drop the stale ones, then the oldest.
+            let idleLimit = now - Self.pendingSessionTimeout
+            pendingSessions = pendingSessions.filter { $0.value.lastUsed > idleLimit }
+            if pendingSessions.count >= Self.maxSessions,
+               let oldest = pendingSessions.min(by: { $0.value.lastUsed < $1.value.lastUsed })?.key {
+                pendingSessions.removeValue(forKey: oldest)
+            }
+        }
+        pendingSessions[remote] = SessionEntry(session: session, lastUsed: now, node: node)
+    }
+
+    private func storeSession(_ session: BoxSession, for remote: SocketAddress, node: UUID?) {
+        let now = NIODeadline.now()
+        if sessions[remote] == nil && sessions.count >= Self.maxSessions {
+            let idleLimit = now - Self.sessionIdleTimeout
+            sessions = sessions.filter { $0.value.lastUsed > idleLimit }
+            if sessions.count >= Self.maxSessions,
+               let oldest = sessions.min(by: { $0.value.lastUsed < $1.value.lastUsed })?.key {
+                sessions.removeValue(forKey: oldest)
+            }
+        }
+        sessions[remote] = SessionEntry(session: session, lastUsed: now, node: node)
+    }
+
+    private func respondToStatus(frame: BoxCodec.Frame, remote: SocketAddress, sealed: Bool, context: ChannelHandlerContext) throws {
         var payload = frame.payload
         let status = try BoxCodec.decodeStatusPayload(from: &payload)
         logger.debug("STATUS received", metadata: ["status": "\(status.status)", "message": "\(status.message)"])
         let buildMessage = "pong \(BoxVersionInfo.description)"
         let pongPayload = BoxCodec.encodeStatusPayload(status: .ok, message: buildMessage, allocator: allocator)
-        send(command: .status, requestId: frame.requestId, payload: pongPayload, to: remote, context: context)
+        send(command: .status, requestId: frame.requestId, payload: pongPayload, to: remote, context: context, sealed: sealed)
     }
 
-    private func handlePut(payload: inout ByteBuffer, frame: BoxCodec.Frame, remote: SocketAddress, context: ChannelHandlerContext) throws {
+    private func handlePut(payload: inout ByteBuffer, frame: BoxCodec.Frame, remote: SocketAddress, sealed: Bool, context: ChannelHandlerContext) throws {
         let putPayload = try BoxCodec.decodePutPayload(from: &payload)
         let queuePath = putPayload.queuePath
         let requestId = frame.requestId
-        let normalizedQueue: String
+        let queueHandle: BoxQueueHandle
         do {
-            normalizedQueue = try BoxServerStore.normalizeQueueName(queuePath)
+            queueHandle = try store.queueHandles.handle(for: queuePath)
         } catch {
             let allocator = self.allocator
             let eventLoop = context.eventLoop
@@ -118,15 +295,51 @@ final class BoxServerHandler: ChannelInboundHandler {
                 )
                 let statusPayload = BoxCodec.encodeStatusPayload(status: .badRequest, message: "invalid-queue", allocator: allocator)
                 let contextValue = contextBox.value
-                self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
             }
             return
         }
 
+        let normalizedQueue = queueHandle.name
+        let volatilePolicy = queueHandle.volatilePolicy
+        let needsDisk = volatilePolicy.map { $0.overflow == .spill } ?? true
+        if needsDisk && diskPressure() && !DiskSpaceMonitor.isCritical(queue: normalizedQueue) {
+            let allocator = self.allocator
+            let eventLoop = context.eventLoop
+            let contextBox = UncheckedSendableBox(context)
+            let remoteAddress = remote
+            eventLoop.execute {
+                self.logger.debug("rejecting put under disk pressure", metadata: ["queue": .string(normalizedQueue)])
+                let statusPayload = BoxCodec.encodeStatusPayload(status: .rateLimited, message: "disk-pressure", allocator: allocator)
+                let contextValue = contextBox.value
+                self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
+            }
+            return
+        }
+
+        if putPayload.contentType == BoxMirrorBatch.contentType {
+            handleMirrorPut(putPayload, frame: frame, remote: remote, sealed: sealed, context: context)
+            return
+        }
+
         let nodeId = frame.nodeId
         let userId = frame.userId
         let contentType = putPayload.contentType
-        let payloadBytes = putPayload.data
+        let receivedBytes = putPayload.data
+        let receivedEncoding = putPayload.encoding
+        let notBefore = putPayload.notBefore.flatMap { $0 > Date() ? $0 : nil }
+        let priority = putPayload.priority
+        if volatilePolicy != nil && notBefore != nil {
+            let allocator = self.allocator
+            let contextBox = UncheckedSendableBox(context)
+            let remoteAddress = remote
+            context.eventLoop.execute {
+                let statusPayload = BoxCodec.encodeStatusPayload(status: .badRequest, message: "volatile-queue", allocator: allocator)
+                self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextBox.value, sealed: sealed)
+            }
+            return
+        }
+        let volatileQueues = self.volatileQueues
         let store = self.store
         let logger = self.logger
         let allocator = self.allocator
@@ -136,29 +349,59 @@ final class BoxServerHandler: ChannelInboundHandler {
         let authorizer = self.authorizer
 
         Task {
+            func answer(_ status: BoxCodec.Status, _ message: String) {
+                eventLoop.execute {
+                    let statusPayload = BoxCodec.encodeStatusPayload(status: status, message: message, allocator: allocator)
+                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextBox.value, sealed: sealed)
+                }
+            }
+            func rejectUnauthorized() {
+                logger.debug(
+                    "rejecting put due to unauthorized identity",
+                    metadata: [
+                        "queue": .string(normalizedQueue),
+                        "requestNode": .string(nodeId.uuidString),
+                        "requestUser": .string(userId.uuidString)
+                    ]
+                )
+                answer(.unauthorized, "unknown-client")
+            }
+
+            // Authorization comes first: an unknown sender gets nothing expanded but a Location record
+            // (self-registration), and only up to the size of one datagram.
             let permitted = await authorizer(nodeId, userId)
-            let allowRegistration = (!permitted) && self.shouldAcceptSelfRegistration(
+            let isLocationQueue = normalizedQueue.caseInsensitiveCompare("whoswho") == .orderedSame
+            guard permitted || isLocationQueue else {
+                rejectUnauthorized()
+                return
+            }
+
+            // Payloads rest as received, so a compressed one is checked here, off the event loop: a corrupt
+            // block would otherwise only surface on GET, after a pop already removed the object. This is the
+            // only decode: the digest of the content goes to the store with the object.
+            let plainBytes: [UInt8]
+            do {
+                plainBytes = try BoxCompression.decode(
+                    receivedBytes,
+                    encoding: receivedEncoding,
+                    maximumSize: permitted ? BoxCompression.maximumDecompressedSize : Self.selfRegistrationMaximumSize
+                )
+            } catch {
+                answer(.badRequest, "invalid-compression")
+                return
+            }
+            // Location records are parsed by the server itself, so they are the one thing stored expanded.
+            let payloadBytes = isLocationQueue ? plainBytes : receivedBytes
+            let encoding: BoxCodec.PayloadEncoding = isLocationQueue ? .identity : receivedEncoding
+
+            guard permitted || self.shouldAcceptSelfRegistration(
                 queue: normalizedQueue,
                 contentType: contentType,
-                payloadBytes: payloadBytes,
+                payloadBytes: plainBytes,
                 nodeId: nodeId,
                 userId: userId
-            )
-
-            guard permitted || allowRegistration else {
-                eventLoop.execute {
-                    logger.debug(
-                        "rejecting put due to unauthorized identity",
-                        metadata: [
-                            "queue": .string(normalizedQueue),
-                            "requestNode": .string(nodeId.uuidString),
-                            "requestUser": .string(userId.uuidString)
-                        ]
-                    )
-                    let statusPayload = BoxCodec.encodeStatusPayload(status: .unauthorized, message: "unknown-client", allocator: allocator)
-                    let contextValue = contextBox.value
-                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
-                }
+            ) else {
+                rejectUnauthorized()
                 return
             }
 
@@ -200,41 +443,197 @@ final class BoxServerHandler: ChannelInboundHandler {
                         contentType: contentType,
                         data: payloadBytes,
                         nodeId: nodeId,
-                        userId: userId
+                        userId: userId,
+                        priority: priority,
+                        encoding: encoding
                     )
                 }
-                try await store.put(storedObject, into: normalizedQueue)
-                logger.info(
+                let reply: (status: BoxCodec.Status, message: String)
+                if let notBefore {
+                    try await store.schedule(storedObject, into: normalizedQueue, notBefore: notBefore, contentDigest: BoxContentDigest(of: plainBytes))
+                    reply = (.ok, "scheduled")
+                } else if volatilePolicy != nil {
+                    switch volatileQueues.push(storedObject, into: normalizedQueue) {
+                    case .stored, .droppedOldest:
+                        reply = (.ok, "stored")
+                    case .rejected:
+                        reply = (.rateLimited, "queue-full")
+                    case .spill:
+                        defer { volatileQueues.finishSpill(normalizedQueue) }
+                        try await store.put(storedObject, into: normalizedQueue, contentDigest: BoxContentDigest(of: plainBytes))
+                        reply = (.ok, "stored")
+                    }
+                } else {
+                    try await store.put(storedObject, into: normalizedQueue, contentDigest: BoxContentDigest(of: plainBytes))
+                    reply = (.ok, "stored")
+                }
+                // Volatile traffic is high-rate by design: keep it out of the info log.
+                logger.log(
+                    level: volatilePolicy == nil ? .info : .debug,
                     "stored object on queue \(normalizedQueue)",
                     metadata: [
                         "queue": .string(normalizedQueue),
                         "bytes": .string("\(storedObject.data.count)"),
                         "originNode": .string(storedObject.nodeId.uuidString),
-                        "originUser": .string(storedObject.userId.uuidString)
+                        "originUser": .string(storedObject.userId.uuidString),
+                        "notBefore": .string(notBefore.map { "\($0)" } ?? "-"),
+                        "priority": .stringConvertible(storedObject.priority),
+                        "encoding": .string(storedObject.encoding.name),
+                        "result": .string(reply.message)
                     ]
                 )
                 eventLoop.execute {
-                    let statusPayload = BoxCodec.encodeStatusPayload(status: .ok, message: "stored", allocator: allocator)
+                    let statusPayload = BoxCodec.encodeStatusPayload(status: reply.status, message: reply.message, allocator: allocator)
                     let contextValue = contextBox.value
-                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
                 }
             } catch {
                 logger.error(
                     "failed to store object",
                     metadata: ["queue": .string(normalizedQueue), "error": .string("\(error)")]
                 )
+                let outOfSpace = DiskSpaceMonitor.isOutOfSpace(error)
                 eventLoop.execute {
-                    let statusPayload = BoxCodec.encodeStatusPayload(status: .internalError, message: "storage-error", allocator: allocator)
+                    let statusPayload = outOfSpace
+                        ? BoxCodec.encodeStatusPayload(status: .tooLarge, message: "storage-full", allocator: allocator)
+                        : BoxCodec.encodeStatusPayload(status: .internalError, message: "storage-error", allocator: allocator)
                     let contextValue = contextBox.value
-                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
+                }
+            }
+        }
+    }
+
+    /// Applies a mirror batch sent by another node of the same user (SPECS §7.16). The reply carries the
+    /// position applied; `conflict` asks the primary for a full copy.
+    ///
+    /// Frame headers are not authenticated by themselves: the batch must arrive sealed with a session
+    /// whose HELLO the source node signed. A batch larger than one datagram arrives as chunks sharing a
+    /// transfer identifier (`objectId`); each chunk is acknowledged, and the last one gets the reply.
+    private func handleMirrorPut(_ putPayload: BoxCodec.PutPayload, frame: BoxCodec.Frame, remote: SocketAddress, sealed: Bool, context: ChannelHandlerContext) {
+        let store = self.store
+        let logger = self.logger
+        let allocator = self.allocator
+        let eventLoop = context.eventLoop
+        let contextBox = UncheckedSendableBox(context)
+        let remoteAddress = remote
+        let authorizer = self.authorizer
+        let requestId = frame.requestId
+        let nodeId = frame.nodeId
+        let userId = frame.userId
+        let ownUserId = identityProvider().1
+        let authenticatedNode = sealed ? sessions[remote]?.node : nil
+        let encoding = putPayload.encoding
+        var data = putPayload.data
+        var transferId: UUID?
+
+        if let chunk = putPayload.chunk {
+            let answer = { (status: BoxCodec.Status, message: String) in
+                let statusPayload = BoxCodec.encodeStatusPayload(status: status, message: message, allocator: allocator)
+                self.send(command: .status, requestId: requestId, payload: statusPayload, to: remote, context: context, sealed: sealed)
+            }
+            guard authenticatedNode == nodeId, userId == ownUserId else {
+                answer(.forbidden, "mirror-forbidden")
+                return
+            }
+            switch collectMirrorChunk(data, chunk: chunk, transfer: putPayload.objectId, from: remote) {
+            case .complete(let assembled):
+                data = assembled
+                transferId = putPayload.objectId
+            case .partial:
+                answer(.ok, "chunk \(chunk.index)")
+                return
+            case .answered(let status, let message):
+                answer(status, message)
+                return
+            case .applying:
+                // Answered once the batch is applied; the sender retransmits meanwhile.
+                return
+            case .invalid:
+                answer(.badRequest, "invalid-mirror-batch")
+                return
+            }
+        }
+        let assembledData = data
+        let assembledTransfer = transferId
+
+        Task {
+            var permitted = false
+            if userId == ownUserId, let authenticatedNode, authenticatedNode == nodeId {
+                permitted = await authorizer(nodeId, userId)
+            }
+            let reply: (status: BoxCodec.Status, message: String)
+            if !permitted {
+                reply = (.forbidden, "mirror-forbidden")
+            } else if let plain = try? BoxCompression.decode(assembledData, encoding: encoding),
+                      let batch = try? BoxMirrorBatch.decode(from: Data(plain)),
+                      batch.source == nodeId {
+                do {
+                    let applied = try await store.applyMirrorBatch(batch)
+                    reply = (.ok, "mirrored \(applied.map { String($0) } ?? "-")")
+                    logger.debug("mirror batch applied", metadata: [
+                        "queue": .string(batch.queue),
+                        "originNode": .string(nodeId.uuidString),
+                        "entries": .stringConvertible(batch.entries.count),
+                        "applied": .string(applied.map { String($0) } ?? "-")
+                    ])
+                } catch BoxStoreError.mirrorOutOfSync {
+                    reply = (.conflict, "mirror-reset-required")
+                } catch {
+                    logger.error("failed to apply mirror batch", metadata: ["queue": .string(batch.queue), "error": .string("\(error)")])
+                    reply = DiskSpaceMonitor.isOutOfSpace(error) ? (.tooLarge, "storage-full") : (.internalError, "storage-error")
+                }
+            } else {
+                reply = (.badRequest, "invalid-mirror-batch")
+            }
+            eventLoop.execute {
+                if let assembledTransfer, self.mirrorTransfers[remoteAddress]?.id == assembledTransfer {
+                    // Kept so a retransmitted last chunk gets the same answer instead of a second apply.
+                    self.mirrorTransfers[remoteAddress]?.reply = reply
                 }
+                let statusPayload = BoxCodec.encodeStatusPayload(status: reply.status, message: reply.message, allocator: allocator)
+                self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextBox.value, sealed: sealed)
             }
         }
     }
 
-    private func handleGet(payload: inout ByteBuffer, frame: BoxCodec.Frame, remote: SocketAddress, context: ChannelHandlerContext) throws {
+    /// Adds one chunk to the mirror transfer of `remote`, which replaces any older transfer of that peer.
+    private func collectMirrorChunk(_ data: [UInt8], chunk: BoxCodec.ChunkInfo, transfer id: UUID?, from remote: SocketAddress) -> MirrorChunkOutcome {
+        guard let id,
+              Int(chunk.count) * BoxCodec.maxChunkSize <= BoxMirrorBatch.maxTransferBytes,
+              data.count <= BoxCodec.maxChunkSize else {
+            return .invalid
+        }
+        var transfer = mirrorTransfers[remote].flatMap { $0.id == id ? $0 : nil } ?? MirrorTransfer(id: id, count: chunk.count)
+        if let reply = transfer.reply {
+            return .answered(reply.status, reply.message)
+        }
+        guard transfer.count == chunk.count else { return .invalid }
+        guard !transfer.applying else { return .applying }
+        transfer.parts[chunk.index] = data
+        transfer.lastUsed = .now()
+        if mirrorTransfers[remote] == nil && mirrorTransfers.count >= Self.maxMirrorTransfers,
+           let oldest = mirrorTransfers.min(by: { $0.value.lastUsed < $1.value.lastUsed })?.key {
+            mirrorTransfers.removeValue(forKey: oldest)
+        }
+        guard transfer.parts.count == Int(transfer.count) else {
+            mirrorTransfers[remote] = transfer
+            return .partial
+        }
+        let assembled = (0..<transfer.count).flatMap { transfer.parts[$0] ?? [] }
+        transfer.parts = [:]
+        transfer.applying = true
+        mirrorTransfers[remote] = transfer
+        return .complete(assembled)
+    }
+
+    private func handleGet(payload: inout ByteBuffer, frame: BoxCodec.Frame, remote: SocketAddress, sealed: Bool, context: ChannelHandlerContext) throws {
         let getPayload = try BoxCodec.decodeGetPayload(from: &payload)
         let queuePath = getPayload.queuePath
+        let cursor = getPayload.cursor
+        let acceptsCompression = getPayload.acceptsCompression
+        let leasePolicy = self.leasePolicy()
+        let volatileQueues = self.volatileQueues
         let store = self.store
         let allocator = self.allocator
         let logger = self.logger
@@ -242,14 +641,13 @@ final class BoxServerHandler: ChannelInboundHandler {
         let eventLoop = context.eventLoop
         let contextBox = UncheckedSendableBox(context)
         let remoteAddress = remote
-        let permanent = self.isPermanentQueue(queuePath)
         let authorizer = self.authorizer
         let nodeId = frame.nodeId
         let userId = frame.userId
 
-        let normalizedQueue: String
+        let queueHandle: BoxQueueHandle
         do {
-            normalizedQueue = try BoxServerStore.normalizeQueueName(queuePath)
+            queueHandle = try store.queueHandles.handle(for: queuePath)
         } catch {
             eventLoop.execute {
                 logger.debug(
@@ -258,10 +656,12 @@ final class BoxServerHandler: ChannelInboundHandler {
                 )
                 let statusPayload = BoxCodec.encodeStatusPayload(status: .badRequest, message: "invalid-queue", allocator: allocator)
                 let contextValue = contextBox.value
-                self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
             }
             return
         }
+        let normalizedQueue = queueHandle.name
+        let permanent = queueHandle.permanent
 
         Task {
             let permitted = await authorizer(nodeId, userId)
@@ -277,32 +677,86 @@ final class BoxServerHandler: ChannelInboundHandler {
                     )
                     let statusPayload = BoxCodec.encodeStatusPayload(status: .unauthorized, message: "unknown-client", allocator: allocator)
                     let contextValue = contextBox.value
-                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
                 }
                 return
             }
 
-            do {
-                let object: BoxStoredObject?
-                if permanent {
-                    object = try await store.peekOldest(from: normalizedQueue)
+            if let cursor {
+                let reply: CursorReply
+                if queueHandle.volatilePolicy != nil {
+                    // Volatile objects carry no durable position or lease state.
+                    reply = .status(.badRequest, "volatile-queue")
                 } else {
-                    object = try await store.popOldest(from: normalizedQueue)
+                    reply = await Self.applyCursor(cursor, queue: normalizedQueue, leasePolicy: leasePolicy, store: store, logger: logger)
                 }
-                if let object {
-                    eventLoop.execute {
-                        let responsePayload = BoxCodec.encodePutPayload(
-                            BoxCodec.PutPayload(queuePath: queuePath, contentType: object.contentType, data: object.data),
-                            allocator: allocator
+                switch reply {
+                case .object(let object):
+                    // Sliced like a plain GET; the requester commits or acknowledges the id under its cursor name.
+                    do {
+                        try await self.sendObject(
+                            BoxStreamedObject(object),
+                            queuePath: queuePath,
+                            acceptsCompression: acceptsCompression,
+                            leased: false,
+                            identified: true,
+                            requestId: requestId,
+                            to: remoteAddress,
+                            contextBox: contextBox,
+                            eventLoop: eventLoop,
+                            sealed: sealed
                         )
-                        let contextValue = contextBox.value
-                        self.send(command: .put, requestId: requestId, payload: responsePayload, to: remoteAddress, context: contextValue)
+                    } catch {
+                        logger.error("failed to send cursor object", metadata: ["queue": .string(normalizedQueue), "error": .string("\(error)")])
+                        eventLoop.execute {
+                            let statusPayload = BoxCodec.encodeStatusPayload(status: .internalError, message: "storage-error", allocator: allocator)
+                            self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextBox.value, sealed: sealed)
+                        }
+                    }
+                case let .status(status, message):
+                    eventLoop.execute {
+                        let statusPayload = BoxCodec.encodeStatusPayload(status: status, message: message, allocator: allocator)
+                        self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextBox.value, sealed: sealed)
+                    }
+                }
+                return
+            }
+
+            do {
+                let found: BoxStreamedObject?
+                // A consuming GET leases the object and only removes it once the reply is out (SPECS §7.10).
+                let consumer = queueHandle.volatilePolicy != nil || permanent ? nil : BoxCodec.CursorRequest.chunkedGetConsumer(for: requestId)
+                if queueHandle.volatilePolicy != nil {
+                    found = try await Self.dequeueVolatile(normalizedQueue, peek: permanent, volatileQueues: volatileQueues, store: store)
+                        .map(BoxStreamedObject.init)
+                } else {
+                    found = try await store.openOldest(from: normalizedQueue, leasingTo: consumer, visibility: leasePolicy.visibilityTimeout)
+                }
+                if let found {
+                    let chunked = try await self.sendObject(
+                        found,
+                        queuePath: queuePath,
+                        acceptsCompression: acceptsCompression,
+                        leased: consumer != nil,
+                        requestId: requestId,
+                        to: remoteAddress,
+                        contextBox: contextBox,
+                        eventLoop: eventLoop,
+                        sealed: sealed
+                    )
+                    if let consumer, !chunked {
+                        // A single frame is popped as before; slices wait for the requester's `ack`.
+                        do {
+                            try await store.acknowledge(queue: normalizedQueue, id: found.id, consumer: consumer)
+                        } catch {
+                            logger.warning("failed to remove popped object", metadata: ["queue": .string(normalizedQueue), "id": .string(found.id.uuidString), "error": .string("\(error)")])
+                        }
                     }
                 } else {
                     eventLoop.execute {
                         let statusPayload = BoxCodec.encodeStatusPayload(status: .badRequest, message: "not-found", allocator: allocator)
                         let contextValue = contextBox.value
-                        self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                        self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
                     }
                 }
             } catch {
@@ -313,13 +767,248 @@ final class BoxServerHandler: ChannelInboundHandler {
                 eventLoop.execute {
                     let statusPayload = BoxCodec.encodeStatusPayload(status: .internalError, message: "storage-error", allocator: allocator)
                     let contextValue = contextBox.value
-                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
                 }
             }
         }
     }
 
-    private func handleSearch(payload: inout ByteBuffer, frame: BoxCodec.Frame, remote: SocketAddress, context: ChannelHandlerContext) throws {
+    /// Answers a GET with `object`: one PUT frame when it fits, otherwise `maxChunkSize` slices read
+    /// from the store one at a time, each handed to the socket before the next is read (SPECS §7.10).
+    /// Slices of a `leased` object carry its id, which the requester acknowledges once it has them all.
+    /// An `identified` object (cursor reply) carries its id in every frame, sliced or not.
+    /// - Returns: Whether the object was sliced.
+    @discardableResult
+    private func sendObject(
+        _ object: BoxStreamedObject,
+        queuePath: String,
+        acceptsCompression: Bool,
+        leased: Bool,
+        identified: Bool = false,
+        requestId: UUID,
+        to remote: SocketAddress,
+        contextBox: UncheckedSendableBox<ChannelHandlerContext>,
+        eventLoop: EventLoop,
+        sealed: Bool
+    ) async throws -> Bool {
+        let allocator = self.allocator
+        // Expanding needs the whole frame, which `BoxCompression.maximumDecompressedSize` bounds.
+        let expand = object.encoding != .identity && !acceptsCompression
+        let reader = expand
+            ? BoxPayloadReader(bytes: try BoxCompression.decode(try object.payload.readRemaining(), encoding: object.encoding))
+            : object.payload
+        let encoding: BoxCodec.PayloadEncoding = expand ? .identity : object.encoding
+        let chunkCount = (reader.size + BoxCodec.maxChunkSize - 1) / BoxCodec.maxChunkSize
+        guard chunkCount > 1 else {
+            let data = try reader.readRemaining()
+            eventLoop.execute {
+                let responsePayload = BoxCodec.encodePutPayload(
+                    BoxCodec.PutPayload(queuePath: queuePath, contentType: object.contentType, data: data, objectId: identified ? object.id : nil, encoding: encoding),
+                    allocator: allocator
+                )
+                self.send(command: .put, requestId: requestId, payload: responsePayload, to: remote, context: contextBox.value, sealed: sealed)
+            }
+            return false
+        }
+        let objectId = leased || identified ? object.id : nil
+        for index in 0..<chunkCount {
+            guard let data = try reader.nextChunk(maxLength: BoxCodec.maxChunkSize) else { break }
+            let chunk = BoxCodec.ChunkInfo(index: UInt32(index), count: UInt32(chunkCount))
+            try await eventLoop.flatSubmit { () -> EventLoopFuture<Void> in
+                let promise = eventLoop.makePromise(of: Void.self)
+                let responsePayload = BoxCodec.encodePutPayload(
+                    BoxCodec.PutPayload(queuePath: queuePath, contentType: object.contentType, data: data, objectId: objectId, encoding: encoding, chunk: chunk),
+                    allocator: allocator
+                )
+                self.send(command: .put, requestId: requestId, payload: responsePayload, to: remote, context: contextBox.value, sealed: sealed, promise: promise)
+                return promise.futureResult
+            }.get()
+        }
+        logger.debug("streamed object", metadata: ["queue": .string(queuePath), "bytes": .stringConvertible(reader.size), "chunks": .stringConvertible(chunkCount)])
+        return true
+    }
+
+    /// Object as sent to a requester: stored bytes go out as-is when it accepts their encoding, otherwise
+    /// they are expanded here (SPECS §7.9).
+    private static func outgoing(_ object: BoxStoredObject, acceptsCompression: Bool) throws -> BoxStoredObject {
+        guard object.encoding != .identity, !acceptsCompression else { return object }
+        return BoxStoredObject(
+            id: object.id,
+            contentType: object.contentType,
+            data: try BoxCompression.decode(object.data, encoding: object.encoding),
+            createdAt: object.createdAt,
+            nodeId: object.nodeId,
+            userId: object.userId,
+            userMetadata: object.userMetadata,
+            digest: object.digest,
+            priority: object.priority
+        )
+    }
+
+    /// Serves a volatile queue from memory, then from its spilled disk backlog once the ring is empty.
+    private static func dequeueVolatile(
+        _ queue: String,
+        peek: Bool,
+        volatileQueues: BoxVolatileQueues,
+        store: BoxServerStore
+    ) async throws -> BoxStoredObject? {
+        if let object = peek ? volatileQueues.peek(from: queue) : volatileQueues.pop(from: queue) {
+            return object
+        }
+        guard let marker = volatileQueues.diskBacklogMarker(queue) else { return nil }
+        let spilled: BoxStoredObject?
+        do {
+            spilled = peek ? try await store.peekOldest(from: queue) : try await store.popOldest(from: queue)
+        } catch BoxStoreError.queueNotFound {
+            spilled = nil
+        }
+        if spilled == nil {
+            volatileQueues.clearDiskBacklog(queue, marker: marker)
+        }
+        return spilled
+    }
+
+    private enum CursorReply: Sendable {
+        case object(BoxStoredObject)
+        case status(BoxCodec.Status, String)
+    }
+
+    /// Runs a cursor or lease operation against the store. Cursor reads never remove objects, even on
+    /// ephemeral queues; leased objects are removed by their acknowledgement only.
+    private static func applyCursor(
+        _ request: BoxCodec.CursorRequest,
+        queue: String,
+        leasePolicy: BoxLeasePolicy,
+        store: BoxServerStore,
+        logger: Logger
+    ) async -> CursorReply {
+        do {
+            switch request.operation {
+            case .next:
+                guard let object = try await store.next(queue: queue, cursor: request.name) else {
+                    return .status(.notFound, "end-of-queue")
+                }
+                return .object(object)
+            case .commit(let id):
+                try await store.commit(queue: queue, cursor: request.name, through: id)
+                return .status(.ok, "committed")
+            case .seek(let date):
+                try await store.seek(queue: queue, cursor: request.name, to: date)
+                return .status(.ok, "positioned")
+            case .lease(let visibility):
+                var policy = leasePolicy
+                if let visibility {
+                    policy = BoxLeasePolicy(visibilityTimeout: visibility, maxInFlight: leasePolicy.maxInFlight)
+                }
+                switch try await store.lease(from: queue, consumer: request.name, policy: policy) {
+                case let .leased(object, _):
+                    return .object(object)
+                case .empty:
+                    return .status(.notFound, "empty")
+                case .windowFull:
+                    return .status(.rateLimited, "in-flight-limit")
+                }
+            case .ack(let id):
+                try await store.acknowledge(queue: queue, id: id, consumer: request.name)
+                return .status(.ok, "acknowledged")
+            }
+        } catch BoxStoreError.invalidCursorName {
+            return .status(.badRequest, "invalid-cursor")
+        } catch BoxStoreError.unorderedQueue {
+            return .status(.badRequest, "unordered-queue")
+        } catch BoxStoreError.queueNotFound {
+            return .status(.notFound, "not-found")
+        } catch BoxStoreError.objectNotFound {
+            return .status(.notFound, "not-found")
+        } catch BoxStoreError.leasedByAnotherConsumer {
+            return .status(.conflict, "leased")
+        } catch BoxStoreError.notLeased {
+            return .status(.conflict, "not-leased")
+        } catch {
+            logger.error("cursor operation failed", metadata: ["queue": .string(queue), "cursor": .string(request.name), "error": .string("\(error)")])
+            return .status(.internalError, "storage-error")
+        }
+    }
+
+    private func handleDelete(payload: inout ByteBuffer, frame: BoxCodec.Frame, remote: SocketAddress, sealed: Bool, context: ChannelHandlerContext) throws {
+        let deletePayload = try BoxCodec.decodeDeletePayload(from: &payload)
+        let queuePath = deletePayload.queuePath
+        let targets = deletePayload.targets
+        let store = self.store
+        let allocator = self.allocator
+        let logger = self.logger
+        let requestId = frame.requestId
+        let eventLoop = context.eventLoop
+        let contextBox = UncheckedSendableBox(context)
+        let remoteAddress = remote
+        let authorizer = self.authorizer
+        let nodeId = frame.nodeId
+        let userId = frame.userId
+
+        let normalizedQueue: String
+        do {
+            normalizedQueue = try store.queueHandles.handle(for: queuePath).name
+        } catch {
+            eventLoop.execute {
+                logger.debug(
+                    "rejecting delete due to invalid queue name",
+                    metadata: ["queue": .string(queuePath), "error": .string("\(error)")]
+                )
+                let statusPayload = BoxCodec.encodeStatusPayload(status: .badRequest, message: "invalid-queue", allocator: allocator)
+                let contextValue = contextBox.value
+                self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
+            }
+            return
+        }
+
+        Task {
+            let permitted = await authorizer(nodeId, userId)
+            let reply: (status: BoxCodec.Status, message: String)
+            if !permitted {
+                logger.debug(
+                    "rejecting delete due to unauthorized identity",
+                    metadata: [
+                        "queue": .string(normalizedQueue),
+                        "requestNode": .string(nodeId.uuidString),
+                        "requestUser": .string(userId.uuidString)
+                    ]
+                )
+                reply = (.unauthorized, "unknown-client")
+            } else {
+                do {
+                    let result = try await store.delete(queue: normalizedQueue, targets: targets)
+                    logger.info(
+                        "deleted objects from queue \(normalizedQueue)",
+                        metadata: [
+                            "queue": .string(normalizedQueue),
+                            "removed": .stringConvertible(result.removed),
+                            "missing": .stringConvertible(result.missing)
+                        ]
+                    )
+                    if result.removed == 0 {
+                        reply = (.notFound, "not-found")
+                    } else {
+                        reply = (.ok, "deleted=\(result.removed) missing=\(result.missing)")
+                    }
+                } catch BoxStoreError.queueNotFound {
+                    reply = (.notFound, "not-found")
+                } catch {
+                    logger.error(
+                        "failed to delete objects",
+                        metadata: ["queue": .string(normalizedQueue), "error": .string("\(error)")]
+                    )
+                    reply = (.internalError, "storage-error")
+                }
+            }
+            eventLoop.execute {
+                let statusPayload = BoxCodec.encodeStatusPayload(status: reply.status, message: reply.message, allocator: allocator)
+                let contextValue = contextBox.value
+                self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
+            }
+        }
+    }
+
+    private func handleSearch(payload: inout ByteBuffer, frame: BoxCodec.Frame, remote: SocketAddress, sealed: Bool, context: ChannelHandlerContext) throws {
         let searchPayload = try BoxCodec.decodeSearchPayload(from: &payload)
         let queuePath = searchPayload.queuePath
         let store = self.store
@@ -335,7 +1024,7 @@ final class BoxServerHandler: ChannelInboundHandler {
 
         let normalizedQueue: String
         do {
-            normalizedQueue = try BoxServerStore.normalizeQueueName(queuePath)
+            normalizedQueue = try store.queueHandles.handle(for: queuePath).name
         } catch {
             eventLoop.execute {
                 logger.debug(
@@ -344,7 +1033,7 @@ final class BoxServerHandler: ChannelInboundHandler {
                 )
                 let statusPayload = BoxCodec.encodeStatusPayload(status: .badRequest, message: "invalid-queue", allocator: allocator)
                 let contextValue = contextBox.value
-                self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
             }
             return
         }
@@ -363,7 +1052,7 @@ final class BoxServerHandler: ChannelInboundHandler {
                     )
                     let statusPayload = BoxCodec.encodeStatusPayload(status: .unauthorized, message: "unknown-client", allocator: allocator)
                     let contextValue = contextBox.value
-                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
                 }
                 return
             }
@@ -381,7 +1070,7 @@ final class BoxServerHandler: ChannelInboundHandler {
                             )
                             let statusPayload = BoxCodec.encodeStatusPayload(status: .ok, message: "sync-empty", allocator: allocator)
                             let contextValue = contextBox.value
-                            self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                            self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
                         }
                         return
                     }
@@ -390,10 +1079,27 @@ final class BoxServerHandler: ChannelInboundHandler {
 
                 var objects: [BoxStoredObject] = []
                 objects.reserveCapacity(references.count)
+                var oversized = 0
 
                 for reference in references {
                     do {
-                        let object = try await store.read(reference: reference)
+                        let object = try Self.outgoing(
+                            try await store.read(reference: reference),
+                            acceptsCompression: searchPayload.acceptsCompression
+                        )
+                        // Sync replies are never sliced: an object past one chunk is reported, not sent.
+                        guard object.data.count <= BoxCodec.maxChunkSize else {
+                            oversized += 1
+                            logger.warning(
+                                "object too large for search reply",
+                                metadata: [
+                                    "queue": .string(normalizedQueue),
+                                    "file": .string(reference.url.lastPathComponent),
+                                    "bytes": .stringConvertible(object.data.count)
+                                ]
+                            )
+                            continue
+                        }
                         objects.append(object)
                     } catch {
                         logger.warning(
@@ -408,15 +1114,22 @@ final class BoxServerHandler: ChannelInboundHandler {
                 }
 
                 let objectsToSend = objects
+                let completion = oversized == 0 ? "sync-complete" : "sync-complete too-large=\(oversized)"
                 eventLoop.execute {
                     let contextValue = contextBox.value
+                    var responses: [(BoxCodec.Command, ByteBuffer)] = []
+                    responses.reserveCapacity(objectsToSend.count + 1)
                     for object in objectsToSend {
-                        let putPayload = BoxCodec.PutPayload(queuePath: queuePath, contentType: object.contentType, data: object.data)
-                        let buffer = BoxCodec.encodePutPayload(putPayload, allocator: allocator)
-                        self.send(command: .put, requestId: requestId, payload: buffer, to: remoteAddress, context: contextValue)
+                        let putPayload = BoxCodec.PutPayload(
+                            queuePath: queuePath,
+                            contentType: object.contentType,
+                            data: object.data,
+                            encoding: object.encoding
+                        )
+                        responses.append((.put, BoxCodec.encodePutPayload(putPayload, allocator: allocator)))
                     }
-                    let statusPayload = BoxCodec.encodeStatusPayload(status: .ok, message: "sync-complete", allocator: allocator)
-                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                    responses.append((.status, BoxCodec.encodeStatusPayload(status: .ok, message: completion, allocator: allocator)))
+                    self.sendBatch(responses, requestId: requestId, to: remoteAddress, context: contextValue, sealed: sealed)
                 }
             } catch {
                 logger.error(
@@ -426,7 +1139,7 @@ final class BoxServerHandler: ChannelInboundHandler {
                 eventLoop.execute {
                     let statusPayload = BoxCodec.encodeStatusPayload(status: .internalError, message: "sync-error", allocator: allocator)
                     let contextValue = contextBox.value
-                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
                 }
             }
         }
@@ -450,7 +1163,7 @@ final class BoxServerHandler: ChannelInboundHandler {
         return false
     }
 
-    private func handleLocate(payload: inout ByteBuffer, frame: BoxCodec.Frame, remote: SocketAddress, context: ChannelHandlerContext) throws {
+    private func handleLocate(payload: inout ByteBuffer, frame: BoxCodec.Frame, remote: SocketAddress, sealed: Bool, context: ChannelHandlerContext) throws {
         let locatePayload = try BoxCodec.decodeLocatePayload(from: &payload)
         let allocator = self.allocator
         let logger = self.logger
@@ -478,7 +1191,7 @@ final class BoxServerHandler: ChannelInboundHandler {
                     )
                     let statusPayload = BoxCodec.encodeStatusPayload(status: .unauthorized, message: "unknown-client", allocator: allocator)
                     let contextValue = contextBox.value
-                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
                 }
                 return
             }
@@ -499,12 +1212,12 @@ final class BoxServerHandler: ChannelInboundHandler {
                             allocator: allocator
                         )
                         let contextValue = contextBox.value
-                        self.send(command: .put, requestId: requestId, payload: responsePayload, to: remoteAddress, context: contextValue)
+                        self.send(command: .put, requestId: requestId, payload: responsePayload, to: remoteAddress, context: contextValue, sealed: sealed)
                     } catch {
                         logger.error("failed to encode location record", metadata: ["error": .string("\(error)")])
                         let statusPayload = BoxCodec.encodeStatusPayload(status: .internalError, message: "encoding-error", allocator: allocator)
                         let contextValue = contextBox.value
-                        self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                        self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
                     }
                 }
             } else {
@@ -518,18 +1231,78 @@ final class BoxServerHandler: ChannelInboundHandler {
                     )
                     let statusPayload = BoxCodec.encodeStatusPayload(status: .notFound, message: "node-not-found", allocator: allocator)
                     let contextValue = contextBox.value
-                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue)
+                    self.send(command: .status, requestId: requestId, payload: statusPayload, to: remoteAddress, context: contextValue, sealed: sealed)
                 }
             }
         }
     }
 
-    private func send(command: BoxCodec.Command, requestId: UUID, payload: ByteBuffer, to remote: SocketAddress, context: ChannelHandlerContext) {
+    /// Sends one reply frame. `promise` completes once the datagram is handed to the socket, or fails
+    /// when the reply cannot be sealed.
+    private func send(
+        command: BoxCodec.Command,
+        requestId: UUID,
+        payload: ByteBuffer,
+        to remote: SocketAddress,
+        context: ChannelHandlerContext,
+        sealed: Bool = false,
+        promise: EventLoopPromise<Void>? = nil
+    ) {
         let (nodeId, userId) = identityProvider()
         let frame = BoxCodec.Frame(command: command, requestId: requestId, nodeId: nodeId, userId: userId, payload: payload)
-        let datagram = BoxCodec.encodeFrame(frame, allocator: allocator)
+        let datagram: ByteBuffer
+        if sealed {
+            guard var entry = sessions[remote] else {
+                logger.debug("session vanished before reply", metadata: ["remote": "\(remote)"])
+                promise?.fail(ReplyError.sessionUnavailable)
+                return
+            }
+            do {
+                datagram = try entry.session.seal(frame, allocator: allocator)
+            } catch {
+                logger.warning("failed to seal reply", metadata: ["remote": "\(remote)", "error": "\(error)"])
+                promise?.fail(error)
+                return
+            }
+            sessions[remote] = entry
+        } else {
+            datagram = BoxCodec.encodeFrame(frame, allocator: allocator)
+        }
         let envelope = AddressedEnvelope(remoteAddress: remote, data: datagram)
-        context.writeAndFlush(wrapOutboundOut(envelope), promise: nil)
+        context.writeAndFlush(wrapOutboundOut(envelope), promise: promise)
+    }
+
+    private enum ReplyError: Error {
+        /// The encrypted session of the requester expired while a reply was in progress.
+        case sessionUnavailable
+    }
+
+    /// Sends a multi-frame response, sealing it in one batch and flushing once.
+    private func sendBatch(_ responses: [(BoxCodec.Command, ByteBuffer)], requestId: UUID, to remote: SocketAddress, context: ChannelHandlerContext, sealed: Bool) {
+        let (nodeId, userId) = identityProvider()
+        let frames = responses.map { command, payload in
+            BoxCodec.Frame(command: command, requestId: requestId, nodeId: nodeId, userId: userId, payload: payload)
+        }
+        let datagrams: [ByteBuffer]
+        if sealed {
+            guard var entry = sessions[remote] else {
+                logger.debug("session vanished before reply", metadata: ["remote": "\(remote)"])
+                return
+            }
+            do {
+                datagrams = try entry.session.seal(frames, allocator: allocator)
+            } catch {
+                logger.warning("failed to seal reply", metadata: ["remote": "\(remote)", "error": "\(error)"])
+                return
+            }
+            sessions[remote] = entry
+        } else {
+            datagrams = frames.map { BoxCodec.encodeFrame($0, allocator: allocator) }
+        }
+        for datagram in datagrams {
+            context.write(wrapOutboundOut(AddressedEnvelope(remoteAddress: remote, data: datagram)), promise: nil)
+        }
+        context.flush()
     }
 }
 
@@ -31,7 +31,21 @@ final class BoxServerRuntimeController: @unchecked Sendable {
     private var portMappingCoordinator: PortMappingCoordinator?
     private var store: BoxServerStore?
     private var noiseKeyStore: BoxNoiseKeyStore?
+    private let identityCache = BoxIdentityCache()
+    private let volatileQueues = BoxVolatileQueues()
     private var presenceTask: Task<Void, Never>?
+    private var addressChangeMonitor: AddressChangeMonitor?
+    /// Reconvergence after an address change; the monitor reports from its own queue.
+    private let addressChangeTask = NIOLockedValueBox<Task<Void, Never>?>(nil)
+    private var retentionSweeper: QueueRetentionSweeper?
+    private var deliveryScheduler: DelayedDeliveryScheduler?
+    private var diskSpaceMonitor: DiskSpaceMonitor?
+    private var manifestSaver: StoreManifestSaver?
+    private var queueWatcher: QueueDirectoryWatcher?
+    private var storeCompactor: StoreCompactor?
+    private var queueMirror: QueueMirror?
+    /// Connection to each mirror follower, kept across batches while its address and key hold.
+    private let mirrorLinks = NIOLockedValueBox<[UUID: MirrorLink]>([:])
     private static let locationSummaryGraceInterval: TimeInterval = 120
 
     init(options: BoxRuntimeOptions) {
@@ -86,8 +100,9 @@ final class BoxServerRuntimeController: @unchecked Sendable {
 
         let store = try await BoxServerStore(root: queueRoot, logger: self.logger)
         self.store = store
+        self.storeCompactor = StoreCompactor(store: store, logger: self.logger)
 
-        let locationCoordinator = LocationServiceCoordinator(store: store, logger: self.logger)
+        let locationCoordinator = LocationServiceCoordinator(store: store, logger: self.logger, identityCache: identityCache)
         try await locationCoordinator.bootstrap()
         self.locationCoordinator = locationCoordinator
 
@@ -95,6 +110,8 @@ final class BoxServerRuntimeController: @unchecked Sendable {
 
         try await reloadConfiguration(path: options.configurationPath, initial: true)
 
+        let diskSpaceMonitor = startDiskSpaceMonitor(root: queueRoot)
+
         let bootstrap = DatagramBootstrap(group: eventLoopGroup)
             .channelOption(ChannelOptions.socketOption(.so_reuseaddr), value: 1)
             .channelInitializer { channel in
@@ -114,11 +131,25 @@ final class BoxServerRuntimeController: @unchecked Sendable {
                         guard let self, let coordinator = self.locationCoordinator else { return nil }
                         return await coordinator.resolve(nodeUUID: nodeId)
                     },
-                    isPermanentQueue: { [weak self] rawQueue in
-                        guard let self else { return false }
-                        guard let normalized = try? BoxServerStore.normalizeQueueName(rawQueue) else { return false }
-                        return self.state.withLockedValue { $0.permanentQueues.contains(normalized) }
-                    }
+                    sessionSigner: { [weak self] transcript in
+                        self?.identityCache.snapshot.signWithNodeKey(transcript)
+                    },
+                    peerVerifier: { [weak self] signature, message, node in
+                        self?.identityCache.snapshot.verifyPeerSignature(signature, for: message, from: node) ?? false
+                    },
+                    replayWindowSize: { [weak self] in
+                        self?.state.withLockedValue { $0.replayWindowSize } ?? BoxReplayWindow.defaultSize
+                    },
+                    helloCookieThreshold: { [weak self] in
+                        self?.state.withLockedValue { $0.helloCookieThreshold } ?? BoxHelloCookieJar.defaultThreshold
+                    },
+                    diskPressure: {
+                        diskSpaceMonitor.isUnderPressure
+                    },
+                    leasePolicy: { [weak self] in
+                        self?.state.withLockedValue { $0.leasePolicy } ?? BoxLeasePolicy()
+                    },
+                    volatileQueues: self.volatileQueues
                 )
                 return channel.pipeline.addHandler(handler)
             }
@@ -133,6 +164,12 @@ final class BoxServerRuntimeController: @unchecked Sendable {
 
         startPortMappingCoordinator()
         startPresenceTask()
+        startAddressChangeMonitor()
+        startRetentionSweeper(store: store)
+        startDeliveryScheduler(store: store)
+        await startManifestSaver(store: store)
+        startQueueWatcher(store: store)
+        await startQueueMirror(store: store)
 
         logStartupSummary()
 
@@ -143,6 +180,15 @@ final class BoxServerRuntimeController: @unchecked Sendable {
     func stop() async {
         logger.info("server shutdown requested")
         presenceTask?.cancel()
+        addressChangeMonitor?.stop()
+        addressChangeTask.withLockedValue { $0?.cancel() }
+        retentionSweeper?.stop()
+        deliveryScheduler?.stop()
+        diskSpaceMonitor?.stop()
+        queueWatcher?.stop()
+        await queueMirror?.stop()
+        await closeMirrorLinks(keeping: [])
+        await storeCompactor?.stop()
         portMappingCoordinator?.stop()
 
         if let admin = adminChannel {
@@ -155,6 +201,13 @@ final class BoxServerRuntimeController: @unchecked Sendable {
         try? await mainChannel?.closeFuture.get()
         mainChannel = nil
 
+        // Last save once no request can change the queues any more, so the next start skips the scans.
+        if let saver = manifestSaver {
+            await saver.stop()
+            await saver.save()
+            manifestSaver = nil
+        }
+
         try? await eventLoopGroup.shutdownGracefully()
         logger.info("server stopped")
     }
@@ -216,6 +269,12 @@ final class BoxServerRuntimeController: @unchecked Sendable {
             },
             syncRoots: { [weak self] in
                 await self?.handleSyncRoots() ?? "{\"status\":\"error\",\"message\":\"shutting-down\"}"
+            },
+            storeCompaction: { [weak self] queue, statusOnly in
+                await self?.handleStoreCompaction(queue: queue, statusOnly: statusOnly) ?? "{\"status\":\"error\",\"message\":\"shutting-down\"}"
+            },
+            snapshot: { [weak self] path, base in
+                await self?.handleSnapshot(path: path, base: base) ?? "{\"status\":\"error\",\"message\":\"shutting-down\"}"
             }
         )
         logger.info("admin channel bound", metadata: ["path": .string(socketPath)])
@@ -225,6 +284,8 @@ final class BoxServerRuntimeController: @unchecked Sendable {
         presenceTask = Task.detached { [weak self] in
             while !Task.isCancelled {
                 await self?.publishPresence()
+                await self?.locationCoordinator?.refreshPeerKeys()
+                await self?.refreshMirrorFollowers()
                 do {
                     try await Task.sleep(nanoseconds: 60 * 1_000_000_000)
                 } catch {
@@ -234,9 +295,239 @@ final class BoxServerRuntimeController: @unchecked Sendable {
         }
     }
 
+    private func startDiskSpaceMonitor(root: URL) -> DiskSpaceMonitor {
+        let monitor = DiskSpaceMonitor(
+            path: root,
+            logger: logger,
+            watermarks: { [weak self] in
+                self?.state.withLockedValue { $0.diskWatermarks } ?? DiskSpaceMonitor.Watermarks()
+            },
+            onTransition: { [weak self] underPressure, sample in
+                self?.handleDiskPressureChange(underPressure, sample: sample)
+            }
+        )
+        diskSpaceMonitor = monitor
+        monitor.start()
+        return monitor
+    }
+
+    private func handleDiskPressureChange(_ underPressure: Bool, sample: DiskSpaceMonitor.Sample) {
+        let watermarks = state.withLockedValue { runtime -> DiskSpaceMonitor.Watermarks in
+            runtime.diskPressure = underPressure
+            return runtime.diskWatermarks
+        }
+        let details = [
+            "freeBytes": "\(sample.freeBytes)",
+            "usedPercent": String(format: "%.1f", sample.usedPercent),
+            "highWatermark": "\(watermarks.high)",
+            "lowWatermark": "\(watermarks.low)"
+        ]
+        let metadata = details.mapValues { Logger.MetadataValue.string($0) }
+        if underPressure {
+            logger.warning("disk high watermark reached, refusing non-critical PUT", metadata: metadata)
+        } else {
+            logger.info("disk usage back under low watermark, accepting PUT", metadata: metadata)
+        }
+        recordAdminEvent(kind: underPressure ? "disk-pressure" : "disk-pressure-cleared", details: details)
+    }
+
+    /// Appends an event to the bounded list exposed by `box admin stats`.
+    private func recordAdminEvent(kind: String, details: [String: String]) {
+        state.withLockedValue { runtime in
+            runtime.adminEvents.append(BoxServerAdminEvent(timestamp: Date(), kind: kind, details: details))
+            if runtime.adminEvents.count > BoxServerAdminEvent.capacity {
+                runtime.adminEvents.removeFirst(runtime.adminEvents.count - BoxServerAdminEvent.capacity)
+            }
+        }
+    }
+
+    private func startRetentionSweeper(store: BoxServerStore) {
+        let sweeper = QueueRetentionSweeper(store: store, logger: logger) { [weak self] in
+            self?.state.withLockedValue { $0.queueRetention } ?? [:]
+        }
+        retentionSweeper = sweeper
+        sweeper.start()
+    }
+
+    private func startDeliveryScheduler(store: BoxServerStore) {
+        let scheduler = DelayedDeliveryScheduler(store: store, logger: logger)
+        deliveryScheduler = scheduler
+        scheduler.start()
+    }
+
+    private func startManifestSaver(store: BoxServerStore) async {
+        let saver = StoreManifestSaver(store: store, locationCoordinator: locationCoordinator, logger: logger)
+        manifestSaver = saver
+        await saver.start()
+    }
+
+    private func startQueueWatcher(store: BoxServerStore) {
+        let watcher = QueueDirectoryWatcher(store: store, logger: logger)
+        queueWatcher = watcher
+        watcher.start()
+    }
+
+    private func startQueueMirror(store: BoxServerStore) async {
+        let (nodeId, queues) = state.withLockedValue { ($0.nodeIdentifier, $0.mirrorQueues) }
+        let mirror = QueueMirror(store: store, source: nodeId, logger: logger) { [weak self] follower, batch in
+            guard let self else { throw CancellationError() }
+            try await self.sendMirrorBatch(batch, to: follower)
+        }
+        queueMirror = mirror
+        await mirror.start(queues: queues)
+        await refreshMirrorFollowers()
+    }
+
+    /// Points the mirror at the other nodes listed in the Location Service record of the user, each
+    /// reached at its first global address, or LAN address otherwise.
+    private func refreshMirrorFollowers() async {
+        guard let mirror = queueMirror, let coordinator = locationCoordinator else { return }
+        let (nodeId, userId) = state.withLockedValue { ($0.nodeIdentifier, $0.userIdentifier) }
+        let nodes = await coordinator.userRecords().first { $0.userUUID == userId }?.nodeUUIDs ?? []
+        var followers: [QueueMirror.Follower] = []
+        for node in nodes where node != nodeId {
+            guard let record = await coordinator.resolve(nodeUUID: node),
+                  let address = record.addresses.first(where: { $0.scope == .global }) ?? record.addresses.first(where: { $0.scope == .lan }) else {
+                continue
+            }
+            followers.append(QueueMirror.Follower(node: node, address: address.ip, port: address.port))
+        }
+        await mirror.setFollowers(followers)
+        await closeMirrorLinks(keeping: Set(followers.map(\.node)))
+    }
+
+    private struct MirrorLink {
+        var follower: QueueMirror.Follower
+        var key: [UInt8]
+        var connection: BoxClientConnection
+    }
+
+    /// Sends `batch` over the follower's long-lived sealed connection. The follower only accepts batches
+    /// from a session whose HELLO this node signed, and its own answer must carry the signature of the key
+    /// it advertises in the Location Service.
+    private func sendMirrorBatch(_ batch: BoxMirrorBatch, to follower: QueueMirror.Follower) async throws {
+        let connection = try mirrorConnection(to: follower)
+        do {
+            try await connection.put(queuePath: batch.queue, contentType: BoxMirrorBatch.contentType, data: [UInt8](try batch.encoded()))
+        } catch let BoxClientError.remoteRejected(status, _) where status == .conflict {
+            throw QueueMirror.TransportError.resetRequired
+        }
+    }
+
+    private func mirrorConnection(to follower: QueueMirror.Follower) throws -> BoxClientConnection {
+        let identityCache = self.identityCache
+        guard let key = identityCache.snapshot.peerKeys[follower.node] else {
+            throw QueueMirror.TransportError.unknownFollowerKey
+        }
+        let (nodeId, userId) = state.withLockedValue { ($0.nodeIdentifier, $0.userIdentifier) }
+        let group = eventLoopGroup
+        let logger = self.logger
+        let (connection, replaced) = mirrorLinks.withLockedValue { links -> (BoxClientConnection, BoxClientConnection?) in
+            if let link = links[follower.node], link.follower == follower, link.key == key {
+                return (link.connection, nil)
+            }
+            let connection = BoxClientConnection(
+                group: group,
+                address: follower.address,
+                port: follower.port,
+                nodeId: nodeId,
+                userId: userId,
+                serverPublicKey: key,
+                helloSigner: { identityCache.snapshot.signWithNodeKey($0) },
+                logger: logger
+            )
+            let replaced = links[follower.node]?.connection
+            links[follower.node] = MirrorLink(follower: follower, key: key, connection: connection)
+            return (connection, replaced)
+        }
+        if let replaced {
+            Task { await replaced.close() }
+        }
+        return connection
+    }
+
+    private func closeMirrorLinks(keeping nodes: Set<UUID>) async {
+        let closed = mirrorLinks.withLockedValue { links -> [BoxClientConnection] in
+            let dropped = links.filter { !nodes.contains($0.key) }
+            links = links.filter { nodes.contains($0.key) }
+            return dropped.values.map(\.connection)
+        }
+        for connection in closed {
+            await connection.close()
+        }
+    }
+
+    private func startAddressChangeMonitor() {
+        let monitor = AddressChangeMonitor(logger: logger) { [weak self] change in
+            self?.scheduleAddressChangeHandling(change)
+        }
+        addressChangeMonitor = monitor
+        monitor.start()
+    }
+
+    private func scheduleAddressChangeHandling(_ change: AddressChangeMonitor.Change) {
+        logger.info("local address change detected", metadata: change.metadata)
+        // A newer change supersedes an in-flight reconvergence (e.g. prefix removed then re-added).
+        let task = Task.detached { [weak self] in
+            await self?.handleAddressChange()
+        }
+        addressChangeTask.withLockedValue { current in
+            current?.cancel()
+            current = task
+        }
+    }
+
+    /// Re-probes connectivity, renews the port mapping and republishes presence without waiting
+    /// for the periodic presence tick.
+    private func handleAddressChange() async {
+        let connectivity = Self.probeConnectivity(logger: logger)
+        state.withLockedValue {
+            $0.hasGlobalIPv6 = connectivity.hasGlobalIPv6
+            $0.globalIPv6Addresses = connectivity.globalIPv6Addresses
+            $0.ipv6DetectionError = connectivity.detectionErrorDescription
+        }
+        portMappingCoordinator?.requestRefresh()
+        guard !Task.isCancelled else { return }
+
+        await publishPresence()
+        guard !Task.isCancelled else { return }
+        await pushPresenceToRoots()
+    }
+
+    /// Pushes the local node record to every configured root so resolvers converge immediately.
+    private func pushPresenceToRoots() async {
+        guard let record = buildLocationServiceRecord() else { return }
+        let snapshot = state.withLockedValue { state -> (config: BoxConfiguration?, nodeId: UUID, userId: UUID, configurationPath: String?, manualAddress: String?, manualPort: UInt16?, port: UInt16) in
+            (state.configuration, state.nodeIdentifier, state.userIdentifier, state.configurationPath, state.manualExternalAddress, state.manualExternalPort, state.port)
+        }
+        guard let configuration = snapshot.config else { return }
+        let roots = Array(Set(configuration.common.rootServers))
+        guard !roots.isEmpty else { return }
+
+        let encoder = JSONEncoder()
+        encoder.outputFormatting = [.sortedKeys]
+        let data: Data
+        do {
+            data = try encoder.encode(record)
+        } catch {
+            logger.warning("failed to encode presence record", metadata: ["error": .string("\(error)")])
+            return
+        }
+
+        for root in roots where !isSelf(root: root, manualAddress: snapshot.manualAddress, manualPort: snapshot.manualPort, serverPort: snapshot.port) {
+            guard !Task.isCancelled else { return }
+            do {
+                try await sendSyncPayload(data: data, to: root, configurationPath: snapshot.configurationPath, nodeId: snapshot.nodeId, userId: snapshot.userId)
+                logger.debug("presence pushed to root", metadata: ["target": .string("\(root.address):\(root.port)")])
+            } catch {
+                logger.warning("presence push failed", metadata: ["target": .string("\(root.address):\(root.port)"), "error": .string("\(error)")])
+            }
+        }
+    }
+
     private func initializeNodeIdentity() async {
         do {
-            let keyStore = try BoxNoiseKeyStore()
+            let keyStore = try BoxNoiseKeyStore(cache: identityCache)
             noiseKeyStore = keyStore
             let identity = try await keyStore.ensureIdentity(for: .node)
             let publicKeyHex = hexString(from: identity.publicKey)
@@ -333,7 +624,7 @@ final class BoxServerRuntimeController: @unchecked Sendable {
         do {
             try await reloadConfiguration(path: effectivePath, initial: false)
             let snapshot = state.withLockedValue { $0 }
-            let metrics = store.map { Self.queueMetrics(at: $0.root) } ?? QueueMetrics.zero
+            let metrics = await queueMetrics()
             var result = statusDictionary(from: snapshot, metrics: metrics)
             result["status"] = "ok"
             result["path"] = effectivePath ?? "none"
@@ -370,6 +661,43 @@ final class BoxServerRuntimeController: @unchecked Sendable {
         return adminResponse(payload)
     }
 
+    /// Starts a compaction job (`box admin store compact [queue]`) or reports the current one.
+    private func handleStoreCompaction(queue: String?, statusOnly: Bool) async -> String {
+        guard let store, let compactor = storeCompactor else {
+            return adminResponse(["status": "error", "message": "store-unavailable"])
+        }
+        if statusOnly {
+            return adminResponse(["status": "ok", "compaction": await compactor.progress().payload])
+        }
+        var target: String?
+        if let queue {
+            guard let normalized = try? BoxServerStore.normalizeQueueName(queue),
+                  await store.listQueues().contains(normalized) else {
+                return adminResponse(["status": "error", "message": "unknown-queue", "queue": queue])
+            }
+            target = normalized
+        }
+        let progress = await compactor.start(queue: target)
+        return adminResponse(["status": "ok", "compaction": progress.payload])
+    }
+
+    /// Writes a point-in-time snapshot of the store (`box admin snapshot <dir>`).
+    private func handleSnapshot(path: String, base: String?) async -> String {
+        guard let store else {
+            return adminResponse(["status": "error", "message": "store-unavailable"])
+        }
+        let directory = URL(fileURLWithPath: NSString(string: path).expandingTildeInPath, isDirectory: true)
+        let baseDirectory = base.map { URL(fileURLWithPath: NSString(string: $0).expandingTildeInPath, isDirectory: true) }
+        do {
+            let snapshot = try await BoxStoreSnapshot.create(from: store, at: directory, base: baseDirectory)
+            logger.info("store snapshot written", metadata: ["path": .string(directory.path), "files": .stringConvertible(snapshot.paths.count)])
+            return adminResponse(["status": "ok", "snapshot": snapshot.payload(path: directory)])
+        } catch {
+            logger.warning("store snapshot failed", metadata: ["path": .string(directory.path), "error": .string("\(error)")])
+            return adminResponse(["status": "error", "message": "snapshot-failed", "reason": error.localizedDescription])
+        }
+    }
+
     private func handleSyncRoots() async -> String {
         guard let coordinator = locationCoordinator else {
             return adminResponse(["status": "error", "message": "location-service-unavailable"])
@@ -612,6 +940,7 @@ final class BoxServerRuntimeController: @unchecked Sendable {
             "queueCount": metrics.count,
             "objects": metrics.objectCount,
             "queueFreeBytes": metrics.freeBytes ?? NSNull(),
+            "diskPressure": snapshot.diskPressure,
             "permanentQueues": Array(snapshot.permanentQueues).sorted(),
             "reloadCount": snapshot.reloadCount,
             "lastReload": snapshot.lastReloadTimestamp.map { iso8601String($0) } ?? NSNull(),
@@ -648,6 +977,20 @@ final class BoxServerRuntimeController: @unchecked Sendable {
             })
             $0.permanentQueues = sanitizedQueues
             options.permanentQueues = sanitizedQueues
+            $0.replayWindowSize = BoxReplayWindow(size: config.server.replayWindow ?? BoxReplayWindow.defaultSize).size
+            $0.helloCookieThreshold = max(0, config.server.helloCookieThreshold ?? BoxHelloCookieJar.defaultThreshold)
+            $0.queueRetention = Self.retentionPolicies(from: config.server.queueRetention ?? [:])
+            $0.leasePolicy = BoxLeasePolicy(
+                visibilityTimeout: TimeInterval(config.server.leaseVisibilityTimeout ?? Int(BoxLeasePolicy.defaultVisibilityTimeout)),
+                maxInFlight: config.server.leaseMaxInFlight ?? BoxLeasePolicy.defaultMaxInFlight
+            )
+            $0.diskWatermarks = DiskSpaceMonitor.Watermarks(
+                high: config.server.diskHighWatermark ?? DiskSpaceMonitor.Watermarks.defaultHigh,
+                low: config.server.diskLowWatermark ?? DiskSpaceMonitor.Watermarks.defaultLow
+            )
+            $0.mirrorQueues = Set((config.server.mirrorQueues ?? []).compactMap { queue -> String? in
+                try? BoxServerStore.normalizeQueueName(queue)
+            })
 
             if !initial {
                 $0.reloadCount += 1
@@ -656,6 +999,11 @@ final class BoxServerRuntimeController: @unchecked Sendable {
                 $0.lastReloadError = nil
             }
         }
+        let volatilePolicies = Self.volatilePolicies(from: config.server.volatileQueues ?? [:])
+        volatileQueues.configure(volatilePolicies)
+        store?.queueHandles.configure(permanent: state.withLockedValue { $0.permanentQueues }, volatile: volatilePolicies)
+        await store?.setReadCacheBudget(config.server.readCacheBytes ?? BoxReadCache.defaultBudget)
+        await queueMirror?.setQueues(state.withLockedValue { $0.mirrorQueues })
         setupLogging()
         logger.info("configuration loaded", metadata: ["path": .string(result.url.path)])
     }
@@ -690,7 +1038,7 @@ final class BoxServerRuntimeController: @unchecked Sendable {
 
     private func renderStatus() async -> String {
         let snapshot = state.withLockedValue { $0 }
-        let metrics = store.map { Self.queueMetrics(at: $0.root) } ?? QueueMetrics.zero
+        let metrics = await queueMetrics()
         var payload = statusDictionary(from: snapshot, metrics: metrics)
         payload["status"] = "ok"
         if let record = buildLocationServiceRecord() {
@@ -715,7 +1063,7 @@ final class BoxServerRuntimeController: @unchecked Sendable {
 
     private func renderStats() async -> String {
         let snapshot = state.withLockedValue { $0 }
-        let metrics = store.map { Self.queueMetrics(at: $0.root) } ?? QueueMetrics.zero
+        let metrics = await queueMetrics()
         var payload: [String: Any] = [
             "logLevel": "\(snapshot.logLevel)",
             "logLevelOrigin": "\(snapshot.logLevelOrigin)",
@@ -724,6 +1072,12 @@ final class BoxServerRuntimeController: @unchecked Sendable {
             "queueCount": metrics.count,
             "objects": metrics.objectCount,
             "queueFreeBytes": metrics.freeBytes ?? NSNull(),
+            "diskPressure": snapshot.diskPressure,
+            "diskHighWatermark": snapshot.diskWatermarks.high,
+            "diskLowWatermark": snapshot.diskWatermarks.low,
+            "events": snapshot.adminEvents.map { event -> [String: Any] in
+                ["timestamp": iso8601String(event.timestamp), "kind": event.kind, "details": event.details]
+            },
             "hasGlobalIPv6": snapshot.hasGlobalIPv6,
             "portMappingEnabled": snapshot.portMappingRequested
         ]
@@ -737,6 +1091,22 @@ final class BoxServerRuntimeController: @unchecked Sendable {
         if let summary = await locationServiceSummaryPayload() {
             payload["locationService"] = summary
         }
+        if let cache = await store?.readCacheStatistics() {
+            payload["readCache"] = [
+                "hits": cache.hits,
+                "misses": cache.misses,
+                "hitRatio": cache.hitRatio,
+                "entries": cache.entries,
+                "bytes": cache.bytes,
+                "budget": cache.budget
+            ] as [String: Any]
+        }
+        if let compaction = await storeCompactor?.progress() {
+            payload["compaction"] = compaction.payload
+        }
+        if let mirroring = await queueMirror?.status() {
+            payload["mirroring"] = mirroring.payload
+        }
         return adminResponse(payload)
     }
 
@@ -849,35 +1219,52 @@ final class BoxServerRuntimeController: @unchecked Sendable {
         return queueRoot
     }
 
-    private static func queueMetrics(at root: URL) -> QueueMetrics {
-        let fileManager = FileManager.default
-        var queueCount = 0
-        var objectCount = 0
-
-        if let contents = try? fileManager.contentsOfDirectory(at: root, includingPropertiesForKeys: [.isDirectoryKey], options: [.skipsHiddenFiles]) {
-            for url in contents {
-                guard (try? url.resourceValues(forKeys: [.isDirectoryKey]).isDirectory) == true else {
-                    continue
-                }
-                queueCount += 1
-                if let entries = try? fileManager.contentsOfDirectory(at: url, includingPropertiesForKeys: nil, options: [.skipsHiddenFiles]) {
-                    objectCount += entries.reduce(0) { partial, fileURL in
-                        fileURL.pathExtension.lowercased() == "json" ? partial + 1 : partial
-                    }
-                }
+    /// Converts the PLIST retention section, keyed by normalized queue name. Invalid queue names and
+    /// non-positive limits are ignored.
+    static func retentionPolicies(from section: [String: BoxConfiguration.QueueRetention]) -> [String: BoxRetentionPolicy] {
+        var policies: [String: BoxRetentionPolicy] = [:]
+        for (queue, retention) in section {
+            guard let normalized = try? BoxServerStore.normalizeQueueName(queue) else { continue }
+            let policy = BoxRetentionPolicy(
+                maxAge: retention.maxAge.flatMap { $0 > 0 ? TimeInterval($0) : nil },
+                maxCount: retention.maxCount.flatMap { $0 > 0 ? $0 : nil },
+                maxBytes: retention.maxBytes.flatMap { $0 > 0 ? Int64($0) : nil }
+            )
+            if policy.isEnabled {
+                policies[normalized] = policy
             }
         }
+        return policies
+    }
+
+    /// Converts the PLIST volatile section, keyed by normalized queue name. `whoswho` always stays on
+    /// disk; unknown overflow policies fall back to `drop-oldest`.
+    static func volatilePolicies(from section: [String: BoxConfiguration.VolatileQueue]) -> [String: BoxVolatilePolicy] {
+        var policies: [String: BoxVolatilePolicy] = [:]
+        for (queue, settings) in section {
+            guard let normalized = try? BoxServerStore.normalizeQueueName(queue),
+                  normalized.caseInsensitiveCompare("whoswho") != .orderedSame else { continue }
+            policies[normalized] = BoxVolatilePolicy(
+                capacity: settings.capacity ?? BoxVolatilePolicy.defaultCapacity,
+                overflow: settings.overflow.flatMap { BoxVolatilePolicy.Overflow(rawValue: $0.lowercased()) } ?? .dropOldest
+            )
+        }
+        return policies
+    }
+
+    /// Queue and object counts come from the store indexes (restored from the manifest at startup),
+    /// so a status request does not list every queue directory.
+    private func queueMetrics() async -> QueueMetrics {
+        guard let store else { return QueueMetrics.zero }
+        let totals = await store.queueTotals()
 
         var freeBytes: UInt64? = nil
-        if let attributes = try? fileManager.attributesOfFileSystem(forPath: root.path),
+        if let attributes = try? FileManager.default.attributesOfFileSystem(forPath: store.root.path),
            let freeSize = attributes[.systemFreeSize] as? NSNumber {
             freeBytes = freeSize.uint64Value
         }
 
-        if queueCount < 1 {
-            queueCount = 1
-        }
-        return QueueMetrics(count: queueCount, objectCount: objectCount, freeBytes: freeBytes)
+        return QueueMetrics(count: max(totals.queues, 1), objectCount: totals.objects, freeBytes: freeBytes)
     }
 
     private static func probeConnectivity(logger: Logger) -> ConnectivitySnapshot {
@@ -963,7 +1350,7 @@ final class BoxServerRuntimeController: @unchecked Sendable {
     }
 
     private func hexString(from bytes: [UInt8]) -> String {
-        bytes.map { String(format: "%02x", $0) }.joined()
+        BoxHex.encode(bytes)
     }
 
     private func adminConnectivityPayload(from record: LocationServiceNodeRecord) -> [String: Any] {
@@ -1104,7 +1491,9 @@ final class BoxServerRuntimeController: @unchecked Sendable {
         locateNode: @escaping @Sendable (UUID) async -> String,
         natProbe: @escaping @Sendable (String?) async -> String,
         locationSummaryProvider: @escaping @Sendable () async -> String,
-        syncRoots: @escaping @Sendable () async -> String
+        syncRoots: @escaping @Sendable () async -> String,
+        storeCompaction: @escaping @Sendable (String?, Bool) async -> String,
+        snapshot: @escaping @Sendable (String, String?) async -> String
     ) async throws -> BoxAdminChannelHandle {
         let dispatcher = BoxAdminCommandDispatcher(
             statusProvider: statusProvider,
@@ -1114,7 +1503,9 @@ final class BoxServerRuntimeController: @unchecked Sendable {
             locateNode: locateNode,
             natProbe: natProbe,
             locationSummaryProvider: locationSummaryProvider,
-            syncRoots: syncRoots
+            syncRoots: syncRoots,
+            storeCompaction: storeCompaction,
+            snapshot: snapshot
         )
 
         #if os(Windows)
@@ -50,4 +50,23 @@ struct BoxServerRuntimeState: Sendable {
     var lastPresenceUpdate: Date?
     var permanentQueues: Set<String>
     var nodeIdentityPublicKey: String?
+    var replayWindowSize: Int = BoxReplayWindow.defaultSize
+    var helloCookieThreshold: Int = BoxHelloCookieJar.defaultThreshold
+    var queueRetention: [String: BoxRetentionPolicy] = [:]
+    var diskWatermarks = DiskSpaceMonitor.Watermarks()
+    var diskPressure = false
+    var leasePolicy = BoxLeasePolicy()
+    /// Queues replicated to the other nodes of the user (`server.mirror_queues`).
+    var mirrorQueues: Set<String> = []
+    var adminEvents: [BoxServerAdminEvent] = []
+}
+
+/// Notable runtime transition reported by `box admin stats` under `events` (most recent last).
+struct BoxServerAdminEvent: Sendable {
+    /// Maximum number of events retained in memory.
+    static let capacity = 32
+
+    var timestamp: Date
+    var kind: String
+    var details: [String: String]
 }
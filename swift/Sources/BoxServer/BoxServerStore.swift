@@ -3,7 +3,9 @@
 //
 // Hypothèses de structure disque (sous la racine logique .box/queues):
 //  - <root>/queues/<queueName>/
-//      └── <timestamp>-<uuid>.json  (ex: 20251017T143015Z-0F2B6F6A-... .json)
+//      └── <timestamp>-<uuid>.json  (ex: 20251017T143015Z-000042-0F2B6F6A-... .json)
+//  - <timestamp> vient d'une horloge logique hybride par queue, à la microseconde: deux PUT ne
+//    partagent jamais un horodatage et l'ordre des noms suit l'ordre d'arrivée (SPECS §7.18).
 //
 // Format JSON minimal pour chaque message:
 // {
@@ -26,11 +28,121 @@
 //  - put(_ object: BoxStoredObject, into queue: String) -> UUID
 //  - get(queue: String, id: UUID) -> BoxStoredObject?
 //  - popOldest(from queue: String) -> BoxStoredObject?
+//  - openOldest(from queue: String, leasingTo consumer: String?, visibility: TimeInterval) -> BoxStreamedObject?
 //  - listQueues() -> [String]
 //  - list(queue: String, limit: Int?, offset: Int?) -> [BoxMessageRef]
 //  - remove(queue: String, id: UUID)
+//  - delete(queue: String, targets: [BoxCodec.DeleteTarget]) -> BoxDeleteResult
 //  - purge(queue: String)
+//  - next(queue: String, cursor: String) -> BoxStoredObject?
+//  - commit(queue: String, cursor: String, through id: UUID)
+//  - seek(queue: String, cursor: String, to date: Date?)
+//  - lease(from: String, consumer: String, policy: BoxLeasePolicy) -> BoxLeaseOutcome
+//  - acknowledge(queue: String, id: UUID, consumer: String)
+//  - schedule(_ object: BoxStoredObject, into queue: String, notBefore: Date) -> UUID
+//  - releaseDueDeliveries() -> Int
+//  - enforceRetention(queue: String, policy: BoxRetentionPolicy, limit: Int) -> BoxRetentionResult
 //
+// Index:
+//  - Chaque queue a un index trié en mémoire (`BoxQueueIndex`), reconstruit paresseusement lorsque la
+//    date de modification du répertoire change (écriture par un autre processus ou une autre instance).
+//
+// Curseurs:
+//  - Un curseur nommé mémorise, par queue, le nom du dernier fichier acquitté (les noms sont triés par
+//    horodatage). Tous les curseurs d'une queue tiennent dans <root>/.cursors/<queue>.json.
+//  - `next` lit l'entrée suivante sans rien supprimer, `commit` avance, `seek` repositionne par date.
+//
+// Baux (leases):
+//  - `lease` masque l'objet le plus ancien pendant un délai de visibilité, `acknowledge` le supprime
+//    (un objet jamais réservé est refusé). Chaque queue a sa table (`BoxLeaseTable`): par nom, par
+//    consommateur et par échéance, sans parcours à chaque appel.
+//  - Les baux vivent en mémoire: au redémarrage ou à expiration, les objets non acquittés réapparaissent.
+//  - `popOldest` ignore les objets sous bail.
+//
+// Priorités:
+//  - Un objet de priorité 1…7 est nommé <timestamp>-p<n>-<uuid>.json (priorité 0: nom inchangé).
+//  - `popOldest`, `peekOldest` et `lease` servent d'abord la classe la plus haute, puis la plus ancienne
+//    entrée de cette classe; curseurs, listes et rétention restent en ordre d'âge.
+//
+// Livraison différée:
+//  - `schedule` écrit l'objet sous <root>/.scheduled/<queue>/<ms>-<nom final>; une roue temporelle
+//    hiérarchique (`BoxTimerWheel`) le fait entrer dans la queue à sa date (`releaseDueDeliveries`).
+//  - Au premier usage, la roue est reconstruite à partir de .scheduled: rien n'est perdu au redémarrage.
+//  - Les entrées différées sont aussi indexées par queue (`scheduledIndexes`): DELETE et rétention les
+//    atteignent avant leur date. `DelayedDeliveryScheduler` dort jusqu'à la prochaine échéance de la roue.
+//
+// Cache de lecture:
+//  - Les objets relus sans être retirés (GET des queues permanentes, get/read par id, curseurs, baux)
+//    sont gardés décodés dans un cache LRU borné en octets (`BoxReadCache`, `setReadCacheBudget`).
+//  - Toute écriture ou suppression d'un fichier invalide son entrée; un changement externe du
+//    répertoire (index reconstruit) vide le cache de la queue.
+//
+// Déduplication:
+//  - Le SHA-256 du contenu est calculé une seule fois au PUT et conservé dans le JSON (`digest`).
+//    Il porte sur le contenu décodé; un contenu compressé (lz4) est rangé sous le SHA-256 des octets
+//    stockés (`blobDigest`), pour que deux encodages d'un même contenu ne partagent pas un blob.
+//  - Les contenus d'au moins `blobThreshold` octets sont stockés une seule fois sous
+//    <root>/.blobs/<2 premiers hex>/<digest>; le JSON de la queue ne garde alors que `digest` et `blobRef`.
+//  - Chaque entrée de queue détient un lien physique <digest>.<blobRef> vers le blob: le compteur de
+//    liens du fichier sert de compteur de références, et le blob disparaît avec sa dernière référence.
+//    Les liens d'un instantané (§7.15) comptent aussi: un blob qu'il tient reste jusqu'à sa suppression.
+//  - `openOldest` ne charge pas un contenu stocké en blob: il ouvre le fichier, que l'appelant lit
+//    par morceaux (`BoxPayloadReader`) pour répondre en GET fragmenté. Pour un GET qui consomme, il
+//    réserve l'objet (bail) au lieu de le supprimer: l'entrée ne part qu'avec l'acquittement.
+//
+// Journal:
+//  - Les opérations touchant plusieurs fichiers (entrée + lien de blob, lots DELETE/rétention, purge)
+//    inscrivent leur intention dans <root>/.journal avant d'agir et la marquent terminée ensuite
+//    (`BoxStoreJournal`). Au démarrage, les intentions restées ouvertes sont menées à terme: la reprise
+//    après crash ne lit que la fin du journal, jamais les queues.
+//  - Seule l'instance qui verrouille .journal (flock) le rejoue et le tronque; une autre instance sur
+//    la même racine écrit dans un journal annexe .journal-<uuid>, repris s'il n'est plus verrouillé.
+//
+// Manifeste:
+//  - Les index des queues (noms, tailles, dates, empreintes) et l'index du Location Service sont
+//    sauvegardés dans <root>/.manifest à l'arrêt propre et périodiquement (`BoxStoreManifest`).
+//  - Au démarrage, le manifeste est relu d'un bloc; chaque index n'est reconstruit que si la date de
+//    modification de son répertoire a changé depuis la sauvegarde.
+//
+// Surveillance (Linux):
+//  - `QueueDirectoryWatcher` pose un watch inotify sur chaque queue; les fichiers écrits ou supprimés
+//    par un autre processus sont repris un par un dans l'index (`reconcile`), sans relister le répertoire.
+//  - L'index d'une queue surveillée est utilisé sans vérifier la date du répertoire à chaque accès.
+//
+// Compactage:
+//  - `box admin store compact` reconstruit les répertoires gonflés par le churn: les entrées vivantes
+//    sont liées (liens physiques) par lots dans <root>/.compact/<queue>.new, puis le répertoire est
+//    échangé par deux renommages en un seul tour de l'acteur. L'ancien est vidé ensuite, hors acteur.
+//  - Il supprime aussi les fichiers temporaires abandonnés et les blobs sans référence.
+//
+// Snapshots:
+//  - `box admin snapshot <dir>` fige l'état du store en un tour de l'acteur (liste des fichiers), puis
+//    crée des liens physiques par lots; tant qu'il n'est pas terminé, un fichier listé est lié avant
+//    d'être supprimé ou remplacé. Les fichiers n'étant jamais modifiés en place, le coût ne dépend que
+//    du nombre de fichiers (`BoxStoreSnapshot`).
+//
+// Miroirs:
+//  - Les écritures et suppressions des queues de `server.mirror_queues` sont publiées, dans l'ordre, sur
+//    un flux (`openChangeFeed`) que `QueueMirror` numérote et expédie par lots aux autres nœuds de
+//    l'utilisateur; le PUT n'attend jamais ce flux.
+//  - Sur le nœud suiveur, `applyMirrorBatch` rejoue un lot dans la queue <queue>@<nœud source> en gardant
+//    les noms de fichiers de la source, et retient la position appliquée dans <root>/.mirror/<nœud>.json:
+//    un lot reçu deux fois ne change rien, un trou ou une autre époque demande une copie complète.
+//
+// Poignées de queues:
+//  - `queueHandles` résout chaque nom reçu une seule fois (nom assaini, répertoire, drapeaux permanent et
+//    volatile); le handler et le store s'en servent sans renormaliser. `ensureQueue` retient les
+//    répertoires déjà vus et ne refait pas de `stat`; un PUT qui échoue sur un répertoire disparu le recrée.
+//
+// Compression:
+//  - Un contenu reçu compressé (`encoding` = "lz4") est stocké tel quel. Son empreinte (`digest`) porte
+//    sur le contenu décodé, son blob sur les octets stockés (`blobDigest`, voir Déduplication).
+//  - Le handler décode un PUT une seule fois, après l'autorisation, et passe l'empreinte à `put`/`schedule`;
+//    le store ne décode lui-même que ce qui arrive sans empreinte (miroirs, appels internes).
+//  - Les lectures rendent les octets stockés avec leur `encoding`: seul le handler décompresse, pour un
+//    client qui ne sait pas lire lz4.
+//
+import BoxCore
 import Foundation
 import Logging
 
@@ -51,6 +163,12 @@ public struct BoxStoredObject: Codable, Sendable {
 	public let userId: UUID
 	/// A dictionary of additionnal data if any are required
 	public var userMetadata: [String:String]? // libre pour infos additionnelles
+	/// SHA-256 of `data`. Filled by the store on PUT when missing and returned on every read.
+	public var digest: BoxContentDigest?
+	/// Priority class (0 bulk … `BoxCodec.maxPriority` urgent); higher classes are dequeued first.
+	public var priority: UInt8
+	/// Encoding of `data` as received from the sender; compressed objects are stored without expanding them.
+	public var encoding: BoxCodec.PayloadEncoding
 	
 	public init(
 		id: UUID = UUID(),
@@ -59,7 +177,10 @@ public struct BoxStoredObject: Codable, Sendable {
 		createdAt: Date = Date(),
 		nodeId: UUID,
 		userId: UUID,
-		userMetadata: [String:String]? = nil
+		userMetadata: [String:String]? = nil,
+		digest: BoxContentDigest? = nil,
+		priority: UInt8 = 0,
+		encoding: BoxCodec.PayloadEncoding = .identity
 	) {
 		self.id = id
 		self.contentType = contentType
@@ -68,6 +189,9 @@ public struct BoxStoredObject: Codable, Sendable {
 		self.nodeId = nodeId
 		self.userId = userId
 		self.userMetadata = userMetadata
+		self.digest = digest
+		self.priority = min(priority, BoxCodec.maxPriority)
+		self.encoding = encoding
 	}
 }
 
@@ -83,11 +207,27 @@ public struct BoxMessageRef: Sendable, Hashable, Codable {
 private struct DiskMessage: Codable {
 	let id: UUID
 	let contentType: String
-	let content: String // base64
+	let content: String? // base64, absent quand le contenu est dans .blobs
 	let createdAt: Date
 	let nodeId: UUID
 	let userId: UUID
 	let userMetadata: [String:String]?
+	let digest: BoxContentDigest? // absent dans les fichiers antérieurs à la déduplication
+	let blobRef: UUID? // nom du lien <digest>.<blobRef> détenu par cette entrée
+	let priority: UInt8? // absent pour la priorité 0
+	let encoding: String? // "lz4" pour un contenu compressé, absent sinon
+	let blobDigest: BoxContentDigest? // SHA-256 des octets stockés quand ils diffèrent du contenu (lz4)
+	
+	/// Digest naming the blob: the stored bytes, which differ from the content when it is compressed.
+	var blobKey: BoxContentDigest? {
+		blobDigest ?? digest
+	}
+	
+	/// Blob link held by this entry, `nil` for inline content.
+	var blobLink: BoxStoreJournal.BlobLink? {
+		guard let blobKey, let blobRef else { return nil }
+		return BoxStoreJournal.BlobLink(digest: blobKey, ref: blobRef)
+	}
 }
 
 // MARK: - Errors
@@ -98,6 +238,12 @@ public enum BoxStoreError: Error, LocalizedError {
 	case invalidQueueName(String)
 	case io(Error)
 	case corrupted(URL)
+	case invalidCursorName(String)
+	case unorderedQueue(String)
+	case leasedByAnotherConsumer(UUID)
+	case notLeased(UUID)
+	case snapshotUnavailable(String)
+	case mirrorOutOfSync(String)
 	
 	public var errorDescription: String? {
 		switch self {
@@ -106,26 +252,119 @@ public enum BoxStoreError: Error, LocalizedError {
 			case .invalidQueueName(let n): return "Nom de queue invalide: \(n)"
 			case .io(let e): return "Erreur IO: \(e.localizedDescription)"
 			case .corrupted(let url): return "Fichier corrompu: \(url.lastPathComponent)"
+			case .invalidCursorName(let n): return "Nom de curseur invalide: \(n)"
+			case .unorderedQueue(let q): return "Queue sans ordre d'âge (curseurs refusés): \(q)"
+			case .leasedByAnotherConsumer(let id): return "Objet réservé par un autre consommateur: \(id)"
+			case .notLeased(let id): return "Objet non réservé: \(id)"
+			case .snapshotUnavailable(let reason): return "Snapshot impossible: \(reason)"
+			case .mirrorOutOfSync(let q): return "Miroir désynchronisé: \(q)"
 		}
 	}
 }
 
 // MARK: - Store
 
+/// Delayed delivery waiting in `<root>/.scheduled/<queue>/<name>`.
+private struct ScheduledDelivery: Sendable {
+	let queue: String
+	let name: String
+}
+
+/// Snapshot being linked by `continueSnapshot`, with the files of its barrier not linked yet.
+private struct PendingSnapshot {
+	let data: URL
+	var pending: Set<String>
+	var files = 0
+	var bytes: Int64 = 0
+	/// Inodes already counted in `bytes`: a blob and its reference links are one file.
+	var inodes: Set<UInt64> = []
+	var missing: [String] = []
+	var failure: Error?
+}
+
+/// Files of the hidden areas listed outside the store for a snapshot barrier, and their directories,
+/// already created under the snapshot data directory.
+struct BoxSnapshotListing: Sendable {
+	var paths: [String] = []
+	var directories: Set<String> = []
+}
+
 public actor BoxServerStore {
 	public let root: URL // .../.box/queues
 	private let fm = FileManager.default
 	private let encoder = JSONEncoder()
 	private let decoder = JSONDecoder()
 	private let logger: Logger
+	/// Ordered indexes keyed by sanitized queue name.
+	private var indexes: [String: BoxQueueIndex] = [:]
+	/// Lease tables keyed by sanitized queue name.
+	private var leases: [String: BoxLeaseTable] = [:]
+	/// Cursor positions keyed by sanitized queue name, with the file date they were read at.
+	private var cursorTables: [String: (positions: [String: String], modifiedAt: Date?)] = [:]
+	/// Directory (under `root`) holding one cursor table per queue.
+	static let cursorDirectoryName = ".cursors"
+	/// Payloads of at least this many bytes are stored once in the blob area and shared.
+	public static let blobThreshold = 1024
+	/// Directory (under `root`) holding deduplicated payloads. Hidden, so never listed as a queue.
+	static let blobDirectoryName = ".blobs"
+	/// Blob-backed queue files never exceed this size, so larger files are known to be inline.
+	private static let descriptorSizeLimit = 16 * 1024
+	/// Directory (under `root`) where compaction rebuilds queue directories (`<queue>.new`) and leaves
+	/// the replaced ones (`<queue>.old`) until they are emptied.
+	static let compactionDirectoryName = ".compact"
+	/// Directory (under `root`) holding delayed deliveries until their date, one subdirectory per queue.
+	static let scheduledDirectoryName = ".scheduled"
+	/// Pending delayed deliveries, rebuilt from `.scheduled` on first use.
+	private var pendingDeliveries = BoxTimerWheel<ScheduledDelivery>()
+	/// Delayed deliveries of each queue, named as in `.scheduled/<queue>/`, so that DELETE and retention
+	/// reach them before their date. The wheel still holds the timers of entries removed here.
+	private var scheduledIndexes: [String: BoxQueueIndex] = [:]
+	/// Told the date of every new delayed delivery (`openDeliveryFeed`).
+	private var deliveryFeed: AsyncStream<Date>.Continuation?
+	private var scheduleLoaded = false
+	/// Decoded objects served again without touching the disk.
+	private var readCache = BoxReadCache()
+	/// Intents of multi-file operations, completed at startup after a crash.
+	private var journal: BoxStoreJournal
+	/// Last generation handed to an index; bumped on every load and local mutation.
+	private var indexGeneration: UInt64 = 0
+	/// Queue directories being rebuilt by compaction, with the names already linked into the copy.
+	private var rebuilds: [String: Set<String>] = [:]
+	/// Snapshot in progress; files it still needs are linked before being removed or replaced.
+	private var pendingSnapshot: PendingSnapshot?
+	/// Paths written or removed since `prepareSnapshot`; the barrier checks them again on disk.
+	private var snapshotTouched: Set<String>?
+	/// Queues whose directory is watched by `QueueDirectoryWatcher`: their index is trusted without a date check.
+	private var watchedQueues: Set<String> = []
+	/// Location Service index read from the manifest, until the coordinator takes it.
+	private var restoredLocations: BoxStoreManifest.Locations?
+	/// Directory (under `root`) holding, per primary node, the positions applied to its mirrors.
+	static let mirrorDirectoryName = ".mirror"
+	/// Receiver of the changes of `fedQueues`, opened by `QueueMirror`.
+	private var changeFeed: AsyncStream<BoxStoreChange>.Continuation?
+	/// Queues whose changes go to `changeFeed` (`server.mirror_queues`).
+	private var fedQueues: Set<String> = []
+	/// Mirror positions keyed by primary node, then by queue; read from `.mirror` on first use.
+	private var mirrorPositions: [UUID: [String: BoxMirrorBatch.Position]] = [:]
+	/// Queue names resolved once, shared with the network handler (SPECS §7.17).
+	let queueHandles: BoxQueueHandleTable
+	/// Queue directories known to exist, so `ensureQueue` and the request paths skip the `stat`.
+	private var knownDirectories: Set<String> = []
+	/// Last stamp given to a file name per queue, in microseconds (see `nextStamp`).
+	private var queueClocks: [String: Int64] = [:]
 	
 	public init(root: URL, logger: Logger = .init(label: "box.server.store")) async throws {
 		self.root = root
+		self.queueHandles = BoxQueueHandleTable(root: root)
 		self.logger = logger
+		self.journal = try BoxStoreJournal(root: root)
 		encoder.outputFormatting = [.withoutEscapingSlashes, .sortedKeys]
 		encoder.dateEncodingStrategy = .iso8601
 		decoder.dateDecodingStrategy = .iso8601
-		try await ensureDirectoryExists(root)
+		try ensureDirectoryExists(root)
+		recoverJournal()
+		recoverCompaction()
+		loadManifest()
 		logger.info("store initialized", metadata: ["root": .string(root.path)])
 	}
 	
@@ -133,46 +372,54 @@ public actor BoxServerStore {
 	
 	@discardableResult
 	public func ensureQueue(_ name: String) async throws -> URL {
-		let sanitized = try sanitizeQueueName(name)
-		let url = root.appendingPathComponent(sanitized, isDirectory: true)
-		try await ensureDirectoryExists(url)
+		let handle = try queueHandle(name)
+		let url = handle.directory
+		guard !knownDirectories.contains(handle.name) else { return url }
 		if !fm.fileExists(atPath: url.path) {
-			try await ensureDirectoryExists(url)
-			logger.info("queue directory created", metadata: ["queue": .string(sanitized), "path": .string(url.path)])
+			try ensureDirectoryExists(url)
+			// A queue created again does not inherit the cursors of its removed predecessor.
+			removeCursorTable(of: handle.name)
+			logger.info("queue directory created", metadata: ["queue": .string(handle.name), "path": .string(url.path)])
 		}
+		knownDirectories.insert(handle.name)
 		return url
 	}
 	
+	/// Directory of `queue`, which must exist. Only the first request on a queue pays the `stat`;
+	/// `queueIndex` forgets a directory it finds removed.
+	/// - Throws: `BoxStoreError.queueNotFound` when the queue has no directory.
+	private func existingQueueDirectory(_ queue: String) throws -> URL {
+		let handle = try queueHandle(queue)
+		if !knownDirectories.contains(handle.name) {
+			guard fm.fileExists(atPath: handle.directory.path) else { throw BoxStoreError.queueNotFound(queue) }
+			knownDirectories.insert(handle.name)
+		}
+		return handle.directory
+	}
+	
 	public func listQueues() async -> [String] {
-		(try? fm.contentsOfDirectory(atPath: root.path))?.sorted() ?? []
+		(try? fm.contentsOfDirectory(atPath: root.path))?.filter { !$0.hasPrefix(".") }.sorted() ?? []
 	}
 	
 	// MARK: - Put/Get
 	
+	/// Stores `object` at the tail of `queue`.
+	/// - Parameter contentDigest: SHA-256 of the decoded content, when the caller already expanded a
+	///   compressed payload (the PUT handler checks it there); computed here otherwise. Never a digest
+	///   received from a peer.
 	@discardableResult
-	public func put(_ object: BoxStoredObject, into queue: String) async throws -> UUID {
+	public func put(_ object: BoxStoredObject, into queue: String, contentDigest: BoxContentDigest? = nil) async throws -> UUID {
 		do {
 			let qurl = try await ensureQueue(queue)
-			let sanitizedQueue = qurl.lastPathComponent
-			let filename = makeFilename(for: object, queue: sanitizedQueue)
-			let fileURL = qurl.appendingPathComponent(filename)
-			let disk = DiskMessage(
-				id: object.id,
-				contentType: object.contentType,
-				content: Data(object.data).base64EncodedString(),
-				createdAt: object.createdAt,
-				nodeId: object.nodeId,
-				userId: object.userId,
-				userMetadata: object.userMetadata
-			)
-			let data = try encoder.encode(disk)
-			logger.debug("put", metadata: [
-				"queue": .string(queue),
-				"id": .string(object.id.uuidString),
-				"bytes": .stringConvertible(object.data.count),
-				"file": .string(fileURL.lastPathComponent)
-			])
-			try atomicWrite(data: data, to: fileURL)
+			do {
+				try storeEntry(object, named: makeFilename(for: object, queue: qurl.lastPathComponent), in: qurl, contentDigest: contentDigest)
+			} catch {
+				// The directory was removed behind our back since `ensureQueue` last saw it.
+				guard !fm.fileExists(atPath: qurl.path) else { throw error }
+				knownDirectories.remove(qurl.lastPathComponent)
+				try await ensureQueue(queue)
+				try storeEntry(object, named: makeFilename(for: object, queue: qurl.lastPathComponent), in: qurl, contentDigest: contentDigest)
+			}
 			return object.id
 		} catch {
 			logger.error("put failed", metadata: ["queue": .string(queue),
@@ -182,29 +429,72 @@ public actor BoxServerStore {
 		}
 	}
 	
+	/// Writes `object` as `filename` in the existing queue directory `qurl`, replacing a file of that name.
+	private func storeEntry(_ object: BoxStoredObject, named filename: String, in qurl: URL, contentDigest known: BoxContentDigest? = nil) throws {
+		let sanitizedQueue = qurl.lastPathComponent
+		let fileURL = qurl.appendingPathComponent(filename)
+		let digest = try known ?? Self.contentDigest(of: object, at: fileURL)
+		let blob = Self.blobKey(of: object, digest: digest)
+		let reservedRef = object.data.count >= Self.blobThreshold ? UUID() : nil
+		// Untimestamped queues overwrite by id: the replaced entry gives its blob reference back.
+		let replaced = blobReference(ofFileAt: fileURL)
+		try journaled(.put(
+			path: journalPath(of: fileURL),
+			blob: reservedRef.map { BlobLink(digest: blob, ref: $0) },
+			replaced: replaced
+		)) {
+			let (data, blobRef) = try encodeEntry(object, digest: digest, blob: blob, blobRef: reservedRef)
+			logger.debug("put", metadata: [
+				"queue": .string(sanitizedQueue),
+				"id": .string(object.id.uuidString),
+				"bytes": .stringConvertible(object.data.count),
+				"digest": .string(digest.hex),
+				"shared": .stringConvertible(blobRef != nil),
+				"file": .string(filename)
+			])
+			let previousModification = BoxQueueIndex.modificationDate(of: qurl)
+			do {
+				try atomicWrite(data: data, to: fileURL)
+			} catch {
+				if let ref = blobRef { releaseBlob(blob, ref: ref) }
+				throw error
+			}
+			if let replaced { releaseBlob(replaced.digest, ref: replaced.ref) }
+			readCache.removeValue(for: BoxReadCache.Key(queue: sanitizedQueue, name: filename))
+			recordMutation(in: qurl, previousModification: previousModification) {
+				$0.insert(BoxQueueIndex.entry(forFileNamed: filename, size: data.count, blobSize: blobRef == nil ? 0 : object.data.count, createdAt: object.createdAt, digest: digest))
+			}
+			noteChange(.stored(queue: sanitizedQueue, name: filename))
+		}
+	}
+	
 	public func get(queue: String, id: UUID) async throws -> BoxStoredObject {
 		do {
-			let qurl = root.appendingPathComponent(try sanitizeQueueName(queue), isDirectory: true)
-			guard fm.fileExists(atPath: qurl.path) else { throw BoxStoreError.queueNotFound(queue) }
+			let qurl = try existingQueueDirectory(queue)
 			let url = try findFileURL(for: id, in: qurl)
 			logger.debug("get", metadata: ["queue": .string(queue), "id": .string(id.uuidString), "file": .string(url.lastPathComponent)])
-			return try readObject(from: url)
+			return try cachedObject(at: url)
 		} catch {
 			logger.error("get failed", metadata: ["queue": .string(queue), "id": .string(id.uuidString), "error": .string("\(error)")])
 			throw error
 		}
 	}
 	
-	// Renvoie et supprime le plus ancien message (ordre déterminé par le préfixe timestamp du nom de fichier)
+	// Renvoie et supprime le plus ancien message de la plus haute priorité (ordre d'âge déterminé par le
+	// préfixe timestamp du nom de fichier)
 	public func popOldest(from queue: String) async throws -> BoxStoredObject? {
 		do {
-			let qurl = root.appendingPathComponent(try sanitizeQueueName(queue), isDirectory: true)
-			guard fm.fileExists(atPath: qurl.path) else { throw BoxStoreError.queueNotFound(queue) }
-			let files = try fm.contentsOfDirectory(at: qurl, includingPropertiesForKeys: nil).filter { $0.pathExtension == "json" }
-			guard let first = files.sorted(by: { $0.lastPathComponent < $1.lastPathComponent }).first else { return nil }
+			let qurl = try existingQueueDirectory(queue)
+			let key = qurl.lastPathComponent
+			expireLeases(in: key, now: Date())
+			guard let oldest = try queueIndex(for: qurl).nextEntry(excluding: { isLeased($0, in: key) }) else { return nil }
+			let first = qurl.appendingPathComponent(oldest.name)
 			logger.debug("pop oldest", metadata: ["queue": .string(queue), "file": .string(first.lastPathComponent)])
-			let obj = try readObject(from: first)
-			try fm.removeItem(at: first)
+			let disk = try readDiskMessage(from: first)
+			let obj = try materialize(disk, from: first)
+			let previousModification = BoxQueueIndex.modificationDate(of: qurl)
+			try unlinkEntry(at: first, reference: disk.blobLink)
+			recordMutation(in: qurl, previousModification: previousModification) { $0.remove(named: oldest.name) }
 			return obj
 		} catch {
 				logger.error("pop failed", metadata: ["queue": .string(queue), "error": .string("\(error)")])
@@ -214,37 +504,153 @@ public actor BoxServerStore {
 
 	public func peekOldest(from queue: String) async throws -> BoxStoredObject? {
 		do {
-			let qurl = root.appendingPathComponent(try sanitizeQueueName(queue), isDirectory: true)
-			guard fm.fileExists(atPath: qurl.path) else { throw BoxStoreError.queueNotFound(queue) }
-			let files = try fm.contentsOfDirectory(at: qurl, includingPropertiesForKeys: nil).filter { $0.pathExtension == "json" }
-			guard let first = files.sorted(by: { $0.lastPathComponent < $1.lastPathComponent }).first else { return nil }
+			let qurl = try existingQueueDirectory(queue)
+			guard let oldest = try queueIndex(for: qurl).nextEntry() else { return nil }
+			let first = qurl.appendingPathComponent(oldest.name)
 			logger.debug("peek oldest", metadata: ["queue": .string(queue), "file": .string(first.lastPathComponent)])
-			return try readObject(from: first)
+			return try cachedObject(at: first)
 		} catch {
 			logger.error("peek failed", metadata: ["queue": .string(queue), "error": .string("\(error)")])
 			throw error
 		}
 	}
 	
+	/// Opens the object `peekOldest` would return, without loading a blob-backed payload: its blob file
+	/// is opened and read chunk by chunk by the caller (SPECS §7.10).
+	///
+	/// With a `consumer`, the oldest unleased object is leased to it for `visibility` instead, as `lease`
+	/// does. Nothing is removed here: a consuming GET acknowledges the lease once its reply is out.
+	func openOldest(from queue: String, leasingTo consumer: String? = nil, visibility: TimeInterval = 0, now: Date = Date()) async throws -> BoxStreamedObject? {
+		do {
+			let qurl = try existingQueueDirectory(queue)
+			let key = qurl.lastPathComponent
+			if consumer != nil {
+				expireLeases(in: key, now: now)
+			}
+			guard let oldest = try queueIndex(for: qurl).nextEntry(excluding: { consumer != nil && isLeased($0, in: key) }) else { return nil }
+			let url = qurl.appendingPathComponent(oldest.name)
+			if consumer == nil, let cached = readCache.object(for: BoxReadCache.Key(queue: key, name: oldest.name)) {
+				return BoxStreamedObject(cached)
+			}
+			let disk = try readDiskMessage(from: url)
+			let streamed: BoxStreamedObject
+			if disk.content == nil, let digest = disk.blobKey, let ref = disk.blobRef {
+				// Same fallback as `materialize`: the reference link shares the blob inode.
+				let primary = blobURL(for: digest)
+				let reader = try BoxPayloadReader(fileURL: fm.fileExists(atPath: primary.path) ? primary : blobReferenceURL(for: digest, ref: ref))
+				streamed = BoxStreamedObject(
+					id: disk.id,
+					contentType: disk.contentType,
+					createdAt: disk.createdAt,
+					nodeId: disk.nodeId,
+					userId: disk.userId,
+					priority: disk.priority ?? 0,
+					encoding: try payloadEncoding(of: disk, at: url),
+					payload: reader
+				)
+			} else {
+				let object = try materialize(disk, from: url)
+				if consumer == nil { readCache.insert(object, for: BoxReadCache.Key(queue: key, name: oldest.name)) }
+				streamed = BoxStreamedObject(object)
+			}
+			logger.debug("open oldest", metadata: ["queue": .string(queue), "file": .string(oldest.name), "bytes": .stringConvertible(streamed.payload.size), "consumer": .string(consumer ?? "")])
+			if let consumer {
+				grantLease(oldest.name, in: key, to: consumer, visibility: visibility, now: now)
+			}
+			return streamed
+		} catch {
+			logger.error("open failed", metadata: ["queue": .string(queue), "error": .string("\(error)")])
+			throw error
+		}
+	}
+	
 	public func remove(queue: String, id: UUID) async throws {
 		do {
-			let qurl = root.appendingPathComponent(try sanitizeQueueName(queue), isDirectory: true)
-			guard fm.fileExists(atPath: qurl.path) else { throw BoxStoreError.queueNotFound(queue) }
+			let qurl = try existingQueueDirectory(queue)
 			let url = try findFileURL(for: id, in: qurl)
 			logger.debug("remove", metadata: ["queue": .string(queue), "id": .string(id.uuidString), "file": .string(url.lastPathComponent)])
-			try fm.removeItem(at: url)
+			let previousModification = BoxQueueIndex.modificationDate(of: qurl)
+			try removeEntryFile(at: url)
+			recordMutation(in: qurl, previousModification: previousModification) { $0.remove(named: url.lastPathComponent) }
 		} catch {
 			logger.error("remove failed", metadata: ["queue": .string(queue), "id": .string(id.uuidString), "error": .string("\(error)")])
 			throw error
         }
 	}
 	
+	/// Removes every entry matched by `targets` (ids or payload digests) in a single actor hop.
+	///
+	/// Lookups go through the queue index and the delayed deliveries of the queue, which are removed
+	/// before their date; a digest target removes all entries holding that content.
+	public func delete(queue: String, targets: [BoxCodec.DeleteTarget]) async throws -> BoxDeleteResult {
+		let qurl = try existingQueueDirectory(queue)
+		let key = qurl.lastPathComponent
+		let needsDigests = targets.contains { if case .digest = $0 { return true } else { return false } }
+		let index = needsDigests ? try resolvedIndex(for: qurl) : try queueIndex(for: qurl)
+		loadScheduleIfNeeded()
+		let scheduled = (needsDigests ? resolvedScheduledIndex(for: key) : scheduledIndexes[key]) ?? BoxQueueIndex()
+		var victims: [BoxQueueIndex.Entry] = []
+		var delayed: [BoxQueueIndex.Entry] = []
+		var selected = Set<String>()
+		var missing = 0
+		for target in targets {
+			let names: [String]
+			let delayedNames: [String]
+			switch target {
+				case .id(let id):
+					names = index.name(for: id).map { [$0] } ?? []
+					delayedNames = scheduled.name(for: id).map { [$0] } ?? []
+				case .digest(let digest):
+					names = index.names(for: digest)
+					delayedNames = scheduled.names(for: digest)
+			}
+			if names.isEmpty && delayedNames.isEmpty { missing += 1 }
+			for name in names where selected.insert(name).inserted {
+				if let entry = index.entry(named: name) { victims.append(entry) }
+			}
+			// Scheduled names start with their delivery date in milliseconds: never a queue file name.
+			for name in delayedNames where selected.insert(name).inserted {
+				if let entry = scheduled.entry(named: name) { delayed.append(entry) }
+			}
+		}
+		guard !victims.isEmpty || !delayed.isEmpty else { return BoxDeleteResult(removed: 0, missing: missing) }
+		
+		var removedCount = 0
+		if !victims.isEmpty {
+			let previousModification = BoxQueueIndex.modificationDate(of: qurl)
+			let removed = try removeEntryFiles(victims.map { (name: $0.name, size: Optional($0.size)) }, in: qurl, failure: "delete failed")
+			recordMutation(in: qurl, previousModification: previousModification) { index in
+				for name in removed { index.remove(named: name) }
+			}
+			removedCount += removed.count
+		}
+		if !delayed.isEmpty {
+			removedCount += try removeScheduledEntries(delayed, of: key, failure: "delete failed").count
+		}
+		logger.debug("delete", metadata: ["queue": .string(queue), "targets": .stringConvertible(targets.count), "removed": .stringConvertible(removedCount)])
+		return BoxDeleteResult(removed: removedCount, missing: missing)
+	}
+	
+	/// Removes every entry of `queue`. Journaled: a purge cut short by a crash is finished at the next start.
 	public func purge(queue: String) async throws {
-		let qurl = root.appendingPathComponent(try sanitizeQueueName(queue), isDirectory: true)
+		let qurl = try queueHandle(queue).directory
 		guard fm.fileExists(atPath: qurl.path) else { return }
-		let urls = try fm.contentsOfDirectory(at: qurl, includingPropertiesForKeys: nil)
-		logger.info("purge", metadata: ["queue": .string(queue), "count": .stringConvertible(urls.count)])
-		for u in urls { try? fm.removeItem(at: u) }
+		try journaled(.purge(queue: qurl.lastPathComponent)) {
+			try purgeEntries(in: qurl)
+		}
+	}
+	
+	private func purgeEntries(in qurl: URL) throws {
+		let names = try fm.contentsOfDirectory(atPath: qurl.path)
+		logger.info("purge", metadata: ["queue": .string(qurl.lastPathComponent), "count": .stringConvertible(names.count)])
+		// Batches keep each journal record small.
+		for start in stride(from: 0, to: names.count, by: 256) {
+			let batch = names[start..<min(start + 256, names.count)]
+			_ = try removeEntryFiles(batch.map { (name: $0, size: Int64?.none) }, in: qurl, failure: "purge failed")
+		}
+		indexes.removeValue(forKey: qurl.lastPathComponent)
+		readCache.removeAll(inQueue: qurl.lastPathComponent)
+		removeCursorTable(of: qurl.lastPathComponent)
 	}
 	
 	public func read(reference: BoxMessageRef) async throws -> BoxStoredObject {
@@ -252,20 +658,14 @@ public actor BoxServerStore {
 	}
 	
 	public func read(queue: String, id: UUID) async throws -> BoxStoredObject {
-		let qurl = root.appendingPathComponent(try sanitizeQueueName(queue), isDirectory: true)
-		guard fm.fileExists(atPath: qurl.path) else {
-			throw BoxStoreError.queueNotFound(queue)
-		}
+		let qurl = try existingQueueDirectory(queue)
 		let fileURL = try findFileURL(for: id, in: qurl)
-		return try readObject(from: fileURL)
+		return try cachedObject(at: fileURL)
 	}
 	
 	public func list(queue: String, limit: Int? = nil, offset: Int? = nil) async throws -> [BoxMessageRef] {
-		let qurl = root.appendingPathComponent(try sanitizeQueueName(queue), isDirectory: true)
-		guard fm.fileExists(atPath: qurl.path) else { throw BoxStoreError.queueNotFound(queue) }
-		let files = try fm.contentsOfDirectory(at: qurl, includingPropertiesForKeys: nil)
-			.filter { $0.pathExtension == "json" }
-			.sorted(by: { $0.lastPathComponent < $1.lastPathComponent })
+		let qurl = try existingQueueDirectory(queue)
+		let files = try queueIndex(for: qurl).entries.map { qurl.appendingPathComponent($0.name) }
 		var sliced = files
 		if let offset = offset, offset > 0 { sliced = Array(sliced.dropFirst(min(offset, sliced.count))) }
 		if let limit = limit { sliced = Array(sliced.prefix(max(0, limit))) }
@@ -275,27 +675,1477 @@ public actor BoxServerStore {
 		}
 	}
 	
+	// MARK: - Delayed delivery
+	
+	/// Stores `object` so that it enters `queue` only at `notBefore` (SPECS §7.5).
+	///
+	/// The entry waits under `<root>/.scheduled/<queue>/` and survives restarts; `releaseDueDeliveries`
+	/// moves it into the queue once due, named after its delivery date. A date already past behaves like `put`.
+	/// `contentDigest` is the one of `put`.
+	@discardableResult
+	public func schedule(_ object: BoxStoredObject, into queue: String, notBefore: Date, now: Date = Date(), contentDigest: BoxContentDigest? = nil) async throws -> UUID {
+		guard notBefore > now else { return try await put(object, into: queue, contentDigest: contentDigest) }
+		loadScheduleIfNeeded()
+		let qurl = try await ensureQueue(queue)
+		let sanitizedQueue = qurl.lastPathComponent
+		let directory = scheduledDirectory(for: sanitizedQueue)
+		try ensureDirectoryExists(directory)
+		let milliseconds = Int64((notBefore.timeIntervalSince1970 * 1000).rounded(.up))
+		let name = "\(milliseconds)-\(makeFilename(for: object, queue: sanitizedQueue, visibleAt: notBefore))"
+		let fileURL = directory.appendingPathComponent(name)
+		let digest = try contentDigest ?? Self.contentDigest(of: object, at: fileURL)
+		let blob = Self.blobKey(of: object, digest: digest)
+		let reservedRef = object.data.count >= Self.blobThreshold ? UUID() : nil
+		let entry = try journaled(.put(path: journalPath(of: fileURL), blob: reservedRef.map { BlobLink(digest: blob, ref: $0) }, replaced: nil)) { () throws -> BoxQueueIndex.Entry in
+			let (data, blobRef) = try encodeEntry(object, digest: digest, blob: blob, blobRef: reservedRef)
+			do {
+				try atomicWrite(data: data, to: fileURL)
+			} catch {
+				if let ref = blobRef { releaseBlob(blob, ref: ref) }
+				throw error
+			}
+			return Self.scheduledEntry(named: name, notBefore: notBefore, size: Int64(data.count), blobSize: blobRef == nil ? 0 : Int64(object.data.count), digest: digest)
+		}
+		pendingDeliveries.schedule(ScheduledDelivery(queue: sanitizedQueue, name: name), at: notBefore)
+		scheduledIndexes[sanitizedQueue, default: BoxQueueIndex()].insert(entry)
+		deliveryFeed?.yield(notBefore)
+		logger.debug("scheduled", metadata: ["queue": .string(queue), "id": .string(object.id.uuidString), "notBefore": .string("\(notBefore)")])
+		return object.id
+	}
+	
+	/// Moves every delayed delivery whose date has passed into its queue.
+	/// - Returns: Number of objects released.
+	@discardableResult
+	public func releaseDueDeliveries(now: Date = Date()) -> Int {
+		loadScheduleIfNeeded()
+		var released = 0
+		for delivery in pendingDeliveries.advance(to: now) {
+			do {
+				if try release(delivery) { released += 1 }
+			} catch {
+				logger.warning("delayed delivery failed", metadata: ["queue": .string(delivery.queue), "file": .string(delivery.name), "error": .string("\(error)")])
+			}
+		}
+		return released
+	}
+	
+	/// Number of delayed deliveries not released yet.
+	public func pendingDeliveryCount() -> Int {
+		loadScheduleIfNeeded()
+		return scheduledIndexes.values.reduce(0) { $0 + $1.entries.count }
+	}
+	
+	/// Date at which `releaseDueDeliveries` has work to do next, `nil` with nothing pending.
+	/// It may come before the next delivery (see `BoxTimerWheel.nextDeadline`), never after it.
+	func nextDeliveryDate() -> Date? {
+		loadScheduleIfNeeded()
+		return pendingDeliveries.nextDeadline
+	}
+	
+	/// Stream of the dates of the deliveries scheduled from now on, so that a scheduler asleep until a
+	/// later date wakes up in time. Opening a new stream finishes the previous one.
+	func openDeliveryFeed() -> AsyncStream<Date> {
+		deliveryFeed?.finish()
+		let (stream, continuation) = AsyncStream<Date>.makeStream()
+		deliveryFeed = continuation
+		return stream
+	}
+	
+	/// Renames a due entry into its queue. Returns `false` when it was deleted meanwhile or another store
+	/// instance released it first.
+	private func release(_ delivery: ScheduledDelivery) throws -> Bool {
+		let scheduled = forgetScheduledEntry(named: delivery.name, in: delivery.queue)
+		let source = scheduledDirectory(for: delivery.queue).appendingPathComponent(delivery.name)
+		guard fm.fileExists(atPath: source.path),
+			  let separator = delivery.name.firstIndex(of: "-") else { return false }
+		let filename = String(delivery.name[delivery.name.index(after: separator)...])
+		let qurl = root.appendingPathComponent(delivery.queue, isDirectory: true)
+		try ensureDirectoryExists(qurl)
+		let destination = qurl.appendingPathComponent(filename)
+		let size = (try? fm.attributesOfItem(atPath: source.path)[.size] as? NSNumber)?.intValue ?? 0
+		let previousModification = BoxQueueIndex.modificationDate(of: qurl)
+		do {
+			if fm.fileExists(atPath: destination.path) {
+				// Untimestamped queues keep one file per id: the delayed version replaces the current one.
+				try removeEntryFile(at: destination)
+			}
+			preserveForSnapshot(source)
+			try fm.moveItem(at: source, to: destination)
+		} catch {
+			throw BoxStoreError.io(error)
+		}
+		recordMutation(in: qurl, previousModification: previousModification) {
+			$0.insert(BoxQueueIndex.entry(forFileNamed: filename, size: size, blobSize: Int(scheduled?.blobSize ?? 0), createdAt: Date(), digest: scheduled?.digest))
+		}
+		noteChange(.stored(queue: delivery.queue, name: filename))
+		logger.debug("delayed delivery released", metadata: ["queue": .string(delivery.queue), "file": .string(filename)])
+		return true
+	}
+	
+	/// Rebuilds the timer wheel from `.scheduled` the first time delayed deliveries are used.
+	private func loadScheduleIfNeeded() {
+		guard !scheduleLoaded else { return }
+		scheduleLoaded = true
+		let base = root.appendingPathComponent(Self.scheduledDirectoryName, isDirectory: true)
+		guard let queues = try? fm.contentsOfDirectory(atPath: base.path) else { return }
+		var restored = 0
+		for queue in queues where !queue.hasPrefix(".") {
+			let files = (try? fm.contentsOfDirectory(at: scheduledDirectory(for: queue), includingPropertiesForKeys: [.fileSizeKey])) ?? []
+			for file in files where file.lastPathComponent.hasSuffix(".json") {
+				let name = file.lastPathComponent
+				guard let separator = name.firstIndex(of: "-"), let milliseconds = Int64(name[..<separator]) else { continue }
+				let notBefore = Date(timeIntervalSince1970: TimeInterval(milliseconds) / 1000)
+				let size = (try? file.resourceValues(forKeys: [.fileSizeKey]).fileSize) ?? 0
+				pendingDeliveries.schedule(ScheduledDelivery(queue: queue, name: name), at: notBefore)
+				// Digests are read from the descriptors only when a DELETE or a byte limit needs them.
+				scheduledIndexes[queue, default: BoxQueueIndex()].insert(Self.scheduledEntry(named: name, notBefore: notBefore, size: Int64(size), blobSize: 0, digest: nil))
+				restored += 1
+			}
+		}
+		if restored > 0 {
+			logger.info("delayed deliveries restored", metadata: ["count": .stringConvertible(restored)])
+		}
+	}
+	
+	/// Index entry of the delayed delivery `name` (`<ms>-<final name>`). It keeps its name in `.scheduled`,
+	/// so entries sort by delivery date, and is dated by its delivery: retention sees the entry it will become.
+	private static func scheduledEntry(named name: String, notBefore: Date, size: Int64, blobSize: Int64, digest: BoxContentDigest?) -> BoxQueueIndex.Entry {
+		let filename = name.firstIndex(of: "-").map { String(name[name.index(after: $0)...]) } ?? name
+		return BoxQueueIndex.Entry(
+			name: name,
+			id: BoxQueueIndex.identifier(fromFileName: filename),
+			createdAt: notBefore,
+			size: size,
+			isTimestamped: true,
+			priority: BoxQueueIndex.priority(fromFileName: filename),
+			digest: digest,
+			blobSize: blobSize
+		)
+	}
+	
+	/// Delayed deliveries of `queue` with the digest and blob size of every entry filled in.
+	private func resolvedScheduledIndex(for queue: String) -> BoxQueueIndex? {
+		guard var index = scheduledIndexes[queue] else { return nil }
+		guard index.undigestedCount > 0 else { return index }
+		resolveDigests(of: &index, in: scheduledDirectory(for: queue))
+		scheduledIndexes[queue] = index
+		return index
+	}
+	
+	/// Drops `name` from the delayed deliveries of `queue`, returning its entry.
+	@discardableResult
+	private func forgetScheduledEntry(named name: String, in queue: String) -> BoxQueueIndex.Entry? {
+		guard let entry = scheduledIndexes[queue]?.remove(named: name) else { return nil }
+		if scheduledIndexes[queue]?.entries.isEmpty == true {
+			scheduledIndexes.removeValue(forKey: queue)
+		}
+		return entry
+	}
+	
+	/// Removes delayed deliveries of `queue` before their date (DELETE, retention). Their timers stay in
+	/// the wheel and find no file once due.
+	private func removeScheduledEntries(_ entries: [BoxQueueIndex.Entry], of queue: String, failure: Logger.Message) throws -> [String] {
+		let removed = try removeEntryFiles(entries.map { (name: $0.name, size: Optional($0.size)) }, in: scheduledDirectory(for: queue), failure: failure, announced: false)
+		for name in removed {
+			forgetScheduledEntry(named: name, in: queue)
+		}
+		return removed
+	}
+	
+	private func scheduledDirectory(for queue: String) -> URL {
+		root.appendingPathComponent(Self.scheduledDirectoryName, isDirectory: true).appendingPathComponent(queue, isDirectory: true)
+	}
+	
+	// MARK: - Leases
+	
+	/// Leases the oldest object that is not already leased, hiding it for `policy.visibilityTimeout`.
+	///
+	/// Nothing is deleted until `acknowledge`: a lost reply only delays the object until the lease expires.
+	public func lease(from queue: String, consumer: String, policy: BoxLeasePolicy, now: Date = Date()) async throws -> BoxLeaseOutcome {
+		let qurl = try existingQueueDirectory(queue)
+		let key = qurl.lastPathComponent
+		expireLeases(in: key, now: now)
+		guard (leases[key]?.inFlight(for: consumer) ?? 0) < policy.maxInFlight else { return .windowFull }
+		guard let entry = try queueIndex(for: qurl).nextEntry(excluding: { isLeased($0, in: key) }) else { return .empty }
+		let object = try cachedObject(at: qurl.appendingPathComponent(entry.name))
+		let expiresAt = grantLease(entry.name, in: key, to: consumer, visibility: policy.visibilityTimeout, now: now)
+		logger.debug("lease", metadata: ["queue": .string(queue), "id": .string(object.id.uuidString), "consumer": .string(consumer)])
+		return .leased(object, expiresAt: expiresAt)
+	}
+	
+	/// Deletes an object leased to `consumer`. Acknowledging after expiry still succeeds for one more
+	/// visibility timeout, unless another consumer leased it since; an object never leased is refused.
+	public func acknowledge(queue: String, id: UUID, consumer: String, now: Date = Date()) async throws {
+		let qurl = try existingQueueDirectory(queue)
+		let key = qurl.lastPathComponent
+		guard let name = try queueIndex(for: qurl).name(for: id) else { throw BoxStoreError.objectNotFound(id) }
+		expireLeases(in: key, now: now)
+		guard let lease = leases[key]?.lease(named: name) else { throw BoxStoreError.notLeased(id) }
+		guard lease.consumer == consumer else { throw BoxStoreError.leasedByAnotherConsumer(id) }
+		let previousModification = BoxQueueIndex.modificationDate(of: qurl)
+		try removeEntryFile(at: qurl.appendingPathComponent(name))
+		recordMutation(in: qurl, previousModification: previousModification) { $0.remove(named: name) }
+	}
+	
+	/// Number of unexpired leases on `queue`.
+	public func inFlightCount(queue: String, now: Date = Date()) throws -> Int {
+		let key = try sanitizeQueueName(queue)
+		expireLeases(in: key, now: now)
+		return leases[key]?.activeCount ?? 0
+	}
+	
+	/// Expires the leases of a queue due at `now`, dropping a table left empty. The table is updated in
+	/// place: no copy of it is held across calls, so a change never duplicates it.
+	private func expireLeases(in key: String, now: Date) {
+		guard leases[key] != nil else { return }
+		leases[key]?.expire(now: now)
+		if leases[key]?.isEmpty == true {
+			leases[key] = nil
+		}
+	}
+	
+	/// Drops the lease of an entry removed by any path (acknowledgement, GET, DELETE, retention, purge,
+	/// external removal), so it no longer counts in its consumer's in-flight window.
+	private func forgetLease(of name: String, in key: String) {
+		guard leases[key] != nil else { return }
+		leases[key]?.remove(named: name)
+		if leases[key]?.isEmpty == true {
+			leases[key] = nil
+		}
+	}
+	
+	private func isLeased(_ name: String, in key: String) -> Bool {
+		leases[key]?.isLeased(name) ?? false
+	}
+	
+	/// Leases `name` to `consumer` for `visibility` and returns the expiry date.
+	@discardableResult
+	private func grantLease(_ name: String, in key: String, to consumer: String, visibility: TimeInterval, now: Date) -> Date {
+		let expiresAt = now.addingTimeInterval(visibility)
+		let lease = BoxLease(consumer: consumer, expiresAt: expiresAt, acknowledgeableUntil: expiresAt.addingTimeInterval(visibility))
+		leases[key, default: BoxLeaseTable()].insert(lease, for: name)
+		return expiresAt
+	}
+	
+	// MARK: - Cursors
+	
+	/// Returns the first object after the committed position of `cursor`, without removing it.
+	///
+	/// The position only moves on `commit`, so a reply lost on the wire is served again (at-least-once).
+	public func next(queue: String, cursor: String) async throws -> BoxStoredObject? {
+		let qurl = try cursorQueueDirectory(queue)
+		let name = try Self.normalizeCursorName(cursor)
+		let position = try cursorPositions(for: qurl.lastPathComponent)[name]
+		guard let entry = try queueIndex(for: qurl).firstEntry(after: position) else { return nil }
+		return try cachedObject(at: qurl.appendingPathComponent(entry.name))
+	}
+	
+	/// Moves `cursor` past the object `id`. Committing an object behind the current position is a no-op.
+	public func commit(queue: String, cursor: String, through id: UUID) async throws {
+		let qurl = try cursorQueueDirectory(queue)
+		let name = try Self.normalizeCursorName(cursor)
+		guard let fileName = try queueIndex(for: qurl).name(for: id) else { throw BoxStoreError.objectNotFound(id) }
+		var positions = try cursorPositions(for: qurl.lastPathComponent)
+		if let current = positions[name], current >= fileName { return }
+		positions[name] = fileName
+		try saveCursorPositions(positions, for: qurl.lastPathComponent)
+	}
+	
+	/// Positions `cursor` so that `next` returns the first object created at or after `date`.
+	/// `nil` rewinds to the oldest object.
+	public func seek(queue: String, cursor: String, to date: Date?) async throws {
+		let qurl = try cursorQueueDirectory(queue)
+		let name = try Self.normalizeCursorName(cursor)
+		var positions = try cursorPositions(for: qurl.lastPathComponent)
+		// A bare timestamp sorts before every file name of that microsecond, so those files are included.
+		positions[name] = date.map { BoxQueueIndex.timestampPrefix(microseconds: BoxQueueIndex.microseconds(of: $0)) }
+		try saveCursorPositions(positions, for: qurl.lastPathComponent)
+	}
+	
+	/// Validates a cursor name with the queue name rules.
+	public static func normalizeCursorName(_ name: String) throws -> String {
+		guard name.utf8.count <= 128, let normalized = try? normalizeQueueName(name) else {
+			throw BoxStoreError.invalidCursorName(name)
+		}
+		return normalized
+	}
+	
+	/// Directory of `queue` for a cursor request. Entries of untimestamped queues are named by id, so a
+	/// position there would follow UUID order instead of age: cursors are refused on them.
+	/// - Throws: `BoxStoreError.unorderedQueue` for such a queue.
+	private func cursorQueueDirectory(_ queue: String) throws -> URL {
+		let qurl = try existingQueueDirectory(queue)
+		guard Self.isTimestamped(queue: qurl.lastPathComponent) else { throw BoxStoreError.unorderedQueue(qurl.lastPathComponent) }
+		return qurl
+	}
+	
+	/// Removes the cursor table of `queue` (purged, removed or created again): its positions name files
+	/// of the previous content and would otherwise outlive it.
+	private func removeCursorTable(of queue: String) {
+		cursorTables.removeValue(forKey: queue)
+		let url = cursorTableURL(for: queue)
+		guard fm.fileExists(atPath: url.path) else { return }
+		do {
+			preserveForSnapshot(url)
+			try fm.removeItem(at: url)
+		} catch {
+			logger.warning("cursor table removal failed", metadata: ["queue": .string(queue), "error": .string("\(error)")])
+		}
+	}
+	
+	private func cursorTableURL(for queue: String) -> URL {
+		root.appendingPathComponent(Self.cursorDirectoryName, isDirectory: true).appendingPathComponent("\(queue).json")
+	}
+	
+	private func cursorPositions(for queue: String) throws -> [String: String] {
+		let url = cursorTableURL(for: queue)
+		let modifiedAt = BoxQueueIndex.modificationDate(of: url)
+		if let cached = cursorTables[queue], cached.modifiedAt == modifiedAt {
+			return cached.positions
+		}
+		var positions: [String: String] = [:]
+		if modifiedAt != nil {
+			do {
+				positions = try decoder.decode([String: String].self, from: Data(contentsOf: url))
+			} catch {
+				throw BoxStoreError.corrupted(url)
+			}
+		}
+		cursorTables[queue] = (positions, modifiedAt)
+		return positions
+	}
+	
+	private func saveCursorPositions(_ positions: [String: String], for queue: String) throws {
+		let url = cursorTableURL(for: queue)
+		try ensureDirectoryExists(url.deletingLastPathComponent())
+		try atomicWrite(data: try encoder.encode(positions), to: url)
+		cursorTables[queue] = (positions, BoxQueueIndex.modificationDate(of: url))
+	}
+	
+	// MARK: - Retention
+	
+	/// Removes the oldest objects of `queue` until it satisfies `policy`, deleting at most `limit` files.
+	///
+	/// Candidates come from the ordered index, so a batch costs `limit` unlinks and no directory scan.
+	/// Delayed deliveries count as the newest entries of the queue, dated by their delivery: they
+	/// are evicted last, before their date when the queue stays over its limits without them.
+	/// Callers run successive batches with pauses in between to keep the actor available for PUT/GET.
+	public func enforceRetention(queue: String, policy: BoxRetentionPolicy, now: Date = Date(), limit: Int) async throws -> BoxRetentionResult {
+		let qurl = try existingQueueDirectory(queue)
+		guard policy.isEnabled, limit > 0 else { return BoxRetentionResult(evicted: 0, evictedBytes: 0, hasMore: false) }
+		let key = qurl.lastPathComponent
+		// Byte limits count blob payloads, which only the descriptors of listed entries tell.
+		let index = policy.maxBytes != nil ? try resolvedIndex(for: qurl) : try queueIndex(for: qurl)
+		loadScheduleIfNeeded()
+		let scheduled = (policy.maxBytes != nil ? resolvedScheduledIndex(for: key) : scheduledIndexes[key]) ?? BoxQueueIndex()
+		let cutoff = policy.maxAge.map { now.addingTimeInterval(-$0) }
+		var remainingCount = index.entries.count + scheduled.entries.count
+		var remainingBytes = index.totalBytes + scheduled.totalBytes
+		var victims: [BoxQueueIndex.Entry] = []
+		var delayed: [BoxQueueIndex.Entry] = []
+		var hasMore = false
+		// Selects `entry` while the queue is over its policy; `false` ends the walk.
+		func evicts(_ entry: BoxQueueIndex.Entry, isDelayed: Bool) -> Bool {
+			let expired = cutoff.map { entry.createdAt < $0 } ?? false
+			let overCount = policy.maxCount.map { remainingCount > $0 } ?? false
+			let overBytes = policy.maxBytes.map { remainingBytes > $0 } ?? false
+			guard expired || overCount || overBytes else { return false }
+			guard victims.count + delayed.count < limit else {
+				hasMore = true
+				return false
+			}
+			if isDelayed {
+				delayed.append(entry)
+			} else {
+				victims.append(entry)
+			}
+			remainingCount -= 1
+			remainingBytes -= entry.bytes
+			return true
+		}
+		var walking = true
+		for entry in index.oldestFirst {
+			walking = evicts(entry, isDelayed: false)
+			if !walking { break }
+		}
+		if walking {
+			for entry in scheduled.entries {
+				if !evicts(entry, isDelayed: true) { break }
+			}
+		}
+		guard !victims.isEmpty || !delayed.isEmpty else { return BoxRetentionResult(evicted: 0, evictedBytes: 0, hasMore: false) }
+		
+		var removed: [BoxQueueIndex.Entry] = []
+		if !victims.isEmpty {
+			let previousModification = BoxQueueIndex.modificationDate(of: qurl)
+			let removedNames = Set(try removeEntryFiles(victims.map { (name: $0.name, size: Optional($0.size)) }, in: qurl, failure: "retention eviction failed"))
+			removed = victims.filter { removedNames.contains($0.name) }
+			recordMutation(in: qurl, previousModification: previousModification) { index in
+				for entry in removed { index.remove(named: entry.name) }
+			}
+		}
+		if !delayed.isEmpty {
+			let removedNames = Set(try removeScheduledEntries(delayed, of: key, failure: "retention eviction failed"))
+			removed += delayed.filter { removedNames.contains($0.name) }
+		}
+		let bytes = removed.reduce(Int64(0)) { $0 + $1.bytes }
+		logger.debug("retention batch", metadata: ["queue": .string(queue), "evicted": .stringConvertible(removed.count), "bytes": .stringConvertible(bytes)])
+		return BoxRetentionResult(evicted: removed.count, evictedBytes: bytes, hasMore: hasMore)
+	}
+	
+	// MARK: - Read cache
+	
+	/// Sets the byte budget of the read cache (`server.read_cache_bytes`); 0 disables it.
+	func setReadCacheBudget(_ bytes: Int) {
+		readCache.budget = bytes
+	}
+	
+	/// Hit/miss counters and occupancy of the read cache.
+	func readCacheStatistics() -> BoxReadCache.Statistics {
+		readCache.statistics
+	}
+	
+	// MARK: - Index
+	
+	/// Returns the index of `qurl`, rebuilding it when the directory changed outside this instance.
+	/// A watched queue is kept up to date by `reconcile`, so its index is returned without a `stat`.
+	private func queueIndex(for qurl: URL) throws -> BoxQueueIndex {
+		let key = qurl.lastPathComponent
+		if let cached = indexes[key], watchedQueues.contains(key) {
+			return cached
+		}
+		if let cached = indexes[key],
+		   let recorded = cached.directoryModifiedAt,
+		   recorded == BoxQueueIndex.modificationDate(of: qurl) {
+			return cached
+		}
+		do {
+			var loaded = try BoxQueueIndex.load(from: qurl, fileManager: fm)
+			if let previous = indexes[key] {
+				// Digests recorded at PUT survive the reload: a timestamped name is never reused, so a file
+				// listed again with its size is the same entry. Only files written elsewhere are read later.
+				loaded.fillDigests { entry in
+					guard entry.isTimestamped, let known = previous.entry(named: entry.name), known.size == entry.size,
+						  let digest = known.digest else { return nil }
+					return (digest, known.blobSize)
+				}
+			}
+			loaded.generation = nextIndexGeneration()
+			// Files may have been rewritten behind our back: cached objects of this queue are suspect.
+			readCache.removeAll(inQueue: key)
+			if indexes[key]?.directoryModifiedAt != nil {
+				// The changes themselves are unknown: a mirror of this queue must be copied again
+				// (`recordMutation` already said so for an index it left without a date).
+				noteChange(.reset(queue: key))
+			}
+			indexes[key] = loaded
+			return loaded
+		} catch {
+			guard fm.fileExists(atPath: qurl.path) else {
+				// Removed behind our back: the next request checks the directory again.
+				knownDirectories.remove(key)
+				removeCursorTable(of: key)
+				throw BoxStoreError.queueNotFound(key)
+			}
+			throw BoxStoreError.io(error)
+		}
+	}
+	
+	/// Returns the index of `qurl` with the digest and blob size of every entry filled in.
+	///
+	/// Entries loaded from a directory listing carry neither; their descriptors are read once here.
+	private func resolvedIndex(for qurl: URL) throws -> BoxQueueIndex {
+		var index = try queueIndex(for: qurl)
+		guard index.undigestedCount > 0 else { return index }
+		resolveDigests(of: &index, in: qurl)
+		indexes[qurl.lastPathComponent] = index
+		return index
+	}
+	
+	/// Fills in the digest and blob size of the entries of `index` that lack them, from their descriptors
+	/// in `directory` (files written before deduplication are hashed from their inline content).
+	private func resolveDigests(of index: inout BoxQueueIndex, in directory: URL) {
+		index.fillDigests { entry in
+			guard let disk = try? readDiskMessage(from: directory.appendingPathComponent(entry.name)) else { return nil }
+			let digest: BoxContentDigest
+			if let recorded = disk.digest {
+				digest = recorded
+			} else if let content = disk.content, let raw = Data(base64Encoded: content) {
+				digest = BoxContentDigest(of: [UInt8](raw))
+			} else {
+				return nil
+			}
+			guard let link = disk.blobLink else { return (digest, 0) }
+			let attributes = try? fm.attributesOfItem(atPath: blobReferenceURL(for: link.digest, ref: link.ref).path)
+			return (digest, (attributes?[.size] as? NSNumber)?.int64Value ?? 0)
+		}
+	}
+	
+	/// Applies a local change to the cached index of `qurl`.
+	///
+	/// When the directory had already changed before our own write (`previousModification` differs
+	/// from the recorded date) the index loses its date instead, so an external write is never masked:
+	/// the next use lists the directory again, keeping only the digests of the stale index.
+	/// A watched queue keeps its index, since the watcher reports that write, but not its older date.
+	private func recordMutation(in qurl: URL, previousModification: Date?, _ mutate: (inout BoxQueueIndex) -> Void) {
+		let key = qurl.lastPathComponent
+		guard var index = indexes[key] else { return }
+		let current = index.directoryModifiedAt.map { $0 == previousModification } ?? false
+		mutate(&index)
+		if current {
+			index.directoryModifiedAt = BoxQueueIndex.modificationDate(of: qurl)
+		} else if !watchedQueues.contains(key), index.directoryModifiedAt != nil {
+			index.directoryModifiedAt = nil
+			noteChange(.reset(queue: key))
+		}
+		index.generation = nextIndexGeneration()
+		indexes[key] = index
+	}
+	
+	private func nextIndexGeneration() -> UInt64 {
+		indexGeneration += 1
+		return indexGeneration
+	}
+	
+	/// Change marker of the index of `queue`: `generation` moves with every write through this store and
+	/// every reload after an external change, so a caller caching data derived from the queue compares
+	/// it instead of listing the directory (SPECS §7.12).
+	func indexVersion(of queue: String) throws -> (generation: UInt64, directoryModifiedAt: Date?) {
+		let qurl = try existingQueueDirectory(queue)
+		let index = try queueIndex(for: qurl)
+		return (index.generation, index.directoryModifiedAt)
+	}
+	
+	/// Number of queues and of objects they hold, counted from the indexes: only a queue whose index is
+	/// missing or out of date is listed (`box admin status` and `stats`).
+	func queueTotals() -> (queues: Int, objects: Int) {
+		var queues = 0
+		var objects = 0
+		for name in (try? fm.contentsOfDirectory(atPath: root.path)) ?? [] where !name.hasPrefix(".") {
+			// Stray files fail to list and are not counted.
+			guard let index = try? queueIndex(for: root.appendingPathComponent(name, isDirectory: true)) else { continue }
+			queues += 1
+			objects += index.entries.count
+		}
+		return (queues, objects)
+	}
+	
+	// MARK: - Change notifications
+	
+	/// Starts trusting the index of `queue` once its directory is watched. An index older than the
+	/// directory (restored from the manifest, or loaded before the watch) is dropped first.
+	func beginWatching(queue: String) {
+		let qurl = root.appendingPathComponent(queue, isDirectory: true)
+		if let cached = indexes[queue], cached.directoryModifiedAt != BoxQueueIndex.modificationDate(of: qurl) {
+			indexes.removeValue(forKey: queue)
+		}
+		watchedQueues.insert(queue)
+	}
+	
+	/// Goes back to directory date checks for `queue` (directory removed, watch lost).
+	func endWatching(queue: String) {
+		watchedQueues.remove(queue)
+		knownDirectories.remove(queue)
+	}
+	
+	func endWatchingAll() {
+		watchedQueues.removeAll()
+		knownDirectories.removeAll()
+	}
+	
+	/// Drops every index after notifications were lost; each one is listed again on next use.
+	func invalidateIndexes() {
+		for key in indexes.keys {
+			readCache.removeAll(inQueue: key)
+			noteChange(.reset(queue: key))
+		}
+		indexes.removeAll()
+		knownDirectories.removeAll()
+	}
+	
+	/// Applies the files of `queue` reported changed by the watcher. Each name is checked on disk, so
+	/// notifications of our own writes, late or repeated ones are harmless: an existing file is
+	/// (re)indexed when its size differs, a missing one is removed. Cached objects of those files are
+	/// dropped in any case. The directory date is left to `settle`: other changes may still be queued.
+	func reconcile(queue: String, names: Set<String>) {
+		let qurl = root.appendingPathComponent(queue, isDirectory: true)
+		for name in names {
+			readCache.removeValue(for: BoxReadCache.Key(queue: queue, name: name))
+		}
+		guard var index = indexes[queue] else { return }
+		var changed = false
+		for name in names {
+			let keys: Set<URLResourceKey> = [.fileSizeKey, .contentModificationDateKey]
+			let url = qurl.appendingPathComponent(name)
+			guard fm.fileExists(atPath: url.path), let values = try? url.resourceValues(forKeys: keys) else {
+				if index.remove(named: name) != nil {
+					forgetLease(of: name, in: queue)
+					noteChange(.removed(queue: queue, name: name))
+					changed = true
+				}
+				continue
+			}
+			let size = values.fileSize ?? 0
+			if let existing = index.entry(named: name), existing.size == Int64(size) { continue }
+			index.insert(BoxQueueIndex.entry(forFileNamed: name, size: size, createdAt: values.contentModificationDate ?? Date(), digest: nil))
+			noteChange(.stored(queue: queue, name: name))
+			changed = true
+		}
+		if changed {
+			index.generation = nextIndexGeneration()
+		}
+		indexes[queue] = index
+	}
+	
+	/// Records the current directory date of the reconciled `queues`, provided `isQuiet` then confirms
+	/// that the watcher has no change left to apply: a change made before the dates were read is
+	/// already queued as an event. Runs in one actor turn, so no local write slips in between.
+	/// - Returns: `false` when events are still pending; the watcher settles again after them.
+	func settle(queues: Set<String>, isQuiet: @Sendable () -> Bool) -> Bool {
+		let dates = queues.map { ($0, BoxQueueIndex.modificationDate(of: root.appendingPathComponent($0, isDirectory: true))) }
+		guard isQuiet() else { return false }
+		for (queue, date) in dates where indexes[queue] != nil {
+			indexes[queue]?.directoryModifiedAt = date
+		}
+		return true
+	}
+	
+	/// Whether `queue` is currently kept up to date by the watcher.
+	func isWatching(queue: String) -> Bool {
+		watchedQueues.contains(queue)
+	}
+	
+	// MARK: - Compaction
+	
+	/// Size of the directory file of `queue` next to its number of entries. Directories never shrink
+	/// after mass deletions, so a large ratio marks a queue worth rebuilding.
+	func directoryFootprint(of queue: String) throws -> (bytes: Int64, entries: Int) {
+		let qurl = try existingQueueDirectory(queue)
+		let entries = try queueIndex(for: qurl).entries.count
+		return (Self.fileSize(at: qurl), entries)
+	}
+	
+	/// Starts rebuilding the directory of `queue` as `<root>/.compact/<queue>.new`.
+	/// - Returns: Names to pass to `continueRebuild`, in batches.
+	func beginRebuild(of queue: String) throws -> [String] {
+		let key = try sanitizeQueueName(queue)
+		let qurl = root.appendingPathComponent(key, isDirectory: true)
+		guard fm.fileExists(atPath: qurl.path) else { throw BoxStoreError.queueNotFound(queue) }
+		let copy = compactionURL(for: key, suffix: "new")
+		do {
+			if fm.fileExists(atPath: copy.path) {
+				try fm.removeItem(at: copy)
+			}
+			try fm.createDirectory(at: copy, withIntermediateDirectories: true)
+		} catch {
+			throw BoxStoreError.io(error)
+		}
+		rebuilds[key] = []
+		return try queueIndex(for: qurl).entries.map(\.name)
+	}
+	
+	/// Hard-links the entries of `names` still present into the copy; only directory entries are written.
+	/// - Returns: Number of files linked.
+	func continueRebuild(of queue: String, names: ArraySlice<String>) throws -> Int {
+		let key = try sanitizeQueueName(queue)
+		guard var linked = rebuilds[key] else { return 0 }
+		let qurl = root.appendingPathComponent(key, isDirectory: true)
+		let copy = compactionURL(for: key, suffix: "new")
+		var count = 0
+		for name in names where !linked.contains(name) {
+			do {
+				try fm.linkItem(at: qurl.appendingPathComponent(name), to: copy.appendingPathComponent(name))
+			} catch {
+				// Removed since the listing: `finishRebuild` works from the index anyway.
+				continue
+			}
+			linked.insert(name)
+			count += 1
+		}
+		rebuilds[key] = linked
+		return count
+	}
+	
+	/// Catches up with the writes made since `beginRebuild`, then swaps the copy in with two renames.
+	/// Runs in one actor turn, so no request sees a half-swapped queue. Entries of untimestamped queues
+	/// (`whoswho`) are replaced in place by name, so their links are checked to point at the current file.
+	/// - Returns: Bytes the directory file shrank by, or `nil` when another process wrote into the queue
+	///   meanwhile: the copy is dropped and the queue left as is.
+	func finishRebuild(of queue: String) throws -> Int64? {
+		let key = try sanitizeQueueName(queue)
+		guard let linked = rebuilds.removeValue(forKey: key) else { return nil }
+		let qurl = root.appendingPathComponent(key, isDirectory: true)
+		let copy = compactionURL(for: key, suffix: "new")
+		let retired = compactionURL(for: key, suffix: "old")
+		do {
+			let index = try queueIndex(for: qurl)
+			var live = Set<String>()
+			live.reserveCapacity(index.entries.count)
+			for entry in index.entries {
+				live.insert(entry.name)
+				let source = qurl.appendingPathComponent(entry.name)
+				let target = copy.appendingPathComponent(entry.name)
+				if linked.contains(entry.name) {
+					guard !entry.isTimestamped, Self.fileNumber(at: source) != Self.fileNumber(at: target) else { continue }
+					try fm.removeItem(at: target)
+				}
+				try fm.linkItem(at: source, to: target)
+			}
+			for name in linked where !live.contains(name) {
+				try? fm.removeItem(at: copy.appendingPathComponent(name))
+			}
+			// Our own links only touch the copy: a new date means an external write the index missed.
+			guard let recorded = index.directoryModifiedAt, recorded == BoxQueueIndex.modificationDate(of: qurl) else {
+				try? fm.removeItem(at: copy)
+				logger.info("queue changed during rebuild, skipped", metadata: ["queue": .string(key)])
+				return nil
+			}
+			let before = Self.fileSize(at: qurl)
+			if fm.fileExists(atPath: retired.path) {
+				try fm.removeItem(at: retired)
+			}
+			try fm.moveItem(at: qurl, to: retired)
+			try fm.moveItem(at: copy, to: qurl)
+			var swapped = index
+			swapped.directoryModifiedAt = BoxQueueIndex.modificationDate(of: qurl)
+			swapped.generation = nextIndexGeneration()
+			indexes[key] = swapped
+			logger.info("queue directory rebuilt", metadata: ["queue": .string(key), "entries": .stringConvertible(index.entries.count)])
+			return max(0, before - Self.fileSize(at: qurl))
+		} catch {
+			try? fm.removeItem(at: copy)
+			throw BoxStoreError.io(error)
+		}
+	}
+	
+	/// Abandons the rebuild of `queue` after a failure; the live directory was never touched.
+	func cancelRebuild(of queue: String) {
+		guard let key = try? sanitizeQueueName(queue), rebuilds.removeValue(forKey: key) != nil else { return }
+		try? fm.removeItem(at: compactionURL(for: key, suffix: "new"))
+	}
+	
+	/// Names of the files left in the directory `queue` replaced by `finishRebuild`, listed once for
+	/// `drainRetiredDirectory`. Runs outside the actor.
+	nonisolated func retiredDirectoryNames(of queue: String) -> [String] {
+		guard let key = try? Self.normalizeQueueName(queue) else { return [] }
+		return (try? FileManager().contentsOfDirectory(atPath: compactionURL(for: key, suffix: "old").path)) ?? []
+	}
+	
+	/// Unlinks `names` from the directory `queue` replaced by `finishRebuild`, and the directory itself
+	/// once `names` ends the listing (`isLast`). They are extra links of live entries, so only directory
+	/// entries go away. Runs outside the actor.
+	/// - Returns: Number of files unlinked.
+	nonisolated func drainRetiredDirectory(of queue: String, names: ArraySlice<String>, isLast: Bool) -> Int {
+		let fileManager = FileManager()
+		guard let key = try? Self.normalizeQueueName(queue) else { return 0 }
+		let retired = compactionURL(for: key, suffix: "old")
+		var removed = 0
+		for name in names where (try? fileManager.removeItem(at: retired.appendingPathComponent(name))) != nil {
+			removed += 1
+		}
+		if isLast {
+			try? fileManager.removeItem(at: retired)
+		}
+		return removed
+	}
+	
+	/// Removes files left in `queue` by interrupted atomic writes (anything but `.json`, older than
+	/// `age` seconds). Such files belong to no index, so this runs outside the actor.
+	/// - Returns: Bytes reclaimed.
+	nonisolated func removeStaleTemporaryFiles(in queue: String, olderThan age: TimeInterval = 3_600, now: Date = Date()) -> Int64 {
+		let fileManager = FileManager()
+		guard let key = try? Self.normalizeQueueName(queue) else { return 0 }
+		let qurl = root.appendingPathComponent(key, isDirectory: true)
+		let keys: [URLResourceKey] = [.isRegularFileKey, .fileSizeKey, .contentModificationDateKey]
+		guard let urls = try? fileManager.contentsOfDirectory(at: qurl, includingPropertiesForKeys: keys) else { return 0 }
+		var reclaimed: Int64 = 0
+		for url in urls where url.pathExtension != "json" {
+			guard let values = try? url.resourceValues(forKeys: Set(keys)), values.isRegularFile == true,
+			      let modifiedAt = values.contentModificationDate, now.timeIntervalSince(modifiedAt) > age else { continue }
+			if (try? fileManager.removeItem(at: url)) != nil {
+				reclaimed += Int64(values.fileSize ?? 0)
+			}
+		}
+		return reclaimed
+	}
+	
+	/// Primary blob files of one `.blobs/<xx>` directory that no reference link points to any more
+	/// (left by a crash between the last release and the removal). Listed outside the actor; the
+	/// candidates are confirmed by `removeOrphanBlobs`.
+	nonisolated func orphanBlobCandidates() -> [[URL]] {
+		let fileManager = FileManager()
+		let area = root.appendingPathComponent(Self.blobDirectoryName, isDirectory: true)
+		guard let prefixes = try? fileManager.contentsOfDirectory(at: area, includingPropertiesForKeys: nil) else { return [] }
+		return prefixes.sorted { $0.lastPathComponent < $1.lastPathComponent }.map { prefix in
+			let names = (try? fileManager.contentsOfDirectory(atPath: prefix.path)) ?? []
+			return names.filter { !$0.contains(".") && !$0.hasPrefix(".") }.map { prefix.appendingPathComponent($0) }
+		}
+	}
+	
+	/// Deletes the blobs of `candidates` that still have no reference link. Retaining a blob writes it
+	/// and links it in the same actor turn, so a blob in use is never seen unreferenced here.
+	/// - Returns: Bytes reclaimed.
+	func removeOrphanBlobs(_ candidates: [URL]) -> Int64 {
+		var reclaimed: Int64 = 0
+		for url in candidates {
+			guard let attributes = try? fm.attributesOfItem(atPath: url.path),
+			      (attributes[.referenceCount] as? NSNumber)?.intValue == 1 else { continue }
+			let size = (attributes[.size] as? NSNumber)?.int64Value ?? 0
+			preserveForSnapshot(url)
+			if (try? fm.removeItem(at: url)) != nil {
+				reclaimed += size
+			}
+		}
+		return reclaimed
+	}
+	
+	/// Puts back a queue directory a crash left renamed away in the middle of a swap, and drops the rest
+	/// of the compaction area (copies being built, replaced directories).
+	private func recoverCompaction() {
+		let area = root.appendingPathComponent(Self.compactionDirectoryName, isDirectory: true)
+		guard let names = try? fm.contentsOfDirectory(atPath: area.path) else { return }
+		for name in names where name.hasSuffix(".old") {
+			let qurl = root.appendingPathComponent(String(name.dropLast(4)), isDirectory: true)
+			if !fm.fileExists(atPath: qurl.path) {
+				try? fm.moveItem(at: area.appendingPathComponent(name), to: qurl)
+				logger.warning("queue directory restored after an interrupted compaction", metadata: ["queue": .string(qurl.lastPathComponent)])
+			}
+		}
+		try? fm.removeItem(at: area)
+	}
+	
+	private nonisolated func compactionURL(for key: String, suffix: String) -> URL {
+		root.appendingPathComponent(Self.compactionDirectoryName, isDirectory: true).appendingPathComponent("\(key).\(suffix)", isDirectory: true)
+	}
+	
+	private static func fileSize(at url: URL) -> Int64 {
+		((try? FileManager.default.attributesOfItem(atPath: url.path))?[.size] as? NSNumber)?.int64Value ?? 0
+	}
+	
+	private static func fileNumber(at url: URL) -> UInt64? {
+		((try? FileManager.default.attributesOfItem(atPath: url.path))?[.systemFileNumber] as? NSNumber)?.uint64Value
+	}
+	
+	// MARK: - Snapshots
+	
+	/// Opens a snapshot: from now on the store records the paths it writes or removes, so the hidden
+	/// areas can be listed outside the actor (`listSnapshotFiles`) and corrected by the barrier.
+	func prepareSnapshot() throws {
+		guard pendingSnapshot == nil, snapshotTouched == nil else {
+			throw BoxStoreError.snapshotUnavailable("another snapshot is in progress")
+		}
+		snapshotTouched = []
+	}
+	
+	/// Lists the files of the hidden areas (cursor tables, mirror positions, delayed deliveries, blobs)
+	/// and creates their directories under `data`. Runs outside the actor, after `prepareSnapshot`.
+	nonisolated func listSnapshotFiles(into data: URL) throws -> BoxSnapshotListing {
+		let fileManager = FileManager()
+		var listing = BoxSnapshotListing()
+		// `.cursors/<queue>.json`, `.mirror/<node>.json`, `.scheduled/<queue>/<name>.json`, `.blobs/<xx>/<digest>[.<ref>]`.
+		for area in Self.snapshotAreas {
+			collectFiles(in: area.name, depth: area.depth, listing: &listing, fileManager: fileManager)
+		}
+		do {
+			try fileManager.createDirectory(at: data, withIntermediateDirectories: true)
+			for directory in listing.directories {
+				try fileManager.createDirectory(at: data.appendingPathComponent(directory, isDirectory: true), withIntermediateDirectories: true)
+			}
+		} catch {
+			throw BoxStoreError.io(error)
+		}
+		return listing
+	}
+	
+	/// Hidden areas copied by a snapshot, with the directory depth of their files.
+	private static let snapshotAreas: [(name: String, depth: Int)] = [
+		(cursorDirectoryName, 0), (mirrorDirectoryName, 0), (scheduledDirectoryName, 1), (blobDirectoryName, 1)
+	]
+	
+	/// Whether `name` is a file of a hidden area rather than a temporary file of an atomic write.
+	private static func isSnapshotFile(_ name: String, in area: String) -> Bool {
+		area == blobDirectoryName ? !name.hasPrefix(".") : name.hasSuffix(".json")
+	}
+	
+	/// Barrier of a point-in-time snapshot (SPECS §7.15): takes the queue entries from their indexes,
+	/// and the hidden-area files from `listing` corrected with the paths the store touched since
+	/// `prepareSnapshot`, which are the only ones checked on disk in this turn. Until `finishSnapshot`, a
+	/// listed file is linked into the snapshot before the store removes or replaces it, so the snapshot
+	/// holds exactly the files of this turn however long the linking takes.
+	/// - Returns: Paths relative to `root`, to pass to `continueSnapshot` in batches.
+	func beginSnapshot(into data: URL, listing: BoxSnapshotListing) throws -> [String] {
+		guard pendingSnapshot == nil, let touched = snapshotTouched else {
+			throw BoxStoreError.snapshotUnavailable("snapshot not prepared")
+		}
+		snapshotTouched = nil
+		var paths = listing.paths.filter { !touched.contains($0) }
+		var directories: Set<String> = []
+		do {
+			for queue in try fm.contentsOfDirectory(atPath: root.path) where !queue.hasPrefix(".") {
+				let qurl = root.appendingPathComponent(queue, isDirectory: true)
+				guard BoxQueueIndex.modificationDate(of: qurl) != nil else { continue }
+				directories.insert(queue)
+				paths += try queueIndex(for: qurl).entries.map { "\(queue)/\($0.name)" }
+			}
+			for path in touched {
+				let components = path.split(separator: "/").map(String.init)
+				guard let area = components.first, let name = components.last,
+				      let expected = Self.snapshotAreas.first(where: { $0.name == area }),
+				      components.count == expected.depth + 2,
+				      Self.isSnapshotFile(name, in: area),
+				      fm.fileExists(atPath: root.appendingPathComponent(path).path) else { continue }
+				paths.append(path)
+				directories.insert(components.dropLast().joined(separator: "/"))
+			}
+			for directory in directories.subtracting(listing.directories) {
+				try fm.createDirectory(at: data.appendingPathComponent(directory, isDirectory: true), withIntermediateDirectories: true)
+			}
+		} catch let error as BoxStoreError {
+			throw error
+		} catch {
+			throw BoxStoreError.io(error)
+		}
+		guard Self.volume(of: data) == Self.volume(of: root) else {
+			throw BoxStoreError.snapshotUnavailable("\(data.path) is not on the volume of the store")
+		}
+		pendingSnapshot = PendingSnapshot(data: data, pending: Set(paths))
+		logger.info("snapshot started", metadata: ["files": .stringConvertible(paths.count), "path": .string(data.path)])
+		return paths
+	}
+	
+	/// Lists the files of the hidden area `relative`, `depth` directory levels down.
+	private nonisolated func collectFiles(in relative: String, depth: Int, listing: inout BoxSnapshotListing, fileManager: FileManager, area: String? = nil) {
+		guard let names = try? fileManager.contentsOfDirectory(atPath: root.appendingPathComponent(relative, isDirectory: true).path) else { return }
+		listing.directories.insert(relative)
+		for name in names {
+			if depth > 0 {
+				collectFiles(in: "\(relative)/\(name)", depth: depth - 1, listing: &listing, fileManager: fileManager, area: area ?? relative)
+			} else if Self.isSnapshotFile(name, in: area ?? relative) {
+				listing.paths.append("\(relative)/\(name)")
+			}
+		}
+	}
+	
+	/// Links the files of `paths` not linked yet; only directory entries are written.
+	func continueSnapshot(paths: ArraySlice<String>) {
+		for path in paths {
+			linkIntoSnapshot(path)
+		}
+	}
+	
+	/// Ends the snapshot once every listed path went through `continueSnapshot`.
+	/// - Returns: Files and bytes linked, and the listed paths that vanished without going through the
+	///   store (removed by another process).
+	func finishSnapshot() throws -> (files: Int, bytes: Int64, missing: [String]) {
+		guard let snapshot = pendingSnapshot else { throw BoxStoreError.snapshotUnavailable("no snapshot in progress") }
+		pendingSnapshot = nil
+		if let failure = snapshot.failure {
+			throw BoxStoreError.io(failure)
+		}
+		logger.info("snapshot finished", metadata: ["files": .stringConvertible(snapshot.files), "bytes": .stringConvertible(snapshot.bytes)])
+		return (snapshot.files, snapshot.bytes, snapshot.missing + snapshot.pending.sorted())
+	}
+	
+	/// Abandons the snapshot in progress; the caller removes what was linked.
+	func cancelSnapshot() {
+		pendingSnapshot = nil
+		snapshotTouched = nil
+	}
+	
+	/// Links the store file at `url` into the pending snapshot if the snapshot still needs it, and notes
+	/// it for a barrier to come. Called before every write, removal or replacement of a store file.
+	private func preserveForSnapshot(_ url: URL) {
+		guard pendingSnapshot != nil || snapshotTouched != nil, url.path.hasPrefix(root.path + "/") else { return }
+		let path = String(url.path.dropFirst(root.path.count + 1))
+		snapshotTouched?.insert(path)
+		linkIntoSnapshot(path)
+	}
+	
+	private func linkIntoSnapshot(_ path: String) {
+		// Mutated in place: copying the snapshot would copy its pending set on every file.
+		guard let data = pendingSnapshot?.data, pendingSnapshot?.pending.remove(path) != nil else { return }
+		let source = root.appendingPathComponent(path)
+		do {
+			try fm.linkItem(at: source, to: data.appendingPathComponent(path))
+			pendingSnapshot?.files += 1
+			let attributes = try? fm.attributesOfItem(atPath: source.path)
+			let inode = (attributes?[.systemFileNumber] as? NSNumber)?.uint64Value
+			if inode.map({ pendingSnapshot?.inodes.insert($0).inserted ?? false }) ?? true {
+				pendingSnapshot?.bytes += (attributes?[.size] as? NSNumber)?.int64Value ?? 0
+			}
+		} catch {
+			if fm.fileExists(atPath: source.path) {
+				pendingSnapshot?.failure = error
+			} else {
+				pendingSnapshot?.missing.append(path)
+			}
+		}
+	}
+	
+	private static func volume(of url: URL) -> UInt64? {
+		((try? FileManager.default.attributesOfItem(atPath: url.path))?[.systemNumber] as? NSNumber)?.uint64Value
+	}
+	
+	// MARK: - Mirroring
+	
+	/// Opens the change feed of `queues` (SPECS §7.16), finishing a previous one. Changes are yielded
+	/// in the order they are made, after the write and without waiting for the reader.
+	func openChangeFeed(queues: Set<String>) -> AsyncStream<BoxStoreChange> {
+		changeFeed?.finish()
+		let (stream, continuation) = AsyncStream<BoxStoreChange>.makeStream()
+		changeFeed = continuation
+		fedQueues = queues
+		return stream
+	}
+	
+	/// Replaces the queues of the open change feed (configuration reload).
+	func setFedQueues(_ queues: Set<String>) {
+		fedQueues = queues
+	}
+	
+	func closeChangeFeed() {
+		changeFeed?.finish()
+		changeFeed = nil
+		fedQueues = []
+	}
+	
+	private func noteChange(_ change: BoxStoreChange) {
+		guard let changeFeed, fedQueues.contains(change.queue) else { return }
+		changeFeed.yield(change)
+	}
+	
+	/// Entry names of `queue` in name order, the starting point of a full mirror copy.
+	func mirrorListing(of queue: String) throws -> [String] {
+		let qurl = try queueHandle(queue).directory
+		guard fm.fileExists(atPath: qurl.path) else { return [] }
+		return try queueIndex(for: qurl).entries.map(\.name)
+	}
+	
+	/// Entry `name` of `queue` with its payload, `nil` once removed. The read cache is bypassed.
+	func mirrorObject(queue: String, name: String) -> BoxStoredObject? {
+		try? readObject(from: root.appendingPathComponent(queue, isDirectory: true).appendingPathComponent(name))
+	}
+	
+	/// Applies a batch shipped by the node `batch.source` to its copy of `batch.queue`, the queue
+	/// `<queue>@<source>` (SPECS §7.16). Entries keep the file names of the primary and a removal of a
+	/// missing file does nothing, so a batch applied twice leaves the copy unchanged.
+	/// - Returns: The position now applied, acknowledged to the primary (`nil` while a full copy is incomplete).
+	/// - Throws: `BoxStoreError.mirrorOutOfSync` when the batch does not follow that position (other
+	///   epoch, gap); the primary then starts a full copy.
+	func applyMirrorBatch(_ batch: BoxMirrorBatch) throws -> UInt64? {
+		let target = try sanitizeQueueName(BoxMirrorBatch.mirrorQueueName(of: batch.queue, source: batch.source))
+		let qurl = root.appendingPathComponent(target, isDirectory: true)
+		var positions = loadMirrorPositions(of: batch.source)
+		if batch.purge == true {
+			if fm.fileExists(atPath: qurl.path) {
+				try journaled(.purge(queue: target)) {
+					try purgeEntries(in: qurl)
+				}
+			}
+			positions[batch.queue] = BoxMirrorBatch.Position(epoch: batch.epoch, applied: nil)
+		}
+		guard var position = positions[batch.queue], position.epoch == batch.epoch else {
+			throw BoxStoreError.mirrorOutOfSync(batch.queue)
+		}
+		try ensureDirectoryExists(qurl)
+		if let first = batch.first, let last = batch.last {
+			guard let applied = position.applied, first <= applied + 1 else {
+				throw BoxStoreError.mirrorOutOfSync(batch.queue)
+			}
+			guard last > applied else { return applied }
+			for entry in batch.entries where entry.seq > applied {
+				try applyMirrorEntry(entry, in: qurl)
+			}
+			position.applied = last
+		} else {
+			// A copy batch sent again after the copy completed (lost acknowledgement) is ignored.
+			if let applied = position.applied { return applied }
+			for entry in batch.entries {
+				try applyMirrorEntry(entry, in: qurl)
+			}
+			position.applied = batch.base
+		}
+		positions[batch.queue] = position
+		try saveMirrorPositions(positions, of: batch.source)
+		return position.applied
+	}
+	
+	private func applyMirrorEntry(_ entry: BoxMirrorBatch.Entry, in qurl: URL) throws {
+		let url = qurl.appendingPathComponent(entry.name)
+		// Names come from another node: only plain entry file names are accepted.
+		guard entry.name.hasSuffix(".json"), !entry.name.hasPrefix("."), !entry.name.contains("/") else {
+			throw BoxStoreError.corrupted(url)
+		}
+		if let object = entry.object {
+			guard let stored = object.storedObject else { throw BoxStoreError.corrupted(url) }
+			try storeEntry(stored, named: entry.name, in: qurl)
+		} else if entry.removed == true, fm.fileExists(atPath: url.path) {
+			let previousModification = BoxQueueIndex.modificationDate(of: qurl)
+			try removeEntryFile(at: url)
+			recordMutation(in: qurl, previousModification: previousModification) { $0.remove(named: entry.name) }
+		}
+	}
+	
+	private func mirrorPositionsURL(of source: UUID) -> URL {
+		root.appendingPathComponent(Self.mirrorDirectoryName, isDirectory: true)
+			.appendingPathComponent("\(source.uuidString).json")
+	}
+	
+	/// Positions applied for `source`. An unreadable file counts as empty: every mirror of that node
+	/// is then copied again.
+	private func loadMirrorPositions(of source: UUID) -> [String: BoxMirrorBatch.Position] {
+		if let cached = mirrorPositions[source] { return cached }
+		let positions = (try? Data(contentsOf: mirrorPositionsURL(of: source)))
+			.flatMap { try? decoder.decode([String: BoxMirrorBatch.Position].self, from: $0) } ?? [:]
+		mirrorPositions[source] = positions
+		return positions
+	}
+	
+	private func saveMirrorPositions(_ positions: [String: BoxMirrorBatch.Position], of source: UUID) throws {
+		let url = mirrorPositionsURL(of: source)
+		try ensureDirectoryExists(url.deletingLastPathComponent())
+		try atomicWrite(data: try encoder.encode(positions), to: url)
+		mirrorPositions[source] = positions
+	}
+	
+	// MARK: - Manifest
+	
+	/// Adopts the indexes saved in `<root>/.manifest`; each one is checked against its directory date on
+	/// first use like any cached index, so queues changed while the server was down are listed again.
+	private func loadManifest() {
+		guard let manifest = BoxStoreManifest.load(from: root) else { return }
+		for (key, var index) in manifest.queues {
+			index.generation = nextIndexGeneration()
+			indexes[key] = index
+		}
+		restoredLocations = manifest.locations
+		logger.info("manifest loaded", metadata: [
+			"queues": .stringConvertible(manifest.queues.count),
+			"savedAt": .string(ISO8601DateFormatter().string(from: manifest.savedAt))
+		])
+	}
+	
+	/// Hands over the Location Service index read from the manifest, once.
+	func takeRestoredLocations() -> BoxStoreManifest.Locations? {
+		defer { restoredLocations = nil }
+		return restoredLocations
+	}
+	
+	/// Copies the indexes still in sync with their directory, for `BoxStoreManifest.save(to:)`.
+	/// The copies share storage with the live indexes, so this costs one stat per queue.
+	/// - Parameter locations: Location Service index saved alongside.
+	/// - Returns: The manifest and the index generation it reflects.
+	func manifestSnapshot(locations: BoxStoreManifest.Locations?) -> (manifest: BoxStoreManifest, generation: UInt64) {
+		var queues: [String: BoxQueueIndex] = [:]
+		for (key, index) in indexes {
+			guard let recorded = index.directoryModifiedAt,
+			      recorded == BoxQueueIndex.modificationDate(of: root.appendingPathComponent(key, isDirectory: true)) else { continue }
+			queues[key] = index
+		}
+		return (BoxStoreManifest(savedAt: Date(), queues: queues, locations: locations), indexGeneration)
+	}
+	
+	// MARK: - Journal
+	
+	private typealias BlobLink = BoxStoreJournal.BlobLink
+	
+	/// Runs `operation` under `intent`, unless it is a single atomic file change, and marks it complete.
+	///
+	/// A completion mark that cannot be written fails the operation: its changes are made, but the
+	/// journal still shows it open and the next start completes it again. When `operation` itself
+	/// throws, its error is the one reported and an unwritten mark is left to recovery as well.
+	private func journaled<T>(_ intent: BoxStoreJournal.Intent, _ operation: () throws -> T) throws -> T {
+		guard intent.needsJournal else { return try operation() }
+		let id = try journal.begin(intent)
+		let result: T
+		do {
+			result = try operation()
+		} catch {
+			try? journal.end(id)
+			throw error
+		}
+		try journal.end(id)
+		return result
+	}
+	
+	/// Completes the intents a previous run left open, then empties the journal.
+	private func recoverJournal() {
+		let intents = journal.recovered
+		for intent in intents {
+			switch intent {
+				case let .put(path, blob, replaced):
+					// Whichever link the entry does not hold (the write landed or not) is released.
+					let held = blobReference(ofFileAt: root.appendingPathComponent(path))
+					for link in [blob, replaced].compactMap({ $0 }) where link != held {
+						releaseBlob(link.digest, ref: link.ref)
+					}
+				case let .remove(paths, blobs):
+					for path in paths {
+						let url = root.appendingPathComponent(path)
+						// Untimestamped queues reuse names: a file rewritten since holds another link and stays.
+						if let held = blobReference(ofFileAt: url), !blobs.contains(held) { continue }
+						try? fm.removeItem(at: url)
+					}
+					// Only links still present are released: the others went before the crash.
+					for link in blobs where fm.fileExists(atPath: blobReferenceURL(for: link.digest, ref: link.ref).path) {
+						releaseBlob(link.digest, ref: link.ref)
+					}
+				case .purge(let queue):
+					let qurl = root.appendingPathComponent(queue, isDirectory: true)
+					if fm.fileExists(atPath: qurl.path) {
+						do {
+							try purgeEntries(in: qurl)
+						} catch {
+							logger.error("purge recovery failed", metadata: ["queue": .string(queue), "error": .string("\(error)")])
+						}
+					}
+			}
+		}
+		// Also drops a line torn by the crash, which would otherwise swallow the next record.
+		journal.checkpoint()
+		if !intents.isEmpty {
+			logger.info("journal recovered", metadata: ["intents": .stringConvertible(intents.count)])
+		}
+	}
+	
+	/// Path of `url` relative to the store root, as recorded in the journal.
+	private func journalPath(of url: URL) -> String {
+		let base = root.path.hasSuffix("/") ? root.path : root.path + "/"
+		return url.path.hasPrefix(base) ? String(url.path.dropFirst(base.count)) : url.lastPathComponent
+	}
+	
+	// MARK: - Blobs
+	
+	/// Number of hard links to the blob with `digest` besides its primary file (0 when not stored as a
+	/// blob): one per queue entry sharing the payload, plus one per link a snapshot (§7.15) holds on the
+	/// blob or on one of its reference files. Snapshots live outside the store and are not tracked, so
+	/// the two cannot be told apart: without snapshots on the volume this is the number of entries.
+	/// Otherwise a blob held by a snapshot outlives its last entry until the snapshot is deleted, then
+	/// the compaction orphan sweep reclaims it.
+	public func blobReferenceCount(for digest: BoxContentDigest) -> Int {
+		let attributes = try? fm.attributesOfItem(atPath: blobURL(for: digest).path)
+		guard let links = attributes?[.referenceCount] as? NSNumber else { return 0 }
+		return max(0, links.intValue - 1)
+	}
+	
+	/// Stores `data` under `digest` unless already present and adds the reference link `ref`.
+	/// - Returns: `ref`, recorded in the queue entry.
+	private func retainBlob(_ digest: BoxContentDigest, data: [UInt8], ref: UUID) throws -> UUID {
+		let primary = blobURL(for: digest)
+		do {
+			try ensureDirectoryExists(primary.deletingLastPathComponent())
+			if !fm.fileExists(atPath: primary.path) {
+				preserveForSnapshot(primary)
+				try Data(data).write(to: primary, options: .atomic)
+			}
+			let reference = blobReferenceURL(for: digest, ref: ref)
+			preserveForSnapshot(reference)
+			try fm.linkItem(at: primary, to: reference)
+		} catch {
+			throw BoxStoreError.io(error)
+		}
+		return ref
+	}
+	
+	/// Drops one reference and deletes the blob once no queue entry points to it anymore.
+	private func releaseBlob(_ digest: BoxContentDigest, ref: UUID) {
+		let reference = blobReferenceURL(for: digest, ref: ref)
+		preserveForSnapshot(reference)
+		try? fm.removeItem(at: reference)
+		if blobReferenceCount(for: digest) == 0 {
+			let primary = blobURL(for: digest)
+			preserveForSnapshot(primary)
+			try? fm.removeItem(at: primary)
+		}
+	}
+	
+	/// Reads the blob reference held by the queue file at `url`, if any.
+	///
+	/// Files larger than `descriptorSizeLimit` are inline by construction and are not opened.
+	private func blobReference(ofFileAt url: URL, size: Int64? = nil) -> BlobLink? {
+		let fileSize = size ?? (try? url.resourceValues(forKeys: [.fileSizeKey]))?.fileSize.map { Int64($0) }
+		guard let fileSize, fileSize <= Int64(Self.descriptorSizeLimit) else { return nil }
+		return (try? readDiskMessage(from: url))?.blobLink
+	}
+	
+	/// Unlinks a queue file and releases its blob reference.
+	private func removeEntryFile(at url: URL, size: Int64? = nil) throws {
+		try unlinkEntry(at: url, reference: blobReference(ofFileAt: url, size: size))
+	}
+	
+	/// Unlinks a queue file whose blob reference is already known; both steps form one journal intent.
+	private func unlinkEntry(at url: URL, reference: BlobLink?) throws {
+		try journaled(.remove(paths: [journalPath(of: url)], blobs: reference.map { [$0] } ?? [])) {
+			preserveForSnapshot(url)
+			try fm.removeItem(at: url)
+			let queue = url.deletingLastPathComponent().lastPathComponent
+			readCache.removeValue(for: BoxReadCache.Key(queue: queue, name: url.lastPathComponent))
+			forgetLease(of: url.lastPathComponent, in: queue)
+			if let reference { releaseBlob(reference.digest, ref: reference.ref) }
+			noteChange(.removed(queue: queue, name: url.lastPathComponent))
+		}
+	}
+	
+	/// Unlinks several queue files of `qurl` under a single journal intent. Delayed deliveries are neither
+	/// cached nor mirrored: their removal is not `announced`.
+	/// - Returns: Names actually removed; failures are logged with `failure` and skipped.
+	private func removeEntryFiles(_ files: [(name: String, size: Int64?)], in qurl: URL, failure: Logger.Message, announced: Bool = true) throws -> [String] {
+		let urls = files.map { qurl.appendingPathComponent($0.name) }
+		let references = zip(urls, files).map { blobReference(ofFileAt: $0, size: $1.size) }
+		return try journaled(.remove(paths: urls.map(journalPath(of:)), blobs: references.compactMap { $0 })) {
+			var removed: [String] = []
+			for (url, reference) in zip(urls, references) {
+				do {
+					preserveForSnapshot(url)
+					try fm.removeItem(at: url)
+				} catch {
+					logger.warning(failure, metadata: ["queue": .string(qurl.lastPathComponent), "file": .string(url.lastPathComponent), "error": .string("\(error)")])
+					continue
+				}
+				if let reference { releaseBlob(reference.digest, ref: reference.ref) }
+				if announced {
+					readCache.removeValue(for: BoxReadCache.Key(queue: qurl.lastPathComponent, name: url.lastPathComponent))
+					forgetLease(of: url.lastPathComponent, in: qurl.lastPathComponent)
+					noteChange(.removed(queue: qurl.lastPathComponent, name: url.lastPathComponent))
+				}
+				removed.append(url.lastPathComponent)
+			}
+			return removed
+		}
+	}
+	
+	private func blobURL(for digest: BoxContentDigest) -> URL {
+		let hex = digest.hex
+		return root
+			.appendingPathComponent(Self.blobDirectoryName, isDirectory: true)
+			.appendingPathComponent(String(hex.prefix(2)), isDirectory: true)
+			.appendingPathComponent(hex)
+	}
+	
+	private func blobReferenceURL(for digest: BoxContentDigest, ref: UUID) -> URL {
+		let primary = blobURL(for: digest)
+		return primary.deletingLastPathComponent().appendingPathComponent("\(primary.lastPathComponent).\(ref.uuidString)")
+	}
+	
 	// MARK: - Helpers
 	
+	/// SHA-256 of the content of `object`, decoded first when it is compressed (SPECS §7.9). A digest sent
+	/// along with the object (PUT, mirror batch) is never trusted: digests name blobs and match DELETE targets.
+	/// - Throws: `BoxStoreError.corrupted(url)` when the compressed payload does not decode.
+	private static func contentDigest(of object: BoxStoredObject, at url: URL) throws -> BoxContentDigest {
+		guard object.encoding != .identity else { return BoxContentDigest(of: object.data) }
+		guard let plain = try? BoxCompression.decode(object.data, encoding: object.encoding) else {
+			throw BoxStoreError.corrupted(url)
+		}
+		return BoxContentDigest(of: plain)
+	}
+	
+	/// Digest naming the blob of `object`: its content digest, or the digest of the stored bytes when
+	/// they are compressed.
+	private static func blobKey(of object: BoxStoredObject, digest: BoxContentDigest) -> BoxContentDigest {
+		object.encoding == .identity ? digest : BoxContentDigest(of: object.data)
+	}
+	
+	/// Encodes the queue file of `object`, moving its payload to the blob area under `blobRef` when set
+	/// (callers reserve it for payloads of at least `blobThreshold` bytes and journal it first).
+	/// The caller owns the returned blob reference and must release it if the file is not written.
+	private func encodeEntry(_ object: BoxStoredObject, digest: BoxContentDigest, blob: BoxContentDigest, blobRef reserved: UUID?) throws -> (data: Data, blobRef: UUID?) {
+		var blobRef = try reserved.map { try retainBlob(blob, data: object.data, ref: $0) }
+		var data = try encoder.encode(makeDiskMessage(object, digest: digest, blob: blob, blobRef: blobRef))
+		if let ref = blobRef, data.count > Self.descriptorSizeLimit {
+			// Oversized metadata: keep the payload inline so the descriptor size rule holds.
+			releaseBlob(blob, ref: ref)
+			blobRef = nil
+			data = try encoder.encode(makeDiskMessage(object, digest: digest, blob: blob, blobRef: nil))
+		}
+		return (data, blobRef)
+	}
+	
+	private func makeDiskMessage(_ object: BoxStoredObject, digest: BoxContentDigest, blob: BoxContentDigest, blobRef: UUID?) -> DiskMessage {
+		DiskMessage(
+			id: object.id,
+			contentType: object.contentType,
+			content: blobRef == nil ? Data(object.data).base64EncodedString() : nil,
+			createdAt: object.createdAt,
+			nodeId: object.nodeId,
+			userId: object.userId,
+			userMetadata: object.userMetadata,
+			digest: digest,
+			blobRef: blobRef,
+			priority: object.priority > 0 ? object.priority : nil,
+			encoding: object.encoding == .identity ? nil : object.encoding.name,
+			blobDigest: blobRef != nil && blob != digest ? blob : nil
+		)
+	}
+	
 	private func readObject(from url: URL) throws -> BoxStoredObject {
+		try materialize(try readDiskMessage(from: url), from: url)
+	}
+	
+	/// Reads the queue file at `url` through the read cache.
+	private func cachedObject(at url: URL) throws -> BoxStoredObject {
+		let key = BoxReadCache.Key(queue: url.deletingLastPathComponent().lastPathComponent, name: url.lastPathComponent)
+		if let cached = readCache.object(for: key) {
+			return cached
+		}
+		let object = try readObject(from: url)
+		readCache.insert(object, for: key)
+		return object
+	}
+	
+	/// Reads the queue file at `url`.
+	/// - Throws: `objectNotFound` when the file is gone (removed since it was indexed), `corrupted` when
+	///   it does not decode, `io` for any other read failure.
+	private func readDiskMessage(from url: URL) throws -> DiskMessage {
+		let data: Data
 		do {
-			let data = try Data(contentsOf: url)
-			let disk = try decoder.decode(DiskMessage.self, from: data)
-			guard let raw = Data(base64Encoded: disk.content) else { throw BoxStoreError.corrupted(url) }
-			return BoxStoredObject(
-				id: disk.id,
-				contentType: disk.contentType,
-				data: [UInt8](raw),
-				createdAt: disk.createdAt,
-				nodeId: disk.nodeId,
-				userId: disk.userId,
-				userMetadata: disk.userMetadata
-			)
-		} catch let e as BoxStoreError {
-			throw e
+			data = try Data(contentsOf: url)
 		} catch {
+			let nsError = error as NSError
+			let missing = (nsError.domain == NSCocoaErrorDomain && (nsError.code == NSFileReadNoSuchFileError || nsError.code == NSFileNoSuchFileError))
+				|| (nsError.domain == NSPOSIXErrorDomain && nsError.code == Int(POSIXError.Code.ENOENT.rawValue))
+			if missing, let id = BoxQueueIndex.identifier(fromFileName: url.lastPathComponent) {
+				throw BoxStoreError.objectNotFound(id)
+			}
 			throw BoxStoreError.io(error)
 		}
+		guard let disk = try? decoder.decode(DiskMessage.self, from: data) else {
+			throw BoxStoreError.corrupted(url)
+		}
+		return disk
+	}
+	
+	/// Resolves the payload of `disk`, inline or from the blob area.
+	private func materialize(_ disk: DiskMessage, from url: URL) throws -> BoxStoredObject {
+		let payload: [UInt8]
+		if let content = disk.content {
+			guard let raw = Data(base64Encoded: content) else { throw BoxStoreError.corrupted(url) }
+			payload = [UInt8](raw)
+		} else if let digest = disk.blobKey, let ref = disk.blobRef,
+				  let raw = (try? Data(contentsOf: blobURL(for: digest))) ?? (try? Data(contentsOf: blobReferenceURL(for: digest, ref: ref))) {
+			// The reference link holds the same inode, so it still resolves if the primary name is gone.
+			payload = [UInt8](raw)
+		} else {
+			throw BoxStoreError.corrupted(url)
+		}
+		return BoxStoredObject(
+			id: disk.id,
+			contentType: disk.contentType,
+			data: payload,
+			createdAt: disk.createdAt,
+			nodeId: disk.nodeId,
+			userId: disk.userId,
+			userMetadata: disk.userMetadata,
+			digest: disk.digest,
+			priority: disk.priority ?? 0,
+			encoding: try payloadEncoding(of: disk, at: url)
+		)
+	}
+	
+	private func payloadEncoding(of disk: DiskMessage, at url: URL) throws -> BoxCodec.PayloadEncoding {
+		guard let name = disk.encoding else { return .identity }
+		guard let encoding = BoxCodec.PayloadEncoding(name: name) else { throw BoxStoreError.corrupted(url) }
+		return encoding
 	}
 	
 	private func peekMeta(from url: URL) throws -> (id: UUID, createdAt: Date) {
@@ -305,26 +2155,20 @@ public actor BoxServerStore {
 	}
 	
 	private func findFileURL(for id: UUID, in qurl: URL) throws -> URL {
-		let upperID = id.uuidString.uppercased()
-		let exactPattern = "\(upperID).JSON"
-		let suffixPattern = "-\(exactPattern)"
-		let files = try fm.contentsOfDirectory(at: qurl, includingPropertiesForKeys: nil)
-		if let match = files.first(where: {
-			let name = $0.lastPathComponent.uppercased()
-			return name == exactPattern || name.hasSuffix(suffixPattern)
-		}) {
-			return match
+		if let name = try queueIndex(for: qurl).name(for: id) {
+			return qurl.appendingPathComponent(name)
 		}
 		throw BoxStoreError.objectNotFound(id)
 	}
 	
-	private func ensureDirectoryExists(_ url: URL) async throws {
+	private func ensureDirectoryExists(_ url: URL) throws {
 		if !fm.fileExists(atPath: url.path) {
 			try fm.createDirectory(at: url, withIntermediateDirectories: true)
 		}
 	}
 	
 	private func atomicWrite(data: Data, to url: URL) throws {
+		preserveForSnapshot(url)
 		do {
 			try data.write(to: url, options: .atomic)
 		} catch {
@@ -333,8 +2177,12 @@ public actor BoxServerStore {
 	}
 	
 	private func sanitizeQueueName(_ name: String) throws -> String {
+		try queueHandle(name).name
+	}
+	
+	private func queueHandle(_ name: String) throws -> BoxQueueHandle {
 		do {
-			return try Self.normalizeQueueName(name)
+			return try queueHandles.handle(for: name)
 		} catch {
 			if case BoxStoreError.invalidQueueName = error {
 				logger.warning("invalid queue name", metadata: ["name": .string(name)])
@@ -349,33 +2197,58 @@ public actor BoxServerStore {
 			while n.hasPrefix("/") { n.removeFirst() }
 		}
 		let invalid = CharacterSet(charactersIn: "/:\\\\?%*|\\\"<>")
-		guard !n.isEmpty, n.rangeOfCharacter(from: invalid) == nil else {
+		// Names starting with "." are reserved for store internals (`.blobs`).
+		guard !n.isEmpty, !n.hasPrefix("."), n.rangeOfCharacter(from: invalid) == nil else {
 			throw BoxStoreError.invalidQueueName(name)
 		}
 		return n
 	}
 
-	private func makeFilename(for object: BoxStoredObject, queue: String) -> String {
-        let queuesWithoutTimestamp = ["uuid", "whoswho"]
-        if queuesWithoutTimestamp.contains(where: { queue.caseInsensitiveCompare($0) == .orderedSame }) {
+	/// Queues whose entries are named by id alone (one entry per id, overwritten by a new PUT).
+	private static let queuesWithoutTimestamp = ["uuid", "whoswho"]
+	
+	/// Whether entries of `queue` carry a timestamp prefix, which gives their age order.
+	static func isTimestamped(queue: String) -> Bool {
+		!queuesWithoutTimestamp.contains(where: { queue.caseInsensitiveCompare($0) == .orderedSame })
+	}
+	
+	/// Builds the queue file name; `visibleAt` overrides the timestamp of delayed deliveries so they sort
+	/// at their delivery date.
+	private func makeFilename(for object: BoxStoredObject, queue: String, visibleAt: Date? = nil) -> String {
+        if !Self.isTimestamped(queue: queue) {
             return "\(object.id.uuidString).json"
         }
-		let ts = iso8601BasicUTC(object.createdAt)
+		let ts: String
+		if let visibleAt {
+			ts = BoxQueueIndex.timestampPrefix(microseconds: BoxQueueIndex.microseconds(of: visibleAt))
+		} else {
+			ts = BoxQueueIndex.timestampPrefix(microseconds: nextStamp(for: BoxQueueIndex.microseconds(of: object.createdAt), in: queue))
+		}
+		if object.priority > 0 {
+			// The priority marker keeps the timestamp first, so names still sort by age.
+			return "\(ts)-p\(object.priority)-\(object.id.uuidString).json"
+		}
 		return "\(ts)-\(object.id.uuidString).json"
 	}
 	
-	private func iso8601BasicUTC(_ date: Date) -> String {
-		// 20251017T143015Z (trisable lexicalement)
-		var cal = Calendar(identifier: .iso8601)
-		cal.timeZone = TimeZone(secondsFromGMT: 0)!
-		let comps = cal.dateComponents([.year,.month,.day,.hour,.minute,.second], from: date)
-		let y = String(format: "%04d", comps.year ?? 0)
-		let m = String(format: "%02d", comps.month ?? 0)
-		let d = String(format: "%02d", comps.day ?? 0)
-		let H = String(format: "%02d", comps.hour ?? 0)
-		let M = String(format: "%02d", comps.minute ?? 0)
-		let S = String(format: "%02d", comps.second ?? 0)
-		return "\(y)\(m)\(d)T\(H)\(M)\(S)Z"
+	/// Hybrid logical clock of `queue`: the creation time in microseconds, moved to just after the last
+	/// stamp of the queue when it is not later by up to a second (same microsecond, PUTs reaching the
+	/// store out of order, clock stepped back). Names then follow arrival order at any rate. An object
+	/// dated further back keeps its own date and sorts by age. The clock starts from the newest name.
+	private func nextStamp(for microseconds: Int64, in queue: String) -> Int64 {
+		let last = queueClocks[queue] ?? newestStamp(in: queue)
+		var stamp = microseconds
+		if let last, stamp <= last, last - stamp < 1_000_000 {
+			stamp = last + 1
+		}
+		queueClocks[queue] = max(stamp, last ?? stamp)
+		return stamp
+	}
+	
+	private func newestStamp(in queue: String) -> Int64? {
+		let qurl = root.appendingPathComponent(queue, isDirectory: true)
+		guard let newest = (try? queueIndex(for: qurl))?.entries.last, newest.isTimestamped else { return nil }
+		return BoxQueueIndex.microseconds(of: newest.createdAt)
 	}
 }
 
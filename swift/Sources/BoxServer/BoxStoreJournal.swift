@@ -0,0 +1,218 @@
+import BoxCore
+import Foundation
+
+#if os(Linux)
+import Glibc
+#elseif canImport(Darwin)
+import Darwin
+#endif
+
+/// Write-ahead journal of the store operations that touch several files (SPECS §7.11).
+///
+/// Such an operation records its intent before its first change and a completion mark after its
+/// last one. An intent describes an end state that is safe to reach again, so at startup
+/// `BoxServerStore` completes the intents a crash left open: recovery reads the journal tail instead
+/// of scanning queues. Records are JSON lines appended to `<root>/.journal`; a torn last line
+/// (crash during an append) is ignored. The file is truncated once no intent is open and it grew
+/// past `checkpointSize`, so the tail stays short.
+///
+/// One store instance per root owns `.journal`: the one holding an exclusive lock on it. Any other
+/// live instance on the same root (a tool, a test) journals to a sidecar `.journal-<uuid>` it locks
+/// the same way, so it never replays nor truncates intents the owner still has open. A sidecar whose
+/// lock can be taken belongs to an instance that is gone: the next instance to open replays it, then
+/// removes it at its first checkpoint.
+struct BoxStoreJournal {
+    /// Journal file name under the store root. Hidden, so never listed as a queue.
+    static let fileName = ".journal"
+    /// Name prefix of the sidecar journals of instances that do not own `fileName`.
+    static let sidecarPrefix = ".journal-"
+    /// Suffix of a sidecar being created, before it is locked and renamed.
+    private static let stagingSuffix = ".open"
+    /// Size past which the journal is truncated as soon as no intent is open.
+    static let checkpointSize = 256 * 1024
+
+    /// Reference link `<digest>.<ref>` held on a blob by one queue entry.
+    struct BlobLink: Codable, Hashable, Sendable {
+        let digest: BoxContentDigest
+        let ref: UUID
+    }
+
+    /// End state of a multi-file operation. Paths are relative to the store root.
+    enum Intent: Codable, Equatable, Sendable {
+        /// The entry at `path` is written with `blob` (if any), replacing an entry holding `replaced`.
+        /// Recovery keeps the link the file ends up holding and releases the other one.
+        case put(path: String, blob: BlobLink?, replaced: BlobLink?)
+        /// Every file of `paths` is unlinked and every link of `blobs` released.
+        case remove(paths: [String], blobs: [BlobLink])
+        /// Every entry of `queue` is removed.
+        case purge(queue: String)
+
+        /// Whether the operation needs a record: a lone write or unlink is already atomic.
+        var needsJournal: Bool {
+            switch self {
+            case let .put(_, blob, replaced):
+                return blob != nil || replaced != nil
+            case let .remove(paths, blobs):
+                return paths.count > 1 || !blobs.isEmpty
+            case .purge:
+                return true
+            }
+        }
+    }
+
+    private struct Record: Codable {
+        let id: UUID
+        /// `nil` marks the completion of intent `id`.
+        let intent: Intent?
+    }
+
+    private let handle: FileHandle
+    /// Whether this instance owns `fileName` rather than a sidecar.
+    let isOwner: Bool
+    /// Sidecars of instances that are gone, held locked until their intents are completed.
+    private var adopted: [(url: URL, handle: FileHandle)] = []
+    private let encoder = JSONEncoder()
+    /// Intents begun by this instance and not completed yet.
+    private var openIntents: Set<UUID> = []
+    /// Bytes in the journal file, as far as this instance knows.
+    private var size: Int
+    /// Intents found open when the journal was opened, oldest first.
+    private(set) var recovered: [Intent]
+
+    /// Opens the journal of the store rooted at `root`, creating both if needed, and reads the intents
+    /// a previous run left open: in `.journal` when this instance owns it, and in the sidecars of
+    /// instances that are gone.
+    init(root: URL) throws {
+        let fm = FileManager.default
+        let url = root.appendingPathComponent(Self.fileName)
+        do {
+            try fm.createDirectory(at: root, withIntermediateDirectories: true)
+            if !fm.fileExists(atPath: url.path) {
+                fm.createFile(atPath: url.path, contents: nil)
+            }
+            let primary = try FileHandle(forUpdating: url)
+            var recovered: [Intent] = []
+            if Self.tryLock(primary) {
+                handle = primary
+                isOwner = true
+                let contents = try Data(contentsOf: url)
+                recovered = Self.unfinishedIntents(in: contents)
+                size = contents.count
+            } else {
+                try primary.close()
+                handle = try Self.createSidecar(in: root)
+                isOwner = false
+                size = 0
+            }
+            var adopted: [(url: URL, handle: FileHandle)] = []
+            let names = try fm.contentsOfDirectory(atPath: root.path).filter {
+                $0.hasPrefix(Self.sidecarPrefix) && !$0.hasSuffix(Self.stagingSuffix)
+            }
+            for name in names.sorted() {
+                let sidecar = root.appendingPathComponent(name)
+                guard let other = try? FileHandle(forUpdating: sidecar) else { continue }
+                guard Self.tryLock(other) else {
+                    try? other.close()
+                    continue
+                }
+                recovered += Self.unfinishedIntents(in: (try? Data(contentsOf: sidecar)) ?? Data())
+                adopted.append((url: sidecar, handle: other))
+            }
+            self.adopted = adopted
+            self.recovered = recovered
+        } catch {
+            throw BoxStoreError.io(error)
+        }
+        encoder.outputFormatting = [.withoutEscapingSlashes, .sortedKeys]
+    }
+
+    /// Intents of `contents` without a completion mark, oldest first. A torn line is skipped.
+    private static func unfinishedIntents(in contents: Data) -> [Intent] {
+        var order: [UUID] = []
+        var pending: [UUID: Intent] = [:]
+        let decoder = JSONDecoder()
+        for line in contents.split(separator: UInt8(ascii: "\n")) {
+            guard let record = try? decoder.decode(Record.self, from: Data(line)) else { continue }
+            if let intent = record.intent {
+                order.append(record.id)
+                pending[record.id] = intent
+            } else {
+                pending.removeValue(forKey: record.id)
+            }
+        }
+        return order.compactMap { pending[$0] }
+    }
+
+    /// Creates and locks a sidecar journal. It is locked under a staging name first, so another
+    /// instance never adopts it in between.
+    private static func createSidecar(in root: URL) throws -> FileHandle {
+        let fm = FileManager.default
+        let name = Self.sidecarPrefix + UUID().uuidString.lowercased()
+        let staging = root.appendingPathComponent(name + Self.stagingSuffix)
+        fm.createFile(atPath: staging.path, contents: nil)
+        let handle = try FileHandle(forUpdating: staging)
+        guard tryLock(handle) else {
+            throw CocoaError(.fileLocking)
+        }
+        try fm.moveItem(at: staging, to: root.appendingPathComponent(name))
+        return handle
+    }
+
+    /// Takes the exclusive lock of `handle` without waiting; `false` when another instance holds it.
+    private static func tryLock(_ handle: FileHandle) -> Bool {
+        #if os(Windows)
+        return true
+        #else
+        return flock(handle.fileDescriptor, LOCK_EX | LOCK_NB) == 0
+        #endif
+    }
+
+    /// Records `intent` before its first change.
+    /// - Returns: Identifier to pass to `end` once the operation is complete.
+    mutating func begin(_ intent: Intent) throws -> UUID {
+        let id = UUID()
+        try append(Record(id: id, intent: intent))
+        openIntents.insert(id)
+        return id
+    }
+
+    /// Marks intent `id` complete and truncates the journal when it is due for a checkpoint.
+    /// - Throws: `BoxStoreError.io` when the mark cannot be written. The intent is then left open on
+    ///   disk, and the next start reaches its end state again.
+    mutating func end(_ id: UUID) throws {
+        openIntents.remove(id)
+        try append(Record(id: id, intent: nil))
+        if openIntents.isEmpty && size >= Self.checkpointSize {
+            checkpoint()
+        }
+    }
+
+    /// Empties the journal and removes the adopted sidecars; only called when no intent of this
+    /// instance is open.
+    mutating func checkpoint() {
+        do {
+            try handle.truncate(atOffset: 0)
+            size = 0
+        } catch {
+            // Kept as is: completed intents are simply read again at the next start.
+        }
+        for sidecar in adopted {
+            try? FileManager.default.removeItem(at: sidecar.url)
+            try? sidecar.handle.close()
+        }
+        adopted = []
+        recovered = []
+    }
+
+    private mutating func append(_ record: Record) throws {
+        do {
+            var line = try encoder.encode(record)
+            line.append(UInt8(ascii: "\n"))
+            try handle.seekToEnd()
+            try handle.write(contentsOf: line)
+            size += line.count
+        } catch {
+            throw BoxStoreError.io(error)
+        }
+    }
+}
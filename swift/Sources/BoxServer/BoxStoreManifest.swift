@@ -0,0 +1,107 @@
+import BoxCore
+import Foundation
+
+/// Snapshot of the store indexes saved in `<root>/.manifest` on clean shutdown and periodically
+/// (SPECS §7.12).
+///
+/// At startup `BoxServerStore` reads the file once and adopts every queue index as is. Each one keeps
+/// the directory modification date it was saved with, so the usual check on first access
+/// (`queueIndex(for:)`) rebuilds only the queues that changed while the server was down. The Location
+/// Service index rides along and is validated the same way against the `whoswho` directory.
+/// A missing, unreadable or older-format file simply means a cold start.
+struct BoxStoreManifest: Sendable {
+    /// Manifest file name under the store root. Hidden, so never listed as a queue.
+    static let fileName = ".manifest"
+    /// Format version; a file with another version is ignored.
+    static let formatVersion = 2
+
+    /// Decoded Location Service records, valid while `whoswho` keeps `directoryModifiedAt`.
+    struct Locations: Codable, Sendable {
+        let directoryModifiedAt: Date
+        let nodes: [LocationServiceNodeRecord]
+        let users: [LocationServiceUserRecord]
+    }
+
+    var savedAt: Date
+    /// Indexes keyed by sanitized queue name.
+    var queues: [String: BoxQueueIndex]
+    var locations: Locations?
+
+    /// Reads the manifest of the store rooted at `root`.
+    /// - Returns: `nil` when there is none or it cannot be used.
+    static func load(from root: URL) -> BoxStoreManifest? {
+        guard let data = try? Data(contentsOf: root.appendingPathComponent(fileName)) else { return nil }
+        return try? JSONDecoder().decode(BoxStoreManifest.self, from: data)
+    }
+
+    /// Atomically replaces the manifest of the store rooted at `root`. Meant to run outside the store
+    /// actor: encoding a large root takes a while and the indexes are value copies.
+    func save(to root: URL) throws {
+        do {
+            let data = try JSONEncoder().encode(self)
+            try data.write(to: root.appendingPathComponent(Self.fileName), options: .atomic)
+        } catch {
+            throw BoxStoreError.io(error)
+        }
+    }
+}
+
+extension BoxStoreManifest: Codable {
+    /// One queue as parallel arrays sorted by name: far smaller than an array of keyed entries.
+    /// Dates use the default encoding (seconds as a double), which round-trips sub-second values.
+    private struct Queue: Codable {
+        let modifiedAt: Date
+        let names: [String]
+        let sizes: [Int64]
+        let blobSizes: [Int64]
+        let dates: [Date]
+        let digests: [BoxContentDigest?]
+    }
+
+    private enum CodingKeys: String, CodingKey {
+        case version, savedAt, queues, locations
+    }
+
+    init(from decoder: Decoder) throws {
+        let container = try decoder.container(keyedBy: CodingKeys.self)
+        let version = try container.decode(Int.self, forKey: .version)
+        guard version == Self.formatVersion else {
+            throw DecodingError.dataCorruptedError(forKey: .version, in: container, debugDescription: "unsupported manifest version \(version)")
+        }
+        savedAt = try container.decode(Date.self, forKey: .savedAt)
+        locations = try container.decodeIfPresent(Locations.self, forKey: .locations)
+        queues = [:]
+        for (name, queue) in try container.decode([String: Queue].self, forKey: .queues) {
+            // A queue whose arrays disagree is left out and listed again on first use.
+            queues[name] = BoxQueueIndex(
+                names: queue.names,
+                sizes: queue.sizes,
+                blobSizes: queue.blobSizes,
+                dates: queue.dates,
+                digests: queue.digests,
+                directoryModifiedAt: queue.modifiedAt
+            )
+        }
+    }
+
+    func encode(to encoder: Encoder) throws {
+        var container = encoder.container(keyedBy: CodingKeys.self)
+        try container.encode(Self.formatVersion, forKey: .version)
+        try container.encode(savedAt, forKey: .savedAt)
+        try container.encodeIfPresent(locations, forKey: .locations)
+        var encoded: [String: Queue] = [:]
+        for (name, index) in queues {
+            guard let modifiedAt = index.directoryModifiedAt else { continue }
+            let entries = index.entries
+            encoded[name] = Queue(
+                modifiedAt: modifiedAt,
+                names: entries.map(\.name),
+                sizes: entries.map(\.size),
+                blobSizes: entries.map(\.blobSize),
+                dates: entries.map(\.createdAt),
+                digests: entries.map(\.digest)
+            )
+        }
+        try container.encode(encoded, forKey: .queues)
+    }
+}
@@ -0,0 +1,220 @@
+import BoxCore
+import Foundation
+import NIOPosix
+
+/// Point-in-time copy of the store written by `box admin snapshot <dir>` (SPECS §7.15).
+///
+/// A snapshot directory holds `queues/`, laid out like the store root (queue directories, `.cursors`,
+/// `.scheduled`, `.blobs`), and this descriptor as `snapshot.json`. Files are hard links: the store
+/// never modifies a file in place, so a link keeps the content of the barrier and creating a snapshot
+/// costs directory entries, not data. Given the previous snapshot as `base`, the descriptor also lists
+/// the paths added and removed since, which is all an incremental backup has to ship.
+public struct BoxStoreSnapshot: Codable, Sendable {
+    /// Descriptor file name inside the snapshot directory.
+    static let descriptorFileName = "snapshot.json"
+    /// Directory mirroring the store root inside the snapshot directory.
+    static let dataDirectoryName = "queues"
+    /// Format version; a descriptor with another version is refused.
+    static let formatVersion = 1
+    /// Files linked per store call.
+    static let batchSize = 1024
+
+    var version: Int
+    public var createdAt: Date
+    /// Entries per queue.
+    public var queues: [String: Int]
+    /// Every file, relative to the store root, sorted.
+    public var paths: [String]
+    public var bytes: Int64
+    /// Snapshot the change lists are relative to.
+    var base: String?
+    /// Paths new or replaced since `base`.
+    var added: [String]?
+    /// Paths of `base` gone since.
+    var removed: [String]?
+
+    /// Admin payload.
+    func payload(path: URL) -> [String: Any] {
+        var payload: [String: Any] = [
+            "path": path.path,
+            "createdAt": ISO8601DateFormatter().string(from: createdAt),
+            "queues": queues,
+            "files": paths.count,
+            "bytes": bytes
+        ]
+        if let base { payload["base"] = base }
+        if let added { payload["added"] = added.count }
+        if let removed { payload["removed"] = removed.count }
+        return payload
+    }
+
+    /// Snapshots `store` into `directory`, which must be missing or empty and on the volume of the store.
+    /// - Parameters:
+    ///   - store: Store to snapshot.
+    ///   - directory: Snapshot directory to create.
+    ///   - base: Previous snapshot, still on this volume, to list the changes against.
+    ///   - threadPool: Pool listing the hidden areas of the store before the barrier.
+    static func create(from store: BoxServerStore, at directory: URL, base: URL?, threadPool: NIOThreadPool = .singleton) async throws -> BoxStoreSnapshot {
+        let fileManager = FileManager()
+        let standardized = directory.standardizedFileURL.path
+        let root = store.root.standardizedFileURL.path
+        guard standardized != root, !standardized.hasPrefix(root + "/") else {
+            throw BoxStoreError.snapshotUnavailable("\(directory.path) is inside the store")
+        }
+        if let existing = try? fileManager.contentsOfDirectory(atPath: directory.path), !existing.isEmpty {
+            throw BoxStoreError.snapshotUnavailable("\(directory.path) is not empty")
+        }
+        let baseSnapshot = try base.map { try load(from: $0) }
+
+        let data = directory.appendingPathComponent(dataDirectoryName, isDirectory: true)
+        let createdAt = Date()
+        let paths: [String]
+        let totals: (files: Int, bytes: Int64, missing: [String])
+        do {
+            // The hidden areas (blobs above all) are listed before the barrier, off the store actor.
+            try await store.prepareSnapshot()
+            let listed: [String]
+            do {
+                let listing = try await threadPool.runIfActive { try store.listSnapshotFiles(into: data) }
+                listed = try await store.beginSnapshot(into: data, listing: listing)
+            } catch {
+                await store.cancelSnapshot()
+                throw error
+            }
+            do {
+                for start in stride(from: 0, to: listed.count, by: batchSize) {
+                    await store.continueSnapshot(paths: listed[start..<min(start + batchSize, listed.count)])
+                }
+                totals = try await store.finishSnapshot()
+            } catch {
+                await store.cancelSnapshot()
+                throw error
+            }
+            let missing = Set(totals.missing)
+            paths = listed.filter { !missing.contains($0) }.sorted()
+        } catch {
+            try? fileManager.removeItem(at: directory)
+            throw error
+        }
+
+        var queues: [String: Int] = [:]
+        for path in paths where !path.hasPrefix(".") {
+            queues[String(path.prefix { $0 != "/" }), default: 0] += 1
+        }
+        // Empty queues have a directory but no file.
+        for name in (try? fileManager.contentsOfDirectory(atPath: data.path)) ?? [] where !name.hasPrefix(".") && queues[name] == nil {
+            queues[name] = 0
+        }
+        var snapshot = BoxStoreSnapshot(
+            version: formatVersion,
+            createdAt: createdAt,
+            queues: queues,
+            paths: paths,
+            bytes: totals.bytes,
+            base: nil,
+            added: nil,
+            removed: nil
+        )
+        if let base, let baseSnapshot {
+            snapshot.base = base.path
+            (snapshot.added, snapshot.removed) = changes(of: data, since: baseSnapshot, at: base, paths: paths)
+        }
+        try snapshot.save(to: directory)
+        return snapshot
+    }
+
+    /// Lists the paths of a new snapshot that are not the same file in `base` (compared by inode,
+    /// since every file is immutable), and the paths of `base` no longer present.
+    static func changes(of data: URL, since base: BoxStoreSnapshot, at baseDirectory: URL, paths: [String]) -> (added: [String], removed: [String]) {
+        let baseData = baseDirectory.appendingPathComponent(dataDirectoryName, isDirectory: true)
+        let previous = Set(base.paths)
+        let added = paths.filter { path in
+            guard previous.contains(path), let current = fileNumber(at: data.appendingPathComponent(path)) else { return true }
+            return current != fileNumber(at: baseData.appendingPathComponent(path))
+        }
+        let current = Set(paths)
+        return (added, base.paths.filter { !current.contains($0) })
+    }
+
+    /// Rebuilds a store root from the snapshot in `directory`, with hard links when both are on the same
+    /// volume and copies otherwise. The server must be stopped and `root` missing or empty.
+    /// - Returns: The restored snapshot.
+    @discardableResult
+    public static func restore(from directory: URL, to root: URL) throws -> BoxStoreSnapshot {
+        let fileManager = FileManager()
+        let snapshot = try load(from: directory)
+        if let existing = try? fileManager.contentsOfDirectory(atPath: root.path), !existing.isEmpty {
+            throw BoxStoreError.snapshotUnavailable("\(root.path) is not empty")
+        }
+        let data = directory.appendingPathComponent(dataDirectoryName, isDirectory: true)
+        let missing = snapshot.paths.filter { !fileManager.fileExists(atPath: data.appendingPathComponent($0).path) }
+        guard missing.isEmpty else {
+            throw BoxStoreError.snapshotUnavailable("\(missing.count) files missing from \(directory.path), first: \(missing[0])")
+        }
+        do {
+            var created: Set<String> = []
+            for queue in snapshot.queues.keys {
+                try fileManager.createDirectory(at: root.appendingPathComponent(queue, isDirectory: true), withIntermediateDirectories: true)
+            }
+            for path in snapshot.paths {
+                let target = root.appendingPathComponent(path)
+                let parent = target.deletingLastPathComponent()
+                if created.insert(parent.path).inserted {
+                    try fileManager.createDirectory(at: parent, withIntermediateDirectories: true)
+                }
+                let source = data.appendingPathComponent(path)
+                do {
+                    try fileManager.linkItem(at: source, to: target)
+                } catch {
+                    try fileManager.copyItem(at: source, to: target)
+                }
+            }
+        } catch {
+            throw BoxStoreError.io(error)
+        }
+        return snapshot
+    }
+
+    /// Reads the descriptor of the snapshot in `directory`.
+    static func load(from directory: URL) throws -> BoxStoreSnapshot {
+        let url = directory.appendingPathComponent(descriptorFileName)
+        guard let data = try? Data(contentsOf: url) else {
+            throw BoxStoreError.snapshotUnavailable("\(directory.path) holds no \(descriptorFileName)")
+        }
+        let decoder = JSONDecoder()
+        decoder.dateDecodingStrategy = .iso8601
+        guard let snapshot = try? decoder.decode(BoxStoreSnapshot.self, from: data) else {
+            throw BoxStoreError.corrupted(url)
+        }
+        guard snapshot.version == formatVersion else {
+            throw BoxStoreError.snapshotUnavailable("unsupported snapshot version \(snapshot.version)")
+        }
+        // Paths are joined to the store root on restore: none may lead out of it.
+        let queues = Array(snapshot.queues.keys)
+        if let unsafe = queues.first(where: { $0.contains("/") || !isRelative($0) }) ?? snapshot.paths.first(where: { !isRelative($0) }) {
+            throw BoxStoreError.snapshotUnavailable("\(url.path) lists a path outside the store: \(unsafe)")
+        }
+        return snapshot
+    }
+
+    /// Whether `path` is relative and free of empty, `.` and `..` components.
+    static func isRelative(_ path: String) -> Bool {
+        !path.hasPrefix("/") && path.split(separator: "/", omittingEmptySubsequences: false).allSatisfy { !$0.isEmpty && $0 != "." && $0 != ".." }
+    }
+
+    /// Writes the descriptor into `directory`.
+    func save(to directory: URL) throws {
+        let encoder = JSONEncoder()
+        encoder.outputFormatting = [.sortedKeys, .withoutEscapingSlashes]
+        encoder.dateEncodingStrategy = .iso8601
+        do {
+            try encoder.encode(self).write(to: directory.appendingPathComponent(Self.descriptorFileName), options: .atomic)
+        } catch {
+            throw BoxStoreError.io(error)
+        }
+    }
+
+    private static func fileNumber(at url: URL) -> UInt64? {
+        ((try? FileManager.default.attributesOfItem(atPath: url.path))?[.systemFileNumber] as? NSNumber)?.uint64Value
+    }
+}
@@ -0,0 +1,140 @@
+import Foundation
+
+/// Slot layout shared by every `BoxTimerWheel` (static stored properties are not allowed in generic types).
+private enum TimerWheelLayout {
+    static let slotBits = 6
+    static let slotCount = 1 << slotBits
+    static let slotMask = UInt64(slotCount - 1)
+    static let levelCount = 4
+    /// Ticks covered by all levels; farther deadlines are parked in the last slot and re-placed later.
+    static let span = UInt64(1) << UInt64(slotBits * levelCount)
+}
+
+/// Hierarchical timer wheel used for delayed deliveries (SPECS §7.5).
+///
+/// Four levels of 64 slots cover 2^24 ticks (about 19 days at the default 100 ms resolution).
+/// Scheduling is O(1): the level comes from the distance to the deadline and the slot from the
+/// deadline bits. Each tick expires one level-0 slot; every 64 ticks the next level-1 slot is spread
+/// back into level 0 (and likewise upward), so an entry moves at most three times before it fires.
+/// Entries never fire early: deadlines are rounded up to the next tick.
+struct BoxTimerWheel<Value: Sendable>: Sendable {
+    private struct Timer: Sendable {
+        let tick: UInt64
+        let value: Value
+    }
+
+    /// Duration of one tick in seconds.
+    let resolution: TimeInterval
+    private let ticksPerSecond: Double
+    private var levels: [[[Timer]]]
+    /// Next tick to process.
+    private(set) var currentTick: UInt64
+    /// Number of pending entries.
+    private(set) var count = 0
+
+    init(resolution: TimeInterval = 0.1, start: Date = Date()) {
+        self.resolution = resolution
+        self.ticksPerSecond = 1 / resolution
+        self.levels = Array(
+            repeating: Array(repeating: [], count: TimerWheelLayout.slotCount),
+            count: TimerWheelLayout.levelCount
+        )
+        self.currentTick = Self.tick(for: start, ticksPerSecond: 1 / resolution, roundingUp: false)
+    }
+
+    var isEmpty: Bool {
+        count == 0
+    }
+
+    /// Adds `value`, due at `deadline`. Past deadlines fire on the next `advance`.
+    mutating func schedule(_ value: Value, at deadline: Date) {
+        let tick = Self.tick(for: deadline, ticksPerSecond: ticksPerSecond, roundingUp: true)
+        place(Timer(tick: max(tick, currentTick), value: value))
+        count += 1
+    }
+
+    /// Processes every tick up to `now` and returns the values that became due, in deadline order.
+    mutating func advance(to now: Date) -> [Value] {
+        let target = Self.tick(for: now, ticksPerSecond: ticksPerSecond, roundingUp: false)
+        var expired: [Value] = []
+        while currentTick <= target {
+            guard count > 0 else {
+                // Nothing pending: skip the idle ticks instead of walking them.
+                currentTick = target + 1
+                break
+            }
+            let slot = Int(currentTick & TimerWheelLayout.slotMask)
+            if slot == 0 {
+                cascade(level: 1)
+            }
+            let timers = levels[0][slot]
+            if !timers.isEmpty {
+                levels[0][slot] = []
+                expired.append(contentsOf: timers.map(\.value))
+                count -= timers.count
+            }
+            currentTick += 1
+        }
+        return expired
+    }
+
+    /// Date of the first tick at which `advance` has work to do, `nil` when nothing is pending.
+    ///
+    /// A level-0 entry gives its own deadline. An entry of a higher level is only known to wait for
+    /// the cascade of its slot, so the date returned may come before its deadline: `advance` then just
+    /// moves it down and the next call gives a closer date. Costs at most one pass over each level.
+    var nextDeadline: Date? {
+        guard count > 0 else { return nil }
+        var earliest = UInt64.max
+        for level in 0..<TimerWheelLayout.levelCount {
+            let shift = UInt64(TimerWheelLayout.slotBits * level)
+            let current = currentTick >> shift
+            for offset in 0..<UInt64(TimerWheelLayout.slotCount) {
+                let slot = Int((current + offset) & TimerWheelLayout.slotMask)
+                guard !levels[level][slot].isEmpty else { continue }
+                var tick = (current + offset) << shift
+                if tick < currentTick {
+                    // The current slot of an upper level already cascaded: it holds the next round.
+                    tick += UInt64(TimerWheelLayout.slotCount) << shift
+                }
+                earliest = min(earliest, tick)
+                break
+            }
+        }
+        // A hundredth of a tick keeps the rounding of `advance` from landing on the tick before.
+        return Date(timeIntervalSince1970: (Double(earliest) + 0.01) / ticksPerSecond)
+    }
+
+    private mutating func place(_ timer: Timer) {
+        let delta = timer.tick - currentTick
+        var level = 0
+        while level < TimerWheelLayout.levelCount - 1,
+              delta >= UInt64(1) << UInt64(TimerWheelLayout.slotBits * (level + 1)) {
+            level += 1
+        }
+        let slotTick = delta >= TimerWheelLayout.span ? currentTick + TimerWheelLayout.span - 1 : timer.tick
+        let slot = Int((slotTick >> UInt64(TimerWheelLayout.slotBits * level)) & TimerWheelLayout.slotMask)
+        levels[level][slot].append(timer)
+    }
+
+    /// Spreads the current slot of `level` over the lower levels, then cascades the level above when
+    /// this one wrapped around.
+    private mutating func cascade(level: Int) {
+        guard level < TimerWheelLayout.levelCount else { return }
+        let slot = Int((currentTick >> UInt64(TimerWheelLayout.slotBits * level)) & TimerWheelLayout.slotMask)
+        let timers = levels[level][slot]
+        levels[level][slot] = []
+        for timer in timers {
+            place(timer)
+        }
+        if slot == 0 {
+            cascade(level: level + 1)
+        }
+    }
+
+    private static func tick(for date: Date, ticksPerSecond: Double, roundingUp: Bool) -> UInt64 {
+        let ticks = date.timeIntervalSince1970 * ticksPerSecond
+        let rounded = roundingUp ? ticks.rounded(.up) : ticks.rounded(.down)
+        return rounded > 0 ? UInt64(rounded) : 0
+    }
+}
@@ -0,0 +1,204 @@
+import BoxCore
+import Foundation
+import NIOConcurrencyHelpers
+
+/// Behaviour of one volatile queue (`server.volatile_queues.<queue>`, SPECS §7.7).
+public struct BoxVolatilePolicy: Sendable, Equatable {
+    /// What a PUT does when the ring is full.
+    public enum Overflow: String, Sendable {
+        /// Evict the oldest object to make room.
+        case dropOldest = "drop-oldest"
+        /// Refuse the PUT (`rate-limited` / `queue-full`).
+        case reject
+        /// Write to the disk store; GET drains the ring, then the disk backlog.
+        case spill
+    }
+
+    public static let defaultCapacity = 1024
+    /// Largest ring accepted from the configuration.
+    public static let maxCapacity = 1 << 20
+
+    /// Maximum number of objects held in memory.
+    public var capacity: Int
+    public var overflow: Overflow
+
+    public init(capacity: Int = BoxVolatilePolicy.defaultCapacity, overflow: Overflow = .dropOldest) {
+        self.capacity = min(max(capacity, 1), Self.maxCapacity)
+        self.overflow = overflow
+    }
+}
+
+/// In-memory queues configured by `server.volatile_queues`.
+///
+/// Each queue is a fixed-size ring of objects guarded by a lock: PUT and GET never touch the disk
+/// and never hop through the store actor. Contents are lost on restart or when the queue leaves the
+/// configuration. With the `spill` policy, overflow goes to the regular store; as long as that
+/// backlog is not drained, new objects follow it to disk so FIFO order holds across both tiers.
+final class BoxVolatileQueues: @unchecked Sendable {
+    enum PushOutcome: Equatable {
+        /// Stored in memory.
+        case stored
+        /// Stored in memory after evicting the oldest object.
+        case droppedOldest
+        /// The ring is full and the policy refuses new objects.
+        case rejected
+        /// The caller must write the object to the disk store, then call `finishSpill`.
+        case spill
+    }
+
+    /// Ring storage. A class, so updates under the lock never copy the slot array.
+    private final class Ring {
+        var policy: BoxVolatilePolicy
+        var slots: [BoxStoredObject?]
+        var head = 0
+        var count = 0
+        /// Whether spilled objects may still be waiting on disk (assumed after a restart).
+        var diskBacklog: Bool
+        /// Number of spills written so far, so a GET that found the disk empty does not clear a newer spill.
+        var spills: UInt64 = 0
+        /// Spills handed to callers whose disk write has not finished yet; the backlog stays set meanwhile.
+        var pendingSpills = 0
+
+        init(policy: BoxVolatilePolicy) {
+            self.policy = policy
+            self.slots = Array(repeating: nil, count: policy.capacity)
+            self.diskBacklog = policy.overflow == .spill
+        }
+
+        var first: BoxStoredObject? {
+            count > 0 ? slots[head] : nil
+        }
+
+        func append(_ object: BoxStoredObject) {
+            slots[(head + count) % slots.count] = object
+            count += 1
+        }
+
+        func removeFirst() -> BoxStoredObject? {
+            guard count > 0 else { return nil }
+            let object = slots[head]
+            slots[head] = nil
+            head = (head + 1) % slots.count
+            count -= 1
+            return object
+        }
+    }
+
+    private let rings = NIOLockedValueBox<[String: Ring]>([:])
+
+    init(policies: [String: BoxVolatilePolicy] = [:]) {
+        configure(policies)
+    }
+
+    /// Applies a new configuration. Rings whose policy changed keep their newest objects; queues
+    /// removed from the configuration lose their contents.
+    func configure(_ policies: [String: BoxVolatilePolicy]) {
+        rings.withLockedValue { rings in
+            var updated: [String: Ring] = [:]
+            for (queue, policy) in policies {
+                guard let previous = rings[queue] else {
+                    updated[queue] = Ring(policy: policy)
+                    continue
+                }
+                if previous.policy == policy {
+                    updated[queue] = previous
+                    continue
+                }
+                let ring = Ring(policy: policy)
+                ring.diskBacklog = previous.diskBacklog && policy.overflow == .spill
+                ring.spills = previous.spills
+                ring.pendingSpills = previous.pendingSpills
+                let keep = min(previous.count, policy.capacity)
+                for _ in 0..<(previous.count - keep) {
+                    _ = previous.removeFirst()
+                }
+                while let object = previous.removeFirst() {
+                    ring.append(object)
+                }
+                updated[queue] = ring
+            }
+            rings = updated
+        }
+    }
+
+    /// Policy of `queue` (normalized name), `nil` for disk-backed queues.
+    func policy(for queue: String) -> BoxVolatilePolicy? {
+        rings.withLockedValue { $0[queue]?.policy }
+    }
+
+    /// Number of objects held in memory for `queue`.
+    func count(of queue: String) -> Int {
+        rings.withLockedValue { $0[queue]?.count ?? 0 }
+    }
+
+    /// Appends `object` according to the overflow policy of `queue`.
+    func push(_ object: BoxStoredObject, into queue: String) -> PushOutcome {
+        rings.withLockedValue { rings in
+            guard let ring = rings[queue] else { return .spill }
+            let outcome: PushOutcome
+            if ring.diskBacklog {
+                ring.pendingSpills += 1
+                outcome = .spill
+            } else if ring.count < ring.policy.capacity {
+                ring.append(object)
+                outcome = .stored
+            } else {
+                switch ring.policy.overflow {
+                case .dropOldest:
+                    _ = ring.removeFirst()
+                    ring.append(object)
+                    outcome = .droppedOldest
+                case .reject:
+                    outcome = .rejected
+                case .spill:
+                    ring.diskBacklog = true
+                    ring.pendingSpills += 1
+                    outcome = .spill
+                }
+            }
+            return outcome
+        }
+    }
+
+    /// Records that the disk write of a `.spill` outcome is over, whether it succeeded or not.
+    ///
+    /// Counting the spill only now keeps a GET that looked at the disk while the write was still in
+    /// flight from clearing the backlog and stranding the object there.
+    func finishSpill(_ queue: String) {
+        rings.withLockedValue { rings in
+            guard let ring = rings[queue] else { return }
+            ring.pendingSpills = max(ring.pendingSpills - 1, 0)
+            ring.spills &+= 1
+        }
+    }
+
+    /// Removes and returns the oldest in-memory object of `queue`.
+    func pop(from queue: String) -> BoxStoredObject? {
+        rings.withLockedValue { rings in
+            rings[queue]?.removeFirst()
+        }
+    }
+
+    /// Returns the oldest in-memory object of `queue` without removing it.
+    func peek(from queue: String) -> BoxStoredObject? {
+        rings.withLockedValue { $0[queue]?.first }
+    }
+
+    /// When GET should look at the disk store once the ring is empty, returns a marker to pass to
+    /// `clearDiskBacklog`; `nil` when nothing was spilled.
+    func diskBacklogMarker(_ queue: String) -> UInt64? {
+        rings.withLockedValue { rings in
+            guard let ring = rings[queue], ring.diskBacklog else { return nil }
+            return ring.spills
+        }
+    }
+
+    /// Records that the disk backlog of `queue` was found empty, so new objects stay in memory again.
+    /// Ignored when another object spilled after `marker` was taken or a spill is still being written.
+    func clearDiskBacklog(_ queue: String, marker: UInt64) {
+        rings.withLockedValue { rings in
+            guard let ring = rings[queue], ring.spills == marker, ring.pendingSpills == 0 else { return }
+            ring.diskBacklog = false
+        }
+    }
+}
@@ -0,0 +1,113 @@
+import BoxCore
+import Foundation
+import Logging
+import NIOConcurrencyHelpers
+
+/// Background task releasing delayed deliveries (SPECS §7.5).
+///
+/// The task sleeps until the next deadline of the store's timer wheel, then releases what is due. A
+/// delivery scheduled for an earlier date wakes it through the store's delivery feed, so an idle store
+/// costs one wakeup per `maximumWait` and nothing per tick.
+final class DelayedDeliveryScheduler: Sendable {
+    /// Release loop, with the wait that a delivery due earlier cuts short.
+    private struct Running {
+        var task: Task<Void, Never>?
+        /// Wait of the release loop until `deadline` (`nil`: nothing pending).
+        var sleeper: Task<Void, Never>?
+        var deadline: Date?
+        /// Set by a delivery scheduled between two waits, which the loop may have missed.
+        var wakeRequested = false
+    }
+
+    private let store: BoxServerStore
+    private let logger: Logger
+    private let maximumWait: TimeInterval
+    private let running = NIOLockedValueBox(Running())
+
+    /// Creates a scheduler.
+    /// - Parameters:
+    ///   - store: Store holding the delayed deliveries.
+    ///   - logger: Logger used for diagnostics.
+    ///   - maximumWait: Longest sleep. Deadlines are wall-clock dates and the clock may be stepped.
+    init(store: BoxServerStore, logger: Logger, maximumWait: TimeInterval = 60) {
+        self.store = store
+        self.logger = logger
+        self.maximumWait = maximumWait
+    }
+
+    func start() {
+        running.withLockedValue { running in
+            guard running.task == nil else { return }
+            running.task = Task.detached { [weak self] in
+                // Opened before the first deadline is read, so no delivery falls between the two.
+                guard let dates = await self?.store.openDeliveryFeed() else { return }
+                let feed = Task { [weak self] in
+                    for await date in dates {
+                        self?.wake(for: date)
+                    }
+                }
+                defer { feed.cancel() }
+                while !Task.isCancelled {
+                    guard let self else { return }
+                    let released = await self.store.releaseDueDeliveries()
+                    if released > 0 {
+                        self.logger.debug("delayed deliveries released", metadata: ["count": .stringConvertible(released)])
+                    }
+                    let next = await self.store.nextDeliveryDate()
+                    guard await self.wait(until: next) else { return }
+                }
+            }
+        }
+    }
+
+    func stop() {
+        running.withLockedValue { running in
+            running.task?.cancel()
+            running.task = nil
+            running.sleeper?.cancel()
+        }
+    }
+
+    /// Sleeps until `deadline`, at most `maximumWait`, or until a delivery due earlier is scheduled.
+    /// - Returns: `false` once the scheduler is stopped.
+    private func wait(until deadline: Date?) async -> Bool {
+        let seconds = min(deadline?.timeIntervalSinceNow ?? maximumWait, maximumWait)
+        let sleeper = Task<Void, Never> {
+            guard seconds > 0 else { return }
+            try? await Task.sleep(nanoseconds: UInt64(seconds * 1_000_000_000))
+        }
+        // Checked under the lock that publishes the sleeper, so a delivery scheduled in between is not missed.
+        let requested = running.withLockedValue { running -> Bool in
+            running.sleeper = sleeper
+            running.deadline = deadline
+            return running.wakeRequested
+        }
+        if requested {
+            sleeper.cancel()
+        }
+        await withTaskCancellationHandler {
+            await sleeper.value
+        } onCancel: {
+            sleeper.cancel()
+        }
+        running.withLockedValue { running in
+            running.sleeper = nil
+            running.deadline = nil
+            running.wakeRequested = false
+        }
+        return !Task.isCancelled
+    }
+
+    /// Cuts the current wait short when `date` comes before its deadline.
+    private func wake(for date: Date) {
+        running.withLockedValue { running in
+            guard let sleeper = running.sleeper else {
+                running.wakeRequested = true
+                return
+            }
+            if running.deadline.map({ date < $0 }) ?? true {
+                sleeper.cancel()
+            }
+        }
+    }
+}
@@ -0,0 +1,184 @@
+import BoxCore
+import Foundation
+import Logging
+import NIOConcurrencyHelpers
+
+#if os(Linux)
+import Glibc
+#elseif os(Windows)
+import WinSDK
+#else
+import Darwin
+#endif
+
+/// Tracks free space on the queue volume and raises a pressure flag between two watermarks.
+///
+/// The volume is sampled with `statvfs` from a background task. Request handlers only read a locked
+/// boolean, so the check costs nothing on the PUT path. Pressure starts when usage reaches the high
+/// watermark and clears only once usage falls below the low watermark, so a volume hovering around
+/// one threshold does not flap.
+final class DiskSpaceMonitor: @unchecked Sendable {
+    /// Usage thresholds in percent of the volume size.
+    struct Watermarks: Sendable, Equatable {
+        static let defaultHigh = 95
+        static let defaultLow = 90
+
+        var high: Int
+        var low: Int
+
+        /// Clamps both values to 1...100 and keeps `low <= high`.
+        init(high: Int = Watermarks.defaultHigh, low: Int = Watermarks.defaultLow) {
+            let clampedHigh = min(max(high, 1), 100)
+            self.high = clampedHigh
+            self.low = min(max(low, 1), clampedHigh)
+        }
+    }
+
+    /// One `statvfs` reading.
+    struct Sample: Sendable, Equatable {
+        var totalBytes: UInt64
+        var freeBytes: UInt64
+
+        var usedPercent: Double {
+            guard totalBytes > 0 else { return 0 }
+            return Double(totalBytes - min(freeBytes, totalBytes)) * 100 / Double(totalBytes)
+        }
+    }
+
+    /// Queues that stay writable under pressure (presence must keep flowing).
+    static let criticalQueues: Set<String> = ["whoswho"]
+
+    private let path: URL
+    private let logger: Logger
+    private let interval: TimeInterval
+    private let watermarks: @Sendable () -> Watermarks
+    private let onTransition: @Sendable (Bool, Sample) -> Void
+    private let pressure = NIOLockedValueBox(false)
+    private let lastSample = NIOLockedValueBox<Sample?>(nil)
+    private var task: Task<Void, Never>?
+
+    /// Creates a monitor.
+    /// - Parameters:
+    ///   - path: Directory on the monitored volume (queue root).
+    ///   - logger: Logger used for diagnostics.
+    ///   - interval: Sampling period.
+    ///   - watermarks: Current thresholds (re-read at each sample so reloads apply).
+    ///   - onTransition: Invoked with the new pressure state whenever it changes.
+    init(
+        path: URL,
+        logger: Logger,
+        interval: TimeInterval = 5,
+        watermarks: @escaping @Sendable () -> Watermarks,
+        onTransition: @escaping @Sendable (Bool, Sample) -> Void
+    ) {
+        self.path = path
+        self.logger = logger
+        self.interval = interval
+        self.watermarks = watermarks
+        self.onTransition = onTransition
+    }
+
+    /// Whether non-critical writes should currently be refused.
+    var isUnderPressure: Bool {
+        pressure.withLockedValue { $0 }
+    }
+
+    /// Most recent sample, if any.
+    var currentSample: Sample? {
+        lastSample.withLockedValue { $0 }
+    }
+
+    func start() {
+        guard task == nil else { return }
+        refresh()
+        task = Task.detached { [weak self] in
+            while !Task.isCancelled {
+                guard let interval = self?.interval else { return }
+                do {
+                    try await Task.sleep(nanoseconds: UInt64(interval * 1_000_000_000))
+                } catch {
+                    return
+                }
+                self?.refresh()
+            }
+        }
+    }
+
+    func stop() {
+        task?.cancel()
+        task = nil
+    }
+
+    /// Samples the volume and updates the pressure flag.
+    func refresh() {
+        guard let sample = Self.sample(at: path) else {
+            logger.debug("disk space sample unavailable", metadata: ["path": .string(path.path)])
+            return
+        }
+        record(sample)
+    }
+
+    /// Applies `sample` to the hysteresis state machine.
+    func record(_ sample: Sample) {
+        lastSample.withLockedValue { $0 = sample }
+        let limits = watermarks()
+        let used = sample.usedPercent
+        let changed: Bool? = pressure.withLockedValue { underPressure in
+            if !underPressure && used >= Double(limits.high) {
+                underPressure = true
+                return true
+            }
+            if underPressure && used < Double(limits.low) {
+                underPressure = false
+                return false
+            }
+            return nil
+        }
+        if let changed {
+            onTransition(changed, sample)
+        }
+    }
+
+    /// Whether `queue` stays writable under pressure.
+    static func isCritical(queue: String) -> Bool {
+        criticalQueues.contains(queue.lowercased())
+    }
+
+    /// Whether a store failure was caused by the volume running out of space.
+    static func isOutOfSpace(_ error: Error) -> Bool {
+        var underlying = error
+        if case BoxStoreError.io(let wrapped) = error {
+            underlying = wrapped
+        }
+        if let cocoa = underlying as? CocoaError, cocoa.code == .fileWriteOutOfSpace {
+            return true
+        }
+        let nsError = underlying as NSError
+        if nsError.domain == NSPOSIXErrorDomain && nsError.code == Int(ENOSPC) {
+            return true
+        }
+        if let posix = nsError.userInfo[NSUnderlyingErrorKey] as? NSError,
+           posix.domain == NSPOSIXErrorDomain, posix.code == Int(ENOSPC) {
+            return true
+        }
+        return false
+    }
+
+    /// Reads total and available bytes of the volume holding `url`.
+    static func sample(at url: URL) -> Sample? {
+#if os(Windows)
+        guard let attributes = try? FileManager.default.attributesOfFileSystem(forPath: url.path),
+              let total = attributes[.systemSize] as? NSNumber,
+              let free = attributes[.systemFreeSize] as? NSNumber else {
+            return nil
+        }
+        return Sample(totalBytes: total.uint64Value, freeBytes: free.uint64Value)
+#else
+        var stats = statvfs()
+        guard statvfs(url.path, &stats) == 0 else { return nil }
+        let blockSize = UInt64(stats.f_frsize)
+        // f_bavail excludes blocks reserved for root: that is what an unprivileged boxd can use.
+        return Sample(totalBytes: UInt64(stats.f_blocks) * blockSize, freeBytes: UInt64(stats.f_bavail) * blockSize)
+#endif
+    }
+}
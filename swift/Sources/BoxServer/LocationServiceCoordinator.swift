@@ -30,10 +30,25 @@ actor LocationServiceCoordinator {
     private let logger: Logger
     private let encoder: JSONEncoder
     private let decoder: JSONDecoder
+    private let identityCache: BoxIdentityCache?
+    /// Records decoded from the queue, reused while the store reports the same index generation.
+    private var recordIndex: RecordIndex?
 
-    init(store: BoxServerStore, logger: Logger) {
+    private struct RecordIndex {
+        let generation: UInt64
+        let directoryModifiedAt: Date?
+        let nodes: [LocationServiceNodeRecord]
+        let users: [LocationServiceUserRecord]
+    }
+
+    /// - Parameters:
+    ///   - store: Queue store holding `/whoswho`.
+    ///   - logger: Logger used for diagnostics.
+    ///   - identityCache: Cache receiving the node public keys advertised by the records, if any.
+    init(store: BoxServerStore, logger: Logger, identityCache: BoxIdentityCache? = nil) {
         self.store = store
         self.logger = logger
+        self.identityCache = identityCache
         let encoder = JSONEncoder()
         encoder.outputFormatting = [.sortedKeys]
         self.encoder = encoder
@@ -41,8 +56,19 @@ actor LocationServiceCoordinator {
     }
 
     /// Ensures the Location Service queue exists before publishing records.
+    /// Adopts the record index saved in the store manifest when the queue did not change since.
     func bootstrap() async throws {
         _ = try await store.ensureQueue(Constants.queueName)
+        if let restored = await store.takeRestoredLocations(),
+           let version = try? await store.indexVersion(of: Constants.queueName),
+           version.directoryModifiedAt == restored.directoryModifiedAt {
+            recordIndex = RecordIndex(
+                generation: version.generation,
+                directoryModifiedAt: version.directoryModifiedAt,
+                nodes: restored.nodes,
+                users: restored.users
+            )
+        }
     }
 
     /// Publishes the supplied record into the Location Service queue, replacing any previous entry for the same node.
@@ -60,19 +86,8 @@ actor LocationServiceCoordinator {
                 userId: record.userUUID,
                 userMetadata: ["schema": Constants.nodeSchema]
             )
-            do {
-                try await store.remove(queue: Constants.queueName, id: record.nodeUUID)
-            } catch {
-                if case BoxStoreError.objectNotFound = error {
-                    // No-op, we are publishing for the first time.
-                } else if case BoxStoreError.queueNotFound = error {
-                    logger.warning("location service queue missing during publish", metadata: ["error": .string("\(error)")])
-                    try await store.ensureQueue(Constants.queueName)
-                } else {
-                    logger.warning("failed to clear existing location record", metadata: ["error": .string("\(error)")])
-                }
-            }
-
+            // `whoswho` entries are named by id: `put` replaces the previous record with one atomic rename,
+            // so readers never see the node without a record, even across a crash.
             _ = try await store.put(storedObject, into: Constants.queueName)
             logger.debug(
                 "location service record persisted",
@@ -83,11 +98,27 @@ actor LocationServiceCoordinator {
                 ]
             )
             await publishUserIndex(for: record.userUUID)
+            if let advertised = record.nodePublicKey, let key = BoxIdentityCache.peerKeyBytes(fromAdvertised: advertised) {
+                identityCache?.updatePeerKey(key, for: record.nodeUUID)
+            }
         } catch {
             logger.error("failed to publish location service record", metadata: ["error": .string("\(error)")])
         }
     }
 
+    /// Rebuilds the peer key table of the identity cache from the records currently stored, so
+    /// handshakes verify peers against a parsed snapshot instead of reading `/whoswho`.
+    func refreshPeerKeys() async {
+        guard let identityCache else { return }
+        var keys: [UUID: [UInt8]] = [:]
+        for record in await snapshot() {
+            guard let advertised = record.nodePublicKey,
+                  let key = BoxIdentityCache.peerKeyBytes(fromAdvertised: advertised) else { continue }
+            keys[record.nodeUUID] = key
+        }
+        identityCache.updatePeerKeys(keys)
+    }
+
     private func publishUserIndex(for userUUID: UUID) async {
         do {
             let nodes = await resolve(userUUID: userUUID)
@@ -104,18 +135,7 @@ actor LocationServiceCoordinator {
                 userId: userUUID,
                 userMetadata: ["schema": Constants.userSchema]
             )
-            do {
-                try await store.remove(queue: Constants.queueName, id: userUUID)
-            } catch {
-                if case BoxStoreError.objectNotFound = error {
-                    // First publish for this user.
-                } else if case BoxStoreError.queueNotFound = error {
-                    logger.warning("location service queue missing during user publish", metadata: ["error": .string("\(error)")])
-                    try await store.ensureQueue(Constants.queueName)
-                } else {
-                    logger.warning("failed to clear existing user record", metadata: ["error": .string("\(error)")])
-                }
-            }
+            // Replaces the previous index in place (see `publish`).
             _ = try await store.put(storedObject, into: Constants.queueName)
             logger.debug(
                 "location service user index persisted",
@@ -146,18 +166,7 @@ actor LocationServiceCoordinator {
                 userId: record.userUUID,
                 userMetadata: ["schema": Constants.userSchema]
             )
-            do {
-                try await store.remove(queue: Constants.queueName, id: record.userUUID)
-            } catch {
-                if case BoxStoreError.objectNotFound = error {
-                    // First import for this user.
-                } else if case BoxStoreError.queueNotFound = error {
-                    logger.warning("location service queue missing during user import", metadata: ["error": .string("\(error)")])
-                    try await store.ensureQueue(Constants.queueName)
-                } else {
-                    logger.warning("failed to clear existing user record during import", metadata: ["error": .string("\(error)")])
-                }
-            }
+            // Replaces the previous record in place (see `publish`).
             _ = try await store.put(storedObject, into: Constants.queueName)
             logger.debug(
                 "location service user record imported",
@@ -176,50 +185,55 @@ actor LocationServiceCoordinator {
     /// Returns the list of Location Service records currently persisted.
     /// - Returns: Array of node records discovered in the queue.
     func snapshot() async -> [LocationServiceNodeRecord] {
-        do {
-            let references = try await store.list(queue: Constants.queueName)
-            var records: [LocationServiceNodeRecord] = []
-            records.reserveCapacity(references.count)
-            for reference in references {
-                do {
-                    let object = try await store.read(reference: reference)
-                    if let record = decode(object: object) {
-                        records.append(record)
-                    }
-                } catch {
-                    logger.warning("failed to decode location record", metadata: ["file": .string(reference.url.lastPathComponent), "error": .string("\(error)")])
-                }
-            }
-            return records.sorted { $0.nodeUUID.uuidString < $1.nodeUUID.uuidString }
-        } catch {
-            logger.error("failed to enumerate location service records", metadata: ["error": .string("\(error)")])
-            return []
-        }
+        await currentRecords()?.nodes ?? []
     }
 
     /// Returns all user records currently persisted in the Location Service queue.
     func userRecords() async -> [LocationServiceUserRecord] {
+        await currentRecords()?.users ?? []
+    }
+
+    /// Record index saved in the store manifest (SPECS §7.12), when one was built.
+    func manifestLocations() -> BoxStoreManifest.Locations? {
+        guard let recordIndex, let modifiedAt = recordIndex.directoryModifiedAt else { return nil }
+        return BoxStoreManifest.Locations(directoryModifiedAt: modifiedAt, nodes: recordIndex.nodes, users: recordIndex.users)
+    }
+
+    /// Returns the decoded records, reading the queue again only once the store reports a change, so
+    /// `resolve` and `authorize` cost a dictionary lookup in the store and a scan of memory.
+    private func currentRecords() async -> RecordIndex? {
         do {
+            // The version is taken before reading: a write racing with the reads only forces one more rebuild.
+            let version = try await store.indexVersion(of: Constants.queueName)
+            if let recordIndex, recordIndex.generation == version.generation {
+                return recordIndex
+            }
             let references = try await store.list(queue: Constants.queueName)
-            var records: [LocationServiceUserRecord] = []
-            records.reserveCapacity(references.count)
+            var nodes: [LocationServiceNodeRecord] = []
+            var users: [LocationServiceUserRecord] = []
             for reference in references {
                 do {
                     let object = try await store.read(reference: reference)
-                    if let record = decodeUser(object: object) {
-                        records.append(record)
+                    if let record = decode(object: object) {
+                        nodes.append(record)
+                    } else if let record = decodeUser(object: object) {
+                        users.append(record)
                     }
                 } catch {
-                    logger.warning(
-                        "failed to decode user location record",
-                        metadata: ["file": .string(reference.url.lastPathComponent), "error": .string("\(error)")]
-                    )
+                    logger.warning("failed to decode location record", metadata: ["file": .string(reference.url.lastPathComponent), "error": .string("\(error)")])
                 }
             }
-            return records.sorted { $0.userUUID.uuidString < $1.userUUID.uuidString }
+            let index = RecordIndex(
+                generation: version.generation,
+                directoryModifiedAt: version.directoryModifiedAt,
+                nodes: nodes.sorted { $0.nodeUUID.uuidString < $1.nodeUUID.uuidString },
+                users: users.sorted { $0.userUUID.uuidString < $1.userUUID.uuidString }
+            )
+            recordIndex = index
+            return index
         } catch {
-            logger.error("failed to enumerate location service user records", metadata: ["error": .string("\(error)")])
-            return []
+            logger.error("failed to enumerate location service records", metadata: ["error": .string("\(error)")])
+            return nil
         }
     }
 
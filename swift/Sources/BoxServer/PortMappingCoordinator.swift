@@ -206,7 +206,15 @@ final class PortMappingCoordinator: @unchecked Sendable {
     private let nodeIdentifier: UUID
     private let userIdentifier: UUID
     private let leaseDuration: UInt32 = 3_600
-    private var task: Task<Void, Never>?
+    /// Discovery and maintenance task, with what an early refresh needs to reach it.
+    private struct Maintenance {
+        var task: Task<Void, Never>?
+        /// Wait of the maintenance loop until the next renewal; cancelled to renew early.
+        var sleeper: Task<Void, Never>?
+        var refreshRequested = false
+    }
+
+    private let maintenance = NIOLockedValueBox(Maintenance())
     private let state = NIOLockedValueBox<MappingHandle?>(nil)
     private let reachabilityState = NIOLockedValueBox<ReachabilitySnapshot?>(nil)
     private let onStateChange: @Sendable (MappingSnapshot?) -> Void
@@ -231,7 +239,14 @@ final class PortMappingCoordinator: @unchecked Sendable {
 #if os(Windows)
         logger.info("port mapping not available on Windows yet", metadata: ["origin": "\(origin)"])
 #else
-        guard task == nil else { return }
+        let started = maintenance.withLockedValue { maintenance -> Bool in
+            guard maintenance.task == nil else { return false }
+            maintenance.task = Task.detached { [weak self] in
+                await self?.run()
+            }
+            return true
+        }
+        guard started else { return }
         logger.info(
             "port mapping requested",
             metadata: [
@@ -239,16 +254,16 @@ final class PortMappingCoordinator: @unchecked Sendable {
                 "origin": "\(origin)"
             ]
         )
-        task = Task.detached { [weak self] in
-            await self?.run()
-        }
 #endif
     }
 
     func stop() {
 #if !os(Windows)
-        task?.cancel()
-        task = nil
+        maintenance.withLockedValue { maintenance in
+            maintenance.task?.cancel()
+            maintenance.task = nil
+            maintenance.sleeper?.cancel()
+        }
 #endif
         if let handle = state.withLockedValue({ $0 }) {
             Task.detached { [weak self] in
@@ -280,6 +295,33 @@ final class PortMappingCoordinator: @unchecked Sendable {
         logger.debug("port mapping coordinator stopped")
     }
 
+    /// Forces an early refresh after a local address change.
+    ///
+    /// When a mapping is active the maintenance loop renews it immediately instead of waiting for
+    /// half of the lease; otherwise the whole discovery sequence (UPnP → PCP → NAT-PMP) restarts.
+    func requestRefresh() {
+#if !os(Windows)
+        let restarted = maintenance.withLockedValue { maintenance -> Bool? in
+            guard let current = maintenance.task else { return nil }
+            if state.withLockedValue({ $0 }) != nil {
+                maintenance.refreshRequested = true
+                maintenance.sleeper?.cancel()
+                return false
+            }
+            current.cancel()
+            maintenance.task = Task.detached { [weak self] in
+                await self?.run()
+            }
+            return true
+        }
+        switch restarted {
+        case true?: logger.debug("port mapping discovery restarted")
+        case false?: logger.debug("port mapping refresh requested")
+        case nil: break
+        }
+#endif
+    }
+
 #if !os(Windows)
     private func run() async {
         do {
@@ -699,11 +741,7 @@ final class PortMappingCoordinator: @unchecked Sendable {
 
         while !Task.isCancelled {
             let refreshSeconds = max(Int(currentHandle.lifetime / 2), 60)
-            do {
-                try await Task.sleep(nanoseconds: UInt64(refreshSeconds) * 1_000_000_000)
-            } catch {
-                if Task.isCancelled { return }
-            }
+            guard await waitForRenewal(seconds: refreshSeconds) else { return }
 
             do {
                 currentHandle = try await refreshMapping(currentHandle)
@@ -727,6 +765,33 @@ final class PortMappingCoordinator: @unchecked Sendable {
         }
     }
 
+    /// Sleeps until the next renewal, `seconds` from now, or until `requestRefresh` asks for it sooner.
+    /// The loop does not wake in between.
+    /// - Returns: `false` when the maintenance task was cancelled.
+    private func waitForRenewal(seconds: Int) async -> Bool {
+        let sleeper = Task<Void, Never> {
+            try? await Task.sleep(nanoseconds: UInt64(seconds) * 1_000_000_000)
+        }
+        // Checked under the lock that publishes the sleeper, so a request in between is not missed.
+        let requested = maintenance.withLockedValue { maintenance -> Bool in
+            maintenance.sleeper = sleeper
+            return maintenance.refreshRequested
+        }
+        if requested {
+            sleeper.cancel()
+        }
+        await withTaskCancellationHandler {
+            await sleeper.value
+        } onCancel: {
+            sleeper.cancel()
+        }
+        maintenance.withLockedValue { maintenance in
+            maintenance.sleeper = nil
+            maintenance.refreshRequested = false
+        }
+        return !Task.isCancelled
+    }
+
     private func refreshMapping(_ handle: MappingHandle) async throws -> MappingHandle {
         switch handle.backend {
         case .upnp(let service, let client, let externalIPv4):
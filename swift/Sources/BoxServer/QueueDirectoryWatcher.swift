@@ -0,0 +1,246 @@
+import BoxCore
+import Foundation
+import Logging
+import NIOConcurrencyHelpers
+
+#if os(Linux)
+import Glibc
+#endif
+
+/// Watches the queue directories and reports file changes to the store (SPECS §7.13).
+///
+/// On Linux every queue directory gets an inotify watch; files written, renamed or removed by another
+/// process (an operator, a script, a second store instance) are reported to
+/// `BoxServerStore.reconcile(queue:names:)`, which updates the index entry by entry and drops the
+/// cached objects of those files. A watched queue is then trusted without checking its directory date
+/// on every access. New queue directories are picked up through a watch on the root. When the kernel
+/// queue overflows, every index is rebuilt on next use. Other platforms (or a host out of inotify
+/// watches) keep the directory date check alone.
+///
+/// The inotify descriptor is read by a dispatch read source, so no thread waits on it; the events are
+/// handed to a task that applies them to the store. Once no event is left, neither in the descriptor
+/// nor on its way to that task, the store records the directory dates of the queues it reconciled.
+final class QueueDirectoryWatcher: @unchecked Sendable {
+    /// One decoded `struct inotify_event`.
+    struct Event: Equatable, Sendable {
+        var watch: Int32
+        var mask: UInt32
+        var name: String
+    }
+
+    /// inotify constants (`sys/inotify.h`), spelled out so their Swift types do not depend on the import.
+    enum Inotify {
+        static let create: UInt32 = 0x100
+        static let closeWrite: UInt32 = 0x8
+        static let movedFrom: UInt32 = 0x40
+        static let movedTo: UInt32 = 0x80
+        static let delete: UInt32 = 0x200
+        static let overflow: UInt32 = 0x4000
+        static let ignored: UInt32 = 0x8000
+        static let onlyDirectory: UInt32 = 0x0100_0000
+        static let isDirectory: UInt32 = 0x4000_0000
+        static let nonBlocking: Int32 = 0x800
+        static let closeOnExec: Int32 = 0x8_0000
+        static let eventHeaderSize = 16
+
+        /// Changes to object files inside a queue directory.
+        static let queueMask = create | closeWrite | movedFrom | movedTo | delete | onlyDirectory
+        /// Queue directories appearing under the root or renamed away (compaction swaps, §7.14).
+        static let rootMask = create | movedFrom | movedTo | onlyDirectory
+    }
+
+    private struct Running {
+        var task: Task<Void, Never>
+        var source: DispatchSourceRead
+    }
+
+    private let store: BoxServerStore
+    private let logger: Logger
+    private let running = NIOLockedValueBox<Running?>(nil)
+    /// Batches read from the descriptor and not applied yet; guarded together with the reads.
+    private let pendingBatches = NIOLockedValueBox(0)
+    private let queue = DispatchQueue(label: "box.queue-watcher")
+
+    /// Creates a watcher.
+    /// - Parameters:
+    ///   - store: Store whose queue directories are watched.
+    ///   - logger: Logger used for diagnostics.
+    init(store: BoxServerStore, logger: Logger) {
+        self.store = store
+        self.logger = logger
+    }
+
+    func start() {
+#if os(Linux)
+        running.withLockedValue { running in
+            guard running == nil else { return }
+            let descriptor = inotify_init1(Inotify.nonBlocking | Inotify.closeOnExec)
+            guard descriptor >= 0 else {
+                logger.info("inotify unavailable, using directory dates", metadata: ["errno": .string("\(errno)")])
+                return
+            }
+            pendingBatches.withLockedValue { $0 = 0 }
+            let (batches, continuation) = AsyncStream.makeStream(of: [Event].self)
+            let source = DispatchSource.makeReadSource(fileDescriptor: descriptor, queue: queue)
+            source.setEventHandler { [weak self] in
+                self?.readEvents(from: descriptor, into: continuation, source: source)
+            }
+            source.setCancelHandler {
+                close(descriptor)
+                continuation.finish()
+            }
+            // Events read before the task has registered every watch wait in the stream.
+            source.activate()
+            let task = Task { [weak self] in
+                await self?.run(descriptor: descriptor, batches: batches)
+            }
+            running = Running(task: task, source: source)
+        }
+#else
+        logger.info("queue directory watcher not available on this platform, using directory dates")
+#endif
+    }
+
+    func stop() {
+        guard let stopped = running.withLockedValue({ running -> Running? in
+            defer { running = nil }
+            return running
+        }) else { return }
+        stopped.task.cancel()
+        // Cancelling closes the descriptor and ends the event stream, which ends the task.
+        stopped.source.cancel()
+    }
+
+#if os(Linux)
+    /// Reads every event available on `descriptor` (dispatch queue only) and passes them on.
+    private func readEvents(from descriptor: Int32, into continuation: AsyncStream<[Event]>.Continuation, source: DispatchSourceRead) {
+        var buffer = [UInt8](repeating: 0, count: 64 * 1024)
+        while true {
+            // The read and the count move together, so `isQuiet` never misses an event in between.
+            let (received, error) = pendingBatches.withLockedValue { pending -> (Int, Int32) in
+                let received = buffer.withUnsafeMutableBytes { raw in
+                    read(descriptor, raw.baseAddress, raw.count)
+                }
+                if received > 0 { pending += 1 }
+                return (received, errno)
+            }
+            if received > 0 {
+                continuation.yield(Self.parseEvents(Array(buffer[0..<received])))
+                continue
+            }
+            if received < 0 && error == EINTR { continue }
+            if received < 0 && error != EAGAIN && error != EWOULDBLOCK {
+                logger.warning("inotify read failed, using directory dates", metadata: ["errno": .string("\(error)")])
+                source.cancel()
+            }
+            return
+        }
+    }
+
+    /// Whether every change reported so far has been applied: nothing left to read on `descriptor`
+    /// and no batch waiting for the task.
+    private func isQuiet(_ descriptor: Int32) -> Bool {
+        pendingBatches.withLockedValue { pending in
+            guard pending == 0 else { return false }
+            var request = pollfd(fd: descriptor, events: Int16(POLLIN), revents: 0)
+            return poll(&request, 1, 0) == 0
+        }
+    }
+
+    private func run(descriptor: Int32, batches: AsyncStream<[Event]>) async {
+        let root = store.root
+        let rootWatch = inotify_add_watch(descriptor, root.path, Inotify.rootMask)
+        var queues: [Int32: String] = [:]
+
+        func watchQueue(_ name: String) async {
+            let watch = inotify_add_watch(descriptor, root.appendingPathComponent(name, isDirectory: true).path, Inotify.queueMask)
+            guard watch >= 0 else {
+                logger.warning("cannot watch queue directory", metadata: ["queue": .string(name), "errno": .string("\(errno)")])
+                return
+            }
+            queues[watch] = name
+            await store.beginWatching(queue: name)
+        }
+
+        // The root watch comes first, so a queue created while the existing ones are registered is not missed.
+        for name in await store.listQueues() {
+            await watchQueue(name)
+        }
+        logger.info("queue directory watcher started", metadata: ["queues": .stringConvertible(queues.count)])
+
+        // Queues reconciled since their directory date was last recorded.
+        var unsettled: Set<String> = []
+        for await events in batches {
+            var changes: [String: Set<String>] = [:]
+            var overflowed = false
+            for event in events {
+                if event.mask & Inotify.overflow != 0 {
+                    overflowed = true
+                } else if event.watch == rootWatch {
+                    guard event.mask & Inotify.isDirectory != 0, !event.name.hasPrefix(".") else { continue }
+                    if event.mask & Inotify.movedFrom != 0 {
+                        // The watch follows the renamed directory: drop it, the replacement gets its own.
+                        if let watch = queues.first(where: { $0.value == event.name })?.key {
+                            inotify_rm_watch(descriptor, watch)
+                            queues.removeValue(forKey: watch)
+                            await store.endWatching(queue: event.name)
+                        }
+                    } else {
+                        await watchQueue(event.name)
+                    }
+                } else if let queue = queues[event.watch] {
+                    if event.mask & Inotify.ignored != 0 {
+                        // The directory was removed (or purged and recreated: the root watch adds it again).
+                        queues.removeValue(forKey: event.watch)
+                        if !queues.values.contains(queue) {
+                            await store.endWatching(queue: queue)
+                        }
+                    } else if event.name.hasSuffix(".json") && !event.name.hasPrefix(".") {
+                        changes[queue, default: []].insert(event.name)
+                    }
+                }
+            }
+            if overflowed {
+                logger.warning("inotify queue overflowed, rebuilding queue indexes")
+                await store.invalidateIndexes()
+            }
+            for (queue, names) in changes {
+                await store.reconcile(queue: queue, names: names)
+                unsettled.insert(queue)
+            }
+            pendingBatches.withLockedValue { $0 -= 1 }
+            // Dates read while events are still queued would hide those changes from the date check.
+            if !unsettled.isEmpty, await store.settle(queues: unsettled, isQuiet: { [self] in isQuiet(descriptor) }) {
+                unsettled.removeAll()
+            }
+        }
+        await store.endWatchingAll()
+    }
+#endif
+
+    /// Decodes the `struct inotify_event` records of one read; a truncated record ends the parse.
+    static func parseEvents(_ bytes: [UInt8]) -> [Event] {
+        var events: [Event] = []
+        var offset = 0
+        while offset + Inotify.eventHeaderSize <= bytes.count {
+            let watch = Int32(bitPattern: readHostUInt32(bytes, at: offset))
+            let mask = readHostUInt32(bytes, at: offset + 4)
+            let length = Int(readHostUInt32(bytes, at: offset + 12))
+            let nameStart = offset + Inotify.eventHeaderSize
+            guard nameStart + length <= bytes.count else { break }
+            // The name is NUL-padded to an aligned length.
+            let nameBytes = bytes[nameStart..<(nameStart + length)].prefix { $0 != 0 }
+            events.append(Event(watch: watch, mask: mask, name: String(decoding: nameBytes, as: UTF8.self)))
+            offset = nameStart + length
+        }
+        return events
+    }
+
+    private static func readHostUInt32(_ bytes: [UInt8], at offset: Int) -> UInt32 {
+        var value: UInt32 = 0
+        withUnsafeMutableBytes(of: &value) { raw in
+            for index in 0..<4 { raw[index] = bytes[offset + index] }
+        }
+        return value
+    }
+}
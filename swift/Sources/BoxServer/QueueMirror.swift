@@ -0,0 +1,477 @@
+import BoxCore
+import Foundation
+import Logging
+
+/// Asynchronous replication of queues to the other nodes of the user (SPECS §7.16).
+///
+/// The store publishes every change of a mirrored queue on its change feed; the mirror numbers them
+/// into a per-queue log kept in memory, and one task per follower ships the entries above the position
+/// that follower acknowledged, in batches of about `batchBytes` of JSON (one datagram); an object larger
+/// than that travels alone, in chunks. A follower without a position (new, reset by a gap or an external
+/// change, or behind the trimmed log) first receives a full copy of the queue. Shipping is woken by the feed, so a mirror trails its queue by about one round trip, and
+/// PUT acknowledgements never wait for it. The log is trimmed to the lowest acknowledged position.
+actor QueueMirror {
+    /// Another node of the user receiving the mirrors.
+    struct Follower: Hashable, Sendable {
+        var node: UUID
+        var address: String
+        var port: UInt16
+    }
+
+    /// Transport failures the mirror handles specially.
+    enum TransportError: Error {
+        /// Rejection of a batch that calls for a full copy rather than a retry.
+        case resetRequired
+        /// No Location Service record advertises the follower's node key yet: it cannot be authenticated.
+        case unknownFollowerKey
+    }
+
+    /// Sends one batch and returns once the follower applied it.
+    typealias Transport = @Sendable (Follower, BoxMirrorBatch) async throws -> Void
+
+    /// Replication state reported by `box admin stats`.
+    struct Status: Sendable {
+        struct Replica: Sendable {
+            var queue: String
+            var acked: UInt64?
+            var pending: UInt64
+            var copying: Bool
+        }
+
+        struct FollowerStatus: Sendable {
+            var node: UUID
+            var address: String
+            var port: UInt16
+            var replicas: [Replica]
+            var lastAckAt: Date?
+            var lastError: String?
+        }
+
+        var queues: [String]
+        var followers: [FollowerStatus]
+        var batches: Int
+        var entries: Int
+        var skipped: Int
+
+        /// Admin payload.
+        var payload: [String: Any] {
+            [
+                "queues": queues,
+                "batches": batches,
+                "entries": entries,
+                "skipped": skipped,
+                "followers": followers.map { follower -> [String: Any] in
+                    var payload: [String: Any] = [
+                        "node": follower.node.uuidString,
+                        "address": follower.address,
+                        "port": follower.port,
+                        "queues": Dictionary(uniqueKeysWithValues: follower.replicas.map { replica -> (String, [String: Any]) in
+                            var entry: [String: Any] = ["pending": replica.pending, "copying": replica.copying]
+                            if let acked = replica.acked { entry["acked"] = acked }
+                            return (replica.queue, entry)
+                        })
+                    ]
+                    if let lastAckAt = follower.lastAckAt { payload["lastAckAt"] = ISO8601DateFormatter().string(from: lastAckAt) }
+                    if let lastError = follower.lastError { payload["lastError"] = lastError }
+                    return payload
+                }
+            ]
+        }
+    }
+
+    /// Numbered changes of one queue.
+    private struct QueueLog {
+        /// Position of the latest change, 0 before the first one.
+        var head: UInt64 = 0
+        /// Changes ending at `head`, oldest first.
+        var changes: [(name: String, removed: Bool)] = []
+
+        /// Position of `changes[0]`.
+        var oldest: UInt64 {
+            head + 1 - UInt64(changes.count)
+        }
+    }
+
+    /// What one follower holds of one queue.
+    private struct Replica {
+        /// Last position acknowledged, `nil` until a copy completed.
+        var acked: UInt64?
+        var copy: Copy?
+    }
+
+    /// Full copy in progress: entry names listed at log position `base`, shipped up to `offset`.
+    private struct Copy {
+        var names: [String]
+        var offset = 0
+        var base: UInt64
+    }
+
+    private struct FollowerState {
+        var follower: Follower
+        var replicas: [String: Replica] = [:]
+        var wake: AsyncStream<Void>.Continuation
+        var task: Task<Void, Never>?
+        /// Queue served last, so a busy queue does not starve the others.
+        var lastQueue: String?
+        var lastAckAt: Date?
+        var lastError: String?
+    }
+
+    /// Batch being sent, with the copy offset it reaches and the entries left out as too large to transfer.
+    private struct Pending {
+        var batch: BoxMirrorBatch
+        var copyEnd: Int?
+        var skipped: [String] = []
+    }
+
+    static let initialBackoff: TimeInterval = 1
+    static let maximumBackoff: TimeInterval = 30
+
+    private let store: BoxServerStore
+    private let source: UUID
+    private let logger: Logger
+    private let transport: Transport
+    private let epoch = UUID()
+    private let logCapacity: Int
+    private let batchBytes: Int
+    private var queues: Set<String> = []
+    private var logs: [String: QueueLog] = [:]
+    private var followers: [UUID: FollowerState] = [:]
+    private var feedTask: Task<Void, Never>?
+    private var shippedBatches = 0
+    private var shippedEntries = 0
+    private var skippedEntries = 0
+
+    /// Creates a mirror.
+    /// - Parameters:
+    ///   - store: Store whose queues are mirrored.
+    ///   - source: Identifier of this node.
+    ///   - logger: Logger used for diagnostics.
+    ///   - logCapacity: Changes kept per queue; a follower further behind gets a full copy.
+    ///   - batchBytes: Approximate JSON size of a batch grouping several entries, so that it fits a single
+    ///     PUT datagram. A larger entry is sent alone and split into chunks by the transport.
+    ///   - transport: Sends a batch to a follower.
+    init(
+        store: BoxServerStore,
+        source: UUID,
+        logger: Logger,
+        logCapacity: Int = 65_536,
+        batchBytes: Int = 40 * 1024,
+        transport: @escaping Transport
+    ) {
+        self.store = store
+        self.source = source
+        self.logger = logger
+        self.logCapacity = logCapacity
+        self.batchBytes = batchBytes
+        self.transport = transport
+    }
+
+    /// Opens the change feed of `queues`.
+    func start(queues: Set<String>) async {
+        guard feedTask == nil else { return }
+        self.queues = queues
+        let feed = await store.openChangeFeed(queues: queues)
+        feedTask = Task.detached { [weak self] in
+            for await change in feed {
+                await self?.record(change)
+            }
+        }
+        logger.info("queue mirroring started", metadata: ["queues": .string(queues.sorted().joined(separator: ","))])
+    }
+
+    func stop() async {
+        feedTask?.cancel()
+        feedTask = nil
+        await store.closeChangeFeed()
+        for state in followers.values {
+            state.task?.cancel()
+            state.wake.finish()
+        }
+        followers.removeAll()
+    }
+
+    /// Replaces the mirrored queues (configuration reload); the logs of dropped queues are discarded.
+    func setQueues(_ queues: Set<String>) async {
+        self.queues = queues
+        await store.setFedQueues(queues)
+        logs = logs.filter { queues.contains($0.key) }
+        for node in followers.keys {
+            followers[node]?.replicas = followers[node]?.replicas.filter { queues.contains($0.key) } ?? [:]
+            followers[node]?.wake.yield()
+        }
+    }
+
+    /// Replaces the followers. A new one starts with a full copy of every mirrored queue.
+    func setFollowers(_ list: [Follower]) {
+        var wanted: [UUID: Follower] = [:]
+        for follower in list where follower.node != source {
+            wanted[follower.node] = wanted[follower.node] ?? follower
+        }
+        for (node, state) in followers where wanted[node] == nil {
+            state.task?.cancel()
+            state.wake.finish()
+            followers.removeValue(forKey: node)
+            logger.info("mirror follower removed", metadata: ["node": .string(node.uuidString)])
+        }
+        for (node, follower) in wanted {
+            if followers[node] != nil {
+                followers[node]?.follower = follower
+                continue
+            }
+            let (signals, wake) = AsyncStream<Void>.makeStream(bufferingPolicy: .bufferingNewest(1))
+            var state = FollowerState(follower: follower, wake: wake)
+            state.task = Task.detached { [weak self] in
+                await self?.ship(to: node, signals: signals)
+            }
+            followers[node] = state
+            wake.yield()
+            logger.info("mirror follower added", metadata: ["node": .string(node.uuidString), "address": .string(follower.address)])
+        }
+        for queue in logs.keys {
+            trim(queue)
+        }
+    }
+
+    func status() -> Status {
+        let followers = self.followers.values.sorted { $0.follower.node.uuidString < $1.follower.node.uuidString }.map { state in
+            Status.FollowerStatus(
+                node: state.follower.node,
+                address: state.follower.address,
+                port: state.follower.port,
+                replicas: queues.sorted().map { queue in
+                    let replica = state.replicas[queue]
+                    let head = logs[queue]?.head ?? 0
+                    return Status.Replica(
+                        queue: queue,
+                        acked: replica?.acked,
+                        pending: replica?.acked.map { head - $0 } ?? head,
+                        copying: replica?.copy != nil
+                    )
+                },
+                lastAckAt: state.lastAckAt,
+                lastError: state.lastError
+            )
+        }
+        return Status(queues: queues.sorted(), followers: followers, batches: shippedBatches, entries: shippedEntries, skipped: skippedEntries)
+    }
+
+    // MARK: - Log
+
+    private func record(_ change: BoxStoreChange) {
+        let queue = change.queue
+        guard queues.contains(queue) else { return }
+        switch change {
+        case .stored(_, let name):
+            append(name, removed: false, to: queue)
+        case .removed(_, let name):
+            append(name, removed: true, to: queue)
+        case .reset:
+            for node in followers.keys {
+                followers[node]?.replicas[queue] = nil
+            }
+        }
+        for state in followers.values {
+            state.wake.yield()
+        }
+    }
+
+    private func append(_ name: String, removed: Bool, to queue: String) {
+        var log = logs[queue] ?? QueueLog()
+        log.head += 1
+        log.changes.append((name: name, removed: removed))
+        if log.changes.count > logCapacity {
+            // Trimmed in slices to keep the cost off every change; followers left behind get a copy.
+            log.changes.removeFirst(log.changes.count - logCapacity + logCapacity / 8)
+        }
+        logs[queue] = log
+    }
+
+    /// Drops the changes every follower acknowledged.
+    private func trim(_ queue: String) {
+        guard var log = logs[queue], !log.changes.isEmpty else { return }
+        var needed = log.head
+        for state in followers.values {
+            // A follower without a replica starts with a copy at the head and needs nothing older.
+            guard let replica = state.replicas[queue] else { continue }
+            if let acked = replica.acked {
+                needed = min(needed, acked)
+            } else if let copy = replica.copy {
+                needed = min(needed, copy.base)
+            }
+        }
+        guard needed >= log.oldest else { return }
+        log.changes.removeFirst(Int(min(needed - log.oldest + 1, UInt64(log.changes.count))))
+        logs[queue] = log
+    }
+
+    // MARK: - Shipping
+
+    private func ship(to node: UUID, signals: AsyncStream<Void>) async {
+        var backoff = Self.initialBackoff
+        for await _ in signals {
+            while !Task.isCancelled, let pending = await nextBatch(for: node), let follower = followers[node]?.follower {
+                do {
+                    try await transport(follower, pending.batch)
+                    acknowledge(pending, from: node)
+                    backoff = Self.initialBackoff
+                } catch TransportError.resetRequired {
+                    followers[node]?.replicas[pending.batch.queue] = nil
+                    logger.info("mirror reset requested", metadata: ["node": .string(node.uuidString), "queue": .string(pending.batch.queue)])
+                } catch {
+                    followers[node]?.lastError = "\(error)"
+                    logger.debug("mirror batch failed", metadata: ["node": .string(node.uuidString), "queue": .string(pending.batch.queue), "error": .string("\(error)")])
+                    do {
+                        try await Task.sleep(nanoseconds: UInt64(backoff * 1_000_000_000))
+                    } catch {
+                        return
+                    }
+                    backoff = min(backoff * 2, Self.maximumBackoff)
+                }
+            }
+        }
+    }
+
+    /// Next batch owed to `node`, serving the mirrored queues in turn.
+    private func nextBatch(for node: UUID) async -> Pending? {
+        guard let state = followers[node] else { return nil }
+        let ordered = queues.sorted()
+        let start = state.lastQueue.flatMap { ordered.firstIndex(of: $0) }.map { $0 + 1 } ?? 0
+        for offset in 0..<ordered.count {
+            let queue = ordered[(start + offset) % ordered.count]
+            if let pending = await nextBatch(for: node, queue: queue) {
+                followers[node]?.lastQueue = queue
+                return pending
+            }
+        }
+        return nil
+    }
+
+    private func nextBatch(for node: UUID, queue: String) async -> Pending? {
+        guard let state = followers[node] else { return nil }
+        var replica = state.replicas[queue] ?? Replica()
+        let log = logs[queue] ?? QueueLog()
+        if let acked = replica.acked, acked < log.head, acked + 1 < log.oldest {
+            logger.info("mirror follower behind the log, copying", metadata: ["node": .string(node.uuidString), "queue": .string(queue)])
+            replica = Replica()
+        }
+        if replica.acked == nil && replica.copy == nil {
+            // Every change up to `base` is visible in the listing; later ones are applied over the copy.
+            let base = log.head
+            guard let names = try? await store.mirrorListing(of: queue) else { return nil }
+            replica.copy = Copy(names: names, base: base)
+            followers[node]?.replicas[queue] = replica
+        }
+        if let copy = replica.copy {
+            return await copyBatch(queue: queue, copy: copy)
+        }
+        guard let acked = replica.acked, acked < log.head else { return nil }
+        return await changeBatch(queue: queue, log: log, after: acked)
+    }
+
+    private func copyBatch(queue: String, copy: Copy) async -> Pending {
+        var entries: [BoxMirrorBatch.Entry] = []
+        var skipped: [String] = []
+        var bytes = 0
+        var index = copy.offset
+        while index < copy.names.count {
+            let name = copy.names[index]
+            // An entry removed since the listing is simply left out.
+            if let object = await store.mirrorObject(queue: queue, name: name) {
+                let entry = BoxMirrorBatch.Entry(seq: 0, name: name, removed: nil, object: BoxMirrorBatch.Object(object))
+                let size = Self.estimatedSize(of: entry)
+                if size > BoxMirrorBatch.maxTransferBytes {
+                    skipped.append(name)
+                } else if bytes + size > batchBytes && !entries.isEmpty {
+                    break
+                } else {
+                    entries.append(entry)
+                    bytes += size
+                }
+            }
+            index += 1
+        }
+        let batch = BoxMirrorBatch(
+            source: source,
+            queue: queue,
+            epoch: epoch,
+            first: nil,
+            last: nil,
+            purge: copy.offset == 0 ? true : nil,
+            base: index >= copy.names.count ? copy.base : nil,
+            entries: entries
+        )
+        return Pending(batch: batch, copyEnd: index, skipped: skipped)
+    }
+
+    private func changeBatch(queue: String, log: QueueLog, after acked: UInt64) async -> Pending {
+        var entries: [BoxMirrorBatch.Entry] = []
+        var skipped: [String] = []
+        var bytes = 0
+        var last = acked
+        for change in log.changes[Int(acked + 1 - log.oldest)...] {
+            var entry = BoxMirrorBatch.Entry(seq: last + 1, name: change.name, removed: change.removed ? true : nil, object: nil)
+            if !change.removed {
+                // Gone since: its removal comes later in the log.
+                guard let object = await store.mirrorObject(queue: queue, name: change.name) else {
+                    last += 1
+                    continue
+                }
+                entry.object = BoxMirrorBatch.Object(object)
+            }
+            let size = Self.estimatedSize(of: entry)
+            if size > BoxMirrorBatch.maxTransferBytes {
+                skipped.append(change.name)
+            } else if bytes + size > batchBytes && !entries.isEmpty {
+                break
+            } else {
+                entries.append(entry)
+                bytes += size
+            }
+            last += 1
+        }
+        let batch = BoxMirrorBatch(source: source, queue: queue, epoch: epoch, first: acked + 1, last: last, purge: nil, base: nil, entries: entries)
+        return Pending(batch: batch, copyEnd: nil, skipped: skipped)
+    }
+
+    private func acknowledge(_ pending: Pending, from node: UUID) {
+        let batch = pending.batch
+        // A replica reset while the batch was in flight starts over.
+        guard var replica = followers[node]?.replicas[batch.queue] else { return }
+        if let last = batch.last {
+            guard let acked = replica.acked, last > acked else { return }
+            replica.acked = last
+        } else {
+            guard var copy = replica.copy, let end = pending.copyEnd else { return }
+            if let base = batch.base {
+                replica.acked = base
+                replica.copy = nil
+            } else {
+                copy.offset = end
+                replica.copy = copy
+            }
+        }
+        followers[node]?.replicas[batch.queue] = replica
+        followers[node]?.lastAckAt = Date()
+        followers[node]?.lastError = nil
+        shippedBatches += 1
+        shippedEntries += batch.entries.count
+        if !pending.skipped.isEmpty {
+            // Chunked transfers are bounded by `BoxMirrorBatch.maxTransferBytes`: larger objects are not mirrored.
+            skippedEntries += pending.skipped.count
+            logger.warning("objects too large to mirror", metadata: [
+                "node": .string(node.uuidString),
+                "queue": .string(batch.queue),
+                "files": .string(pending.skipped.joined(separator: ","))
+            ])
+        }
+        trim(batch.queue)
+    }
+
+    /// JSON size of `entry`: base64 content plus a bound on the metadata.
+    private static func estimatedSize(of entry: BoxMirrorBatch.Entry) -> Int {
+        let content = entry.object.map { ($0.content.count + 2) / 3 * 4 } ?? 0
+        let metadata = entry.object?.userMetadata?.reduce(0) { $0 + $1.key.utf8.count + $1.value.utf8.count + 8 } ?? 0
+        return 512 + entry.name.utf8.count + content + metadata
+    }
+}
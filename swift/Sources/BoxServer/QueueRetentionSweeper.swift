@@ -0,0 +1,104 @@
+import BoxCore
+import Foundation
+import Logging
+
+/// Background task enforcing `server.queue_retention` (SPECS §7.3).
+///
+/// Each pass walks the configured queues and evicts the oldest objects in small batches through
+/// `BoxServerStore.enforceRetention`. A pass deletes at most `budgetPerPass` files and pauses between
+/// batches, so the store actor is released regularly and PUT/GET never queue behind a large purge.
+/// Whatever exceeds the budget is handled on the next pass.
+final class QueueRetentionSweeper: @unchecked Sendable {
+    private let store: BoxServerStore
+    private let logger: Logger
+    private let policies: @Sendable () -> [String: BoxRetentionPolicy]
+    private let interval: TimeInterval
+    private let batchSize: Int
+    private let budgetPerPass: Int
+    private let batchPause: TimeInterval
+    private var task: Task<Void, Never>?
+
+    /// Creates a sweeper.
+    /// - Parameters:
+    ///   - store: Store to sweep.
+    ///   - logger: Logger used for diagnostics.
+    ///   - interval: Delay between passes.
+    ///   - batchSize: Files deleted per store call.
+    ///   - budgetPerPass: Maximum files deleted per pass across all queues.
+    ///   - batchPause: Pause between two batches.
+    ///   - policies: Current policies keyed by normalized queue name.
+    init(
+        store: BoxServerStore,
+        logger: Logger,
+        interval: TimeInterval = 30,
+        batchSize: Int = 64,
+        budgetPerPass: Int = 1024,
+        batchPause: TimeInterval = 0.02,
+        policies: @escaping @Sendable () -> [String: BoxRetentionPolicy]
+    ) {
+        self.store = store
+        self.logger = logger
+        self.interval = interval
+        self.batchSize = batchSize
+        self.budgetPerPass = budgetPerPass
+        self.batchPause = batchPause
+        self.policies = policies
+    }
+
+    func start() {
+        guard task == nil else { return }
+        task = Task.detached { [weak self] in
+            while !Task.isCancelled {
+                guard let self else { return }
+                _ = await self.sweep()
+                do {
+                    try await Task.sleep(nanoseconds: UInt64(self.interval * 1_000_000_000))
+                } catch {
+                    return
+                }
+            }
+        }
+    }
+
+    func stop() {
+        task?.cancel()
+        task = nil
+    }
+
+    /// Runs one pass over every configured queue.
+    /// - Returns: Number of objects evicted.
+    @discardableResult
+    func sweep(now: Date = Date()) async -> Int {
+        var budget = budgetPerPass
+        var total = 0
+        for (queue, policy) in policies().sorted(by: { $0.key < $1.key }) where policy.isEnabled {
+            var evicted = 0
+            var bytes: Int64 = 0
+            while budget > 0, !Task.isCancelled {
+                let result: BoxRetentionResult
+                do {
+                    result = try await store.enforceRetention(queue: queue, policy: policy, now: now, limit: min(batchSize, budget))
+                } catch BoxStoreError.queueNotFound {
+                    break
+                } catch {
+                    logger.warning("retention sweep failed", metadata: ["queue": .string(queue), "error": .string("\(error)")])
+                    break
+                }
+                evicted += result.evicted
+                bytes += result.evictedBytes
+                budget -= result.evicted
+                guard result.hasMore, result.evicted > 0 else { break }
+                try? await Task.sleep(nanoseconds: UInt64(batchPause * 1_000_000_000))
+            }
+            if evicted > 0 {
+                logger.info("retention applied", metadata: [
+                    "queue": .string(queue),
+                    "evicted": .stringConvertible(evicted),
+                    "bytes": .stringConvertible(bytes)
+                ])
+            }
+            total += evicted
+        }
+        return total
+    }
+}
@@ -0,0 +1,186 @@
+import BoxCore
+import Foundation
+import Logging
+import NIOPosix
+
+/// Online store compaction driven by `box admin store compact [queue]` (SPECS §7.14).
+///
+/// One job runs at a time, in the background, as a sequence of short store calls separated by a
+/// pause, so PUT and GET traffic interleaves with it:
+/// - files left by interrupted atomic writes are removed;
+/// - a queue whose directory file is much larger than its entries need is rebuilt: live entries are
+///   hard-linked into a fresh directory in batches, which is swapped in by `finishRebuild`, then the
+///   replaced directory is emptied in batches;
+/// - primary blobs no reference link points to are deleted.
+/// Directory listings and the unlinks that follow them run on a NIO thread pool, never on the
+/// cooperative threads of this actor or of the store.
+/// Progress is reported by `progress()`, through the same admin command and `box admin stats`.
+actor StoreCompactor {
+    /// Snapshot of the current (or last) job.
+    struct Progress: Sendable {
+        enum State: String, Sendable {
+            case idle
+            case running
+            case completed
+            case failed
+        }
+
+        var state: State = .idle
+        /// Queue being processed.
+        var queue: String?
+        var queuesDone = 0
+        var queuesTotal = 0
+        var directoriesRebuilt = 0
+        var filesLinked = 0
+        var filesRemoved = 0
+        var bytesReclaimed: Int64 = 0
+        var startedAt: Date?
+        var finishedAt: Date?
+        var error: String?
+
+        /// Admin payload.
+        var payload: [String: Any] {
+            var payload: [String: Any] = [
+                "state": state.rawValue,
+                "queuesDone": queuesDone,
+                "queuesTotal": queuesTotal,
+                "directoriesRebuilt": directoriesRebuilt,
+                "filesLinked": filesLinked,
+                "filesRemoved": filesRemoved,
+                "bytesReclaimed": bytesReclaimed
+            ]
+            if let queue { payload["queue"] = queue }
+            if let startedAt { payload["startedAt"] = ISO8601DateFormatter().string(from: startedAt) }
+            if let finishedAt { payload["finishedAt"] = ISO8601DateFormatter().string(from: finishedAt) }
+            if let error { payload["error"] = error }
+            return payload
+        }
+    }
+
+    /// Files linked or unlinked per store call.
+    static let batchSize = 256
+    /// Directories below this size are never rebuilt.
+    static let minimumDirectoryBytes: Int64 = 64 * 1024
+    /// A directory is rebuilt when its file exceeds this many bytes per live entry.
+    static let bytesPerEntryThreshold: Int64 = 256
+
+    private let store: BoxServerStore
+    private let logger: Logger
+    private let pause: TimeInterval
+    private let threadPool: NIOThreadPool
+    private var current = Progress()
+    private var task: Task<Void, Never>?
+
+    /// Creates a compactor.
+    /// - Parameters:
+    ///   - store: Store to compact.
+    ///   - logger: Logger used for diagnostics.
+    ///   - pause: Delay between two batches, which throttles the job.
+    ///   - threadPool: Pool running the blocking directory listings and unlinks.
+    init(store: BoxServerStore, logger: Logger, pause: TimeInterval = 0.01, threadPool: NIOThreadPool = .singleton) {
+        self.store = store
+        self.logger = logger
+        self.pause = pause
+        self.threadPool = threadPool
+    }
+
+    /// Starts a job over `queue` (every queue when `nil`) unless one is running.
+    /// - Returns: Progress of the job now running.
+    func start(queue: String?) async -> Progress {
+        guard current.state != .running else { return current }
+        let queues: [String]
+        if let queue {
+            queues = [queue]
+        } else {
+            queues = await store.listQueues()
+        }
+        current = Progress(state: .running, queuesTotal: queues.count, startedAt: Date())
+        logger.info("store compaction started", metadata: ["queues": .stringConvertible(queues.count)])
+        task = Task { await self.run(queues: queues, sweepBlobs: queue == nil) }
+        return current
+    }
+
+    func progress() -> Progress {
+        current
+    }
+
+    /// Waits for the running job, if any (tests).
+    func wait() async {
+        await task?.value
+    }
+
+    func stop() {
+        task?.cancel()
+    }
+
+    private func run(queues: [String], sweepBlobs: Bool) async {
+        do {
+            for queue in queues {
+                current.queue = queue
+                try await compact(queue: queue)
+                current.queuesDone += 1
+            }
+            current.queue = nil
+            if sweepBlobs {
+                let store = store
+                for candidates in try await threadPool.runIfActive({ store.orphanBlobCandidates() }) where !candidates.isEmpty {
+                    try Task.checkCancellation()
+                    current.bytesReclaimed += await store.removeOrphanBlobs(candidates)
+                    try await throttle()
+                }
+            }
+            current.state = .completed
+        } catch {
+            current.state = .failed
+            current.error = "\(error)"
+            logger.warning("store compaction failed", metadata: ["queue": .string(current.queue ?? "-"), "error": .string("\(error)")])
+        }
+        current.finishedAt = Date()
+        logger.info("store compaction finished", metadata: [
+            "state": .string(current.state.rawValue),
+            "directoriesRebuilt": .stringConvertible(current.directoriesRebuilt),
+            "bytesReclaimed": .stringConvertible(current.bytesReclaimed)
+        ])
+    }
+
+    private func compact(queue: String) async throws {
+        let store = store
+        current.bytesReclaimed += try await threadPool.runIfActive { store.removeStaleTemporaryFiles(in: queue) }
+        let footprint = try await store.directoryFootprint(of: queue)
+        guard footprint.bytes >= Self.minimumDirectoryBytes,
+              footprint.bytes > Int64(footprint.entries) * Self.bytesPerEntryThreshold else { return }
+
+        let names = try await store.beginRebuild(of: queue)
+        do {
+            for start in stride(from: 0, to: names.count, by: Self.batchSize) {
+                try Task.checkCancellation()
+                current.filesLinked += try await store.continueRebuild(of: queue, names: names[start..<min(start + Self.batchSize, names.count)])
+                try await throttle()
+            }
+            guard let saved = try await store.finishRebuild(of: queue) else { return }
+            current.directoriesRebuilt += 1
+            current.bytesReclaimed += saved
+        } catch {
+            await store.cancelRebuild(of: queue)
+            throw error
+        }
+        // Listed once: the batches below only unlink.
+        let retired = try await threadPool.runIfActive { store.retiredDirectoryNames(of: queue) }
+        var start = 0
+        repeat {
+            let names = retired[start..<min(start + Self.batchSize, retired.count)]
+            start += names.count
+            let isLast = start == retired.count
+            current.filesRemoved += try await threadPool.runIfActive {
+                store.drainRetiredDirectory(of: queue, names: names, isLast: isLast)
+            }
+            if !isLast {
+                try await throttle()
+            }
+        } while start < retired.count
+    }
+
+    private func throttle() async throws {
+        try await Task.sleep(nanoseconds: UInt64(pause * 1_000_000_000))
+    }
+}
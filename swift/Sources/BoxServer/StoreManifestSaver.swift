@@ -0,0 +1,76 @@
+import BoxCore
+import Foundation
+import Logging
+
+/// Background task saving the store manifest (SPECS §7.12).
+///
+/// The store only copies its indexes; encoding and writing `<root>/.manifest` happen here, outside
+/// the store actor. A save is skipped when no index changed since the previous one, so an idle
+/// server does not rewrite the file. On clean shutdown `stop` waits for a periodic save in progress,
+/// then a final `save()` writes the last state: an older snapshot can never land after it.
+actor StoreManifestSaver {
+    private struct Mark: Equatable {
+        let generation: UInt64
+        let locations: Date?
+    }
+
+    private let store: BoxServerStore
+    private let locationCoordinator: LocationServiceCoordinator?
+    private let logger: Logger
+    private let interval: TimeInterval
+    private var task: Task<Void, Never>?
+    private var lastMark: Mark?
+
+    /// Creates a saver.
+    /// - Parameters:
+    ///   - store: Store whose indexes are saved.
+    ///   - locationCoordinator: Coordinator whose record index is saved alongside, if any.
+    ///   - logger: Logger used for diagnostics.
+    ///   - interval: Delay between two periodic saves.
+    init(store: BoxServerStore, locationCoordinator: LocationServiceCoordinator?, logger: Logger, interval: TimeInterval = 300) {
+        self.store = store
+        self.locationCoordinator = locationCoordinator
+        self.logger = logger
+        self.interval = interval
+    }
+
+    func start() {
+        guard task == nil else { return }
+        task = Task.detached { [weak self, interval] in
+            while !Task.isCancelled {
+                do {
+                    try await Task.sleep(nanoseconds: UInt64(interval * 1_000_000_000))
+                } catch {
+                    return
+                }
+                guard let self else { return }
+                await self.save()
+            }
+        }
+    }
+
+    /// Cancels the periodic saves and waits for the one in progress, if any.
+    func stop() async {
+        guard let task else { return }
+        self.task = nil
+        task.cancel()
+        await task.value
+    }
+
+    /// Writes the manifest unless nothing changed since the last successful save.
+    func save() async {
+        let locations = await locationCoordinator?.manifestLocations()
+        let (manifest, generation) = await store.manifestSnapshot(locations: locations)
+        let mark = Mark(generation: generation, locations: locations?.directoryModifiedAt)
+        // Saves are serialized by the actor except across the awaits above: a save that took its
+        // snapshot first must not overwrite a newer manifest.
+        guard mark != lastMark, mark.generation >= (lastMark?.generation ?? 0) else { return }
+        do {
+            try manifest.save(to: store.root)
+            lastMark = mark
+            logger.debug("store manifest saved", metadata: ["queues": .stringConvertible(manifest.queues.count)])
+        } catch {
+            logger.warning("failed to save store manifest", metadata: ["error": .string("\(error)")])
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#if !os(Windows)
+import Foundation
+import Logging
+import NIOConcurrencyHelpers
+import XCTest
+@testable import BoxServer
+
+#if os(Linux)
+import Glibc
+#else
+import Darwin
+#endif
+
+final class AddressChangeMonitorTests: XCTestCase {
+    func testParseNetlinkMessagesExtractsAddressEvents() {
+        var datagram: [UInt8] = []
+        datagram += addressMessage(type: 20, family: UInt8(AF_INET6), scope: 0, index: 2)
+        datagram += addressMessage(type: 21, family: UInt8(AF_INET), scope: 0, index: 3)
+
+        let events = AddressChangeMonitor.parseNetlinkMessages(datagram)
+        XCTAssertEqual(events.count, 2)
+        XCTAssertEqual(events[0], AddressChangeMonitor.Event(kind: .added, family: .ipv6, scope: 0, interfaceIndex: 2))
+        XCTAssertEqual(events[1], AddressChangeMonitor.Event(kind: .removed, family: .ipv4, scope: 0, interfaceIndex: 3))
+    }
+
+    func testParseNetlinkMessagesSkipsUnrelatedAndTruncatedMessages() {
+        var datagram: [UInt8] = []
+        // RTM_NEWLINK (16) must be ignored.
+        datagram += addressMessage(type: 16, family: UInt8(AF_INET), scope: 0, index: 1)
+        datagram += addressMessage(type: 20, family: UInt8(AF_INET), scope: 0, index: 4)
+        // Truncated trailing header.
+        datagram += [0x40, 0x00, 0x00, 0x00, 0x14, 0x00]
+
+        let events = AddressChangeMonitor.parseNetlinkMessages(datagram)
+        XCTAssertEqual(events, [AddressChangeMonitor.Event(kind: .added, family: .ipv4, scope: 0, interfaceIndex: 4)])
+    }
+
+    func testLinkAndHostScopedEventsDoNotAffectReachability() {
+        let link = AddressChangeMonitor.Event(kind: .added, family: .ipv6, scope: 253, interfaceIndex: 2)
+        let host = AddressChangeMonitor.Event(kind: .added, family: .ipv4, scope: 254, interfaceIndex: 1)
+        let global = AddressChangeMonitor.Event(kind: .removed, family: .ipv6, scope: 0, interfaceIndex: 2)
+        XCTAssertFalse(link.affectsReachability)
+        XCTAssertFalse(host.affectsReachability)
+        XCTAssertTrue(global.affectsReachability)
+    }
+
+    func testReportedEventsAreCoalescedUntilTheBurstIsQuiet() async throws {
+        let changes = NIOLockedValueBox<[AddressChangeMonitor.Change]>([])
+        let delivered = expectation(description: "change delivered")
+        let monitor = AddressChangeMonitor(logger: Logger(label: "test.address"), debounce: 0.1) { change in
+            changes.withLockedValue { $0.append(change) }
+            delivered.fulfill()
+        }
+        monitor.report([AddressChangeMonitor.Event(kind: .removed, family: .ipv6, scope: 0, interfaceIndex: 2)])
+        monitor.report([AddressChangeMonitor.Event(kind: .added, family: .ipv6, scope: 253, interfaceIndex: 2)])
+        monitor.report([
+            AddressChangeMonitor.Event(kind: .added, family: .ipv6, scope: 0, interfaceIndex: 2),
+            AddressChangeMonitor.Event(kind: .added, family: .ipv4, scope: 0, interfaceIndex: 3)
+        ])
+        await fulfillment(of: [delivered], timeout: 2)
+        try await Task.sleep(nanoseconds: 200_000_000)
+
+        let received = changes.withLockedValue { $0 }
+        XCTAssertEqual(received.count, 1, "one burst, one change")
+        XCTAssertEqual(received.first?.added, 2, "the link-scoped address is left out")
+        XCTAssertEqual(received.first?.removed, 1)
+        XCTAssertEqual(received.first?.families, [.ipv4, .ipv6])
+    }
+
+    /// Builds `nlmsghdr` + `ifaddrmsg` (plus one 8-byte attribute to exercise alignment) in host order.
+    private func addressMessage(type: UInt16, family: UInt8, scope: UInt8, index: UInt32) -> [UInt8] {
+        let length = UInt32(16 + 8 + 8)
+        var bytes: [UInt8] = []
+        bytes += withUnsafeBytes(of: length) { Array($0) }
+        bytes += withUnsafeBytes(of: type) { Array($0) }
+        bytes += [0, 0]
+        bytes += [0, 0, 0, 0]
+        bytes += [0, 0, 0, 0]
+        bytes += [family, 64, 0, scope]
+        bytes += withUnsafeBytes(of: index) { Array($0) }
+        bytes += [8, 0, 1, 0, 0, 0, 0, 0]
+        return bytes
+    }
+}
+#endif
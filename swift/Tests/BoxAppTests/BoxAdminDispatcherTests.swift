@@ -28,6 +28,14 @@ final class BoxAdminDispatcherTests: XCTestCase {
             syncRoots: {
                 XCTFail("sync-roots should not be called")
                 return ""
+            },
+            storeCompaction: { _, _ in
+                XCTFail("store compact should not be called")
+                return ""
+            },
+            snapshot: { _, _ in
+                XCTFail("snapshot should not be called")
+                return ""
             }
         )
 
@@ -62,7 +70,9 @@ final class BoxAdminDispatcherTests: XCTestCase {
             locateNode: { _ in "" },
             natProbe: { _ in "" },
             locationSummaryProvider: { "" },
-            syncRoots: { "" }
+            syncRoots: { "" },
+            storeCompaction: { _, _ in "" },
+            snapshot: { _, _ in "" }
         )
 
         let response = await dispatcher.process("log-target stdout")
@@ -85,7 +95,9 @@ final class BoxAdminDispatcherTests: XCTestCase {
             locateNode: { _ in "" },
             natProbe: { _ in "" },
             locationSummaryProvider: { "" },
-            syncRoots: { "" }
+            syncRoots: { "" },
+            storeCompaction: { _, _ in "" },
+            snapshot: { _, _ in "" }
         )
 
         let response = await dispatcher.process("log-target {\"target\":\"stderr\"}")
@@ -108,7 +120,9 @@ final class BoxAdminDispatcherTests: XCTestCase {
             locateNode: { _ in "" },
             natProbe: { _ in "" },
             locationSummaryProvider: { "" },
-            syncRoots: { "" }
+            syncRoots: { "" },
+            storeCompaction: { _, _ in "" },
+            snapshot: { _, _ in "" }
         )
 
         let response = await dispatcher.process("reload-config {\"path\":\"~/config.plist\"}")
@@ -148,7 +162,9 @@ final class BoxAdminDispatcherTests: XCTestCase {
             locateNode: { _ in "" },
             natProbe: { _ in "" },
             locationSummaryProvider: { "" },
-            syncRoots: { "" }
+            syncRoots: { "" },
+            storeCompaction: { _, _ in "" },
+            snapshot: { _, _ in "" }
         )
 
         let response = await dispatcher.process("stats")
@@ -170,7 +186,9 @@ final class BoxAdminDispatcherTests: XCTestCase {
                 return "{\"status\":\"ok\"}"
             },
             locationSummaryProvider: { "" },
-            syncRoots: { "" }
+            syncRoots: { "" },
+            storeCompaction: { _, _ in "" },
+            snapshot: { _, _ in "" }
         )
 
         let response = await dispatcher.process("nat-probe 192.0.2.1")
@@ -191,7 +209,9 @@ final class BoxAdminDispatcherTests: XCTestCase {
                 expectation.fulfill()
                 return "{\"status\":\"ok\"}"
             },
-            syncRoots: { "" }
+            syncRoots: { "" },
+            storeCompaction: { _, _ in "" },
+            snapshot: { _, _ in "" }
         )
 
         let response = await dispatcher.process("location-summary")
@@ -199,6 +219,32 @@ final class BoxAdminDispatcherTests: XCTestCase {
         await fulfillment(of: [expectation], timeout: 0.1)
     }
 
+    func testStoreCompactParsesQueueAndStatus() async throws {
+        let dispatcher = fixtureDispatcher()
+        var response = await dispatcher.process("store compact")
+        XCTAssertEqual(response, "compact * false")
+        response = await dispatcher.process("store compact /INBOX")
+        XCTAssertEqual(response, "compact /INBOX false")
+        response = await dispatcher.process("store compact {\"queue\":\"whoswho\"}")
+        XCTAssertEqual(response, "compact whoswho false")
+        response = await dispatcher.process("store compact-status")
+        XCTAssertEqual(response, "compact * true")
+        response = await dispatcher.process("store compactfoo")
+        assertJSON(response, equals: ["status": "error", "message": "unknown-command", "command": "store compactfoo"])
+    }
+
+    func testSnapshotParsesPathAndBase() async throws {
+        let dispatcher = fixtureDispatcher()
+        var response = await dispatcher.process("snapshot /backup/box-1")
+        XCTAssertEqual(response, "snapshot /backup/box-1 -")
+        response = await dispatcher.process("snapshot {\"path\":\"/backup/box-2\",\"base\":\"/backup/box-1\"}")
+        XCTAssertEqual(response, "snapshot /backup/box-2 /backup/box-1")
+        response = await dispatcher.process("snapshot")
+        XCTAssertTrue(response.contains("missing-snapshot-path"))
+        response = await dispatcher.process("snapshotx")
+        assertJSON(response, equals: ["status": "error", "message": "unknown-command", "command": "snapshotx"])
+    }
+
     private func fixtureDispatcher() -> BoxAdminCommandDispatcher {
         BoxAdminCommandDispatcher(
             statusProvider: { "status" },
@@ -208,7 +254,9 @@ final class BoxAdminDispatcherTests: XCTestCase {
             locateNode: { _ in "locate" },
             natProbe: { _ in "probe" },
             locationSummaryProvider: { "summary" },
-            syncRoots: { "sync" }
+            syncRoots: { "sync" },
+            storeCompaction: { queue, statusOnly in "compact \(queue ?? "*") \(statusOnly)" },
+            snapshot: { path, base in "snapshot \(path) \(base ?? "-")" }
         )
     }
 }
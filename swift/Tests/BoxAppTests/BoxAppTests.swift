@@ -45,6 +45,121 @@ final class BoxAppTests: XCTestCase {
         XCTAssertEqual(decoded.data, payload.data)
     }
 
+    /// Verifies GET cursor extensions and the object id trailer of PUT responses.
+    func testCursorPayloadsRoundTrip() throws {
+        let allocator = ByteBufferAllocator()
+        let operations: [BoxCodec.CursorOperation] = [
+            .next, .commit(UUID()), .seek(Date(timeIntervalSince1970: 1_700_000_000.5)), .seek(nil),
+            .lease(visibility: 2.5), .lease(visibility: nil), .ack(UUID())
+        ]
+        for operation in operations {
+            let request = BoxCodec.CursorRequest(name: "indexer", operation: operation)
+            var buffer = BoxCodec.encodeGetPayload(BoxCodec.GetPayload(queuePath: "/alerts", cursor: request), allocator: allocator)
+            let decoded = try BoxCodec.decodeGetPayload(from: &buffer)
+            XCTAssertEqual(decoded.queuePath, "/alerts")
+            XCTAssertEqual(decoded.cursor, request)
+        }
+
+        var plain = BoxCodec.encodeGetPayload(BoxCodec.GetPayload(queuePath: "/alerts"), allocator: allocator)
+        XCTAssertNil(try BoxCodec.decodeGetPayload(from: &plain).cursor)
+
+        let objectId = UUID()
+        var put = BoxCodec.encodePutPayload(BoxCodec.PutPayload(queuePath: "/alerts", contentType: "text/plain", data: [1, 2], objectId: objectId), allocator: allocator)
+        XCTAssertEqual(try BoxCodec.decodePutPayload(from: &put).objectId, objectId)
+    }
+
+    /// Verifies the delayed-delivery trailer of PUT, with and without an object id in front of it.
+    func testPutPayloadCarriesNotBefore() throws {
+        let allocator = ByteBufferAllocator()
+        let notBefore = Date(timeIntervalSince1970: 1_700_000_000.25)
+        var delayed = BoxCodec.encodePutPayload(BoxCodec.PutPayload(queuePath: "/jobs", contentType: "text/plain", data: [1], notBefore: notBefore), allocator: allocator)
+        let decoded = try BoxCodec.decodePutPayload(from: &delayed)
+        XCTAssertNil(decoded.objectId)
+        XCTAssertEqual(decoded.notBefore, notBefore)
+
+        let objectId = UUID()
+        var both = BoxCodec.encodePutPayload(BoxCodec.PutPayload(queuePath: "/jobs", contentType: "text/plain", data: [1], objectId: objectId, notBefore: notBefore), allocator: allocator)
+        let decodedBoth = try BoxCodec.decodePutPayload(from: &both)
+        XCTAssertEqual(decodedBoth.objectId, objectId)
+        XCTAssertEqual(decodedBoth.notBefore, notBefore)
+
+        var urgent = BoxCodec.encodePutPayload(BoxCodec.PutPayload(queuePath: "/jobs", contentType: "text/plain", data: [1], priority: 9), allocator: allocator)
+        let decodedUrgent = try BoxCodec.decodePutPayload(from: &urgent)
+        XCTAssertNil(decodedUrgent.objectId)
+        XCTAssertNil(decodedUrgent.notBefore)
+        XCTAssertEqual(decodedUrgent.priority, BoxCodec.maxPriority, "priorities are clamped")
+    }
+
+    /// Verifies the encoding byte of PUT and the accepted-encodings flag of GET, with and without a cursor.
+    func testCompressionIsNegotiatedPerFrame() throws {
+        let allocator = ByteBufferAllocator()
+        let text = Array(String(repeating: "{\"status\":\"online\"}", count: 40).utf8)
+        let frame = try XCTUnwrap(BoxCompression.compress(text))
+        var put = BoxCodec.encodePutPayload(BoxCodec.PutPayload(queuePath: "/INBOX", contentType: "application/json", data: frame, encoding: .lz4), allocator: allocator)
+        let decodedPut = try BoxCodec.decodePutPayload(from: &put)
+        XCTAssertEqual(decodedPut.encoding, .lz4)
+        XCTAssertEqual(decodedPut.priority, 0)
+        XCTAssertEqual(try BoxCompression.decode(decodedPut.data, encoding: decodedPut.encoding), text)
+
+        var plain = BoxCodec.encodeGetPayload(BoxCodec.GetPayload(queuePath: "/INBOX", acceptsCompression: true), allocator: allocator)
+        let decodedPlain = try BoxCodec.decodeGetPayload(from: &plain)
+        XCTAssertNil(decodedPlain.cursor)
+        XCTAssertTrue(decodedPlain.acceptsCompression)
+
+        let request = BoxCodec.CursorRequest(name: "indexer", operation: .next)
+        var cursor = BoxCodec.encodeGetPayload(BoxCodec.GetPayload(queuePath: "/INBOX", cursor: request, acceptsCompression: true), allocator: allocator)
+        let decodedCursor = try BoxCodec.decodeGetPayload(from: &cursor)
+        XCTAssertEqual(decodedCursor.cursor, request)
+        XCTAssertTrue(decodedCursor.acceptsCompression)
+
+        var legacy = BoxCodec.encodeGetPayload(BoxCodec.GetPayload(queuePath: "/INBOX", cursor: request), allocator: allocator)
+        XCTAssertFalse(try BoxCodec.decodeGetPayload(from: &legacy).acceptsCompression)
+
+        var search = BoxCodec.encodeSearchPayload(BoxCodec.SearchPayload(queuePath: "/INBOX", acceptsCompression: true), allocator: allocator)
+        let decodedSearch = try BoxCodec.decodeSearchPayload(from: &search)
+        XCTAssertEqual(decodedSearch.queuePath, "/INBOX")
+        XCTAssertTrue(decodedSearch.acceptsCompression)
+
+        var legacySearch = BoxCodec.encodeSearchPayload(BoxCodec.SearchPayload(queuePath: "/INBOX"), allocator: allocator)
+        XCTAssertFalse(try BoxCodec.decodeSearchPayload(from: &legacySearch).acceptsCompression)
+    }
+
+    /// Verifies the chunk trailer of PUT frames carrying one slice of a large object.
+    func testChunkedPutPayloadRoundTrip() throws {
+        let allocator = ByteBufferAllocator()
+        let chunk = BoxCodec.ChunkInfo(index: 2, count: 5)
+        var buffer = BoxCodec.encodePutPayload(
+            BoxCodec.PutPayload(queuePath: "/media", contentType: "video/mp4", data: [1, 2, 3], chunk: chunk),
+            allocator: allocator
+        )
+        let decoded = try BoxCodec.decodePutPayload(from: &buffer)
+        XCTAssertEqual(decoded.chunk, chunk)
+        XCTAssertEqual(decoded.encoding, .identity)
+        XCTAssertEqual(decoded.data, [1, 2, 3])
+
+        var whole = BoxCodec.encodePutPayload(BoxCodec.PutPayload(queuePath: "/media", contentType: "video/mp4", data: [1]), allocator: allocator)
+        XCTAssertNil(try BoxCodec.decodePutPayload(from: &whole).chunk)
+
+        var invalid = BoxCodec.encodePutPayload(
+            BoxCodec.PutPayload(queuePath: "/media", contentType: "video/mp4", data: [1], chunk: BoxCodec.ChunkInfo(index: 5, count: 5)),
+            allocator: allocator
+        )
+        XCTAssertThrowsError(try BoxCodec.decodePutPayload(from: &invalid))
+    }
+
+    /// Verifies DELETE payload encoding/decoding symmetry and the batch limit.
+    func testDeletePayloadRoundTrip() throws {
+        let allocator = ByteBufferAllocator()
+        let targets: [BoxCodec.DeleteTarget] = [.id(UUID()), .digest(BoxContentDigest(of: Array("hello".utf8)))]
+        var buffer = try BoxCodec.encodeDeletePayload(BoxCodec.DeletePayload(queuePath: "/INBOX", targets: targets), allocator: allocator)
+        let decoded = try BoxCodec.decodeDeletePayload(from: &buffer)
+        XCTAssertEqual(decoded.queuePath, "/INBOX")
+        XCTAssertEqual(decoded.targets, targets)
+
+        let oversized = BoxCodec.DeletePayload(queuePath: "/INBOX", targets: Array(repeating: .id(UUID()), count: BoxCodec.maxDeleteTargets + 1))
+        XCTAssertThrowsError(try BoxCodec.encodeDeletePayload(oversized, allocator: allocator))
+    }
+
     /// Verifies STATUS payload encoding/decoding symmetry.
     func testStatusPayloadRoundTrip() throws {
         let allocator = ByteBufferAllocator()
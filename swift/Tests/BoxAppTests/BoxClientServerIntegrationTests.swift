@@ -1,6 +1,8 @@
 import XCTest
+import Crypto
 import Foundation
 import Logging
+import NIOPosix
 #if canImport(Darwin)
 import Darwin
 #elseif canImport(Glibc)
@@ -56,6 +58,135 @@ final class BoxClientServerIntegrationTests: XCTestCase {
         XCTAssertTrue(entries.isEmpty, "Handshake should not enqueue any object")
     }
 
+    func testHandshakeVerifiesPinnedServerKey() async throws {
+        let port = try allocateEphemeralUDPPort()
+        let serverConfiguration = try makeServerConfiguration(port: port, adminEnabled: false)
+        let context = try await startServer(
+            configurationData: serverConfiguration.data,
+            forcedPort: port,
+            adminChannelEnabled: false
+        )
+        defer { context.tearDown() }
+        try await context.waitForQueueInfrastructure()
+
+        func options(pinning key: [UInt8]?) -> BoxRuntimeOptions {
+            BoxRuntimeOptions(
+                mode: .client,
+                address: "127.0.0.1",
+                port: port,
+                portOrigin: .cliFlag,
+                addressOrigin: .cliFlag,
+                configurationPath: context.configurationURL.path,
+                adminChannelEnabled: false,
+                logLevel: .info,
+                logTarget: .stderr,
+                logLevelOrigin: .default,
+                logTargetOrigin: .default,
+                nodeId: serverConfiguration.nodeId,
+                userId: serverConfiguration.userId,
+                portMappingRequested: false,
+                clientAction: .handshake,
+                portMappingOrigin: .default,
+                rootServers: [],
+                serverPublicKey: key
+            )
+        }
+
+        // The server binds after loading its node identity.
+        try await BoxClient.run(with: options(pinning: nil))
+        let keyDirectory = context.homeDirectory.appendingPathComponent(".box/keys", isDirectory: true)
+        let nodeKey = try await BoxNoiseKeyStore(baseDirectory: keyDirectory).loadIdentity(for: .node).publicKey
+        try await BoxClient.run(with: options(pinning: nodeKey))
+
+        let impostor = Array(Curve25519.Signing.PrivateKey().publicKey.rawRepresentation)
+        do {
+            try await BoxClient.run(with: options(pinning: impostor))
+            XCTFail("a server signing with another key must be rejected")
+        } catch {
+            XCTAssertEqual(error as? BoxSessionError, .invalidSignature)
+        }
+    }
+
+    func testMirrorBatchRequiresSessionSignedBySourceNode() async throws {
+        let port = try allocateEphemeralUDPPort()
+        let serverConfiguration = try makeServerConfiguration(port: port, adminEnabled: false)
+        let context = try await startServer(
+            configurationData: serverConfiguration.data,
+            forcedPort: port,
+            adminChannelEnabled: false
+        )
+        defer { context.tearDown() }
+        try await context.waitForQueueInfrastructure()
+
+        let keyDirectory = context.homeDirectory.appendingPathComponent(".box/keys", isDirectory: true)
+        let group = MultiThreadedEventLoopGroup(numberOfThreads: 1)
+        defer { try? group.syncShutdownGracefully() }
+        let node = serverConfiguration.nodeId
+        let batch = try BoxMirrorBatch(source: node, queue: "INBOX", epoch: UUID(), first: nil, last: nil, purge: true, base: 0, entries: []).encoded()
+
+        func connection(signingWith identity: BoxIdentityMaterial?) -> BoxClientConnection {
+            BoxClientConnection(
+                group: group,
+                address: "127.0.0.1",
+                port: port,
+                nodeId: node,
+                userId: serverConfiguration.userId,
+                serverPublicKey: identity?.publicKey,
+                helloSigner: { transcript in try? identity?.signature(for: transcript) },
+                retransmitInterval: .milliseconds(200),
+                logger: Logger(label: "box.tests.mirror")
+            )
+        }
+
+        // Headers alone prove nothing: an anonymous session cannot pose as the node.
+        let anonymous = connection(signingWith: nil)
+        do {
+            try await anonymous.put(queuePath: "INBOX", contentType: BoxMirrorBatch.contentType, data: [UInt8](batch))
+            XCTFail("a mirror batch over an anonymous session must be refused")
+        } catch let BoxClientError.remoteRejected(status, message) {
+            XCTAssertEqual(status, .forbidden)
+            XCTAssertEqual(message, "mirror-forbidden")
+        }
+        await anonymous.close()
+
+        // The node's own record advertises its key once presence is published.
+        let identity = try await BoxNoiseKeyStore(baseDirectory: keyDirectory).loadIdentity(for: .node)
+        var accepted: String?
+        for _ in 0..<50 where accepted == nil {
+            let signed = connection(signingWith: identity)
+            accepted = try? await signed.put(queuePath: "INBOX", contentType: BoxMirrorBatch.contentType, data: [UInt8](batch))
+            await signed.close()
+            if accepted == nil {
+                try await Task.sleep(nanoseconds: 100_000_000)
+            }
+        }
+        XCTAssertEqual(accepted, "mirrored 0")
+
+        // A batch larger than one datagram travels in acknowledged chunks.
+        let content = Data((0..<200_000).map { _ in UInt8.random(in: 0...255) })
+        let stored = BoxStoredObject(contentType: "application/octet-stream", data: [UInt8](content), createdAt: Date(), nodeId: node, userId: serverConfiguration.userId)
+        let name = "\(stored.id.uuidString).json"
+        let large = try BoxMirrorBatch(
+            source: node,
+            queue: "INBOX",
+            epoch: UUID(),
+            first: nil,
+            last: nil,
+            purge: true,
+            base: 1,
+            entries: [BoxMirrorBatch.Entry(seq: 0, name: name, removed: nil, object: BoxMirrorBatch.Object(stored))]
+        ).encoded()
+        XCTAssertGreaterThan(large.count, 4 * BoxCodec.maxChunkSize)
+        let signed = connection(signingWith: identity)
+        let reply = try await signed.put(queuePath: "INBOX", contentType: BoxMirrorBatch.contentType, data: [UInt8](large))
+        await signed.close()
+        XCTAssertEqual(reply, "mirrored 1")
+        let copy = context.homeDirectory
+            .appendingPathComponent(".box/queues", isDirectory: true)
+            .appendingPathComponent(BoxMirrorBatch.mirrorQueueName(of: "INBOX", source: node), isDirectory: true)
+        XCTAssertTrue(FileManager.default.fileExists(atPath: copy.appendingPathComponent(name).path))
+    }
+
     func testPutAndGetRoundTrip() async throws {
         let port = try allocateEphemeralUDPPort()
         let serverConfiguration = try makeServerConfiguration(port: port, adminEnabled: false)
@@ -203,6 +334,133 @@ final class BoxClientServerIntegrationTests: XCTestCase {
         XCTAssertEqual(afterSecondRead.count, 1, "Permanent queue should continue to retain messages after repeated GET operations")
     }
 
+    func testDeleteAcknowledgesPermanentQueueEntries() async throws {
+        let port = try allocateEphemeralUDPPort()
+        let serverConfiguration = try makeServerConfiguration(port: port, adminEnabled: false, permanentQueues: ["INBOX"])
+        let context = try await startServer(
+            configurationData: serverConfiguration.data,
+            forcedPort: port,
+            adminChannelEnabled: false
+        )
+        defer { context.tearDown() }
+
+        try await context.waitForQueueInfrastructure()
+
+        func options(_ action: BoxClientAction) -> BoxRuntimeOptions {
+            BoxRuntimeOptions(
+                mode: .client,
+                address: "127.0.0.1",
+                port: port,
+                portOrigin: .cliFlag,
+                addressOrigin: .cliFlag,
+                configurationPath: context.configurationURL.path,
+                adminChannelEnabled: false,
+                logLevel: .info,
+                logTarget: .stderr,
+                logLevelOrigin: .default,
+                logTargetOrigin: .default,
+                nodeId: serverConfiguration.nodeId,
+                userId: serverConfiguration.userId,
+                portMappingRequested: false,
+                clientAction: action,
+                portMappingOrigin: .default,
+                rootServers: []
+            )
+        }
+
+        let processed = Array("processed".utf8)
+        try await BoxClient.run(with: options(.put(queuePath: "INBOX", contentType: "text/plain", data: processed)))
+        try await BoxClient.run(with: options(.put(queuePath: "INBOX", contentType: "text/plain", data: processed)))
+        try await BoxClient.run(with: options(.put(queuePath: "INBOX", contentType: "text/plain", data: Array("pending".utf8))))
+
+        let queuesRoot = context.homeDirectory.appendingPathComponent(".box/queues", isDirectory: true)
+        let store = try await BoxServerStore(root: queuesRoot, logger: Logger(label: "box.tests.store.delete"))
+        let stored = try await store.list(queue: "INBOX")
+        XCTAssertEqual(stored.count, 3)
+
+        let unknown = UUID()
+        let targets: [BoxCodec.DeleteTarget] = [.digest(BoxContentDigest(of: processed)), .id(unknown)]
+        try await BoxClient.run(with: options(.delete(queuePath: "INBOX", targets: targets)))
+
+        let remaining = try await store.list(queue: "INBOX")
+        XCTAssertEqual(remaining.count, 1, "DELETE by digest should remove every copy of the acknowledged payload")
+        let survivor = try await store.read(reference: remaining[0])
+        XCTAssertEqual(survivor.data, Array("pending".utf8))
+    }
+
+    func testCursorStreamsPermanentQueue() async throws {
+        let port = try allocateEphemeralUDPPort()
+        let serverConfiguration = try makeServerConfiguration(port: port, adminEnabled: false, permanentQueues: ["INBOX"])
+        let context = try await startServer(
+            configurationData: serverConfiguration.data,
+            forcedPort: port,
+            adminChannelEnabled: false
+        )
+        defer { context.tearDown() }
+
+        try await context.waitForQueueInfrastructure()
+
+        func options(_ action: BoxClientAction) -> BoxRuntimeOptions {
+            BoxRuntimeOptions(
+                mode: .client,
+                address: "127.0.0.1",
+                port: port,
+                portOrigin: .cliFlag,
+                addressOrigin: .cliFlag,
+                configurationPath: context.configurationURL.path,
+                adminChannelEnabled: false,
+                logLevel: .info,
+                logTarget: .stderr,
+                logLevelOrigin: .default,
+                logTargetOrigin: .default,
+                nodeId: serverConfiguration.nodeId,
+                userId: serverConfiguration.userId,
+                portMappingRequested: false,
+                clientAction: action,
+                portMappingOrigin: .default,
+                rootServers: []
+            )
+        }
+
+        for text in ["first", "second"] {
+            try await BoxClient.run(with: options(.put(queuePath: "INBOX", contentType: "text/plain", data: Array(text.utf8))))
+        }
+
+        let consume = options(.cursor(queuePath: "INBOX", cursor: "reader", operation: .next))
+        try await BoxClient.run(with: consume)
+        try await BoxClient.run(with: consume)
+        do {
+            try await BoxClient.run(with: consume)
+            XCTFail("Cursor should report the end of the queue")
+        } catch BoxClientError.remoteRejected(let status, let message) {
+            XCTAssertEqual(status, .notFound)
+            XCTAssertEqual(message, "end-of-queue")
+        }
+
+        let queuesRoot = context.homeDirectory.appendingPathComponent(".box/queues", isDirectory: true)
+        let store = try await BoxServerStore(root: queuesRoot, logger: Logger(label: "box.tests.store.cursor"))
+        let stored = try await store.list(queue: "INBOX")
+        XCTAssertEqual(stored.count, 2, "Cursor reads must not consume the permanent queue")
+        let other = try await store.next(queue: "INBOX", cursor: "other")
+        XCTAssertNotNil(other, "A fresh cursor starts at the oldest object")
+
+        try await BoxClient.run(with: options(.cursor(queuePath: "INBOX", cursor: "reader", operation: .seek(nil))))
+        let rewound = try await store.next(queue: "INBOX", cursor: "reader")
+        XCTAssertEqual(rewound?.id, other?.id)
+
+        let leased = try await store.put(BoxStoredObject(contentType: "text/plain", data: Array("job".utf8), nodeId: UUID(), userId: UUID()), into: "jobs")
+        try await BoxClient.run(with: options(.cursor(queuePath: "jobs", cursor: "worker", operation: .lease(visibility: 5))))
+        let jobs = try await store.list(queue: "jobs")
+        XCTAssertFalse(jobs.contains { $0.id == leased }, "Acknowledged lease should delete the object")
+
+        // A lease larger than one frame arrives in slices, each carrying the id the worker acknowledges.
+        let payload = (0..<(3 * BoxCodec.maxChunkSize + 17)).map { _ in UInt8.random(in: 0...255) }
+        let large = try await store.put(BoxStoredObject(contentType: "application/octet-stream", data: payload, nodeId: UUID(), userId: UUID()), into: "jobs")
+        try await BoxClient.run(with: options(.cursor(queuePath: "jobs", cursor: "worker", operation: .lease(visibility: 5))))
+        let remainingJobs = try await store.list(queue: "jobs")
+        XCTAssertFalse(remainingJobs.contains { $0.id == large }, "A sliced lease should be delivered and acknowledged")
+    }
+
     func testLocateRequestSucceedsForKnownClient() async throws {
         let port = try allocateEphemeralUDPPort()
         let serverConfiguration = try makeServerConfiguration(port: port, adminEnabled: false)
@@ -0,0 +1,52 @@
+import BoxCore
+import Foundation
+import XCTest
+
+final class BoxCompressionTests: XCTestCase {
+    func testRoundTripAcrossSizesAndShapes() throws {
+        let record = Array(#"{"node_uuid":"776BA464-BA07-4B6D-B102-11D5D9917C6F","addresses":[{"ip":"2001:db8::1","port":12567}]}"#.utf8)
+        var generator = SystemRandomNumberGenerator()
+        let samples: [[UInt8]] = [
+            [],
+            Array("short".utf8),
+            Array(repeating: 0x61, count: 13),
+            Array(repeating: 0x61, count: 70_000),
+            (0..<4_096).map { _ in UInt8.random(in: 0...255, using: &generator) },
+            (0..<200).flatMap { _ in record }
+        ]
+        for sample in samples {
+            // Incompressible input is refused; everything else must expand back to the original bytes.
+            guard let frame = BoxCompression.compress(sample) else { continue }
+            XCTAssertLessThan(frame.count, sample.count)
+            XCTAssertEqual(try BoxCompression.decompress(frame), sample)
+        }
+        let json = (0..<200).flatMap { _ in record }
+        let frame = try XCTUnwrap(BoxCompression.compress(json))
+        XCTAssertLessThan(frame.count, json.count / 10, "repetitive JSON shrinks by an order of magnitude")
+        XCTAssertNil(BoxCompression.compress(Array("tiny".utf8)))
+    }
+
+    func testMalformedFramesAreRejected() throws {
+        let text = Array(String(repeating: "hello box ", count: 100).utf8)
+        let frame = try XCTUnwrap(BoxCompression.compress(text))
+        XCTAssertThrowsError(try BoxCompression.decompress(Array(frame.dropLast(3))))
+        XCTAssertThrowsError(try BoxCompression.decompress([0, 0]))
+
+        var wrongSize = frame
+        wrongSize[3] &+= 1
+        XCTAssertThrowsError(try BoxCompression.decompress(wrongSize))
+
+        // A forged header may not make the reader allocate beyond the limit.
+        XCTAssertThrowsError(try BoxCompression.decompress([0xFF, 0xFF, 0xFF, 0xFF, 0x00])) { error in
+            XCTAssertEqual(error as? BoxCompressionError, .tooLarge)
+        }
+    }
+
+    func testOnlyTextLikeContentIsCompressed() {
+        XCTAssertTrue(BoxCompression.shouldCompress(contentType: "application/json; charset=utf-8", size: 4_096))
+        XCTAssertTrue(BoxCompression.shouldCompress(contentType: "text/plain", size: 4_096))
+        XCTAssertTrue(BoxCompression.shouldCompress(contentType: "application/activity+json", size: 4_096))
+        XCTAssertFalse(BoxCompression.shouldCompress(contentType: "image/jpeg", size: 4_096))
+        XCTAssertFalse(BoxCompression.shouldCompress(contentType: "text/plain", size: BoxCompression.minimumSize - 1))
+    }
+}
@@ -31,7 +31,15 @@ final class BoxConfigurationTests: XCTestCase {
             "port_mapping": true,
             "external_address": "198.51.100.4",
             "external_port": 16000,
-            "permanent_queues": ["INBOX", "alerts"]
+            "permanent_queues": ["INBOX", "alerts"],
+            "replay_window": 4096,
+            "hello_cookie_threshold": 64,
+            "queue_retention": ["INBOX": ["max_age": 86_400, "max_count": 1_000]],
+            "disk_high_watermark": 97,
+            "disk_low_watermark": 92,
+            "lease_visibility_timeout": 120,
+            "lease_max_in_flight": 16,
+            "volatile_queues": ["telemetry": ["capacity": 128, "overflow": "spill"]]
         ],
             "client": [
                 "log_level": "error",
@@ -65,6 +73,14 @@ final class BoxConfigurationTests: XCTestCase {
         XCTAssertEqual(configuration.server.externalAddress, "198.51.100.4")
         XCTAssertEqual(configuration.server.externalPort, 16000)
         XCTAssertEqual(configuration.server.permanentQueues ?? [], ["INBOX", "alerts"])
+        XCTAssertEqual(configuration.server.replayWindow, 4096)
+        XCTAssertEqual(configuration.server.helloCookieThreshold, 64)
+        XCTAssertEqual(configuration.server.queueRetention?["INBOX"], BoxConfiguration.QueueRetention(maxAge: 86_400, maxCount: 1_000))
+        XCTAssertEqual(configuration.server.diskHighWatermark, 97)
+        XCTAssertEqual(configuration.server.diskLowWatermark, 92)
+        XCTAssertEqual(configuration.server.leaseVisibilityTimeout, 120)
+        XCTAssertEqual(configuration.server.leaseMaxInFlight, 16)
+        XCTAssertEqual(configuration.server.volatileQueues?["telemetry"], BoxConfiguration.VolatileQueue(capacity: 128, overflow: "spill"))
 
         XCTAssertEqual(configuration.client.logLevel, Logger.Level.error)
         XCTAssertEqual(configuration.client.logTarget, "file:/tmp/box.log")
@@ -0,0 +1,48 @@
+import BoxCore
+import Foundation
+import NIOCore
+import XCTest
+
+/// Unit tests covering the stateless HELLO cookie mechanism.
+final class BoxHelloCookieTests: XCTestCase {
+    func testLoadIsMeasuredPerSecond() {
+        let start = Date()
+        var jar = BoxHelloCookieJar(threshold: 2, now: start)
+        XCTAssertFalse(jar.recordHandshake(now: start))
+        XCTAssertFalse(jar.recordHandshake(now: start.addingTimeInterval(0.1)))
+        XCTAssertTrue(jar.recordHandshake(now: start.addingTimeInterval(0.2)))
+        XCTAssertFalse(jar.recordHandshake(now: start.addingTimeInterval(1.5)), "a new window resets the count")
+
+        var strict = BoxHelloCookieJar(threshold: 0, now: start)
+        XCTAssertTrue(strict.recordHandshake(now: start))
+    }
+
+    func testCookieIsBoundToAddressAndSurvivesOneRotation() {
+        let start = Date()
+        var jar = BoxHelloCookieJar(now: start)
+        let address = Array("192.0.2.1|12567".utf8)
+        let cookie = jar.cookie(for: address)
+        XCTAssertEqual(cookie.count, BoxHelloCookieJar.cookieSize)
+        XCTAssertTrue(jar.validate(cookie, for: address))
+        XCTAssertFalse(jar.validate(cookie, for: Array("192.0.2.1|12568".utf8)))
+        XCTAssertFalse(jar.validate(Array(cookie.dropLast()), for: address))
+
+        jar.rotateIfNeeded(now: start.addingTimeInterval(BoxHelloCookieJar.rotationInterval))
+        XCTAssertTrue(jar.validate(cookie, for: address), "previous secret still accepted")
+        XCTAssertNotEqual(jar.cookie(for: address), cookie)
+
+        jar.rotateIfNeeded(now: start.addingTimeInterval(2 * BoxHelloCookieJar.rotationInterval))
+        XCTAssertFalse(jar.validate(cookie, for: address))
+    }
+
+    func testCookieExtensionRoundTrip() throws {
+        let allocator = ByteBufferAllocator()
+        let cookie = [UInt8](repeating: 0xab, count: BoxHelloCookieJar.cookieSize)
+        let hello = BoxCodec.HelloPayload(status: .rateLimited, supportedVersions: [1], cookie: cookie)
+        var buffer = try BoxCodec.encodeHelloPayload(hello, allocator: allocator)
+        let decoded = try BoxCodec.decodeHelloPayload(from: &buffer)
+        XCTAssertEqual(decoded.status, .rateLimited)
+        XCTAssertEqual(decoded.cookie, cookie)
+        XCTAssertNil(decoded.keyShare)
+    }
+}
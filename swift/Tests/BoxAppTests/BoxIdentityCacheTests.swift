@@ -0,0 +1,97 @@
+import XCTest
+import Foundation
+@testable import BoxCore
+
+final class BoxIdentityCacheTests: XCTestCase {
+    func testKeyStorePopulatesCacheAndSignsWithoutActorHop() async throws {
+        let tempDirectory = FileManager.default.temporaryDirectory.appendingPathComponent("box-identity-cache-\(UUID().uuidString)", isDirectory: true)
+        try FileManager.default.createDirectory(at: tempDirectory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: tempDirectory) }
+
+        let store = try BoxNoiseKeyStore(baseDirectory: tempDirectory)
+        XCTAssertNil(store.cache.snapshot.nodeMaterial)
+
+        let identity = try await store.ensureIdentity(for: .node)
+        let snapshot = store.cache.snapshot
+        XCTAssertEqual(snapshot.nodeMaterial, identity)
+        XCTAssertEqual(snapshot.generation, 1)
+
+        let message = Array("transcript".utf8)
+        let signature = try XCTUnwrap(snapshot.signWithNodeKey(message))
+        XCTAssertNoThrow(try BoxSessionHandshake.verify(signature: signature, transcript: message, publicKey: identity.publicKey))
+    }
+
+    func testRotationSwapsSnapshotAndKeepsOldReadersConsistent() async throws {
+        let tempDirectory = FileManager.default.temporaryDirectory.appendingPathComponent("box-identity-rotate-\(UUID().uuidString)", isDirectory: true)
+        try FileManager.default.createDirectory(at: tempDirectory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: tempDirectory) }
+
+        let store = try BoxNoiseKeyStore(baseDirectory: tempDirectory)
+        let first = try await store.ensureIdentity(for: .node)
+        let before = store.cache.snapshot
+
+        let second = try await store.regenerateIdentity(for: .node)
+        let after = store.cache.snapshot
+
+        XCTAssertNotEqual(first, second)
+        XCTAssertEqual(before.nodeMaterial, first, "previously acquired snapshots must not change")
+        XCTAssertEqual(after.nodeMaterial, second)
+        XCTAssertGreaterThan(after.generation, before.generation)
+    }
+
+    func testPeerKeysAreParsedFromAdvertisedHex() async throws {
+        let tempDirectory = FileManager.default.temporaryDirectory.appendingPathComponent("box-identity-peer-\(UUID().uuidString)", isDirectory: true)
+        try FileManager.default.createDirectory(at: tempDirectory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: tempDirectory) }
+
+        XCTAssertNil(BoxIdentityCache.peerKeyBytes(fromAdvertised: "hex:zz"))
+        XCTAssertNil(BoxIdentityCache.peerKeyBytes(fromAdvertised: "hex:abcd"))
+
+        let peerStore = try BoxNoiseKeyStore(baseDirectory: tempDirectory)
+        let peerIdentity = try await peerStore.ensureIdentity(for: .node)
+        let advertised = "hex:" + BoxHex.encode(peerIdentity.publicKey).uppercased()
+        let parsed = try XCTUnwrap(BoxIdentityCache.peerKeyBytes(fromAdvertised: advertised))
+        XCTAssertEqual(parsed, peerIdentity.publicKey)
+
+        let cache = BoxIdentityCache()
+        let peer = UUID()
+        cache.updatePeerKey(parsed, for: peer)
+        let generation = cache.snapshot.generation
+        cache.updatePeerKey(parsed, for: peer)
+        XCTAssertEqual(cache.snapshot.generation, generation, "unchanged keys must not swap the snapshot")
+
+        let message = Array("hello".utf8)
+        let signature = try XCTUnwrap(peerStore.cache.snapshot.signWithNodeKey(message))
+        XCTAssertTrue(cache.snapshot.verifyPeerSignature(signature, for: message, from: peer))
+        XCTAssertFalse(cache.snapshot.verifyPeerSignature(signature, for: Array("other".utf8), from: peer))
+        XCTAssertFalse(cache.snapshot.verifyPeerSignature(signature, for: message, from: UUID()))
+    }
+
+    func testConcurrentPeerKeyUpdatesAreAllKept() async throws {
+        let tempDirectory = FileManager.default.temporaryDirectory.appendingPathComponent("box-identity-concurrent-\(UUID().uuidString)", isDirectory: true)
+        try FileManager.default.createDirectory(at: tempDirectory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: tempDirectory) }
+
+        let peerStore = try BoxNoiseKeyStore(baseDirectory: tempDirectory)
+        let key = try await peerStore.ensureIdentity(for: .node).publicKey
+        let cache = BoxIdentityCache()
+        let peers = (0..<64).map { _ in UUID() }
+        DispatchQueue.concurrentPerform(iterations: peers.count) { index in
+            cache.updatePeerKey(key, for: peers[index])
+        }
+        let snapshot = cache.snapshot
+        XCTAssertEqual(Set(snapshot.peerKeys.keys), Set(peers))
+        XCTAssertEqual(snapshot.generation, UInt64(peers.count))
+        let message = Array("hello".utf8)
+        let signature = try XCTUnwrap(peerStore.cache.snapshot.signWithNodeKey(message))
+        XCTAssertTrue(peers.allSatisfy { snapshot.verifyPeerSignature(signature, for: message, from: $0) })
+    }
+
+    func testHexRoundTrip() {
+        let bytes: [UInt8] = [0x00, 0x0f, 0xa5, 0xff]
+        XCTAssertEqual(BoxHex.encode(bytes), "000fa5ff")
+        XCTAssertEqual(BoxHex.decode("000FA5ff"), bytes)
+        XCTAssertNil(BoxHex.decode("abc"))
+        XCTAssertNil(BoxHex.decode("0g"))
+    }
+}
@@ -0,0 +1,46 @@
+import Foundation
+import XCTest
+@testable import BoxServer
+
+final class BoxReadCacheTests: XCTestCase {
+    private func makeObject(bytes: Int) -> BoxStoredObject {
+        BoxStoredObject(contentType: "application/octet-stream", data: [UInt8](repeating: 0x42, count: bytes), nodeId: UUID(), userId: UUID())
+    }
+
+    private func key(_ name: String) -> BoxReadCache.Key {
+        BoxReadCache.Key(queue: "INBOX", name: name)
+    }
+
+    func testLeastRecentlyUsedEntryIsEvictedFirst() {
+        let entryCost = 1_000 + BoxReadCache.entryOverhead
+        var cache = BoxReadCache(budget: entryCost * 16)
+        cache.insert(makeObject(bytes: 1_000), for: key("a"))
+        cache.insert(makeObject(bytes: 1_000), for: key("b"))
+        XCTAssertNotNil(cache.object(for: key("a")), "touching a makes b the eviction candidate")
+
+        cache.budget = entryCost + 1
+        XCTAssertNil(cache.object(for: key("b")))
+        XCTAssertNotNil(cache.object(for: key("a")))
+        XCTAssertEqual(cache.statistics.bytes, entryCost)
+
+        cache.insert(makeObject(bytes: 1_000), for: key("c"))
+        XCTAssertNil(cache.object(for: key("c")), "objects above an eighth of the budget are not cached")
+        XCTAssertNotNil(cache.object(for: key("a")))
+    }
+
+    func testInvalidationAndStatistics() {
+        var cache = BoxReadCache(budget: 1_000_000)
+        cache.insert(makeObject(bytes: 10), for: key("a"))
+        cache.insert(makeObject(bytes: 10), for: BoxReadCache.Key(queue: "alerts", name: "a"))
+        XCTAssertNotNil(cache.object(for: key("a")))
+        XCTAssertNil(cache.object(for: key("missing")))
+        XCTAssertEqual(cache.statistics.hitRatio, 0.5)
+
+        cache.removeAll(inQueue: "INBOX")
+        XCTAssertNil(cache.object(for: key("a")))
+        XCTAssertEqual(cache.statistics.entries, 1)
+        cache.removeValue(for: BoxReadCache.Key(queue: "alerts", name: "a"))
+        XCTAssertEqual(cache.statistics.entries, 0)
+        XCTAssertEqual(cache.statistics.bytes, 0)
+    }
+}
@@ -0,0 +1,42 @@
+import BoxCore
+import XCTest
+
+/// Unit tests covering the session replay bitmap.
+final class BoxReplayWindowTests: XCTestCase {
+    func testSizeIsClampedAndRoundedToWords() {
+        XCTAssertEqual(BoxReplayWindow().size, 2048)
+        XCTAssertEqual(BoxReplayWindow(size: 1).size, 128)
+        XCTAssertEqual(BoxReplayWindow(size: 1000).size, 1024)
+        XCTAssertEqual(BoxReplayWindow(size: 1_000_000).size, 65_536)
+    }
+
+    func testRejectsZeroAndDuplicates() {
+        var window = BoxReplayWindow()
+        XCTAssertFalse(window.accept(0))
+        XCTAssertTrue(window.accept(1))
+        XCTAssertFalse(window.accept(1))
+        XCTAssertTrue(window.accept(3))
+        XCTAssertTrue(window.accept(2))
+        XCTAssertFalse(window.wouldAccept(2))
+    }
+
+    func testAcceptsReorderingInsideSpanAndRejectsOlderCounters() {
+        var window = BoxReplayWindow(size: 256)
+        XCTAssertTrue(window.accept(1_000))
+        XCTAssertTrue(window.accept(1_000 - window.span + 1))
+        XCTAssertFalse(window.accept(1_000 - window.span))
+        XCTAssertFalse(window.accept(10))
+    }
+
+    func testLargeJumpClearsRecycledWords() {
+        var window = BoxReplayWindow(size: 128)
+        for counter in UInt64(1)...100 {
+            XCTAssertTrue(window.accept(counter))
+        }
+        // Jumping a full ring ahead must not leave stale bits that would reject fresh counters.
+        XCTAssertTrue(window.accept(100 + 128))
+        XCTAssertTrue(window.accept(100 + 128 - 1))
+        XCTAssertFalse(window.accept(100 + 128))
+        XCTAssertFalse(window.accept(100))
+    }
+}
@@ -0,0 +1,1089 @@
+import XCTest
+import Foundation
+import Logging
+import BoxCore
+@testable import BoxServer
+
+final class BoxServerStoreTests: XCTestCase {
+    private func makeTemporaryDirectory() throws -> URL {
+        let url = FileManager.default.temporaryDirectory.appendingPathComponent("box-store-\(UUID().uuidString)", isDirectory: true)
+        try FileManager.default.createDirectory(at: url, withIntermediateDirectories: true)
+        return url
+    }
+
+    private func makeObject(bytes: Int = 16, createdAt: Date = Date()) -> BoxStoredObject {
+        BoxStoredObject(contentType: "application/octet-stream", data: [UInt8](repeating: 0x42, count: bytes), createdAt: createdAt, nodeId: UUID(), userId: UUID())
+    }
+
+    func testIndexFollowsWritesFromAnotherStoreInstance() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let other = try await BoxServerStore(root: temporaryDirectory)
+
+        let first = try await store.put(makeObject(createdAt: Date(timeIntervalSinceNow: -10)), into: "INBOX")
+        var listed = try await store.list(queue: "INBOX").map(\.id)
+        XCTAssertEqual(listed, [first])
+
+        let second = try await other.put(makeObject(), into: "INBOX")
+        listed = try await store.list(queue: "INBOX").map(\.id)
+        XCTAssertEqual(listed, [first, second])
+        let read = try await store.read(queue: "INBOX", id: second)
+        XCTAssertEqual(read.id, second)
+
+        try await other.remove(queue: "INBOX", id: first)
+        let popped = try await store.popOldest(from: "INBOX")
+        XCTAssertEqual(popped?.id, second)
+        let empty = try await store.popOldest(from: "INBOX")
+        XCTAssertNil(empty)
+    }
+
+    func testRetentionEvictsOldestByCountAgeAndBytes() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let now = Date()
+        var ids: [UUID] = []
+        for offset in 0..<6 {
+            let object = makeObject(bytes: 100, createdAt: now.addingTimeInterval(TimeInterval(-3_600 + offset * 60)))
+            ids.append(try await store.put(object, into: "INBOX"))
+        }
+
+        var result = try await store.enforceRetention(queue: "INBOX", policy: BoxRetentionPolicy(maxCount: 4), now: now, limit: 1)
+        XCTAssertEqual(result.evicted, 1)
+        XCTAssertTrue(result.hasMore)
+        result = try await store.enforceRetention(queue: "INBOX", policy: BoxRetentionPolicy(maxCount: 4), now: now, limit: 10)
+        XCTAssertEqual(result.evicted, 1)
+        XCTAssertFalse(result.hasMore)
+        var listed = try await store.list(queue: "INBOX")
+        XCTAssertEqual(listed.map(\.id), Array(ids[2...]))
+
+        // The oldest remaining object (58 minutes old) is past max_age; the 57-minute one is kept.
+        result = try await store.enforceRetention(queue: "INBOX", policy: BoxRetentionPolicy(maxAge: 3_450), now: now, limit: 10)
+        XCTAssertEqual(result.evicted, 1)
+        listed = try await store.list(queue: "INBOX")
+        XCTAssertEqual(listed.map(\.id), Array(ids[3...]))
+
+        let sizes = try listed.map { try FileManager.default.attributesOfItem(atPath: $0.url.path)[.size] as? Int ?? 0 }
+        let budget = Int64(sizes.suffix(2).reduce(0, +))
+        result = try await store.enforceRetention(queue: "INBOX", policy: BoxRetentionPolicy(maxBytes: budget), now: now, limit: 10)
+        XCTAssertEqual(result.evicted, 1)
+        XCTAssertEqual(result.evictedBytes, Int64(sizes[0]))
+        listed = try await store.list(queue: "INBOX")
+        XCTAssertEqual(listed.map(\.id), Array(ids[4...]))
+    }
+
+    func testSweeperRespectsBudgetPerPass() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        for _ in 0..<10 {
+            try await store.put(makeObject(), into: "alerts")
+        }
+        let sweeper = QueueRetentionSweeper(store: store, logger: Logger(label: "test.retention"), batchSize: 2, budgetPerPass: 5, batchPause: 0) {
+            ["alerts": BoxRetentionPolicy(maxCount: 1)]
+        }
+
+        let firstPass = await sweeper.sweep()
+        XCTAssertEqual(firstPass, 5)
+        let secondPass = await sweeper.sweep()
+        XCTAssertEqual(secondPass, 4)
+        let remaining = try await store.list(queue: "alerts")
+        XCTAssertEqual(remaining.count, 1)
+    }
+
+    func testIdenticalPayloadsShareOneBlob() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let payload = (0..<4_096).map { UInt8(truncatingIfNeeded: $0) }
+        let digest = BoxContentDigest(of: payload)
+        func object() -> BoxStoredObject {
+            BoxStoredObject(contentType: "application/octet-stream", data: payload, nodeId: UUID(), userId: UUID())
+        }
+
+        let first = try await store.put(object(), into: "INBOX")
+        try await store.put(object(), into: "INBOX")
+        try await store.put(object(), into: "alerts")
+        var references = await store.blobReferenceCount(for: digest)
+        XCTAssertEqual(references, 3)
+        let queues = await store.listQueues()
+        XCTAssertEqual(queues, ["INBOX", "alerts"])
+
+        let read = try await store.read(queue: "INBOX", id: first)
+        XCTAssertEqual(read.data, payload)
+        XCTAssertEqual(read.digest, digest)
+
+        try await store.remove(queue: "INBOX", id: first)
+        references = await store.blobReferenceCount(for: digest)
+        XCTAssertEqual(references, 2)
+        try await store.purge(queue: "alerts")
+        references = await store.blobReferenceCount(for: digest)
+        XCTAssertEqual(references, 1)
+        let popped = try await store.popOldest(from: "INBOX")
+        XCTAssertEqual(popped?.data, payload)
+        references = await store.blobReferenceCount(for: digest)
+        XCTAssertEqual(references, 0)
+        let shard = temporaryDirectory.appendingPathComponent(".blobs/\(digest.hex.prefix(2))", isDirectory: true)
+        let leftovers = try FileManager.default.contentsOfDirectory(atPath: shard.path)
+        XCTAssertEqual(leftovers, [])
+    }
+
+    func testSmallPayloadsStayInlineWithDigest() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let object = makeObject(bytes: 16)
+        let id = try await store.put(object, into: "INBOX")
+        let read = try await store.read(queue: "INBOX", id: id)
+        XCTAssertEqual(read.digest, BoxContentDigest(of: object.data))
+        let references = await store.blobReferenceCount(for: BoxContentDigest(of: object.data))
+        XCTAssertEqual(references, 0)
+        XCTAssertThrowsError(try BoxServerStore.normalizeQueueName(".blobs"))
+        XCTAssertEqual(BoxContentDigest(of: Array("abc".utf8)).hex, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad")
+    }
+
+    func testDigestsAreComputedAndBlobBytesCountTowardRetention() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let payload = (0..<8_192).map { UInt8(truncatingIfNeeded: $0 &* 7) }
+        let forged = BoxContentDigest(of: Array("something else".utf8))
+        let now = Date()
+        let first = try await store.put(
+            BoxStoredObject(contentType: "application/octet-stream", data: payload, createdAt: now.addingTimeInterval(-2), nodeId: UUID(), userId: UUID(), digest: forged),
+            into: "media"
+        )
+        let read = try await store.read(queue: "media", id: first)
+        XCTAssertEqual(read.digest, BoxContentDigest(of: payload), "a digest sent with the object is recomputed")
+        let forgedReferences = await store.blobReferenceCount(for: forged)
+        XCTAssertEqual(forgedReferences, 0)
+        try await store.put(makeObject(bytes: 8_192, createdAt: now.addingTimeInterval(-1)), into: "media")
+
+        // Both descriptors are small; the payloads behind them exceed the byte limit. A fresh instance
+        // lists the queue and reads the blob sizes back from the descriptors.
+        let reloaded = try await BoxServerStore(root: temporaryDirectory)
+        let result = try await reloaded.enforceRetention(queue: "media", policy: BoxRetentionPolicy(maxBytes: 12_000), now: now, limit: 10)
+        XCTAssertEqual(result.evicted, 1)
+        XCTAssertGreaterThan(result.evictedBytes, Int64(payload.count))
+        let remaining = try await reloaded.list(queue: "media")
+        XCTAssertEqual(remaining.count, 1)
+        XCTAssertNotEqual(remaining.first?.id, first)
+
+        // A descriptor that does not decode is reported as corrupted, not as an I/O failure.
+        let kept = try XCTUnwrap(remaining.first)
+        try Data("{".utf8).write(to: kept.url)
+        let fresh = try await BoxServerStore(root: temporaryDirectory)
+        do {
+            _ = try await fresh.read(queue: "media", id: kept.id)
+            XCTFail("a truncated descriptor must not read")
+        } catch BoxStoreError.corrupted {
+        }
+    }
+
+    func testDeleteByIdAndDigestUsesIndex() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let writer = try await BoxServerStore(root: temporaryDirectory)
+        let shared = BoxStoredObject(contentType: "text/plain", data: Array("ack".utf8), nodeId: UUID(), userId: UUID())
+        let first = try await writer.put(shared, into: "alerts")
+        let second = try await writer.put(BoxStoredObject(contentType: "text/plain", data: shared.data, nodeId: UUID(), userId: UUID()), into: "alerts")
+        let other = try await writer.put(makeObject(), into: "alerts")
+        let kept = try await writer.put(makeObject(bytes: 8), into: "alerts")
+
+        // A second instance loads the queue from a listing and must resolve digests from the files.
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let result = try await store.delete(queue: "alerts", targets: [.digest(BoxContentDigest(of: shared.data)), .id(other), .id(UUID())])
+        XCTAssertEqual(result, BoxDeleteResult(removed: 3, missing: 1))
+        let listed = try await store.list(queue: "alerts").map(\.id)
+        XCTAssertEqual(listed, [kept])
+        XCTAssertFalse(listed.contains(first) || listed.contains(second))
+
+        let again = try await store.delete(queue: "alerts", targets: [.id(first)])
+        XCTAssertEqual(again, BoxDeleteResult(removed: 0, missing: 1))
+    }
+
+    func testDigestsRecordedAtPutSurviveAReloadAfterAnExternalWrite() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let kept = try await store.put(makeObject(bytes: 8), into: "alerts")
+        _ = try await store.list(queue: "alerts")
+        let object = makeObject(bytes: 24)
+        let recorded = try await store.put(object, into: "alerts")
+        let external = try await BoxServerStore(root: temporaryDirectory)
+        let written = try await external.put(makeObject(bytes: 40), into: "alerts")
+        let listed = try await store.list(queue: "alerts")
+        XCTAssertEqual(listed.count, 3, "the external write reloads the index")
+
+        // Same size, unreadable content: only the digest kept from the PUT can still match the file.
+        let url = try XCTUnwrap(listed.first { $0.id == recorded }?.url)
+        let size = try XCTUnwrap(FileManager.default.attributesOfItem(atPath: url.path)[.size] as? NSNumber)
+        try Data(repeating: 0x20, count: size.intValue).write(to: url)
+        let targets: [BoxCodec.DeleteTarget] = [.digest(BoxContentDigest(of: object.data)), .digest(BoxContentDigest(of: makeObject(bytes: 40).data))]
+        let result = try await store.delete(queue: "alerts", targets: targets)
+        XCTAssertEqual(result, BoxDeleteResult(removed: 2, missing: 0))
+        let remaining = try await store.list(queue: "alerts").map(\.id)
+        XCTAssertEqual(remaining, [kept])
+        XCTAssertFalse(remaining.contains(written))
+    }
+
+    func testCursorsReadIndependentlyAndPersist() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let base = Date(timeIntervalSince1970: 1_760_000_000)
+        var ids: [UUID] = []
+        for offset in 0..<3 {
+            ids.append(try await store.put(makeObject(createdAt: base.addingTimeInterval(TimeInterval(offset * 60))), into: "alerts"))
+        }
+
+        var next = try await store.next(queue: "alerts", cursor: "indexer")
+        XCTAssertEqual(next?.id, ids[0])
+        next = try await store.next(queue: "alerts", cursor: "indexer")
+        XCTAssertEqual(next?.id, ids[0], "next does not move the cursor")
+        try await store.commit(queue: "alerts", cursor: "indexer", through: ids[0])
+        next = try await store.next(queue: "alerts", cursor: "indexer")
+        XCTAssertEqual(next?.id, ids[1])
+        let audit = try await store.next(queue: "alerts", cursor: "audit")
+        XCTAssertEqual(audit?.id, ids[0], "cursors are independent")
+
+        // Positions survive a new store instance; the queue itself is untouched.
+        let reopened = try await BoxServerStore(root: temporaryDirectory)
+        try await reopened.commit(queue: "alerts", cursor: "indexer", through: ids[2])
+        next = try await reopened.next(queue: "alerts", cursor: "indexer")
+        XCTAssertNil(next)
+        try await reopened.commit(queue: "alerts", cursor: "indexer", through: ids[0])
+        next = try await store.next(queue: "alerts", cursor: "indexer")
+        XCTAssertNil(next, "committing behind the position is ignored")
+
+        try await store.seek(queue: "alerts", cursor: "indexer", to: base.addingTimeInterval(60))
+        next = try await store.next(queue: "alerts", cursor: "indexer")
+        XCTAssertEqual(next?.id, ids[1])
+        try await store.seek(queue: "alerts", cursor: "indexer", to: nil)
+        next = try await store.next(queue: "alerts", cursor: "indexer")
+        XCTAssertEqual(next?.id, ids[0])
+        let listed = try await store.list(queue: "alerts")
+        XCTAssertEqual(listed.count, 3)
+        let queues = await store.listQueues()
+        XCTAssertEqual(queues, ["alerts"])
+        XCTAssertThrowsError(try BoxServerStore.normalizeCursorName("bad/name"))
+    }
+
+    func testCursorTablesGoWithTheirQueueAndUnorderedQueuesRefuseCursors() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let table = temporaryDirectory.appendingPathComponent("\(BoxServerStore.cursorDirectoryName)/alerts.json")
+        let first = try await store.put(makeObject(), into: "alerts")
+        try await store.commit(queue: "alerts", cursor: "indexer", through: first)
+        XCTAssertTrue(FileManager.default.fileExists(atPath: table.path))
+
+        try await store.purge(queue: "alerts")
+        XCTAssertFalse(FileManager.default.fileExists(atPath: table.path), "a purge drops the positions")
+        let second = try await store.put(makeObject(), into: "alerts")
+        var next = try await store.next(queue: "alerts", cursor: "indexer")
+        XCTAssertEqual(next?.id, second)
+
+        // A queue directory removed, then created again, starts without cursors too.
+        try await store.commit(queue: "alerts", cursor: "indexer", through: second)
+        try FileManager.default.removeItem(at: temporaryDirectory.appendingPathComponent("alerts"))
+        let third = try await store.put(makeObject(), into: "alerts")
+        XCTAssertFalse(FileManager.default.fileExists(atPath: table.path))
+        next = try await store.next(queue: "alerts", cursor: "indexer")
+        XCTAssertEqual(next?.id, third)
+
+        let id = try await store.put(makeObject(), into: "uuid")
+        do {
+            try await store.commit(queue: "uuid", cursor: "indexer", through: id)
+            XCTFail("cursors follow age order, which a queue named by id does not have")
+        } catch BoxStoreError.unorderedQueue {}
+    }
+
+    func testLeasesHideObjectsUntilAckOrExpiry() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let base = Date()
+        var ids: [UUID] = []
+        for offset in 0..<3 {
+            ids.append(try await store.put(makeObject(createdAt: base.addingTimeInterval(TimeInterval(offset * 60 - 600))), into: "INBOX"))
+        }
+        let policy = BoxLeasePolicy(visibilityTimeout: 30, maxInFlight: 2)
+
+        guard case let .leased(first, _) = try await store.lease(from: "INBOX", consumer: "worker", policy: policy, now: base),
+              case let .leased(second, _) = try await store.lease(from: "INBOX", consumer: "worker", policy: policy, now: base) else {
+            return XCTFail("expected two leases")
+        }
+        XCTAssertEqual([first.id, second.id], Array(ids[0...1]))
+        guard case .windowFull = try await store.lease(from: "INBOX", consumer: "worker", policy: policy, now: base) else {
+            return XCTFail("in-flight window should be full")
+        }
+        let popped = try await store.popOldest(from: "INBOX")
+        XCTAssertEqual(popped?.id, ids[2], "plain GET skips leased objects")
+
+        try await store.acknowledge(queue: "INBOX", id: first.id, consumer: "worker", now: base)
+        do {
+            try await store.acknowledge(queue: "INBOX", id: second.id, consumer: "other", now: base)
+            XCTFail("ack by another consumer must fail")
+        } catch BoxStoreError.leasedByAnotherConsumer {}
+
+        // The unacknowledged lease expires and the object becomes visible again.
+        let later = base.addingTimeInterval(31)
+        guard case let .leased(redelivered, _) = try await store.lease(from: "INBOX", consumer: "other", policy: policy, now: later) else {
+            return XCTFail("expired lease should be redelivered")
+        }
+        XCTAssertEqual(redelivered.id, second.id)
+        try await store.acknowledge(queue: "INBOX", id: second.id, consumer: "other", now: later)
+        let remaining = try await store.list(queue: "INBOX")
+        XCTAssertTrue(remaining.isEmpty)
+        guard case .empty = try await store.lease(from: "INBOX", consumer: "other", policy: policy, now: later) else {
+            return XCTFail("queue should be empty")
+        }
+    }
+
+    func testAcknowledgeRequiresALeaseAndLeasesExpireInOrder() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let base = Date()
+        let never = try await store.put(makeObject(createdAt: base.addingTimeInterval(-60)), into: "INBOX")
+        do {
+            try await store.acknowledge(queue: "INBOX", id: never, consumer: "worker", now: base)
+            XCTFail("an object never leased must not be acknowledged")
+        } catch BoxStoreError.notLeased {}
+
+        let long = BoxLeasePolicy(visibilityTimeout: 60, maxInFlight: 4)
+        let short = BoxLeasePolicy(visibilityTimeout: 10, maxInFlight: 4)
+        _ = try await store.put(makeObject(createdAt: base.addingTimeInterval(-30)), into: "INBOX")
+        guard case let .leased(first, _) = try await store.lease(from: "INBOX", consumer: "worker", policy: long, now: base),
+              case let .leased(second, _) = try await store.lease(from: "INBOX", consumer: "worker", policy: short, now: base) else {
+            return XCTFail("expected two leases")
+        }
+        XCTAssertEqual(first.id, never)
+        var inFlight = try await store.inFlightCount(queue: "INBOX", now: base.addingTimeInterval(11))
+        XCTAssertEqual(inFlight, 1, "the shorter lease expires first")
+        // Still acknowledgeable by its consumer for one more visibility timeout.
+        try await store.acknowledge(queue: "INBOX", id: second.id, consumer: "worker", now: base.addingTimeInterval(15))
+        inFlight = try await store.inFlightCount(queue: "INBOX", now: base.addingTimeInterval(61))
+        XCTAssertEqual(inFlight, 0)
+        do {
+            try await store.acknowledge(queue: "INBOX", id: first.id, consumer: "worker", now: base.addingTimeInterval(121))
+            XCTFail("a lease past its acknowledgement grace is forgotten")
+        } catch BoxStoreError.notLeased {}
+    }
+
+    func testRemovingALeasedEntryFreesItsConsumerWindow() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let base = Date()
+        for offset in 0..<3 {
+            _ = try await store.put(makeObject(createdAt: base.addingTimeInterval(TimeInterval(offset - 60))), into: "INBOX")
+        }
+        let policy = BoxLeasePolicy(visibilityTimeout: 60, maxInFlight: 1)
+        guard case let .leased(first, _) = try await store.lease(from: "INBOX", consumer: "worker", policy: policy, now: base) else {
+            return XCTFail("expected a lease")
+        }
+        _ = try await store.delete(queue: "INBOX", targets: [.id(first.id)])
+        var inFlight = try await store.inFlightCount(queue: "INBOX", now: base)
+        XCTAssertEqual(inFlight, 0, "DELETE drops the lease of the entry it removes")
+
+        guard case .leased = try await store.lease(from: "INBOX", consumer: "worker", policy: policy, now: base) else {
+            return XCTFail("the window must be free again")
+        }
+        try await store.purge(queue: "INBOX")
+        inFlight = try await store.inFlightCount(queue: "INBOX", now: base)
+        XCTAssertEqual(inFlight, 0, "a purge drops every lease")
+    }
+
+    func testHigherPriorityIsDequeuedFirst() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let base = Date(timeIntervalSinceNow: -600)
+        func object(priority: UInt8, offset: TimeInterval) -> BoxStoredObject {
+            BoxStoredObject(contentType: "text/plain", data: [priority], createdAt: base.addingTimeInterval(offset), nodeId: UUID(), userId: UUID(), priority: priority)
+        }
+        let bulkOld = try await store.put(object(priority: 0, offset: 0), into: "INBOX")
+        let bulkNew = try await store.put(object(priority: 0, offset: 10), into: "INBOX")
+        let urgentNew = try await store.put(object(priority: 7, offset: 30), into: "INBOX")
+        let urgentOld = try await store.put(object(priority: 7, offset: 20), into: "INBOX")
+        let normal = try await store.put(object(priority: 3, offset: 5), into: "INBOX")
+
+        let listed = try await store.list(queue: "INBOX").map(\.id)
+        XCTAssertEqual(listed, [bulkOld, normal, bulkNew, urgentOld, urgentNew], "listing stays in age order")
+        let peeked = try await store.peekOldest(from: "INBOX")
+        XCTAssertEqual(peeked?.id, urgentOld)
+
+        // A fresh instance rebuilds the priority classes from the file names.
+        let reloaded = try await BoxServerStore(root: temporaryDirectory)
+        var popped: [UUID] = []
+        while let next = try await reloaded.popOldest(from: "INBOX") {
+            popped.append(next.id)
+            if next.id == urgentOld { XCTAssertEqual(next.priority, 7) }
+        }
+        XCTAssertEqual(popped, [urgentOld, urgentNew, normal, bulkOld, bulkNew])
+    }
+
+    func testDelayedDeliverySurvivesRestart() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let now = Date()
+        let notBefore = now.addingTimeInterval(3_600)
+        let first = try await BoxServerStore(root: temporaryDirectory)
+        let id = try await first.schedule(makeObject(bytes: 2_048), into: "jobs", notBefore: notBefore, now: now)
+        let immediate = try await first.schedule(makeObject(), into: "jobs", notBefore: now.addingTimeInterval(-1), now: now)
+
+        var listed = try await first.list(queue: "jobs").map(\.id)
+        XCTAssertEqual(listed, [immediate], "delayed objects stay hidden until their date")
+        let early = await first.releaseDueDeliveries(now: notBefore.addingTimeInterval(-1))
+        XCTAssertEqual(early, 0)
+
+        // A new instance rebuilds the timer wheel from disk.
+        let restarted = try await BoxServerStore(root: temporaryDirectory)
+        let pending = await restarted.pendingDeliveryCount()
+        XCTAssertEqual(pending, 1)
+        let released = await restarted.releaseDueDeliveries(now: notBefore.addingTimeInterval(1))
+        XCTAssertEqual(released, 1)
+        listed = try await restarted.list(queue: "jobs").map(\.id)
+        XCTAssertEqual(listed, [immediate, id])
+        let object = try await restarted.read(queue: "jobs", id: id)
+        XCTAssertEqual(object.data.count, 2_048)
+        let lateRelease = await first.releaseDueDeliveries(now: notBefore.addingTimeInterval(1))
+        XCTAssertEqual(lateRelease, 0, "an entry released by another instance is skipped")
+    }
+
+    func testDeleteAndRetentionReachDelayedDeliveries() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let now = Date()
+        let visible: UUID
+        let byId: UUID
+        let kept: UUID
+        do {
+            let first = try await BoxServerStore(root: temporaryDirectory)
+            visible = try await first.put(makeObject(), into: "jobs")
+            byId = try await first.schedule(makeObject(bytes: 24), into: "jobs", notBefore: now.addingTimeInterval(60), now: now)
+            _ = try await first.schedule(makeObject(bytes: 2_048), into: "jobs", notBefore: now.addingTimeInterval(120), now: now)
+            kept = try await first.schedule(makeObject(bytes: 32), into: "jobs", notBefore: now.addingTimeInterval(180), now: now)
+        }
+
+        // Restored from disk, the delayed entries carry no digest until a DELETE needs one.
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let deleted = try await store.delete(queue: "jobs", targets: [.id(byId), .digest(BoxContentDigest(of: makeObject(bytes: 2_048).data))])
+        XCTAssertEqual(deleted.removed, 2)
+        XCTAssertEqual(deleted.missing, 0)
+        var pending = await store.pendingDeliveryCount()
+        XCTAssertEqual(pending, 1)
+
+        // The remaining delivery counts as the newest entry: the visible one goes first.
+        var result = try await store.enforceRetention(queue: "jobs", policy: BoxRetentionPolicy(maxCount: 1), now: now, limit: 10)
+        XCTAssertEqual(result.evicted, 1)
+        var listed = try await store.list(queue: "jobs").map(\.id)
+        XCTAssertFalse(listed.contains(visible))
+        pending = await store.pendingDeliveryCount()
+        XCTAssertEqual(pending, 1)
+
+        result = try await store.enforceRetention(queue: "jobs", policy: BoxRetentionPolicy(maxCount: 0), now: now, limit: 10)
+        XCTAssertEqual(result.evicted, 1)
+        pending = await store.pendingDeliveryCount()
+        XCTAssertEqual(pending, 0)
+        let released = await store.releaseDueDeliveries(now: now.addingTimeInterval(600))
+        XCTAssertEqual(released, 0, "deleted deliveries are never released")
+        listed = try await store.list(queue: "jobs").map(\.id)
+        XCTAssertFalse(listed.contains(kept))
+        let leftovers = try FileManager.default.contentsOfDirectory(atPath: temporaryDirectory.appendingPathComponent(".scheduled/jobs").path)
+        XCTAssertEqual(leftovers, [])
+    }
+
+    func testSchedulerWakesUpForAnEarlierDelivery() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        _ = try await store.schedule(makeObject(), into: "jobs", notBefore: Date().addingTimeInterval(3_600))
+        let scheduler = DelayedDeliveryScheduler(store: store, logger: Logger(label: "test.scheduler"), maximumWait: 3_600)
+        scheduler.start()
+        defer { scheduler.stop() }
+        try await Task.sleep(nanoseconds: 100_000_000)
+
+        // The scheduler now sleeps until the delivery due in an hour.
+        let soon = try await store.schedule(makeObject(bytes: 24), into: "jobs", notBefore: Date().addingTimeInterval(0.2))
+        var listed: [UUID] = []
+        for _ in 0..<50 where listed.isEmpty {
+            try await Task.sleep(nanoseconds: 50_000_000)
+            listed = try await store.list(queue: "jobs").map(\.id)
+        }
+        XCTAssertEqual(listed, [soon])
+    }
+
+    func testCompressedObjectsAreStoredAsReceived() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let text = Array(String(repeating: "compressible text ", count: 200).utf8)
+        let frame = try XCTUnwrap(BoxCompression.compress(text))
+        let object = BoxStoredObject(contentType: "text/plain", data: frame, nodeId: UUID(), userId: UUID(), encoding: .lz4)
+        let id = try await store.put(object, into: "INBOX")
+
+        // A fresh instance reads the file back, bypassing the read cache.
+        let reloaded = try await BoxServerStore(root: temporaryDirectory)
+        let read = try await reloaded.read(queue: "INBOX", id: id)
+        XCTAssertEqual(read.encoding, .lz4)
+        XCTAssertEqual(read.data, frame, "the store never expands payloads")
+        XCTAssertEqual(read.digest, BoxContentDigest(of: text), "the digest covers the decoded content")
+        XCTAssertEqual(try BoxCompression.decode(read.data, encoding: read.encoding), text)
+    }
+
+    func testEncodingsOfOneContentShareItsDigestButNotItsBlob() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let text = Array((0..<4_000).map { "line \($0)\n" }.joined().utf8)
+        let frame = try XCTUnwrap(BoxCompression.compress(text))
+        XCTAssertGreaterThanOrEqual(frame.count, BoxServerStore.blobThreshold)
+        let digest = BoxContentDigest(of: text)
+        let compressed = try await store.put(
+            BoxStoredObject(contentType: "text/plain", data: frame, nodeId: UUID(), userId: UUID(), encoding: .lz4),
+            into: "INBOX"
+        )
+        let plain = try await store.put(BoxStoredObject(contentType: "text/plain", data: text, nodeId: UUID(), userId: UUID()), into: "INBOX")
+
+        let reloaded = try await BoxServerStore(root: temporaryDirectory)
+        let readCompressed = try await reloaded.read(queue: "INBOX", id: compressed)
+        let readPlain = try await reloaded.read(queue: "INBOX", id: plain)
+        XCTAssertEqual(readCompressed.encoding, .lz4)
+        XCTAssertEqual(readCompressed.data, frame)
+        XCTAssertEqual(readPlain.encoding, .identity)
+        XCTAssertEqual(readPlain.data, text)
+        XCTAssertEqual(readCompressed.digest, digest)
+        XCTAssertEqual(readPlain.digest, digest)
+        let plainReferences = await reloaded.blobReferenceCount(for: digest)
+        XCTAssertEqual(plainReferences, 1, "the compressed payload has a blob of its own")
+
+        let result = try await reloaded.delete(queue: "INBOX", targets: [.digest(digest)])
+        XCTAssertEqual(result, BoxDeleteResult(removed: 2, missing: 0))
+    }
+
+    func testReadCacheServesRepeatedReadsAndFollowsWrites() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let other = try await BoxServerStore(root: temporaryDirectory)
+        let id = UUID()
+        func version(_ text: String) -> BoxStoredObject {
+            BoxStoredObject(id: id, contentType: "text/plain", data: Array(text.utf8), nodeId: UUID(), userId: UUID())
+        }
+
+        try await store.put(version("v1"), into: "whoswho")
+        _ = try await store.peekOldest(from: "whoswho")
+        let cached = try await store.read(queue: "whoswho", id: id)
+        XCTAssertEqual(cached.data, Array("v1".utf8))
+        var statistics = await store.readCacheStatistics()
+        XCTAssertEqual(statistics.misses, 1)
+        XCTAssertEqual(statistics.hits, 1)
+        XCTAssertEqual(statistics.entries, 1)
+
+        // Our own overwrite invalidates the entry; so does a rewrite by another instance.
+        try await store.put(version("v2"), into: "whoswho")
+        var read = try await store.read(queue: "whoswho", id: id)
+        XCTAssertEqual(read.data, Array("v2".utf8))
+        try await other.put(version("v3"), into: "whoswho")
+        read = try await store.read(queue: "whoswho", id: id)
+        XCTAssertEqual(read.data, Array("v3".utf8))
+
+        try await store.remove(queue: "whoswho", id: id)
+        statistics = await store.readCacheStatistics()
+        XCTAssertEqual(statistics.entries, 0)
+        XCTAssertEqual(statistics.bytes, 0)
+
+        await store.setReadCacheBudget(0)
+        try await store.put(version("v4"), into: "whoswho")
+        _ = try await store.peekOldest(from: "whoswho")
+        _ = try await store.peekOldest(from: "whoswho")
+        statistics = await store.readCacheStatistics()
+        XCTAssertEqual(statistics.entries, 0, "a zero budget disables the cache")
+    }
+
+    func testJournalCompletesInterruptedOperationsAtStartup() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let fileManager = FileManager.default
+        let object = makeObject(bytes: 4_096)
+        let digest = BoxContentDigest(of: object.data)
+        do {
+            let store = try await BoxServerStore(root: temporaryDirectory)
+            try await store.put(object, into: "media")
+            for _ in 0..<3 {
+                try await store.put(makeObject(bytes: 32), into: "INBOX")
+            }
+            let entry = try XCTUnwrap(fileManager.contentsOfDirectory(atPath: temporaryDirectory.appendingPathComponent("media").path).first)
+            let descriptor = try Data(contentsOf: temporaryDirectory.appendingPathComponent("media/\(entry)"))
+            let fields = try XCTUnwrap(JSONSerialization.jsonObject(with: descriptor) as? [String: Any])
+            let ref = try XCTUnwrap((fields["blobRef"] as? String).flatMap(UUID.init(uuidString:)))
+
+            // A second instance crashes after unlinking the entry but before releasing its blob link, and
+            // in the middle of a purge. `store` owns `.journal`, so those intents land in a sidecar.
+            var journal = try BoxStoreJournal(root: temporaryDirectory)
+            XCTAssertFalse(journal.isOwner)
+            _ = try journal.begin(.remove(paths: ["media/\(entry)"], blobs: [BoxStoreJournal.BlobLink(digest: digest, ref: ref)]))
+            _ = try journal.begin(.purge(queue: "INBOX"))
+            try fileManager.removeItem(at: temporaryDirectory.appendingPathComponent("media/\(entry)"))
+            let inbox = try fileManager.contentsOfDirectory(atPath: temporaryDirectory.appendingPathComponent("INBOX").path)
+            try fileManager.removeItem(at: temporaryDirectory.appendingPathComponent("INBOX/\(inbox[0])"))
+            let handle = try FileHandle(forWritingTo: temporaryDirectory.appendingPathComponent(BoxStoreJournal.fileName))
+            try handle.seekToEnd()
+            try handle.write(contentsOf: Data("{\"id\":".utf8))
+            try handle.close()
+            let references = await store.blobReferenceCount(for: digest)
+            XCTAssertEqual(references, 1, "the leaked link still holds the blob")
+        }
+
+        let restarted = try await BoxServerStore(root: temporaryDirectory)
+        let references = await restarted.blobReferenceCount(for: digest)
+        XCTAssertEqual(references, 0)
+        XCTAssertFalse(fileManager.fileExists(atPath: temporaryDirectory.appendingPathComponent(".blobs/\(digest.hex.prefix(2))/\(digest.hex)").path))
+        let remaining = try await restarted.list(queue: "INBOX")
+        XCTAssertTrue(remaining.isEmpty, "the interrupted purge is finished")
+        let journalSize = try Data(contentsOf: temporaryDirectory.appendingPathComponent(BoxStoreJournal.fileName)).count
+        XCTAssertEqual(journalSize, 0, "recovery empties the journal, torn line included")
+        let sidecars = try fileManager.contentsOfDirectory(atPath: temporaryDirectory.path).filter { $0.hasPrefix(BoxStoreJournal.sidecarPrefix) }
+        XCTAssertEqual(sidecars, [], "the sidecar of the crashed instance is removed once replayed")
+    }
+
+    func testLiveJournalIsNeitherReplayedNorTruncatedByAnotherInstance() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let journalURL = temporaryDirectory.appendingPathComponent(BoxStoreJournal.fileName)
+        do {
+            // The owner is in the middle of a purge when a tool opens the same root.
+            var owner = try BoxStoreJournal(root: temporaryDirectory)
+            XCTAssertTrue(owner.isOwner)
+            _ = try owner.begin(.purge(queue: "INBOX"))
+            let tool = try await BoxServerStore(root: temporaryDirectory)
+            try await tool.put(makeObject(), into: "INBOX")
+            let listed = try await tool.list(queue: "INBOX")
+            XCTAssertEqual(listed.count, 1, "the owner's open purge is not replayed")
+            let journalSize = try Data(contentsOf: journalURL).count
+            XCTAssertGreaterThan(journalSize, 0, "the owner's journal is not truncated")
+        }
+
+        // Once the owner is gone, the next instance takes `.journal` over and completes the purge.
+        let restarted = try await BoxServerStore(root: temporaryDirectory)
+        let remaining = try await restarted.list(queue: "INBOX")
+        XCTAssertTrue(remaining.isEmpty)
+    }
+
+    func testManifestRestoresIndexesUntilTheirDirectoryChanges() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let first = try await store.put(makeObject(createdAt: Date().addingTimeInterval(-60)), into: "INBOX")
+        try await store.put(makeObject(bytes: 4_096), into: "INBOX")
+        _ = try await store.list(queue: "INBOX")
+        let saved = await store.manifestSnapshot(locations: nil).manifest
+        try saved.save(to: temporaryDirectory)
+
+        let loaded = try XCTUnwrap(BoxStoreManifest.load(from: temporaryDirectory))
+        let original = try XCTUnwrap(saved.queues["INBOX"])
+        let restored = try XCTUnwrap(loaded.queues["INBOX"])
+        XCTAssertEqual(restored.entries, original.entries)
+        XCTAssertEqual(restored.totalBytes, original.totalBytes)
+        XCTAssertEqual(restored.directoryModifiedAt, original.directoryModifiedAt, "dates survive the round trip exactly")
+
+        // The restarted store starts from the manifest and lists the queue again once another writer changed it.
+        let restarted = try await BoxServerStore(root: temporaryDirectory)
+        let totals = await restarted.queueTotals()
+        XCTAssertEqual(totals.objects, 2)
+        let other = try await BoxServerStore(root: temporaryDirectory)
+        try await other.put(makeObject(), into: "INBOX")
+        let listed = try await restarted.list(queue: "INBOX")
+        XCTAssertEqual(listed.count, 3)
+        let oldest = try await restarted.popOldest(from: "INBOX")
+        XCTAssertEqual(oldest?.id, first)
+    }
+
+    func testManifestSaverWritesTheLastStateAfterStop() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let saver = StoreManifestSaver(store: store, locationCoordinator: nil, logger: Logger(label: "test.manifest"), interval: 0.005)
+        await saver.start()
+        for _ in 0..<20 {
+            try await store.put(makeObject(), into: "INBOX")
+            _ = try await store.list(queue: "INBOX")
+        }
+
+        // `stop` waits for a periodic save in progress, so the final save is the last write.
+        await saver.stop()
+        await saver.save()
+        let loaded = try XCTUnwrap(BoxStoreManifest.load(from: temporaryDirectory))
+        XCTAssertEqual(loaded.queues["INBOX"]?.entries.count, 20)
+    }
+
+    func testWatchedQueueIndexFollowsReportedChanges() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let fileManager = FileManager.default
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let kept = try await store.put(makeObject(createdAt: Date().addingTimeInterval(-60)), into: "INBOX")
+        try await store.put(makeObject(), into: "INBOX")
+        let inbox = temporaryDirectory.appendingPathComponent("INBOX", isDirectory: true)
+        let names = try fileManager.contentsOfDirectory(atPath: inbox.path).sorted()
+        _ = try await store.list(queue: "INBOX")
+        await store.beginWatching(queue: "INBOX")
+        let before = try await store.indexVersion(of: "INBOX")
+
+        // An operator drops one file and removes another; the watcher reports both names.
+        let dropped = "20200101T000000Z-\(UUID().uuidString).json"
+        try fileManager.copyItem(at: inbox.appendingPathComponent(names[1]), to: inbox.appendingPathComponent(dropped))
+        try fileManager.removeItem(at: inbox.appendingPathComponent(names[1]))
+        await store.reconcile(queue: "INBOX", names: [dropped, names[1]])
+        let after = try await store.indexVersion(of: "INBOX")
+        XCTAssertNotEqual(after.generation, before.generation)
+        var listed = try await store.list(queue: "INBOX")
+        XCTAssertEqual(listed.map(\.url.lastPathComponent), [dropped, names[0]])
+
+        // A watched index is trusted: a change nobody reported stays invisible until it is.
+        let unreported = "20200101T000001Z-\(UUID().uuidString).json"
+        try fileManager.copyItem(at: inbox.appendingPathComponent(names[0]), to: inbox.appendingPathComponent(unreported))
+        listed = try await store.list(queue: "INBOX")
+        XCTAssertEqual(listed.count, 2)
+        await store.endWatching(queue: "INBOX")
+        listed = try await store.list(queue: "INBOX")
+        XCTAssertEqual(listed.count, 3, "without a watch the directory date check sees it")
+        XCTAssertTrue(listed.contains { $0.id == kept })
+    }
+
+    func testDirectoryRebuildKeepsWritesMadeDuringIt() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        var ids: [UUID] = []
+        for offset in 0..<5 {
+            ids.append(try await store.put(makeObject(bytes: 2_048, createdAt: Date().addingTimeInterval(Double(offset - 60))), into: "INBOX"))
+        }
+        let node = makeObject()
+        try await store.put(node, into: "whoswho")
+
+        let names = try await store.beginRebuild(of: "INBOX")
+        XCTAssertEqual(names.count, 5)
+        let linked = try await store.continueRebuild(of: "INBOX", names: names[0..<3])
+        XCTAssertEqual(linked, 3)
+        // Traffic between batches: a pop of a linked entry and a new write.
+        let popped = try await store.popOldest(from: "INBOX")
+        XCTAssertEqual(popped?.id, ids[0])
+        let late = try await store.put(makeObject(), into: "INBOX")
+        _ = try await store.continueRebuild(of: "INBOX", names: names[3...])
+        let saved = try await store.finishRebuild(of: "INBOX")
+        XCTAssertNotNil(saved)
+
+        var remaining: [UUID] = []
+        while let object = try await store.popOldest(from: "INBOX") {
+            remaining.append(object.id)
+        }
+        XCTAssertEqual(remaining, Array(ids[1...]) + [late])
+        let footprint = try await store.directoryFootprint(of: "INBOX")
+        XCTAssertEqual(footprint.entries, 0)
+        let retired = store.retiredDirectoryNames(of: "INBOX")
+        XCTAssertEqual(store.drainRetiredDirectory(of: "INBOX", names: retired[...], isLast: true), retired.count)
+        XCTAssertFalse(FileManager.default.fileExists(atPath: temporaryDirectory.appendingPathComponent(".compact/INBOX.old").path))
+        let references = await store.blobReferenceCount(for: BoxContentDigest(of: makeObject(bytes: 2_048).data))
+        XCTAssertEqual(references, 0, "blob links follow the entries, not the directory links")
+
+        // A record replaced in place by name is linked again, so the swap keeps the new content.
+        _ = try await store.beginRebuild(of: "whoswho")
+        _ = try await store.continueRebuild(of: "whoswho", names: ["\(node.id.uuidString).json"])
+        let replacement = BoxStoredObject(id: node.id, contentType: "application/octet-stream", data: [1, 2, 3], createdAt: Date(), nodeId: UUID(), userId: UUID())
+        try await store.put(replacement, into: "whoswho")
+        _ = try await store.finishRebuild(of: "whoswho")
+        let current = try await store.read(queue: "whoswho", id: node.id)
+        XCTAssertEqual(current.data, [1, 2, 3])
+    }
+
+    func testSnapshotKeepsTheFilesOfItsBarrier() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let root = temporaryDirectory.appendingPathComponent("queues", isDirectory: true)
+        let data = temporaryDirectory.appendingPathComponent("snapshot/queues", isDirectory: true)
+        let store = try await BoxServerStore(root: root)
+        let first = try await store.put(makeObject(bytes: 2_048, createdAt: Date(timeIntervalSinceNow: -10)), into: "INBOX")
+        let firstName = try await store.list(queue: "INBOX")[0].url.lastPathComponent
+
+        try await store.prepareSnapshot()
+        let listing = try store.listSnapshotFiles(into: data)
+        // Written between the listing and the barrier: the barrier adds its blob files.
+        let second = try await store.put(makeObject(bytes: 3_000, createdAt: Date(timeIntervalSinceNow: -5)), into: "INBOX")
+        let paths = try await store.beginSnapshot(into: data, listing: listing)
+        XCTAssertTrue(paths.contains("INBOX/\(firstName)"))
+        // Traffic before any batch: the pops link the entries and their blobs before removing them.
+        let popped = try await store.popOldest(from: "INBOX")
+        XCTAssertEqual(popped?.id, first)
+        let poppedSecond = try await store.popOldest(from: "INBOX")
+        XCTAssertEqual(poppedSecond?.id, second)
+        try await store.put(makeObject(), into: "INBOX")
+        await store.continueSnapshot(paths: paths[...])
+        let totals = try await store.finishSnapshot()
+        XCTAssertEqual(totals.files, paths.count)
+        XCTAssertTrue(totals.missing.isEmpty)
+
+        let linked = try FileManager.default.contentsOfDirectory(atPath: data.appendingPathComponent("INBOX").path)
+        XCTAssertEqual(linked.count, 2)
+        XCTAssertTrue(linked.contains(firstName))
+        let blobs = paths.filter { $0.hasPrefix(".blobs/") }
+        XCTAssertEqual(blobs.count, 4, "the primary blob and the reference link of each entry")
+        XCTAssertTrue(blobs.allSatisfy { FileManager.default.fileExists(atPath: data.appendingPathComponent($0).path) })
+        // A blob and its reference link are one file: its bytes are counted once.
+        let entryBytes = try linked.reduce(Int64(0)) { total, name in
+            let attributes = try FileManager.default.attributesOfItem(atPath: data.appendingPathComponent("INBOX/\(name)").path)
+            return total + ((attributes[.size] as? NSNumber)?.int64Value ?? 0)
+        }
+        XCTAssertEqual(totals.bytes, entryBytes + 2_048 + 3_000)
+    }
+
+    func testSnapshotRestoreRefusesPathsOutsideTheRoot() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory.appendingPathComponent("queues", isDirectory: true))
+        try await store.put(makeObject(), into: "INBOX")
+        let directory = temporaryDirectory.appendingPathComponent("snapshot", isDirectory: true)
+        var snapshot = try await BoxStoreSnapshot.create(from: store, at: directory, base: nil)
+
+        for unsafe in ["../escape.json", "/etc/escape.json", "INBOX/./x.json", "INBOX//x.json"] {
+            snapshot.paths = [unsafe]
+            try snapshot.save(to: directory)
+            let restoredRoot = temporaryDirectory.appendingPathComponent("restored", isDirectory: true)
+            XCTAssertThrowsError(try BoxStoreSnapshot.restore(from: directory, to: restoredRoot), unsafe)
+        }
+        snapshot.paths = []
+        snapshot.queues = ["../INBOX": 0]
+        try snapshot.save(to: directory)
+        XCTAssertThrowsError(try BoxStoreSnapshot.restore(from: directory, to: temporaryDirectory.appendingPathComponent("restored", isDirectory: true)))
+        XCTAssertFalse(FileManager.default.fileExists(atPath: temporaryDirectory.appendingPathComponent("INBOX").path))
+    }
+
+    func testSnapshotRestoresAndListsChangesSinceItsBase() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let root = temporaryDirectory.appendingPathComponent("queues", isDirectory: true)
+        let store = try await BoxServerStore(root: root)
+        let kept = try await store.put(makeObject(bytes: 2_048, createdAt: Date(timeIntervalSinceNow: -10)), into: "INBOX")
+        let node = makeObject()
+        try await store.put(node, into: "whoswho")
+        try await store.ensureQueue("empty")
+
+        let older = temporaryDirectory.appendingPathComponent("snapshot-1", isDirectory: true)
+        let snapshot = try await BoxStoreSnapshot.create(from: store, at: older, base: nil)
+        XCTAssertEqual(snapshot.queues, ["INBOX": 1, "whoswho": 1, "empty": 0])
+        XCTAssertNil(snapshot.added)
+
+        let replacement = BoxStoredObject(id: node.id, contentType: "text/plain", data: [1, 2, 3], createdAt: Date(), nodeId: UUID(), userId: UUID())
+        try await store.put(replacement, into: "whoswho")
+        try await store.put(makeObject(), into: "INBOX")
+        _ = try await store.popOldest(from: "INBOX")
+        let newer = temporaryDirectory.appendingPathComponent("snapshot-2", isDirectory: true)
+        let incremental = try await BoxStoreSnapshot.create(from: store, at: newer, base: older)
+        let lateName = try await store.list(queue: "INBOX")[0].url.lastPathComponent
+        XCTAssertEqual(Set(incremental.added ?? []), ["INBOX/\(lateName)", "whoswho/\(node.id.uuidString).json"])
+        XCTAssertEqual(incremental.removed?.filter { $0.hasPrefix("INBOX/") }.count, 1)
+        // The released blob keeps its primary file while the older snapshot links it.
+        XCTAssertEqual(incremental.removed?.filter { $0.hasPrefix(".blobs/") }.count, 1)
+
+        let restoredRoot = temporaryDirectory.appendingPathComponent("restored", isDirectory: true)
+        try BoxStoreSnapshot.restore(from: older, to: restoredRoot)
+        XCTAssertThrowsError(try BoxStoreSnapshot.restore(from: older, to: restoredRoot))
+        let restored = try await BoxServerStore(root: restoredRoot)
+        let queues = await restored.listQueues()
+        XCTAssertEqual(queues, ["INBOX", "empty", "whoswho"])
+        let object = try await restored.read(queue: "INBOX", id: kept)
+        XCTAssertEqual(object.data.count, 2_048)
+        let record = try await restored.read(queue: "whoswho", id: node.id)
+        XCTAssertEqual(record.data, node.data)
+    }
+
+    func testMirrorShipsQueueChangesToFollower() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let primary = try await BoxServerStore(root: temporaryDirectory.appendingPathComponent("primary", isDirectory: true))
+        let follower = try await BoxServerStore(root: temporaryDirectory.appendingPathComponent("follower", isDirectory: true))
+        let source = UUID()
+        let existing = try await primary.put(makeObject(bytes: 2_048, createdAt: Date(timeIntervalSinceNow: -10)), into: "INBOX")
+        let mirror = QueueMirror(store: primary, source: source, logger: Logger(label: "test.mirror")) { _, batch in
+            // Through the wire encoding, as the PUT carries it.
+            let received = try BoxMirrorBatch.decode(from: try batch.encoded())
+            do {
+                _ = try await follower.applyMirrorBatch(received)
+            } catch BoxStoreError.mirrorOutOfSync {
+                throw QueueMirror.TransportError.resetRequired
+            }
+        }
+        await mirror.start(queues: ["INBOX"])
+        await mirror.setFollowers([QueueMirror.Follower(node: UUID(), address: "::1", port: 12567)])
+        let added = try await primary.put(makeObject(), into: "INBOX")
+        // Larger than a batch: sent alone rather than skipped.
+        let large = try await primary.put(makeObject(bytes: 200 * 1024), into: "INBOX")
+        try await primary.put(makeObject(), into: "other")
+
+        let copy = BoxMirrorBatch.mirrorQueueName(of: "INBOX", source: source)
+        func mirrored() async -> [String] {
+            ((try? await follower.list(queue: copy)) ?? []).map(\.url.lastPathComponent)
+        }
+        let primaryNames = try await primary.list(queue: "INBOX").map(\.url.lastPathComponent)
+        try await waitUntil { await mirrored() == primaryNames }
+        try await primary.remove(queue: "INBOX", id: existing)
+        try await waitUntil { await mirrored().count == 2 }
+        let kept = try await follower.read(queue: copy, id: added)
+        XCTAssertEqual(kept.data.count, 16)
+        let keptLarge = try await follower.read(queue: copy, id: large)
+        XCTAssertEqual(keptLarge.data.count, 200 * 1024)
+        let skipped = await mirror.status().skipped
+        XCTAssertEqual(skipped, 0)
+        let followerQueues = await follower.listQueues()
+        XCTAssertEqual(followerQueues, [copy])
+        try await waitUntil { await mirror.status().followers.first?.replicas.first?.pending == 0 }
+
+        // A batch that does not follow the applied position asks for a full copy.
+        let stray = BoxMirrorBatch(source: source, queue: "INBOX", epoch: UUID(), first: 1, last: 1, purge: nil, base: nil, entries: [])
+        do {
+            _ = try await follower.applyMirrorBatch(stray)
+            XCTFail("a batch of another epoch must be refused")
+        } catch BoxStoreError.mirrorOutOfSync {
+        }
+        await mirror.stop()
+    }
+
+    private func waitUntil(_ condition: () async -> Bool) async throws {
+        for _ in 0..<500 {
+            if await condition() { return }
+            try await Task.sleep(nanoseconds: 10_000_000)
+        }
+        XCTFail("condition not met in time")
+    }
+
+    func testQueueHandlesAreInternedAndFollowConfiguration() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+
+        let inbox = try store.queueHandles.handle(for: " /INBOX ")
+        XCTAssertEqual(inbox.name, "INBOX")
+        XCTAssertEqual(inbox.directory.lastPathComponent, "INBOX")
+        XCTAssertFalse(inbox.permanent)
+        XCTAssertEqual(try store.queueHandles.handle(for: "INBOX"), inbox)
+        XCTAssertNotEqual(try store.queueHandles.handle(for: "other"), inbox)
+        XCTAssertThrowsError(try store.queueHandles.handle(for: ".blobs"))
+
+        store.queueHandles.configure(permanent: ["INBOX"], volatile: ["other": BoxVolatilePolicy()])
+        let permanent = try store.queueHandles.handle(for: " /INBOX ")
+        XCTAssertEqual(permanent.name, inbox.name)
+        XCTAssertTrue(permanent.permanent)
+        XCTAssertNotNil(try store.queueHandles.handle(for: "other").volatilePolicy)
+
+        // A queue directory removed behind the store's back is created again by the next put.
+        let id = try await store.put(makeObject(), into: "INBOX")
+        try FileManager.default.removeItem(at: inbox.directory)
+        let again = try await store.put(makeObject(), into: "INBOX")
+        let listed = try await store.list(queue: "INBOX").map(\.id)
+        XCTAssertEqual(listed, [again])
+        XCTAssertNotEqual(id, again)
+
+        // Requests trust the directory once seen; one removed since is reported missing all the same.
+        try FileManager.default.removeItem(at: inbox.directory)
+        do {
+            _ = try await store.list(queue: "INBOX")
+            XCTFail("a removed queue must be reported missing")
+        } catch BoxStoreError.queueNotFound {}
+        do {
+            _ = try await store.popOldest(from: "INBOX")
+            XCTFail("the directory is checked again after a miss")
+        } catch BoxStoreError.queueNotFound {}
+    }
+
+    func testEntryNamesKeepArrivalOrderWithinTheSameMicrosecond() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let createdAt = Date()
+        var ids: [UUID] = []
+        for _ in 0..<50 {
+            ids.append(try await store.put(makeObject(createdAt: createdAt), into: "INBOX"))
+        }
+        let listed = try await store.list(queue: "INBOX")
+        XCTAssertEqual(listed.map(\.id), ids)
+        let first = try XCTUnwrap(listed.first?.url.lastPathComponent)
+        XCTAssertEqual(BoxQueueIndex.timestamp(fromFileName: first).map(BoxQueueIndex.microseconds(of:)), BoxQueueIndex.microseconds(of: createdAt))
+
+        // A restarted store continues after the newest name.
+        let restarted = try await BoxServerStore(root: temporaryDirectory)
+        let next = try await restarted.put(makeObject(createdAt: createdAt), into: "INBOX")
+        let relisted = try await restarted.list(queue: "INBOX")
+        XCTAssertEqual(relisted.last?.id, next)
+    }
+
+    func testEntryNameStampsRoundTripAndOlderNamesStillParse() throws {
+        let stamp = BoxQueueIndex.timestampPrefix(microseconds: 1_760_711_415_000_042)
+        XCTAssertEqual(stamp, "20251017T143015Z-000042")
+        let name = "\(stamp)-p3-0F2B6F6A-0000-0000-0000-000000000001.json"
+        XCTAssertEqual(BoxQueueIndex.timestamp(fromFileName: name).map(BoxQueueIndex.microseconds(of:)), 1_760_711_415_000_042)
+        XCTAssertEqual(BoxQueueIndex.priority(fromFileName: name), 3)
+        XCTAssertEqual(BoxQueueIndex.timestampPrefix(microseconds: 951_782_400_000_000), "20000229T000000Z-000000")
+
+        // Names written with second stamps, including a UUID whose first group is all digits.
+        let legacy = "20251017T143015Z-12345678-0000-0000-0000-000000000001.json"
+        XCTAssertEqual(BoxQueueIndex.timestamp(fromFileName: legacy), Date(timeIntervalSince1970: 1_760_711_415))
+        XCTAssertEqual(BoxQueueIndex.priority(fromFileName: "20251017T143015Z-p7-0F2B6F6A-0000-0000-0000-000000000001.json"), 7)
+        XCTAssertNil(BoxQueueIndex.timestamp(fromFileName: "0F2B6F6A-0000-0000-0000-000000000001.json"))
+    }
+
+    func testLargeObjectsAreStreamedFromTheirBlob() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let payload = (0..<(BoxCodec.maxChunkSize * 2 + 1_000)).map { UInt8(truncatingIfNeeded: $0 &* 31) }
+        let object = BoxStoredObject(contentType: "application/octet-stream", data: payload, nodeId: UUID(), userId: UUID())
+        let id = try await store.put(object, into: "media")
+
+        let peeked = try await store.openOldest(from: "media")
+        XCTAssertEqual(peeked?.id, id)
+        let listed = try await store.list(queue: "media")
+        XCTAssertEqual(listed.count, 1, "a peek leaves the object in place")
+
+        let consumer = BoxCodec.CursorRequest.chunkedGetConsumer(for: UUID())
+        let opened = try await store.openOldest(from: "media", leasingTo: consumer, visibility: 30)
+        let streamed = try XCTUnwrap(opened)
+        XCTAssertEqual(streamed.id, id)
+        XCTAssertEqual(streamed.payload.size, payload.count)
+        var remaining = try await store.list(queue: "media")
+        XCTAssertEqual(remaining.count, 1, "a consuming open leases the object until it is acknowledged")
+        let hidden = try await store.openOldest(from: "media", leasingTo: BoxCodec.CursorRequest.chunkedGetConsumer(for: UUID()), visibility: 30)
+        XCTAssertNil(hidden, "another consuming GET skips the leased object")
+        try await store.acknowledge(queue: "media", id: id, consumer: consumer)
+        remaining = try await store.list(queue: "media")
+        XCTAssertTrue(remaining.isEmpty)
+
+        // The entry and its last blob link are gone; the open reader still delivers every chunk.
+        var received: [UInt8] = []
+        var chunks = 0
+        while let chunk = try streamed.payload.nextChunk(maxLength: BoxCodec.maxChunkSize) {
+            XCTAssertLessThanOrEqual(chunk.count, BoxCodec.maxChunkSize)
+            received.append(contentsOf: chunk)
+            chunks += 1
+        }
+        XCTAssertEqual(chunks, 3)
+        XCTAssertEqual(received, payload)
+        XCTAssertTrue(streamed.payload.isAtEnd)
+    }
+
+    func testRetentionPoliciesAreParsedFromConfiguration() {
+        let policies = BoxServerRuntimeController.retentionPolicies(from: [
+            "/INBOX": .init(maxAge: 86_400, maxCount: 0),
+            "alerts": .init(maxBytes: 1_048_576),
+            "noop": .init(),
+            "bad/name": .init(maxCount: 1)
+        ])
+        XCTAssertEqual(policies, [
+            "INBOX": BoxRetentionPolicy(maxAge: 86_400),
+            "alerts": BoxRetentionPolicy(maxBytes: 1_048_576)
+        ])
+    }
+}
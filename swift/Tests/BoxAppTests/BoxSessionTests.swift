@@ -0,0 +1,101 @@
+import Foundation
+import NIOCore
+import XCTest
+@testable import BoxCore
+
+/// Unit tests covering the HELLO key exchange and the sealed frame layer.
+final class BoxSessionTests: XCTestCase {
+    private let allocator = ByteBufferAllocator()
+
+    private func makeSessions() throws -> (client: BoxSession, server: BoxSession) {
+        let clientHandshake = BoxSessionHandshake()
+        let serverHandshake = BoxSessionHandshake()
+        let client = try clientHandshake.session(peerShare: serverHandshake.publicKey, role: .initiator)
+        let server = try serverHandshake.session(peerShare: clientHandshake.publicKey, role: .responder)
+        return (client, server)
+    }
+
+    private func makeFrame(_ text: String, command: BoxCodec.Command = .status) -> BoxCodec.Frame {
+        var payload = allocator.buffer(capacity: text.utf8.count)
+        payload.writeString(text)
+        return BoxCodec.Frame(command: command, requestId: UUID(), nodeId: UUID(), userId: UUID(), payload: payload)
+    }
+
+    func testSealedFrameRoundTrip() throws {
+        var (client, server) = try makeSessions()
+        let frame = makeFrame("ping")
+        var datagram = try client.seal(frame, allocator: allocator)
+        XCTAssertEqual(datagram.readableBytes, BoxCodec.headerSize + BoxSession.overhead + 4)
+
+        var decoded = try BoxCodec.decodeFrame(from: &datagram)
+        XCTAssertTrue(decoded.isSealed)
+        XCTAssertEqual(decoded.command, .status)
+        XCTAssertEqual(decoded.requestId, frame.requestId)
+
+        try server.open(&decoded)
+        XCTAssertFalse(decoded.isSealed)
+        XCTAssertEqual(decoded.payload.getString(at: decoded.payload.readerIndex, length: decoded.payload.readableBytes), "ping")
+    }
+
+    func testReplayedFrameIsRejected() throws {
+        var (client, server) = try makeSessions()
+        let datagram = try client.seal(makeFrame("once"), allocator: allocator)
+
+        var first = datagram
+        var frame = try BoxCodec.decodeFrame(from: &first)
+        try server.open(&frame)
+
+        var second = datagram
+        var replay = try BoxCodec.decodeFrame(from: &second)
+        XCTAssertThrowsError(try server.open(&replay)) { error in
+            XCTAssertEqual(error as? BoxSessionError, .replayed)
+        }
+    }
+
+    func testTamperedHeaderFailsAuthentication() throws {
+        var (client, server) = try makeSessions()
+        var datagram = try client.seal(makeFrame("secret"), allocator: allocator)
+        // Flip a bit in the node identifier: the header is associated data.
+        let index = datagram.readerIndex + 30
+        datagram.setInteger(datagram.getInteger(at: index, as: UInt8.self)! ^ 0x01, at: index)
+
+        var frame = try BoxCodec.decodeFrame(from: &datagram)
+        XCTAssertThrowsError(try server.open(&frame)) { error in
+            XCTAssertEqual(error as? BoxSessionError, .authenticationFailed)
+        }
+    }
+
+    func testBatchSealProducesIndependentDatagrams() throws {
+        var (client, server) = try makeSessions()
+        let frames = ["a", "bb", "ccc"].map { makeFrame($0, command: .put) }
+        let datagrams = try server.seal(frames, allocator: allocator)
+        XCTAssertEqual(datagrams.count, 3)
+
+        // Deliver out of order: the replay window accepts reordering.
+        for (index, expected) in [(2, "ccc"), (0, "a"), (1, "bb")] {
+            var datagram = datagrams[index]
+            var frame = try BoxCodec.decodeFrame(from: &datagram)
+            try client.open(&frame)
+            XCTAssertEqual(frame.payload.getString(at: frame.payload.readerIndex, length: frame.payload.readableBytes), expected)
+        }
+    }
+
+    func testHelloExtensionsRoundTripAndSignatureVerifies() async throws {
+        let tempDirectory = FileManager.default.temporaryDirectory.appendingPathComponent("box-session-\(UUID().uuidString)", isDirectory: true)
+        try FileManager.default.createDirectory(at: tempDirectory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: tempDirectory) }
+        let material = try await BoxNoiseKeyStore(baseDirectory: tempDirectory).ensureIdentity(for: .node)
+        let clientShare = BoxSessionHandshake().publicKey
+        let serverShare = BoxSessionHandshake().publicKey
+        let transcript = BoxSessionHandshake.transcript(initiatorShare: clientShare, responderShare: serverShare)
+        let signature = try material.signature(for: transcript)
+
+        let hello = BoxCodec.HelloPayload(status: .ok, supportedVersions: [1], keyShare: serverShare, signature: signature)
+        var buffer = try BoxCodec.encodeHelloPayload(hello, allocator: allocator)
+        let decoded = try BoxCodec.decodeHelloPayload(from: &buffer)
+        XCTAssertEqual(decoded.keyShare, serverShare)
+        XCTAssertEqual(decoded.signature, signature)
+        XCTAssertNoThrow(try BoxSessionHandshake.verify(signature: signature, transcript: transcript, publicKey: material.publicKey))
+        XCTAssertThrowsError(try BoxSessionHandshake.verify(signature: signature, transcript: Array(transcript.reversed()), publicKey: material.publicKey))
+    }
+}
@@ -0,0 +1,65 @@
+import Foundation
+import XCTest
+@testable import BoxServer
+
+final class BoxTimerWheelTests: XCTestCase {
+    private let start = Date(timeIntervalSince1970: 1_700_000_000)
+
+    func testEntriesFireOnTheirTickAndNeverEarly() {
+        var wheel = BoxTimerWheel<Int>(resolution: 0.1, start: start)
+        wheel.schedule(2, at: start.addingTimeInterval(0.25))
+        wheel.schedule(1, at: start.addingTimeInterval(0.15))
+        wheel.schedule(0, at: start.addingTimeInterval(-5))
+        XCTAssertEqual(wheel.count, 3)
+
+        XCTAssertEqual(wheel.advance(to: start), [0], "past deadlines fire on the next advance")
+        XCTAssertEqual(wheel.advance(to: start.addingTimeInterval(0.21)), [1])
+        XCTAssertEqual(wheel.advance(to: start.addingTimeInterval(0.29)), [], "0.25 s rounds up to the 0.3 s tick")
+        XCTAssertEqual(wheel.advance(to: start.addingTimeInterval(0.31)), [2])
+        XCTAssertTrue(wheel.isEmpty)
+    }
+
+    func testDistantDeadlinesCascadeThroughEveryLevel() {
+        var wheel = BoxTimerWheel<Int>(resolution: 1, start: start)
+        // One deadline per level, the last one just beyond the 2^24-tick span of the wheel.
+        let offsets: [TimeInterval] = [30, 3_000, 300_000, 16_800_000]
+        for (value, offset) in offsets.enumerated() {
+            wheel.schedule(value, at: start.addingTimeInterval(offset))
+        }
+        var fired: [Int] = []
+        for (value, offset) in offsets.enumerated() {
+            XCTAssertEqual(wheel.advance(to: start.addingTimeInterval(offset - 1)), [], "entry \(value) fired early")
+            fired += wheel.advance(to: start.addingTimeInterval(offset))
+        }
+        XCTAssertEqual(fired, [0, 1, 2, 3])
+        XCTAssertTrue(wheel.isEmpty)
+    }
+
+    func testNextDeadlineIsNeverLateAndReachesDistantEntriesInAFewSteps() {
+        var wheel = BoxTimerWheel<Int>(resolution: 1, start: start)
+        XCTAssertNil(wheel.nextDeadline)
+        wheel.schedule(0, at: start.addingTimeInterval(30))
+        XCTAssertEqual(wheel.nextDeadline?.timeIntervalSince(start) ?? 0, 30, accuracy: 0.1)
+        XCTAssertEqual(wheel.advance(to: start.addingTimeInterval(30)), [0])
+
+        let deadline = start.addingTimeInterval(300_000)
+        wheel.schedule(1, at: deadline)
+        var fired: [Int] = []
+        var wakeups = 0
+        while fired.isEmpty, let next = wheel.nextDeadline {
+            XCTAssertLessThan(next.timeIntervalSince(deadline), 0.1, "a wakeup never comes after the deadline")
+            fired = wheel.advance(to: next)
+            wakeups += 1
+        }
+        XCTAssertEqual(fired, [1])
+        XCTAssertLessThanOrEqual(wakeups, 4, "one wakeup per level at most")
+    }
+
+    func testIdleWheelSkipsAheadWithoutLosingNewEntries() {
+        var wheel = BoxTimerWheel<String>(resolution: 0.1, start: start)
+        XCTAssertEqual(wheel.advance(to: start.addingTimeInterval(86_400)), [])
+        wheel.schedule("later", at: start.addingTimeInterval(86_401))
+        XCTAssertEqual(wheel.advance(to: start.addingTimeInterval(86_400.9)), [])
+        XCTAssertEqual(wheel.advance(to: start.addingTimeInterval(86_401)), ["later"])
+    }
+}
@@ -0,0 +1,86 @@
+import BoxCore
+import Foundation
+import XCTest
+@testable import BoxServer
+
+final class BoxVolatileQueuesTests: XCTestCase {
+    private func makeObject(_ text: String) -> BoxStoredObject {
+        BoxStoredObject(contentType: "text/plain", data: Array(text.utf8), nodeId: UUID(), userId: UUID())
+    }
+
+    private func popText(_ queues: BoxVolatileQueues, _ queue: String) -> String? {
+        queues.pop(from: queue).map { String(decoding: $0.data, as: UTF8.self) }
+    }
+
+    func testDropOldestEvictsTheHeadOfTheRing() {
+        let queues = BoxVolatileQueues(policies: ["ticks": BoxVolatilePolicy(capacity: 2)])
+        XCTAssertEqual(queues.push(makeObject("a"), into: "ticks"), .stored)
+        XCTAssertEqual(queues.push(makeObject("b"), into: "ticks"), .stored)
+        XCTAssertEqual(queues.push(makeObject("c"), into: "ticks"), .droppedOldest)
+        XCTAssertEqual(queues.count(of: "ticks"), 2)
+        XCTAssertEqual(queues.peek(from: "ticks").map { String(decoding: $0.data, as: UTF8.self) }, "b")
+        XCTAssertEqual(popText(queues, "ticks"), "b")
+        XCTAssertEqual(popText(queues, "ticks"), "c")
+        XCTAssertNil(queues.pop(from: "ticks"))
+        XCTAssertNil(queues.diskBacklogMarker("ticks"))
+    }
+
+    func testRejectRefusesObjectsWhenFull() {
+        let queues = BoxVolatileQueues(policies: ["ticks": BoxVolatilePolicy(capacity: 1, overflow: .reject)])
+        XCTAssertEqual(queues.push(makeObject("a"), into: "ticks"), .stored)
+        XCTAssertEqual(queues.push(makeObject("b"), into: "ticks"), .rejected)
+        XCTAssertEqual(popText(queues, "ticks"), "a")
+        XCTAssertEqual(queues.push(makeObject("c"), into: "ticks"), .stored)
+    }
+
+    func testSpillRoutesObjectsToDiskUntilTheBacklogIsDrained() {
+        let queues = BoxVolatileQueues(policies: ["ticks": BoxVolatilePolicy(capacity: 1, overflow: .spill)])
+        // A spill queue may have leftovers on disk from a previous run.
+        let startupMarker = queues.diskBacklogMarker("ticks")
+        XCTAssertNotNil(startupMarker)
+        XCTAssertEqual(queues.push(makeObject("a"), into: "ticks"), .spill)
+        // A GET finding the disk empty while "a" is still being written must not clear the backlog.
+        queues.clearDiskBacklog("ticks", marker: startupMarker!)
+        XCTAssertNotNil(queues.diskBacklogMarker("ticks"))
+        queues.finishSpill("ticks")
+        // The disk was found empty before "a" spilled: the stale marker must not clear the backlog.
+        queues.clearDiskBacklog("ticks", marker: startupMarker!)
+        XCTAssertNotNil(queues.diskBacklogMarker("ticks"))
+
+        let marker = queues.diskBacklogMarker("ticks")!
+        queues.clearDiskBacklog("ticks", marker: marker)
+        XCTAssertNil(queues.diskBacklogMarker("ticks"))
+        XCTAssertEqual(queues.push(makeObject("b"), into: "ticks"), .stored)
+        XCTAssertEqual(queues.push(makeObject("c"), into: "ticks"), .spill)
+        XCTAssertEqual(queues.push(makeObject("d"), into: "ticks"), .spill, "later objects follow the backlog to disk")
+        XCTAssertEqual(queues.count(of: "ticks"), 1)
+    }
+
+    func testReconfigureKeepsTheNewestObjects() {
+        let queues = BoxVolatileQueues(policies: ["ticks": BoxVolatilePolicy(capacity: 4)])
+        for text in ["a", "b", "c", "d"] {
+            _ = queues.push(makeObject(text), into: "ticks")
+        }
+        queues.configure(["ticks": BoxVolatilePolicy(capacity: 2)])
+        XCTAssertEqual(queues.count(of: "ticks"), 2)
+        XCTAssertEqual(popText(queues, "ticks"), "c")
+        XCTAssertEqual(popText(queues, "ticks"), "d")
+
+        queues.configure([:])
+        XCTAssertNil(queues.policy(for: "ticks"))
+        XCTAssertEqual(queues.push(makeObject("e"), into: "ticks"), .spill, "unknown queues are disk-backed")
+    }
+
+    func testVolatilePoliciesAreParsedFromConfiguration() {
+        let policies = BoxServerRuntimeController.volatilePolicies(from: [
+            "Telemetry": BoxConfiguration.VolatileQueue(capacity: 0, overflow: "reject"),
+            "metrics": BoxConfiguration.VolatileQueue(overflow: "unknown"),
+            "whoswho": BoxConfiguration.VolatileQueue(capacity: 8)
+        ])
+        XCTAssertNil(policies["whoswho"])
+        XCTAssertEqual(policies["metrics"], BoxVolatilePolicy(capacity: BoxVolatilePolicy.defaultCapacity, overflow: .dropOldest))
+        XCTAssertEqual(policies.count, 2)
+        let telemetry = policies.first { $0.key.lowercased() == "telemetry" }?.value
+        XCTAssertEqual(telemetry, BoxVolatilePolicy(capacity: 1, overflow: .reject))
+    }
+}
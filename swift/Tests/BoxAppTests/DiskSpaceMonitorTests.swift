@@ -0,0 +1,53 @@
+import Foundation
+import Logging
+import NIOConcurrencyHelpers
+import XCTest
+@testable import BoxServer
+
+final class DiskSpaceMonitorTests: XCTestCase {
+    private func sample(usedPercent: UInt64) -> DiskSpaceMonitor.Sample {
+        DiskSpaceMonitor.Sample(totalBytes: 1_000, freeBytes: 1_000 - usedPercent * 10)
+    }
+
+    func testPressureUsesHysteresisBetweenWatermarks() {
+        let transitions = NIOLockedValueBox<[Bool]>([])
+        let monitor = DiskSpaceMonitor(
+            path: FileManager.default.temporaryDirectory,
+            logger: Logger(label: "test.disk"),
+            watermarks: { DiskSpaceMonitor.Watermarks(high: 95, low: 90) },
+            onTransition: { underPressure, _ in transitions.withLockedValue { $0.append(underPressure) } }
+        )
+
+        monitor.record(sample(usedPercent: 94))
+        XCTAssertFalse(monitor.isUnderPressure)
+        monitor.record(sample(usedPercent: 95))
+        XCTAssertTrue(monitor.isUnderPressure)
+        monitor.record(sample(usedPercent: 92))
+        XCTAssertTrue(monitor.isUnderPressure, "stays raised between the watermarks")
+        monitor.record(sample(usedPercent: 89))
+        XCTAssertFalse(monitor.isUnderPressure)
+        monitor.record(sample(usedPercent: 93))
+        XCTAssertFalse(monitor.isUnderPressure, "does not re-arm below the high watermark")
+
+        XCTAssertEqual(transitions.withLockedValue { $0 }, [true, false])
+        XCTAssertEqual(monitor.currentSample, sample(usedPercent: 93))
+    }
+
+    func testWatermarksAreClamped() {
+        XCTAssertEqual(DiskSpaceMonitor.Watermarks(high: 150, low: 120), DiskSpaceMonitor.Watermarks(high: 100, low: 100))
+        XCTAssertEqual(DiskSpaceMonitor.Watermarks(high: 80, low: 90).low, 80)
+        XCTAssertEqual(DiskSpaceMonitor.Watermarks(high: 0, low: -5), DiskSpaceMonitor.Watermarks(high: 1, low: 1))
+    }
+
+    func testSamplesQueueVolumeAndClassifiesErrors() {
+        let sample = DiskSpaceMonitor.sample(at: FileManager.default.temporaryDirectory)
+        XCTAssertNotNil(sample)
+        XCTAssertGreaterThan(sample?.totalBytes ?? 0, 0)
+
+        XCTAssertTrue(DiskSpaceMonitor.isCritical(queue: "WhosWho"))
+        XCTAssertFalse(DiskSpaceMonitor.isCritical(queue: "INBOX"))
+        XCTAssertTrue(DiskSpaceMonitor.isOutOfSpace(BoxStoreError.io(CocoaError(.fileWriteOutOfSpace))))
+        XCTAssertTrue(DiskSpaceMonitor.isOutOfSpace(NSError(domain: NSPOSIXErrorDomain, code: Int(ENOSPC))))
+        XCTAssertFalse(DiskSpaceMonitor.isOutOfSpace(BoxStoreError.io(CocoaError(.fileNoSuchFile))))
+    }
+}
@@ -0,0 +1,82 @@
+import BoxCore
+import Foundation
+import Logging
+import XCTest
+@testable import BoxServer
+
+final class QueueDirectoryWatcherTests: XCTestCase {
+    func testParseEventsDecodesPaddedNames() {
+        var bytes: [UInt8] = []
+        bytes += event(watch: 3, mask: QueueDirectoryWatcher.Inotify.movedTo, name: "20251017T143015Z-0F2B6F6A-0000-0000-0000-000000000001.json")
+        bytes += event(watch: 1, mask: QueueDirectoryWatcher.Inotify.create | QueueDirectoryWatcher.Inotify.isDirectory, name: "photos")
+        bytes += event(watch: 3, mask: QueueDirectoryWatcher.Inotify.overflow, name: nil)
+
+        let events = QueueDirectoryWatcher.parseEvents(bytes)
+        XCTAssertEqual(events, [
+            QueueDirectoryWatcher.Event(watch: 3, mask: QueueDirectoryWatcher.Inotify.movedTo, name: "20251017T143015Z-0F2B6F6A-0000-0000-0000-000000000001.json"),
+            QueueDirectoryWatcher.Event(watch: 1, mask: QueueDirectoryWatcher.Inotify.create | QueueDirectoryWatcher.Inotify.isDirectory, name: "photos"),
+            QueueDirectoryWatcher.Event(watch: 3, mask: QueueDirectoryWatcher.Inotify.overflow, name: "")
+        ])
+    }
+
+    func testParseEventsStopsAtTruncatedRecord() {
+        var bytes = event(watch: 2, mask: QueueDirectoryWatcher.Inotify.delete, name: "a.json")
+        bytes += Array(event(watch: 2, mask: QueueDirectoryWatcher.Inotify.delete, name: "b.json").prefix(20))
+
+        XCTAssertEqual(QueueDirectoryWatcher.parseEvents(bytes), [
+            QueueDirectoryWatcher.Event(watch: 2, mask: QueueDirectoryWatcher.Inotify.delete, name: "a.json")
+        ])
+    }
+
+#if os(Linux)
+    func testWatcherAppliesChangesFromAnotherInstanceAndSettlesTheDirectoryDate() async throws {
+        let temporaryDirectory = FileManager.default.temporaryDirectory.appendingPathComponent("box-watcher-\(UUID().uuidString)", isDirectory: true)
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let other = try await BoxServerStore(root: temporaryDirectory)
+        let first = try await store.put(makeObject(createdAt: Date(timeIntervalSinceNow: -10)), into: "INBOX")
+        _ = try await store.list(queue: "INBOX")
+
+        let watcher = QueueDirectoryWatcher(store: store, logger: Logger(label: "test.watcher"))
+        watcher.start()
+        defer { watcher.stop() }
+        try await waitUntil { await store.isWatching(queue: "INBOX") }
+
+        // A watched index is trusted without a date check: only the watcher can show this write.
+        let second = try await other.put(makeObject(), into: "INBOX")
+        try await waitUntil { (try? await store.list(queue: "INBOX").map(\.id)) == [first, second] }
+        let queueDirectory = temporaryDirectory.appendingPathComponent("INBOX", isDirectory: true)
+        try await waitUntil {
+            (try? await store.indexVersion(of: "INBOX").directoryModifiedAt) == BoxQueueIndex.modificationDate(of: queueDirectory)
+        }
+
+        try await other.remove(queue: "INBOX", id: first)
+        try await waitUntil { (try? await store.list(queue: "INBOX").map(\.id)) == [second] }
+    }
+
+    private func makeObject(createdAt: Date = Date()) -> BoxStoredObject {
+        BoxStoredObject(contentType: "text/plain", data: Array("watched".utf8), createdAt: createdAt, nodeId: UUID(), userId: UUID())
+    }
+
+    private func waitUntil(_ condition: () async -> Bool) async throws {
+        for _ in 0..<500 {
+            if await condition() { return }
+            try await Task.sleep(nanoseconds: 10_000_000)
+        }
+        XCTFail("condition not met in time")
+    }
+#endif
+
+    /// Lays out a `struct inotify_event` in host byte order, its name NUL-padded to 16 bytes.
+    private func event(watch: Int32, mask: UInt32, name: String?) -> [UInt8] {
+        var nameBytes = name.map { Array($0.utf8) } ?? []
+        if !nameBytes.isEmpty {
+            nameBytes += [UInt8](repeating: 0, count: 16 - nameBytes.count % 16)
+        }
+        var bytes: [UInt8] = []
+        for value in [UInt32(bitPattern: watch), mask, 0, UInt32(nameBytes.count)] {
+            withUnsafeBytes(of: value) { bytes += $0 }
+        }
+        return bytes + nameBytes
+    }
+}
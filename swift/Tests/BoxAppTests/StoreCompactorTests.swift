@@ -0,0 +1,114 @@
+import BoxCore
+import Foundation
+import Logging
+import XCTest
+@testable import BoxServer
+
+final class StoreCompactorTests: XCTestCase {
+    private func makeTemporaryDirectory() throws -> URL {
+        let url = FileManager.default.temporaryDirectory.appendingPathComponent("box-compact-\(UUID().uuidString)", isDirectory: true)
+        try FileManager.default.createDirectory(at: url, withIntermediateDirectories: true)
+        return url
+    }
+
+    private func makeObject(bytes: Int = 16, createdAt: Date = Date()) -> BoxStoredObject {
+        BoxStoredObject(contentType: "application/octet-stream", data: [UInt8](repeating: 0x42, count: bytes), createdAt: createdAt, nodeId: UUID(), userId: UUID())
+    }
+
+    func testCompactionKeepsLiveEntriesAndReclaimsLeftovers() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let fileManager = FileManager.default
+        let store = try await BoxServerStore(root: temporaryDirectory)
+
+        var ids: [UUID] = []
+        for index in 0..<1_500 {
+            ids.append(try await store.put(makeObject(createdAt: Date(timeIntervalSinceNow: Double(index - 2_000))), into: "INBOX"))
+        }
+        for id in ids.dropLast(5) {
+            try await store.remove(queue: "INBOX", id: id)
+        }
+        let media = try await store.put(makeObject(bytes: 4_096), into: "media")
+        let inUse = BoxContentDigest(of: makeObject(bytes: 4_096).data)
+
+        // Leftovers of a crash: a temporary file of an interrupted write, and a blob no entry links to.
+        let partial = temporaryDirectory.appendingPathComponent("INBOX/partial.tmp")
+        fileManager.createFile(atPath: partial.path, contents: Data(repeating: 1, count: 100))
+        try fileManager.setAttributes([.modificationDate: Date(timeIntervalSinceNow: -7_200)], ofItemAtPath: partial.path)
+        let orphan = BoxContentDigest(of: [1, 2, 3])
+        let orphanURL = temporaryDirectory.appendingPathComponent(".blobs/\(orphan.hex.prefix(2))/\(orphan.hex)")
+        try fileManager.createDirectory(at: orphanURL.deletingLastPathComponent(), withIntermediateDirectories: true)
+        fileManager.createFile(atPath: orphanURL.path, contents: Data(repeating: 2, count: 50))
+
+        let footprint = try await store.directoryFootprint(of: "INBOX")
+        let sparse = footprint.bytes >= StoreCompactor.minimumDirectoryBytes
+            && footprint.bytes > Int64(footprint.entries) * StoreCompactor.bytesPerEntryThreshold
+
+        let compactor = StoreCompactor(store: store, logger: Logger(label: "test.compactor"), pause: 0)
+        let started = await compactor.start(queue: nil)
+        XCTAssertEqual(started.state, .running)
+        await compactor.wait()
+        let progress = await compactor.progress()
+        XCTAssertEqual(progress.state, .completed)
+        XCTAssertEqual(progress.queuesDone, progress.queuesTotal)
+        XCTAssertEqual(progress.directoriesRebuilt, sparse ? 1 : 0)
+        XCTAssertGreaterThanOrEqual(progress.bytesReclaimed, 150)
+
+        let listed = try await store.list(queue: "INBOX").map(\.id)
+        XCTAssertEqual(listed, Array(ids.suffix(5)))
+        let read = try await store.read(queue: "media", id: media)
+        XCTAssertEqual(read.data, makeObject(bytes: 4_096).data)
+        let references = await store.blobReferenceCount(for: inUse)
+        XCTAssertEqual(references, 1, "a blob in use is kept")
+        XCTAssertFalse(fileManager.fileExists(atPath: partial.path))
+        XCTAssertFalse(fileManager.fileExists(atPath: orphanURL.path))
+        XCTAssertFalse(fileManager.fileExists(atPath: temporaryDirectory.appendingPathComponent(".compact/INBOX.old").path))
+    }
+
+    func testRemoveOrphanBlobsSkipsBlobsStillLinked() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let store = try await BoxServerStore(root: temporaryDirectory)
+        let id = try await store.put(makeObject(bytes: 2_048), into: "media")
+        let digest = BoxContentDigest(of: makeObject(bytes: 2_048).data)
+
+        let candidates = store.orphanBlobCandidates().flatMap { $0 }
+        XCTAssertEqual(candidates.map(\.lastPathComponent), [digest.hex])
+        let reclaimed = await store.removeOrphanBlobs(candidates)
+        XCTAssertEqual(reclaimed, 0)
+        let read = try await store.read(queue: "media", id: id)
+        XCTAssertEqual(read.id, id)
+
+        try await store.remove(queue: "media", id: id)
+        XCTAssertEqual(store.orphanBlobCandidates().flatMap { $0 }, [], "the last release removes the blob itself")
+    }
+
+    func testStartupRestoresADirectorySwappedAwayByAnInterruptedCompaction() async throws {
+        let temporaryDirectory = try makeTemporaryDirectory()
+        defer { try? FileManager.default.removeItem(at: temporaryDirectory) }
+        let fileManager = FileManager.default
+        let area = temporaryDirectory.appendingPathComponent(BoxServerStore.compactionDirectoryName, isDirectory: true)
+        var inbox: [UUID] = []
+        do {
+            let store = try await BoxServerStore(root: temporaryDirectory)
+            for _ in 0..<3 {
+                inbox.append(try await store.put(makeObject(), into: "INBOX"))
+            }
+            _ = try await store.put(makeObject(), into: "media")
+        }
+
+        // INBOX crashed between its two renames; media crashed after its swap, before its drain.
+        try fileManager.createDirectory(at: area, withIntermediateDirectories: true)
+        try fileManager.moveItem(at: temporaryDirectory.appendingPathComponent("INBOX"), to: area.appendingPathComponent("INBOX.old"))
+        try fileManager.createDirectory(at: area.appendingPathComponent("INBOX.new"), withIntermediateDirectories: true)
+        try fileManager.createDirectory(at: area.appendingPathComponent("media.old"), withIntermediateDirectories: true)
+        fileManager.createFile(atPath: area.appendingPathComponent("media.old/stale.json").path, contents: Data("{}".utf8))
+
+        let restarted = try await BoxServerStore(root: temporaryDirectory)
+        let listed = try await restarted.list(queue: "INBOX").map(\.id)
+        XCTAssertEqual(Set(listed), Set(inbox))
+        let media = try await restarted.list(queue: "media")
+        XCTAssertEqual(media.count, 1, "a directory already swapped in is kept")
+        XCTAssertFalse(fileManager.fileExists(atPath: area.path))
+    }
+}